@@ -0,0 +1,234 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include "modules/util.h"
+
+// rows generated and written at once, so images larger than the memory can be created
+#define GENERATOR_STRIP_ROWS 64
+
+typedef enum {
+    PATTERN_NOISE,              // every channel uniformly distributed in [0, 255]
+    PATTERN_GRADIENT,           // red along x, green along y, blue along the diagonal
+    PATTERN_LOW_VARIANCE,       // every channel in [120, 135], like testing/in/valid/lowVariance.ppm
+    PATTERN_SATURATED,          // every channel either 0 or 255
+} Pattern;
+
+
+/**
+ * @brief Returns the next value of a xorshift64* generator.
+ *
+ * @param state Pointer to the state of the generator, must not be zero.
+ *
+ * @return 64 pseudo random bits.
+ */
+
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+
+/**
+ * @brief Fills one row of rgb values with a pattern.
+ *
+ * @param pattern The pattern.
+ * @param row Pointer to 3 * width bytes.
+ * @param y Index of the row.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param state State of the random generator.
+ */
+
+static void fill_row(Pattern pattern, uint8_t *row, size_t y, size_t width, size_t height, uint64_t *state) {
+    size_t x = 0;
+    switch (pattern) {
+        case PATTERN_NOISE:
+            // eight random bytes per step
+            for (; x + 8 <= 3 * width; x += 8) {
+                uint64_t bits = next_random(state);
+                memcpy(row + x, &bits, 8);
+            }
+            for (; x < 3 * width; x++) {
+                row[x] = (uint8_t) next_random(state);
+            }
+            break;
+        case PATTERN_GRADIENT:
+            for (; x < width; x++) {
+                row[3 * x] = (uint8_t) (width > 1 ? 255 * x / (width - 1) : 0);
+                row[3 * x + 1] = (uint8_t) (height > 1 ? 255 * y / (height - 1) : 0);
+                row[3 * x + 2] = (uint8_t) (width + height > 2 ? 255 * (x + y) / (width + height - 2) : 0);
+            }
+            break;
+        case PATTERN_LOW_VARIANCE:
+            for (; x < 3 * width; x++) {
+                row[x] = (uint8_t) (120 + (next_random(state) >> 60));
+            }
+            break;
+        case PATTERN_SATURATED:
+            for (; x < 3 * width; x++) {
+                row[x] = (next_random(state) >> 63) ? 255 : 0;
+            }
+            break;
+    }
+}
+
+
+/**
+ * @brief Writes rows of rgb values as ascii samples.
+ *
+ * @param fp The file.
+ * @param strip Pointer to the rows.
+ * @param three_width Number of samples per row.
+ * @param rows Number of rows.
+ *
+ * @return 1 on success, 0 if the file could not be written.
+ */
+
+static int write_plain_rows(FILE *fp, const uint8_t *strip, size_t three_width, size_t rows) {
+    for (size_t i = 0; i < rows * three_width; i++) {
+        char separator = (i + 1) % three_width ? ' ' : '\n';
+        if (fprintf(fp, "%u%c", strip[i], separator) < 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Prints the usage of the generator.
+ */
+
+static void print_usage(void) {
+    printf("Usage:\n"
+           "  create_ppm_image.out -w <width> -h <height> [-p <pattern>] [-s <seed>] [-a] [-o <file>]\n\n"
+           "Options:\n"
+           "  -w <val>\t Width of the image.\n"
+           "  -h <val>\t Height of the image.\n"
+           "  -p <name>\t noise, gradient, lowvariance or saturated (default: noise).\n"
+           "  -s <val>\t Seed of the random patterns (default: 1).\n"
+           "  -a\t\t Write a plain image (P3) with ascii samples, one row per line.\n"
+           "  -o <file>\t Output file path (default: image.ppm).\n\n"
+           "Creates a P6 or P3 image with the given size and content distribution.\n");
+}
+
+
+/**
+ * @brief Main function of the image generator.
+ */
+
+int main(int argc, char **argv) {
+
+    int opt;
+    long width = 0;
+    long height = 0;
+    long seed = 1;
+    Pattern pattern = PATTERN_NOISE;
+    int plain = 0;
+    char *output_filename = "image.ppm";
+
+    while ((opt = getopt(argc, argv, "w:h:p:s:ao:")) != -1) {
+        switch (opt) {
+            case 'w':
+                if (!stringToLong(optarg, &width) || width <= 0) {
+                    fprintf(stderr, "Invalid image width: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'h':
+                if (!stringToLong(optarg, &height) || height <= 0) {
+                    fprintf(stderr, "Invalid image height: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'p':
+                if (!strcmp(optarg, "noise")) {
+                    pattern = PATTERN_NOISE;
+                } else if (!strcmp(optarg, "gradient")) {
+                    pattern = PATTERN_GRADIENT;
+                } else if (!strcmp(optarg, "lowvariance")) {
+                    pattern = PATTERN_LOW_VARIANCE;
+                } else if (!strcmp(optarg, "saturated")) {
+                    pattern = PATTERN_SATURATED;
+                } else {
+                    fprintf(stderr, "Unknown pattern '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 's':
+                if (!stringToLong(optarg, &seed)) {
+                    fprintf(stderr, "Invalid seed: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'a':
+                plain = 1;
+                break;
+            case 'o':
+                output_filename = optarg;
+                break;
+            default:
+                print_usage();
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (!width || !height) {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    // the image has to be readable by main.out
+    size_t three_width;
+    size_t pixel_bytes;
+    if (__builtin_umull_overflow(3, (size_t) width, &three_width) ||
+        __builtin_umull_overflow(three_width, (size_t) height, &pixel_bytes)) {
+        fprintf(stderr, "Image too big\n");
+        return EXIT_FAILURE;
+    }
+
+    FILE *fp = fopen(output_filename, "wb");
+    if (!fp) {
+        fprintf(stderr, "Unable to open file '%s' for writing\n", output_filename);
+        return EXIT_FAILURE;
+    }
+
+    uint8_t *strip = malloc(three_width * GENERATOR_STRIP_ROWS);
+    if (!strip) {
+        fprintf(stderr, "Unable to allocate memory for strip\n");
+        fclose(fp);
+        return EXIT_FAILURE;
+    }
+
+    // the state of xorshift must not be zero
+    uint64_t state = (uint64_t) seed * 0x9E3779B97F4A7C15ULL + 1;
+    if (!state) {
+        state = 1;
+    }
+
+    int success = fprintf(fp, "%s\n%ld %ld\n255\n", plain ? "P3" : "P6", width, height) > 0;
+    for (size_t y = 0; success && y < (size_t) height; y += GENERATOR_STRIP_ROWS) {
+        size_t rows = (size_t) height - y < GENERATOR_STRIP_ROWS ? (size_t) height - y : GENERATOR_STRIP_ROWS;
+        for (size_t r = 0; r < rows; r++) {
+            fill_row(pattern, strip + r * three_width, y + r, (size_t) width, (size_t) height, &state);
+        }
+        if (plain) {
+            success = write_plain_rows(fp, strip, three_width, rows);
+        } else {
+            success = fwrite(strip, three_width, rows, fp) == rows;
+        }
+    }
+
+    free(strip);
+    if (fclose(fp) || !success) {
+        fprintf(stderr, "Error writing image data to '%s'\n", output_filename);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
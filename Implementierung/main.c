@@ -3,260 +3,30 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <getopt.h>
+#include <limits.h>
 #include <string.h>
 #include <time.h>
 #include <math.h>
-#include "modules/brightness_contrast.h"
-#include "modules/brightness_contrast_sse.h"
+#include <unistd.h>
+#include "modules/autotune.h"
+#include "modules/batch.h"
+#include "modules/benchmark.h"
+#include "modules/brightness_contrast_opencl.h"
+#include "modules/brightness_contrast_simd.h"
+#include "modules/buffer_pool.h"
+#include "modules/daemon.h"
+#include "modules/dispatch.h"
+#include "modules/frames.h"
+#include "modules/instrument.h"
+#include "modules/jpeg.h"
+#include "modules/mapped_io.h"
+#include "modules/ppm.h"
+#include "modules/roi.h"
+#include "modules/downscale.h"
+#include "modules/variants.h"
+#include "modules/stream.h"
 #include "modules/util.h"
-
-
-typedef struct {
-    size_t width, height;
-    uint8_t *data;
-} PPMImage;
-
-/**
- * @brief Reads a PPM image from a file.
- *
- * @param filename The path to the PPM file to be read.
- *
- * @return A pointer to a dynamically allocated PPMImage structure containing
- *         the image data. If the file cannot be opened, is not in the correct
- *         format, or if there is a memory allocation failure, the program
- *         will terminate with an error message.
- *
- * This function opens a PPM file and reads its contents into a PPMImage structure.
- * The function expects the PPM file to be in the P6 format.
- * It performs several checks to ensure the format is correct, including checking
- * the file header (must be 'P6'), the image dimensions, and the maximum color value.
- * The function handles whitespace and comments in the PPM file format.
- */
-
-PPMImage *readPPM(const char *filename) {
-
-    int buflen = 64;
-    char buffer[buflen];
-    PPMImage *img;
-    FILE *fp;
-    long maxval = -1;
-
-
-    // open file
-    fp = fopen(filename, "rb");
-    if (!fp) {
-        fprintf(stderr, "Unable to open file '%s'\n", filename);
-        exit(EXIT_FAILURE);
-    }
-
-    img = (PPMImage *) malloc(sizeof(PPMImage));
-    if (!img) {
-        fprintf(stderr, "Failed to allocate memeory for image\n");
-        fclose(fp);
-        exit(EXIT_FAILURE);
-    }
-    // load file format into buffer and ignore comments
-    char curr = 'x';            // Current character
-    int numWP = 0;                // Number of whitespaces read. Concurrent whitespaces are counted as 1
-    int token_switch = 0;        // 0: currently reading token 1: between tokens
-
-    for (int i = 0; i < buflen - 1 || numWP >= 3; ++i) {
-        if (!fread(&curr, 1, 1, fp)) {
-            fprintf(stderr, "Error reading file.\n");
-            free(img);
-            fclose(fp);
-            exit(EXIT_FAILURE);
-        }
-
-        if (token_switch) {
-            if (curr == ' ' || curr == '\t' || curr == '\r' || curr == '\n') {
-                // Whitespace character between tokens are ignored, writing index has to be 0 in next round
-                i = -1;
-            } else if (curr == '#') {
-                // Ignore comment and decrement writing index
-                while (curr != '\r' && curr != '\n') {
-                    if (!fread(&curr, 1, 1, fp)) {
-                        fprintf(stderr, "Error reading file.\n");
-                        free(img);
-                        fclose(fp);
-                        exit(EXIT_FAILURE);
-                    }
-                }
-                i = -1;
-            } else {
-                // Whitespace between tokens has ended. Start reading token
-                token_switch = 0;
-            }
-        }
-        // continue to next iteration if still between tokens
-        if (token_switch) {
-            continue;
-        }
-
-        if (curr == '#') {
-            // Ignore everything in the comment
-
-            while (curr != '\r' && curr != '\n') {
-                if (!fread(&curr, 1, 1, fp)) {
-                    fprintf(stderr, "Error reading file.\n");
-                    free(img);
-                    fclose(fp);
-                    exit(EXIT_FAILURE);
-                }
-            }
-            i--;
-        } else {
-
-            if (curr == ' ' || curr == '\t' || curr == '\r' || curr == '\n') {    //token has ended
-
-                buffer[i] = '\0';
-                if (numWP == 0) {    //current token: image format
-
-                    if (buffer[0] != 'P' || buffer[1] != '6') {
-                        fprintf(stderr, "Format of ppm must be P6\n");
-                        free(img);
-                        fclose(fp);
-                        exit(EXIT_FAILURE);
-                    }
-                } else if (numWP == 1) {    //current token: width
-
-                    long width;
-                    int check = stringToLong(buffer, &width);
-                    if (!check || width <= 0) {
-                        fprintf(stderr, "Invalid image width\n");
-                        fclose(fp);
-                        free(img);
-                        exit(EXIT_FAILURE);
-                    }
-                    img->width = (size_t) width;
-                } else if (numWP == 2) {    //current token: height
-                    long height;
-                    int check = stringToLong(buffer, &height);
-                    if (!check || height <= 0) {
-                        fprintf(stderr, "Invalid image height\n");
-                        fclose(fp);
-                        free(img);
-                        exit(EXIT_FAILURE);
-                    }
-                    img->height = (size_t) height;
-                } else if (numWP == 3) {    // curent token: maximum_value
-
-                    if (stringToLong(buffer, &maxval) != 1) {
-                        fprintf(stderr, "Invalid max color value (error loading '%s')\n", filename);
-                        fclose(fp);
-                        free(img);
-                        exit(EXIT_FAILURE);
-                    }
-                    if (maxval >= 256 || maxval <= 0) {
-                        fprintf(stderr, "Invalid maximum value\n");
-                        fclose(fp);
-                        free(img);
-                        exit(EXIT_FAILURE);
-                    }
-                    break;
-
-                } else {
-                    fprintf(stderr, "Error parsing image\n");
-                    fclose(fp);
-                    free(img);
-                    exit(EXIT_FAILURE);
-                }
-
-                token_switch = 1;        // token has ended
-                i = -1;
-                numWP++;
-            } else {
-                buffer[i] = curr;
-            }
-        }
-    }
-    //check if 4 tokens have been parsed (P6, width, height, maxval)
-    if (numWP != 3) {
-        fprintf(stderr, "Image format corrupted\n");
-        fclose(fp);
-        free(img);
-        exit(EXIT_FAILURE);
-    }
-
-    // check for overflow: 3*width*height
-    size_t three_height;
-    size_t pix_mem_size;
-    if (__builtin_umull_overflow(3, img->height, &three_height)) {
-        fprintf(stderr, "Image too big\n");
-        fclose(fp);
-        free(img);
-        exit(EXIT_FAILURE);
-    }
-    if (__builtin_umull_overflow(three_height, img->width, &pix_mem_size)) {
-        fprintf(stderr, "image too big\n");
-        fclose(fp);
-        free(img);
-        exit(EXIT_FAILURE);
-    }
-
-    // allocate memory for rgb values
-    img->data = (uint8_t *) malloc(pix_mem_size);
-
-    if (!img->data) {
-        fprintf(stderr, "Unable to allocate memory for image\n");
-        fclose(fp);
-        free(img);
-        exit(EXIT_FAILURE);
-    }
-
-    // load rgb values into img->data
-    if (fread(img->data, three_height, img->width, fp) != img->width) {
-        fprintf(stderr, "Error loading image data from '%s'\n", filename);
-        fclose(fp);
-        free(img->data);
-        free(img);
-        exit(EXIT_FAILURE);
-    }
-
-    fclose(fp);
-    return img;
-}
-
-/**
- * @brief Writes a PGM image to a file.
- *
- * @param output_filename The path where the PGM file will be written.
- * @param pixels Pointer to the array of pixels that constitute the image.
- * @param width The width of the image.
- * @param height The height of the image.
- *
- * This function creates a PGM file and writes the image data into it.
- * The image is written in P5 format. In case of failure to open the file for writing,
- * the program terminates with an error message.
- */
-int writePGM(const char *output_filename, const uint8_t *pixels, size_t width, size_t height) {
-    FILE *fp;
-
-    fp = fopen(output_filename, "wb");
-
-    if (fp == NULL) {
-        fprintf(stderr, "Unable to open file '%s' for writing\n", output_filename);
-        return 0;
-    }
-
-    fprintf(fp, "P5\n%zu %zu\n255\n", width, height);
-
-    // overflow checked already
-    fwrite(pixels, sizeof(uint8_t), width * height, fp);
-    fclose(fp);
-    return 1;
-}
-
-/**
- * @brief Frees the memory allocated for a PPMImage structure.
- *
- * @param img Pointer to the PPMImage structure to be freed.
- */
-
-void freePPM(PPMImage *img) {
-    free(img->data);
-    free(img);
-}
+#include "modules/cli.h"
 
 
 /**
@@ -267,7 +37,43 @@ int main(int argc, char **argv) {
 
     int opt;
     int V_option = 0;
+    int auto_version = 1;                       // choose the version from the autotune profile if there is one
+    int version_given = 0;
     int B_option = 0;
+    int threads = (int) sysconf(_SC_NPROCESSORS_ONLN);   // number of threads for version 3
+    int threads_given = 0;
+    int isa_given = 0;
+    int stream = 0;                             // convert the image strip by strip
+    int strip_rows = 0;                         // 0 lets the stream mode choose the strip height
+    int use_mmap = 0;                           // map input and output instead of copying them
+    int batch = 0;                              // convert every positional argument and manifest entry
+    char *manifest_filename = NULL;             // "-" reads the manifest from stdin
+    BatchIo batch_io = BATCH_IO_STDIO;          // how the batch reads and writes its files
+    int io_given = 0;
+    int output_given = 0;
+    int warmup = 1;                             // unmeasured iterations before -B
+    int flush_cache = 0;                        // evict the caches before every measured iteration
+    int json = 0;                               // print -B results as JSON
+    int pgm16 = 0;                              // keep the maximum value of 16 bit images in the output
+    int precise = 0;                            // reproduce the results of version 1 with version 0
+    long nontemporal;                           // pixels from which the grey values bypass the caches
+    int nontemporal_given = 0;
+    long gpu_threshold;                         // pixels from which version 4 converts on the GPU
+    int gpu_threshold_given = 0;
+    int run_autotune = 0;                       // measure the versions and save the profile of this host
+    char *profile_filename = NULL;              // NULL for the profile of this host, see default_profile_path()
+    int frames = 0;                             // convert concatenated frames from stdin to stdout
+    int previous_contrast = 0;                  // adjust the contrast of a frame with the previous one
+    long sample_rate = 0;                       // estimate the statistics from one of every sample_rate blocks
+    int use_region = 0;                         // convert only the region of interest
+    Region region;
+    int region_statistics = 0;                  // adjust the contrast with the statistics of the region
+    int downscale = 0;                          // reduce the image by this factor, 0 keeps its size
+    char *variant_specs[VARIANTS_MAX];          // parameter sets converted from one decode of the input
+    size_t num_variants = 0;
+    char *daemon_socket = NULL;                 // serve conversion requests on this socket
+    char *connect_socket = NULL;                // let the daemon on this socket convert the image
+    int query_metrics = 0;                      // print the metrics of the daemon instead
     int brightness = 0;
     int tmp_contrast;
     float contrast = NAN;                       // nan if user does not what to adjust the contrast
@@ -279,22 +85,53 @@ int main(int argc, char **argv) {
     coeffs[1] = 0.7109375;                      // standard coeff b
     coeffs[2] = 0.07421875;                     // standard coeff c
 
+    if (threads < 1) {
+        // sysconf failed, fall back to a single thread
+        threads = 1;
+    }
+
     struct option long_options[] = {
             {"coeffs",     required_argument, 0, 'c'},
             {"brightness", required_argument, 0, 'b'},
             {"contrast",   required_argument, 0, 'k'},
+            {"isa",        required_argument, 0, 'i'},
+            {"stream",     optional_argument, 0, 's'},
+            {"mmap",       no_argument,       0, 'm'},
+            {"batch",      optional_argument, 0, 'a'},
+            {"io-uring",   optional_argument, 0, 'U'},
+            {"warmup",     required_argument, 0, 'w'},
+            {"flush-cache", no_argument,      0, 'f'},
+            {"json",       no_argument,       0, 'j'},
+            {"pgm16",      no_argument,       0, 'p'},
+            {"precise",    no_argument,       0, 'q'},
+            {"nontemporal", required_argument, 0, 'n'},
+            {"gpu-threshold", required_argument, 0, 'G'},
+            {"frames",     no_argument,       0, 'F'},
+            {"previous-contrast", no_argument, 0, 'P'},
+            {"sample",     required_argument, 0, 'S'},
+            {"roi",        required_argument, 0, 'R'},
+            {"roi-statistics", no_argument,   0, 'T'},
+            {"downscale",  required_argument, 0, 'Z'},
+            {"variant",    required_argument, 0, 'W'},
+            {"autotune",   no_argument,       0, 'A'},
+            {"profile",    required_argument, 0, 'L'},
+            {"daemon",     required_argument, 0, 'D'},
+            {"connect",    required_argument, 0, 'C'},
+            {"daemon-metrics", no_argument,   0, 'M'},
             {"help",       no_argument,       0, 'h'},
             {0, 0,                            0, 0}};
 
     while (1) {
-        opt = getopt_long(argc, argv, "V:B::o:h", long_options, NULL);
+        opt = getopt_long(argc, argv, "V:B::o:t:h", long_options, NULL);
         if (opt == -1) {
             break;
         }
 
         switch (opt) {
             case 'V':
-                if (!stringToInt(optarg, &V_option)) {
+                version_given = 1;
+                auto_version = !strcmp(optarg, "auto");
+                if (!auto_version && !stringToInt(optarg, &V_option)) {
                     fprintf(stderr, "Could not pass argument for option -V: %s\n", optarg);
                     return EXIT_FAILURE;
                 }
@@ -315,6 +152,15 @@ int main(int argc, char **argv) {
                 break;
             case 'o':
                 output_filename = optarg;
+                output_given = 1;
+                break;
+
+            case 't':
+                if (!stringToInt(optarg, &threads)) {
+                    fprintf(stderr, "Could not pass argument for option -t: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                threads_given = 1;
                 break;
 
             case 'h':
@@ -343,12 +189,360 @@ int main(int argc, char **argv) {
                 contrast = (float) tmp_contrast;
                 break;
 
+            case 'i':
+                if (!select_kernels(optarg)) {
+                    return EXIT_FAILURE;
+                }
+                isa_given = 1;
+                break;
+
+            case 's':
+                stream = 1;
+                if (optarg) {
+                    if (!stringToInt(optarg, &strip_rows) || strip_rows < 1) {
+                        fprintf(stderr, "Could not pass argument for option --stream: %s\n", optarg);
+                        return EXIT_FAILURE;
+                    }
+                }
+                break;
+
+            case 'm':
+                use_mmap = 1;
+                break;
+
+            case 'a':
+                batch = 1;
+                manifest_filename = optarg;
+                break;
+
+            case 'U':
+                if (optarg && strcmp(optarg, "direct")) {
+                    fprintf(stderr, "Could not pass argument for option --io-uring: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                batch_io = optarg ? BATCH_IO_URING_DIRECT : BATCH_IO_URING;
+                io_given = 1;
+                break;
+
+            case 'w':
+                if (!stringToInt(optarg, &warmup) || warmup < 0) {
+                    fprintf(stderr, "Could not pass argument for option --warmup: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'f':
+                flush_cache = 1;
+                break;
+
+            case 'j':
+                json = 1;
+                break;
+
+            case 'p':
+                pgm16 = 1;
+                break;
+
+            case 'q':
+                precise = 1;
+                break;
+
+            case 'n':
+                if (!stringToLong(optarg, &nontemporal) || nontemporal < 0) {
+                    fprintf(stderr, "Could not pass argument for option --nontemporal: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                set_nontemporal_threshold((size_t) nontemporal);
+                nontemporal_given = 1;
+                break;
+
+            case 'G':
+                if (!stringToLong(optarg, &gpu_threshold) || gpu_threshold < 0) {
+                    fprintf(stderr, "Could not pass argument for option --gpu-threshold: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                set_gpu_threshold((size_t) gpu_threshold);
+                gpu_threshold_given = 1;
+                break;
+
+            case 'F':
+                frames = 1;
+                break;
+
+            case 'P':
+                previous_contrast = 1;
+                break;
+
+            case 'S':
+                if (!stringToLong(optarg, &sample_rate) || sample_rate < 1) {
+                    fprintf(stderr, "Could not pass argument for option --sample: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'R':
+                if (!parseRegion(optarg, &region)) {
+                    return EXIT_FAILURE;
+                }
+                use_region = 1;
+                break;
+
+            case 'T':
+                region_statistics = 1;
+                break;
+
+            case 'Z':
+                if (!stringToInt(optarg, &downscale) || downscale < 1 || downscale > DOWNSCALE_MAX_FACTOR) {
+                    fprintf(stderr, "Could not pass argument for option --downscale: %s (1 to %d)\n", optarg,
+                            DOWNSCALE_MAX_FACTOR);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'W':
+                if (num_variants == VARIANTS_MAX) {
+                    fprintf(stderr, "Option --variant can be given at most %d times.\n", VARIANTS_MAX);
+                    return EXIT_FAILURE;
+                }
+                variant_specs[num_variants++] = optarg;
+                break;
+
+            case 'A':
+                run_autotune = 1;
+                break;
+
+            case 'L':
+                profile_filename = optarg;
+                break;
+
+            case 'D':
+                daemon_socket = optarg;
+                break;
+
+            case 'C':
+                connect_socket = optarg;
+                break;
+
+            case 'M':
+                query_metrics = 1;
+                break;
+
             case '?':
                 fprintf(stderr, "Error parsing options\n");
                 return EXIT_FAILURE;
         }
     }
 
+    if (precise && (V_option != 0 || stream || batch)) {
+        fprintf(stderr, "Option --precise is only available for version 0 without --stream and --batch.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (region_statistics && !use_region) {
+        fprintf(stderr, "Option --roi-statistics is only available with --roi.\n");
+        return EXIT_FAILURE;
+    }
+    if (use_region && (V_option != 0 || stream || batch || frames || precise || sample_rate)) {
+        fprintf(stderr, "Option --roi is only available for version 0 without --stream, --batch, --frames, --precise and --sample.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (downscale && (V_option != 0 || stream || batch || frames || precise || sample_rate || use_region)) {
+        fprintf(stderr, "Option --downscale is only available for version 0 without --stream, --batch, --frames, --precise, --sample and --roi.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (num_variants && (V_option != 0 || B_option || stream || use_mmap || batch || frames || precise || sample_rate ||
+                         use_region || downscale || output_given)) {
+        fprintf(stderr, "Option --variant is only available for version 0 without -B, -o, --stream, --mmap, --batch, --frames, --precise, --sample, --roi and --downscale.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (sample_rate && (V_option != 0 || stream || batch || frames || precise)) {
+        fprintf(stderr, "Option --sample is only available for version 0 without --stream, --batch, --frames and --precise.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (io_given && !batch) {
+        fprintf(stderr, "Option --io-uring is only available with --batch.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (previous_contrast && !frames) {
+        fprintf(stderr, "Option --previous-contrast is only available with --frames.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (daemon_socket || connect_socket) {
+        if (V_option != 0 || B_option || stream || use_mmap || batch || frames || precise || sample_rate || use_region ||
+            downscale || num_variants || run_autotune) {
+            fprintf(stderr, "Options --daemon and --connect are only available for version 0 without -B, --stream, --mmap, --batch, --frames, --precise, --sample, --roi, --downscale, --variant and --autotune.\n");
+            return EXIT_FAILURE;
+        }
+        if (daemon_socket && connect_socket) {
+            fprintf(stderr, "Options --daemon and --connect can not be combined.\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (query_metrics && !connect_socket) {
+        fprintf(stderr, "Option --daemon-metrics is only available with --connect.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (daemon_socket) {
+        if (optind < argc) {
+            fprintf(stderr, "Option --daemon takes no input files.\n");
+            return EXIT_FAILURE;
+        }
+        if (!checkParams(V_option, B_option, threads, daemon_socket, output_filename, coeffs[0], coeffs[1],
+                         coeffs[2], brightness, contrast)) {
+            return EXIT_FAILURE;
+        }
+        return run_daemon(daemon_socket, coeffs[0], coeffs[1], coeffs[2], brightness, contrast, threads)
+               ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (query_metrics) {
+        if (optind < argc) {
+            fprintf(stderr, "Option --daemon-metrics takes no input files.\n");
+            return EXIT_FAILURE;
+        }
+        int connection = daemon_connect(connect_socket);
+        DaemonMetrics metrics;
+        int exec_res = connection >= 0 && daemon_metrics(connection, &metrics);
+        if (connection >= 0) {
+            close(connection);
+        }
+        if (exec_res) {
+            print_daemon_metrics(stdout, &metrics);
+        }
+        return exec_res ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (run_autotune) {
+        if (version_given || stream || use_mmap || batch || frames || precise || sample_rate || use_region ||
+            downscale || num_variants || output_given) {
+            fprintf(stderr, "Option --autotune is only available without -V, -o, --stream, --mmap, --batch, --frames, --precise, --sample, --roi, --downscale and --variant.\n");
+            return EXIT_FAILURE;
+        }
+        if (optind < argc) {
+            fprintf(stderr, "Option --autotune takes no input files.\n");
+            return EXIT_FAILURE;
+        }
+        char default_path[PATH_MAX];
+        if (!profile_filename && !default_profile_path(default_path, sizeof(default_path))) {
+            fprintf(stderr, "Neither XDG_CONFIG_HOME nor HOME is set, choose the profile with --profile.\n");
+            return EXIT_FAILURE;
+        }
+        if (!checkParams(V_option, B_option, threads, profile_filename ? profile_filename : default_path,
+                         output_filename, coeffs[0], coeffs[1], coeffs[2], brightness, contrast)) {
+            return EXIT_FAILURE;
+        }
+
+        // -B sets the iterations per candidate and size
+        BenchmarkConfig config = {B_option ? B_option : AUTOTUNE_ITERATIONS, warmup, flush_cache};
+        TuneProfile profile;
+        if (!autotune(&config, threads, coeffs[0], coeffs[1], coeffs[2], brightness, contrast, &profile) ||
+            !save_profile(profile_filename ? profile_filename : default_path, &profile)) {
+            return EXIT_FAILURE;
+        }
+        printf("Saved the profile with %zu size range(s) to '%s'\n", profile.count,
+               profile_filename ? profile_filename : default_path);
+        return EXIT_SUCCESS;
+    }
+
+    if (frames) {
+        if (V_option != 0 || B_option || stream || use_mmap || batch || precise) {
+            fprintf(stderr, "Option --frames is only available for version 0 without -B, --stream, --mmap, --batch and --precise.\n");
+            return EXIT_FAILURE;
+        }
+        if (optind < argc - 1) {
+            fprintf(stderr, "Too many positional arguments given.\n");
+            return EXIT_FAILURE;
+        }
+        // the frames are read from stdin and written to stdout by default
+        input_filename = optind == argc - 1 ? argv[optind] : "-";
+        if (!output_given) {
+            output_filename = "-";
+        }
+        if (!checkParams(V_option, B_option, threads, input_filename, output_filename, coeffs[0], coeffs[1],
+                         coeffs[2], brightness, contrast)) {
+            return EXIT_FAILURE;
+        }
+
+        FILE *in = strcmp(input_filename, "-") ? fopen(input_filename, "rb") : stdin;
+        if (!in) {
+            fprintf(stderr, "Unable to open file '%s'\n", input_filename);
+            return EXIT_FAILURE;
+        }
+        FILE *out = strcmp(output_filename, "-") ? fopen(output_filename, "wb") : stdout;
+        if (!out) {
+            fprintf(stderr, "Unable to open file '%s' for writing\n", output_filename);
+            if (in != stdin) {
+                fclose(in);
+            }
+            return EXIT_FAILURE;
+        }
+
+        FrameStats stats;
+        int exec_res = convert_frames(in, in == stdin ? "stdin" : input_filename, out,
+                                      out == stdout ? "stdout" : output_filename, coeffs[0], coeffs[1], coeffs[2],
+                                      brightness, contrast, previous_contrast, &stats);
+        if (in != stdin) {
+            fclose(in);
+        }
+        if (out != stdout && fclose(out)) {
+            fprintf(stderr, "Error writing image data to '%s'\n", output_filename);
+            exec_res = 0;
+        }
+
+        // stdout carries the frames, so the statistics go to stderr
+        fprintf(stderr, "Converted %zu frame(s) in %f seconds: %.1f frames/s, %.1f MB/s\n", stats.frames,
+                stats.seconds, stats.frames / stats.seconds, stats.bytes / stats.seconds / 1e6);
+        return exec_res ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (batch) {
+        if (V_option != 0 || stream || use_mmap) {
+            fprintf(stderr, "Option --batch is only available for version 0 without --stream and --mmap.\n");
+            return EXIT_FAILURE;
+        }
+        if (optind == argc && !manifest_filename) {
+            fprintf(stderr, "No input file specified.\n");
+            return EXIT_FAILURE;
+        }
+        // the outputs are written to the current directory by default
+        if (!output_given) {
+            output_filename = ".";
+        }
+        if (!checkParams(V_option, B_option, threads, manifest_filename ? manifest_filename : argv[optind],
+                         output_filename, coeffs[0], coeffs[1], coeffs[2], brightness, contrast)) {
+            return EXIT_FAILURE;
+        }
+
+        BatchInputs inputs = {argv + optind, (size_t) (argc - optind), NULL};
+        if (manifest_filename) {
+            inputs.manifest = strcmp(manifest_filename, "-") ? fopen(manifest_filename, "r") : stdin;
+            if (!inputs.manifest) {
+                fprintf(stderr, "Unable to open file '%s'\n", manifest_filename);
+                return EXIT_FAILURE;
+            }
+        }
+
+        BatchStats stats;
+        int exec_res = batch_convert(&inputs, output_filename, coeffs[0], coeffs[1], coeffs[2], brightness,
+                                     contrast, threads, batch_io, &stats);
+        if (inputs.manifest && inputs.manifest != stdin) {
+            fclose(inputs.manifest);
+        }
+
+        printf("Converted %zu image(s), skipped %zu, in %f seconds with %d worker(s): %.1f images/s, %.1f MB/s\n",
+               stats.images, stats.failed, stats.seconds, threads, stats.images / stats.seconds,
+               stats.bytes / stats.seconds / 1e6);
+        return exec_res ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     // checks if only one positional argument exists
     if (optind == argc - 1) {
         input_filename = argv[optind];
@@ -360,98 +554,316 @@ int main(int argc, char **argv) {
         return EXIT_FAILURE;
     }
 
-    if (!checkParams(V_option, B_option, input_filename, output_filename, coeffs[0], coeffs[1], coeffs[2], brightness,
+    if (!checkParams(V_option, B_option, threads, input_filename, output_filename, coeffs[0], coeffs[1], coeffs[2], brightness,
                      contrast)) {
         return EXIT_FAILURE;
     }
 
-    // Read input image
-    PPMImage *input_image = readPPM(input_filename);
-    if (!input_image) {
-        fprintf(stderr, "readPPM returned NULL. Reading input image not possible.\n");
-        return EXIT_FAILURE;
+    if (connect_socket) {
+        // the daemon converts with its own coefficients and adjustments
+        DaemonReply reply;
+        if (!daemon_convert_file(connect_socket, input_filename, output_filename, &reply)) {
+            return EXIT_FAILURE;
+        }
+        printf("The daemon took %f seconds for the request.\n", reply.nanoseconds / 1e9);
+        return EXIT_SUCCESS;
     }
 
-    // check overflow for width * height
-    size_t wh;
-    if (__builtin_umull_overflow(input_image->width, input_image->height, &wh)) {
-        fprintf(stderr, "image is too large. Overflow happened.\n");
-        freePPM(input_image);
-        return EXIT_FAILURE;
+    if (num_variants) {
+        // the coefficients, brightness and contrast of the command line are the defaults of every variant
+        Variant variants[VARIANTS_MAX];
+        for (size_t v = 0; v < num_variants; v++) {
+            if (!parseVariant(variant_specs[v], coeffs, brightness, contrast, &variants[v])) {
+                return EXIT_FAILURE;
+            }
+        }
+        if (!convert_variants(input_filename, variants, num_variants)) {
+            fprintf(stderr, "Execution failed for the variants\n");
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
     }
 
-    // Allocate memory for new image
-    uint8_t *new_pixels = malloc(wh);
-    if (!new_pixels) {
-        fprintf(stderr, "malloc for new_pixels returned NULL\n");
-        freePPM(input_image);
-        return EXIT_FAILURE;
+    if (use_region) {
+        // the region mode reads only the rows of the region and writes the file itself
+        int counter = 0;
+        int exec_res;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        do {
+            exec_res = brightness_contrast_roi(input_filename, output_filename, &region, coeffs[0], coeffs[1],
+                                               coeffs[2], brightness, contrast, region_statistics, use_mmap);
+            counter++;
+        } while (exec_res && counter < B_option);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        if (!exec_res) {
+            fprintf(stderr, "Execution failed for the region\n");
+            return EXIT_FAILURE;
+        }
+        if (B_option) {
+            double time = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
+            printf("The region takes %f seconds for %d iteration(s) with the %s kernels. Average: %f seconds (including reading and writing the file)\n",
+                   time, B_option, get_kernels()->name, time / B_option);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if (downscale) {
+        // the downscale mode reads the rows of every block row and writes the reduced file itself
+        int counter = 0;
+        int exec_res;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        do {
+            exec_res = brightness_contrast_downscale(input_filename, output_filename, (size_t) downscale, coeffs[0],
+                                                     coeffs[1], coeffs[2], brightness, contrast, use_mmap);
+            counter++;
+        } while (exec_res && counter < B_option);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        if (!exec_res) {
+            fprintf(stderr, "Execution failed for the downscaled image\n");
+            return EXIT_FAILURE;
+        }
+        if (B_option) {
+            double time = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
+            printf("The downscaled image takes %f seconds for %d iteration(s) with the %s kernels. Average: %f seconds (including reading and writing the file)\n",
+                   time, B_option, get_kernels()->name, time / B_option);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if (stream) {
+        if (V_option != 0) {
+            fprintf(stderr, "Option --stream is only available for version 0.\n");
+            return EXIT_FAILURE;
+        }
+        if (use_mmap) {
+            fprintf(stderr, "Options --stream and --mmap can not be combined.\n");
+            return EXIT_FAILURE;
+        }
+
+        // the stream mode reads and writes the files itself
+        int counter = 0;
+        int exec_res;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        do {
+            exec_res = brightness_contrast_stream(input_filename, output_filename, coeffs[0], coeffs[1], coeffs[2],
+                                                  brightness, contrast, strip_rows);
+            counter++;
+        } while (exec_res && counter < B_option);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        if (!exec_res) {
+            fprintf(stderr, "Execution failed in stream mode\n");
+            return EXIT_FAILURE;
+        }
+        if (B_option) {
+            double time = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
+            printf("The stream mode takes %f seconds for %d iteration(s) with the %s kernels. Average: %f seconds (including reading and writing the file)\n",
+                   time, B_option, get_kernels()->name, time / B_option);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    PPMImage *input_image;
+    PPMImage mapped_image;
+    int grey_input = 0;                         // the decoded image holds grey values, see readJPEG()
+    MappedFile input_map, output_map;
+    PoolBuffer output_buffer = {NULL, 0};
+    uint8_t *new_pixels;
+
+    if (use_mmap) {
+        // the kernels read from the input mapping and store into the output mapping
+        if (!mapPPM(input_filename, &input_map)) {
+            return EXIT_FAILURE;
+        }
+        if (!mapPGM(output_filename, input_map.width, input_map.height, &input_map, &output_map)) {
+            unmapFile(&input_map);
+            return EXIT_FAILURE;
+        }
+        mapped_image.width = input_map.width;
+        mapped_image.height = input_map.height;
+        mapped_image.maxval = 255;
+        mapped_image.data = input_map.data;
+        input_image = &mapped_image;
+        new_pixels = output_map.data;
+    } else {
+        // Read input image from one stream, a JPEG image converted by version 0 may be decoded to its luma only
+        FILE *input_fp = fopen(input_filename, "rb");
+        if (!input_fp) {
+            fprintf(stderr, "Unable to open file '%s'\n", input_filename);
+            return EXIT_FAILURE;
+        }
+        int jpeg = isJPEG(input_fp);
+        input_image = jpeg ? readJPEG(input_fp, input_filename,
+                                      V_option == 0 && !precise && !sample_rate ? coeffs : NULL, &grey_input)
+                           : readPPMStream(input_fp, input_filename);
+        fclose(input_fp);
+        if (!input_image) {
+            fprintf(stderr, "%s returned NULL. Reading input image not possible.\n", jpeg ? "readJPEG" : "readPPM");
+            return EXIT_FAILURE;
+        }
+        if (input_image->maxval > 255 && V_option != 0) {
+            fprintf(stderr, "16 bit images are only supported by version 0.\n");
+            freePPM(input_image);
+            return EXIT_FAILURE;
+        }
+        if (input_image->maxval > 255 && precise) {
+            fprintf(stderr, "Option --precise is only available for 8 bit images.\n");
+            freePPM(input_image);
+            return EXIT_FAILURE;
+        }
+        if (input_image->maxval > 255 && sample_rate) {
+            fprintf(stderr, "Option --sample is only available for 8 bit images.\n");
+            freePPM(input_image);
+            return EXIT_FAILURE;
+        }
+
+        // check overflow for width * height
+        size_t wh;
+        if (__builtin_umull_overflow(input_image->width, input_image->height, &wh)) {
+            fprintf(stderr, "image is too large. Overflow happened.\n");
+            freePPM(input_image);
+            return EXIT_FAILURE;
+        }
+
+        // Allocate aligned memory for new image, 16 bit samples need two bytes (6 * wh checked in readPPM())
+        if (!buffer_alloc(input_image->maxval > 255 && pgm16 ? 2 * wh : wh, &output_buffer)) {
+            fprintf(stderr, "malloc for new_pixels returned NULL\n");
+            freePPM(input_image);
+            return EXIT_FAILURE;
+        }
+        new_pixels = output_buffer.data;
+    }
+
+    // the version, threads, kernels and store mode of the profile, unless they are given on the command line
+    if (auto_version && input_image->maxval <= 255 && !precise && !sample_rate && !grey_input) {
+        char default_path[PATH_MAX];
+        const char *path = profile_filename;
+        if (!path && default_profile_path(default_path, sizeof(default_path))) {
+            path = default_path;
+        }
+        TuneProfile profile;
+        if (path && load_profile(path, &profile)) {
+            const TuneEntry *entry = profile_lookup(&profile, input_image->width * input_image->height);
+            V_option = entry->version;
+            if (!threads_given) {
+                threads = entry->threads;
+            }
+            if (!isa_given) {
+                select_kernels(entry->kernels);
+            }
+            if (!nontemporal_given) {
+                set_nontemporal_threshold(entry->nontemporal ? 0 : SIZE_MAX);
+            }
+            if (V_option == 4 && !gpu_threshold_given) {
+                set_gpu_threshold(0);
+            }
+        } else if (version_given) {
+            fprintf(stderr, "No autotune profile found, run --autotune first. Using version 0.\n");
+        }
     }
 
     // Start Image Conversion
-    int counter = 0;
+    SampledStatistics statistics;
+    Conversion conversion = {V_option, threads, input_image->data, input_image->width, input_image->height,
+                             coeffs[0], coeffs[1], coeffs[2], brightness, contrast, new_pixels,
+                             input_image->maxval, input_image->maxval > 255 && pgm16, precise,
+                             (size_t) sample_rate, &statistics, grey_input};
     int exec_res;
-    struct timespec start, end;
-    clock_gettime(CLOCK_MONOTONIC, &start);
-
-    switch (V_option) {
-        case 2:
-            do {
-                exec_res = brightness_contrast_V2(
-                        input_image->data, input_image->width, input_image->height,
-                        coeffs[0], coeffs[1], coeffs[2],
-                        brightness, contrast, new_pixels);
-                counter++;
-            } while (counter < B_option);
-            break;
-        case 1:
-            do {
-                exec_res = brightness_contrast_V1(
-                        input_image->data, input_image->width, input_image->height,
-                        coeffs[0], coeffs[1], coeffs[2],
-                        brightness, contrast, new_pixels);
-                counter++;
-            } while (counter < B_option);
-            break;
 
-        case 0:
-        default:
-            do {
-                exec_res = brightness_contrast_V0(
-                        input_image->data, input_image->width, input_image->height,
-                        coeffs[0], coeffs[1], coeffs[2],
-                        brightness, contrast, new_pixels);
-                counter++;
-            } while (counter < B_option);
-            break;
-    }
+    if (B_option) {
+        BenchmarkConfig config = {B_option, warmup, flush_cache};
+        double time_single = 0.0;
+
+        // version 3 measures the scaling for 1, 2, 4, ... threads up to the requested number
+        for (int t = V_option == 3 ? 1 : threads;; t = (t * 2 < threads) ? t * 2 : threads) {
+            conversion.threads = t;
+            BenchmarkResult result;
+            exec_res = benchmark_conversion(&conversion, &config, &result);
+            if (!exec_res) {
+                break;
+            }
+
+            if (json) {
+                print_benchmark_json(&conversion, &config, get_kernels()->name, &result);
+            } else if (V_option == 3) {
+                if (t == 1) {
+                    time_single = result.total;
+                }
+                printf("%s, %d thread(s): %f seconds for %d iteration(s). Average: %f seconds. Speedup: %.2fx\n",
+                       get_kernels()->name, t, result.total, B_option, result.mean, time_single / result.total);
+                print_benchmark_text(&result);
+            } else {
+                printf("The implementation takes %f seconds for %d iteration(s) of version %d of the implementation. Average: %f seconds (excluding reading and writing the file)\n",
+                       result.total, B_option, V_option, result.mean);
+                if (V_option == 0) {
+                    printf("Version 0 used the %s kernels.\n", get_kernels()->name);
+                } else if (V_option == 4 && use_gpu(conversion.width * conversion.height)) {
+                    printf("Version 4 used the GPU %s.\n", gpu_device_name());
+                } else if (V_option == 4) {
+                    printf("Version 4 used the %s kernels of the CPU.\n", get_kernels()->name);
+                }
+                print_benchmark_text(&result);
+            }
+            free_benchmark(&result);
 
-    clock_gettime(CLOCK_MONOTONIC, &end);
+            if (V_option != 3 || t == threads) {
+                break;
+            }
+        }
+    } else {
+        exec_res = run_conversion(&conversion);
+    }
 
     if (!exec_res) {
-        freePPM(input_image);
-        free(new_pixels);
+        if (use_mmap) {
+            unmapFile(&output_map);
+            unmapFile(&input_map);
+            remove(output_filename);
+        } else {
+            freePPM(input_image);
+            buffer_free(&output_buffer);
+        }
         fprintf(stderr, "Execution failed with version %d\n", V_option);
         return EXIT_FAILURE;
     }
 
-    if (B_option) {
-        double time = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
-        double average_time = time / B_option;
-        printf("The implementation takes %f seconds for %d iteration(s) of version %d of the implementation. Average: %f seconds (excluding reading and writing the file)\n",
-               time, B_option, V_option, average_time);
+    if (sample_rate && !isnan(contrast) && !json) {
+        printf("Statistics estimated from %zu pixels in %zu block(s): mean %.3f (standard error %.3f), standard deviation %.3f (standard error %.3f)\n",
+               statistics.pixels, statistics.blocks, statistics.mean, statistics.mean_error, statistics.std,
+               statistics.std_error);
     }
 
-    // Write PGM file
-    int retPGM = writePGM(output_filename, new_pixels, input_image->width, input_image->height);
+    // Write PGM file, a mapped output only has to be unmapped
+    int retPGM;
+    if (use_mmap) {
+        retPGM = unmapFile(&output_map);
+        unmapFile(&input_map);
+    } else {
+        if (conversion.wide) {
+            retPGM = writePGM16(output_filename, new_pixels, input_image->width, input_image->height,
+                                input_image->maxval);
+        } else {
+            retPGM = writePGM(output_filename, new_pixels, input_image->width, input_image->height);
+        }
 
-    // Free remaining ressources 
-    freePPM(input_image);
-    free(new_pixels);
+        // Free remaining ressources
+        freePPM(input_image);
+        buffer_free(&output_buffer);
+    }
 
     if(!retPGM) {
         // return exit failure if image could not be written
         return EXIT_FAILURE;
     }
+
+    // time and hardware counters of every phase, only with make INSTRUMENT=1
+    if (instrument_enabled()) {
+        instrument_report(stdout, json);
+    }
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,367 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "autotune.h"
+#include "brightness_contrast_opencl.h"
+#include "brightness_contrast_simd.h"
+#include "buffer_pool.h"
+#include "dispatch.h"
+
+// kernels of the architecture, see the kernel table of dispatch.c
+#define AUTOTUNE_MAX_KERNELS 8
+
+// longest line of a profile
+#define AUTOTUNE_LINE_LENGTH 256
+
+
+/**
+ * @brief Builds the path of the profile of this host.
+ *
+ * @param path Buffer where the path will be stored.
+ * @param size Size of the buffer.
+ *
+ * @return 1 on success, 0 if neither XDG_CONFIG_HOME nor HOME is set or the path is too long.
+ *
+ * The profile is $XDG_CONFIG_HOME/imgconv/<host>.profile, with ~/.config
+ * if XDG_CONFIG_HOME is not set. The host name keeps the profiles apart if
+ * the home directory is shared by several machines.
+ */
+
+int default_profile_path(char *path, size_t size) {
+    char host[HOST_NAME_MAX + 1];
+    if (gethostname(host, sizeof(host))) {
+        strcpy(host, "localhost");
+    }
+    host[HOST_NAME_MAX] = '\0';
+
+    const char *config = getenv("XDG_CONFIG_HOME");
+    const char *home = getenv("HOME");
+    int length;
+    if (config && *config) {
+        length = snprintf(path, size, "%s/imgconv/%s.profile", config, host);
+    } else if (home && *home) {
+        length = snprintf(path, size, "%s/.config/imgconv/%s.profile", home, host);
+    } else {
+        return 0;
+    }
+    return length > 0 && (size_t) length < size;
+}
+
+
+/**
+ * @brief Selects the kernels and the store mode of an entry for the following conversions.
+ *
+ * @param entry The entry.
+ *
+ * @return 1 on success, 0 if the kernels are not supported.
+ */
+
+static int apply_entry(const TuneEntry *entry) {
+    if (!select_kernels(entry->kernels)) {
+        return 0;
+    }
+    set_nontemporal_threshold(entry->nontemporal ? 0 : SIZE_MAX);
+    return 1;
+}
+
+
+/**
+ * @brief Measures one candidate and keeps it if it is the fastest so far.
+ *
+ * @param conversion The conversion, its version and threads are set from the candidate.
+ * @param config Number of iterations and warmup iterations, cache flushing.
+ * @param candidate The candidate.
+ * @param best The fastest candidate so far.
+ * @param best_time Median time of the fastest candidate, negative if there is none yet.
+ *
+ * @return 1 on success, 0 if the candidate could not be measured.
+ */
+
+static int measure_candidate(Conversion *conversion, const BenchmarkConfig *config, const TuneEntry *candidate,
+                             TuneEntry *best, double *best_time) {
+    if (!apply_entry(candidate)) {
+        return 0;
+    }
+    conversion->version = candidate->version;
+    conversion->threads = candidate->threads;
+
+    BenchmarkResult result;
+    if (!benchmark_conversion(conversion, config, &result)) {
+        return 0;
+    }
+    if (*best_time < 0 || result.median < *best_time * AUTOTUNE_MARGIN) {
+        *best = *candidate;
+        *best_time = result.median;
+    }
+    free_benchmark(&result);
+    return 1;
+}
+
+
+/**
+ * @brief Compares the choices of two entries.
+ *
+ * @return 1 if both choose the same version, threads, kernels and store mode, 0 otherwise.
+ */
+
+static int same_choice(const TuneEntry *x, const TuneEntry *y) {
+    return x->version == y->version && x->threads == y->threads && !strcmp(x->kernels, y->kernels) &&
+           x->nontemporal == y->nontemporal;
+}
+
+
+/**
+ * @brief Measures the versions with the results of version 0 for a grid of image sizes.
+ *
+ * @param config Number of iterations and warmup iterations, cache flushing.
+ * @param max_threads Most threads tried for version 3.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param profile Pointer where the fastest candidate for every size range will be stored.
+ *
+ * @return 1 on success, 0 on failure.
+ *
+ * For every size, version 0 is measured with every supported instruction set,
+ * with and without non-temporal stores. Version 3 is then measured with 2, 4,
+ * ... up to max_threads threads with the kernels and store mode of the fastest
+ * version 0, and version 4 on the GPU if one was found, so the number of
+ * measurements grows with the sum and not the product of the choices. Versions
+ * 1 and 2 are not candidates, their float arithmetic differs from version 0.
+ *
+ * Neighbouring sizes with the same choice share one entry, a new entry starts
+ * halfway (on a log scale) between two sizes with different choices. The
+ * selected kernels are restored, the threshold for non-temporal stores stays
+ * set.
+ */
+
+int autotune(const BenchmarkConfig *config, int max_threads, float a, float b, float c, int16_t brightness,
+             float contrast, TuneProfile *profile) {
+    const Kernels *kernels[AUTOTUNE_MAX_KERNELS];
+    size_t num_kernels = supported_kernels(kernels, AUTOTUNE_MAX_KERNELS);
+    const char *selected = get_kernels()->name;
+    int gpu = gpu_device_name() != NULL;
+
+    // one image of the largest size, the smaller sizes use its beginning
+    size_t max_pixels = (size_t) 1 << AUTOTUNE_MAX_LOG2;
+    PoolBuffer image = {NULL, 0}, result = {NULL, 0};
+    if (!buffer_alloc(3 * max_pixels, &image) || !buffer_alloc(max_pixels, &result)) {
+        fprintf(stderr, "Unable to allocate memory for the autotuning\n");
+        buffer_free(&image);
+        return 0;
+    }
+    uint32_t state = 120;
+    for (size_t i = 0; i < 3 * max_pixels; i++) {
+        state = state * 1664525u + 1013904223u;
+        image.data[i] = (uint8_t) (state >> 24);
+    }
+    if (gpu) {
+        set_gpu_threshold(0);
+    }
+
+    profile->count = 0;
+    int success = 1;
+    for (int log2 = AUTOTUNE_MIN_LOG2; success && log2 <= AUTOTUNE_MAX_LOG2; log2 += 2) {
+        size_t width = (size_t) 1 << (log2 / 2), height = (size_t) 1 << (log2 - log2 / 2);
+        Conversion conversion = {0, 1, image.data, width, height, a, b, c, brightness, contrast, result.data,
+                                 255, 0, 0, 0, NULL, 0};
+        TuneEntry best, candidate;
+        double best_time = -1;
+        memset(&candidate, 0, sizeof(candidate));
+        candidate.threads = 1;
+
+        // the widest kernels first, the narrower ones have to beat them by the margin
+        for (size_t k = num_kernels; success && k > 0; k--) {
+            snprintf(candidate.kernels, sizeof(candidate.kernels), "%s", kernels[k - 1]->name);
+            for (int nontemporal = 0; success && nontemporal <= (kernels[k - 1]->stream_store != NULL);
+                 nontemporal++) {
+                candidate.nontemporal = nontemporal;
+                success = measure_candidate(&conversion, config, &candidate, &best, &best_time);
+            }
+        }
+
+        candidate = best;
+        candidate.version = 3;
+        for (int t = 2; success && max_threads > 1; t = t * 2 < max_threads ? t * 2 : max_threads) {
+            candidate.threads = t > max_threads ? max_threads : t;
+            success = measure_candidate(&conversion, config, &candidate, &best, &best_time);
+            if (candidate.threads == max_threads) {
+                break;
+            }
+        }
+
+        if (success && gpu) {
+            candidate.version = 4;
+            candidate.threads = 1;
+            success = measure_candidate(&conversion, config, &candidate, &best, &best_time);
+        }
+        if (!success) {
+            fprintf(stderr, "Autotuning failed for %zu pixels\n", width * height);
+            break;
+        }
+
+        printf("%zu pixels: version %d, %s kernels, %d thread(s), %s stores: %f seconds\n", width * height,
+               best.version, best.kernels, best.threads, best.nontemporal ? "non-temporal" : "temporal", best_time);
+        if (!profile->count || !same_choice(&profile->entries[profile->count - 1], &best)) {
+            best.min_pixels = profile->count ? (size_t) 1 << (log2 - 1) : 0;
+            profile->entries[profile->count++] = best;
+        }
+    }
+
+    select_kernels(selected);
+    buffer_free(&image);
+    buffer_free(&result);
+    return success;
+}
+
+
+/**
+ * @brief Creates the missing parent directories of a file.
+ *
+ * @param path Path of the file.
+ *
+ * Failures are not reported, they show up when the file is opened.
+ */
+
+static void create_parents(const char *path) {
+    char directory[PATH_MAX];
+    if (strlen(path) >= sizeof(directory)) {
+        return;
+    }
+    strcpy(directory, path);
+    for (char *slash = strchr(directory + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        mkdir(directory, 0755);
+        *slash = '/';
+    }
+}
+
+
+/**
+ * @brief Writes a profile as a text file.
+ *
+ * @param path Path of the file, missing directories are created.
+ * @param profile The profile.
+ *
+ * @return 1 on success, 0 on failure.
+ *
+ * Every entry is one line "<min_pixels> <version> <kernels> <threads>
+ * <temporal|nontemporal>". The file is written under a temporary name and
+ * renamed, so a conversion starting at the same time reads either the old or
+ * the new profile.
+ */
+
+int save_profile(const char *path, const TuneProfile *profile) {
+    char temporary[PATH_MAX];
+    if (snprintf(temporary, sizeof(temporary), "%s.%ld", path, (long) getpid()) >= (int) sizeof(temporary)) {
+        fprintf(stderr, "Path of the profile '%s' is too long\n", path);
+        return 0;
+    }
+    create_parents(path);
+
+    FILE *file = fopen(temporary, "w");
+    if (!file) {
+        fprintf(stderr, "Unable to open file '%s' for writing\n", temporary);
+        return 0;
+    }
+    char host[HOST_NAME_MAX + 1] = "localhost";
+    gethostname(host, sizeof(host));
+    host[HOST_NAME_MAX] = '\0';
+    fprintf(file, "# imgconv autotune profile of %s\n# min_pixels version kernels threads stores\n", host);
+    for (size_t i = 0; i < profile->count; i++) {
+        const TuneEntry *entry = &profile->entries[i];
+        fprintf(file, "%zu %d %s %d %s\n", entry->min_pixels, entry->version, entry->kernels, entry->threads,
+                entry->nontemporal ? "nontemporal" : "temporal");
+    }
+
+    if (fclose(file) || rename(temporary, path)) {
+        fprintf(stderr, "Unable to write file '%s'\n", path);
+        remove(temporary);
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Reads a profile written by save_profile().
+ *
+ * @param path Path of the file.
+ * @param profile Pointer where the profile will be stored.
+ *
+ * @return 1 on success, 0 if the file does not exist or is invalid; only an invalid file is reported.
+ *
+ * Kernels the cpu does not support make the profile invalid, e.g. if it was
+ * copied from another host.
+ */
+
+int load_profile(const char *path, TuneProfile *profile) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        if (errno != ENOENT) {
+            fprintf(stderr, "Unable to open profile '%s'\n", path);
+        }
+        return 0;
+    }
+
+    char line[AUTOTUNE_LINE_LENGTH];
+    size_t line_number = 0;
+    int valid = 1;
+    profile->count = 0;
+    while (valid && fgets(line, sizeof(line), file)) {
+        line_number++;
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+
+        TuneEntry entry;
+        char stores[AUTOTUNE_NAME_LENGTH] = "";
+        memset(&entry, 0, sizeof(entry));
+        valid = profile->count < AUTOTUNE_MAX_ENTRIES &&
+                sscanf(line, "%zu %d %15s %d %15s", &entry.min_pixels, &entry.version, entry.kernels,
+                       &entry.threads, stores) == 5 &&
+                (entry.version == 0 || entry.version == 3 || entry.version == 4) && entry.threads >= 1 &&
+                (!strcmp(stores, "temporal") || !strcmp(stores, "nontemporal")) &&
+                (profile->count ? entry.min_pixels > profile->entries[profile->count - 1].min_pixels
+                                : entry.min_pixels == 0) &&
+                find_kernels(entry.kernels) != NULL;
+        entry.nontemporal = !strcmp(stores, "nontemporal");
+        if (valid) {
+            profile->entries[profile->count++] = entry;
+        }
+    }
+    fclose(file);
+
+    if (!valid || !profile->count) {
+        fprintf(stderr, "Invalid profile '%s' in line %zu, run --autotune again\n", path, line_number);
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Looks up the entry of a profile for an image size.
+ *
+ * @param profile The profile.
+ * @param pixels Number of pixels of the image.
+ *
+ * @return The entry with the largest min_pixels not above pixels.
+ */
+
+const TuneEntry *profile_lookup(const TuneProfile *profile, size_t pixels) {
+    size_t i = 0;
+    while (i + 1 < profile->count && profile->entries[i + 1].min_pixels <= pixels) {
+        i++;
+    }
+    return &profile->entries[i];
+}
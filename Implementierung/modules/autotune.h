@@ -0,0 +1,103 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "benchmark.h"
+
+#ifndef TEAM120_AUTOTUNE_H
+#define TEAM120_AUTOTUNE_H
+
+// size ranges a profile can distinguish
+#define AUTOTUNE_MAX_ENTRIES 16
+
+// the measured sizes are squares of 2^AUTOTUNE_MIN_LOG2 to 2^AUTOTUNE_MAX_LOG2 pixels in steps of 4
+#define AUTOTUNE_MIN_LOG2 12
+#define AUTOTUNE_MAX_LOG2 24
+
+// a candidate replaces the fastest one so far only if it is faster by this factor, so noise does not split ranges
+#define AUTOTUNE_MARGIN 0.98
+
+// iterations per candidate and size without -B
+#define AUTOTUNE_ITERATIONS 5
+
+#define AUTOTUNE_NAME_LENGTH 16
+
+typedef struct {
+    size_t min_pixels;          // the entry applies to images with at least this number of pixels
+    int version;                // 0, 3 or 4, the versions with the results of version 0
+    int threads;                // threads of version 3
+    char kernels[AUTOTUNE_NAME_LENGTH];  // name of the kernels, see select_kernels()
+    int nontemporal;            // 1 to write the grey values with non-temporal stores
+} TuneEntry;
+
+typedef struct {
+    size_t count;               // entries ordered by their min_pixels, the first one starts at 0
+    TuneEntry entries[AUTOTUNE_MAX_ENTRIES];
+} TuneProfile;
+
+
+/**
+ * @brief Builds the path of the profile of this host.
+ *
+ * @param path Buffer where the path will be stored.
+ * @param size Size of the buffer.
+ *
+ * @return 1 on success, 0 if neither XDG_CONFIG_HOME nor HOME is set or the path is too long.
+ */
+
+int default_profile_path(char *path, size_t size);
+
+
+/**
+ * @brief Measures the versions with the results of version 0 for a grid of image sizes.
+ *
+ * @param config Number of iterations and warmup iterations, cache flushing.
+ * @param max_threads Most threads tried for version 3.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param profile Pointer where the fastest candidate for every size range will be stored.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+
+int autotune(const BenchmarkConfig *config, int max_threads, float a, float b, float c, int16_t brightness,
+             float contrast, TuneProfile *profile);
+
+
+/**
+ * @brief Writes a profile as a text file.
+ *
+ * @param path Path of the file, missing directories are created.
+ * @param profile The profile.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+
+int save_profile(const char *path, const TuneProfile *profile);
+
+
+/**
+ * @brief Reads a profile written by save_profile().
+ *
+ * @param path Path of the file.
+ * @param profile Pointer where the profile will be stored.
+ *
+ * @return 1 on success, 0 if the file does not exist or is invalid; only an invalid file is reported.
+ */
+
+int load_profile(const char *path, TuneProfile *profile);
+
+
+/**
+ * @brief Looks up the entry of a profile for an image size.
+ *
+ * @param profile The profile.
+ * @param pixels Number of pixels of the image.
+ *
+ * @return The entry with the largest min_pixels not above pixels.
+ */
+
+const TuneEntry *profile_lookup(const TuneProfile *profile, size_t pixels);
+
+#endif
@@ -0,0 +1,849 @@
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include "batch.h"
+#include "buffer_pool.h"
+#include "imgconv.h"
+#include "io_ring.h"
+
+// largest read or write of a single operation, a multiple of BATCH_DIRECT_ALIGNMENT
+#define TRANSFER_CHUNK ((size_t) 1 << 30)
+
+struct Slot;
+
+typedef struct {
+    struct Slot *slot;
+    uint8_t *data;
+    size_t length;              // bytes to transfer
+    size_t done;                // bytes transferred so far
+    off_t offset;               // offset of data in the file
+    int buffer_index;           // registered buffer holding data, -1 if none
+} Transfer;
+
+typedef struct Slot {
+    ImgconvContext ctx;         // buffers are reused for every image of the slot
+    char input[PATH_MAX];
+    char output[PATH_MAX];
+    ImgconvError error;
+
+    // used by the io_uring backend only
+    size_t index;               // position of the slot, selects its registered buffers
+    PoolBuffer file;            // contents of the input file, decoded in place
+    int fd;                     // file being read or written
+    int reading;                // 1 while the input is read, 0 while the output is written
+    int direct;                 // 1 if fd was opened with O_DIRECT
+    Transfer transfers[2];      // the read, or the writes of the header and the grey values
+    int in_flight;              // transfers not completed yet
+    char header[64];
+    void *registered[2];        // buffers registered for the file and the grey values
+    size_t registered_length[2];
+} Slot;
+
+typedef struct {
+    Slot **items;               // ring buffer, large enough for every slot and end marker
+    size_t capacity, head, count;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+} SlotQueue;
+
+typedef struct {
+    const BatchInputs *inputs;
+    size_t next_name;
+    char *line;                 // line buffer for the manifest
+    size_t line_capacity;
+
+    const char *output;
+    int output_is_template;
+
+    SlotQueue free_slots;       // slots ready to be read into
+    SlotQueue decoded;          // slots waiting for conversion, NULL ends a worker
+    SlotQueue converted;        // slots waiting to be written, NULL ends the writer
+    BufferPool pool;            // shared by the contexts of all slots
+
+    int workers;                // number of running conversion threads
+    int finished_workers;
+    pthread_mutex_t finished_mutex;
+
+    int wake_fd;                // eventfd written for every converted slot, -1 with stdio
+} Batch;
+
+
+/**
+ * @brief Initializes a queue.
+ *
+ * @param queue The queue.
+ * @param capacity Maximum number of entries.
+ *
+ * @return 1 on success, 0 if the memory could not be allocated.
+ */
+
+static int queue_init(SlotQueue *queue, size_t capacity) {
+    queue->items = malloc(capacity * sizeof(Slot *));
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->count = 0;
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    return queue->items != NULL;
+}
+
+
+/**
+ * @brief Frees a queue.
+ *
+ * @param queue The queue.
+ */
+
+static void queue_destroy(SlotQueue *queue) {
+    free(queue->items);
+    pthread_mutex_destroy(&queue->mutex);
+    pthread_cond_destroy(&queue->not_empty);
+}
+
+
+/**
+ * @brief Appends a slot to a queue.
+ *
+ * @param queue The queue, never full as it has room for every slot and end marker.
+ * @param slot The slot or NULL as end marker.
+ */
+
+static void queue_push(SlotQueue *queue, Slot *slot) {
+    pthread_mutex_lock(&queue->mutex);
+    queue->items[(queue->head + queue->count) % queue->capacity] = slot;
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+
+/**
+ * @brief Removes the first slot from a queue, waits if the queue is empty.
+ *
+ * @param queue The queue.
+ *
+ * @return The slot or NULL as end marker.
+ */
+
+static Slot *queue_pop(SlotQueue *queue) {
+    pthread_mutex_lock(&queue->mutex);
+    while (!queue->count) {
+        pthread_cond_wait(&queue->not_empty, &queue->mutex);
+    }
+    Slot *slot = queue->items[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    pthread_mutex_unlock(&queue->mutex);
+    return slot;
+}
+
+
+/**
+ * @brief Removes the first slot from a queue without waiting.
+ *
+ * @param queue The queue.
+ * @param slot Pointer where the slot or the end marker NULL will be stored.
+ *
+ * @return 1 if an entry was removed, 0 if the queue is empty.
+ */
+
+static int queue_try_pop(SlotQueue *queue, Slot **slot) {
+    pthread_mutex_lock(&queue->mutex);
+    if (!queue->count) {
+        pthread_mutex_unlock(&queue->mutex);
+        return 0;
+    }
+    *slot = queue->items[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    pthread_mutex_unlock(&queue->mutex);
+    return 1;
+}
+
+
+/**
+ * @brief Returns the next input file.
+ *
+ * @param batch The batch.
+ *
+ * @return The name of the file, NULL if all inputs have been returned. The name
+ *         stays valid until the next call.
+ *
+ * The files given on the command line come first, then the lines of the
+ * manifest. Empty lines of the manifest are skipped.
+ */
+
+static const char *next_input(Batch *batch) {
+    if (batch->next_name < batch->inputs->count) {
+        return batch->inputs->names[batch->next_name++];
+    }
+    if (!batch->inputs->manifest) {
+        return NULL;
+    }
+
+    ssize_t length;
+    while ((length = getline(&batch->line, &batch->line_capacity, batch->inputs->manifest)) >= 0) {
+        while (length > 0 && (batch->line[length - 1] == '\n' || batch->line[length - 1] == '\r')) {
+            batch->line[--length] = '\0';
+        }
+        if (length > 0) {
+            return batch->line;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Builds the name of the output file for an input file.
+ *
+ * @param batch The batch.
+ * @param input The name of the input file.
+ * @param output Buffer of PATH_MAX bytes for the name of the output file.
+ *
+ * @return 1 on success, 0 if the name is too long.
+ *
+ * The base name of the input without its extension either replaces the first
+ * %s of the template or is placed into the output directory with the extension .pgm.
+ */
+
+static int output_name(const Batch *batch, const char *input, char *output) {
+    const char *base = strrchr(input, '/');
+    base = base ? base + 1 : input;
+    const char *extension = strrchr(base, '.');
+    int base_length = (int) (extension && extension != base ? (size_t) (extension - base) : strlen(base));
+
+    int length;
+    if (batch->output_is_template) {
+        const char *marker = strstr(batch->output, "%s");
+        length = snprintf(output, PATH_MAX, "%.*s%.*s%s", (int) (marker - batch->output), batch->output,
+                          base_length, base, marker + 2);
+    } else {
+        length = snprintf(output, PATH_MAX, "%s/%.*s.pgm", batch->output, base_length, base);
+    }
+    return length >= 0 && length < PATH_MAX;
+}
+
+
+/**
+ * @brief Stores the names of the input and the output file in a slot.
+ *
+ * @param batch The batch.
+ * @param slot The slot.
+ * @param input The name of the input file.
+ *
+ * @return 1 on success, 0 if a name is too long. The error of the slot is set then.
+ */
+
+static int prepare_slot(const Batch *batch, Slot *slot, const char *input) {
+    size_t length = strlen(input);
+    if (length >= PATH_MAX || !output_name(batch, input, slot->output)) {
+        snprintf(slot->input, PATH_MAX, "%.*s", PATH_MAX - 1, input);
+        slot->error = IMGCONV_ERROR_PARAMS;
+        return 0;
+    }
+    memcpy(slot->input, input, length + 1);
+    return 1;
+}
+
+
+/**
+ * @brief Adds a slot whose image has passed all stages to the statistics and reports a failure.
+ *
+ * @param slot The slot.
+ * @param stats The statistics.
+ */
+
+static void count_slot(const Slot *slot, BatchStats *stats) {
+    if (slot->error == IMGCONV_OK) {
+        stats->images++;
+        stats->bytes += 3 * slot->ctx.width * slot->ctx.height;
+    } else {
+        fprintf(stderr, "Skipping '%s': %s\n", slot->input, imgconv_strerror(slot->error));
+        stats->failed++;
+    }
+}
+
+
+/**
+ * @brief First stage: reads and decodes the input files.
+ *
+ * @param arg Pointer to the Batch.
+ *
+ * @return Always NULL.
+ *
+ * While this thread decodes the next file, the workers convert the previous
+ * ones and the writer writes the results.
+ */
+
+static void *read_stage(void *arg) {
+    Batch *batch = (Batch *) arg;
+    const char *input;
+
+    while ((input = next_input(batch))) {
+        Slot *slot = queue_pop(&batch->free_slots);
+        if (prepare_slot(batch, slot, input)) {
+            slot->error = imgconv_decode(&slot->ctx, slot->input);
+        }
+        queue_push(&batch->decoded, slot);
+    }
+
+    // one end marker for every worker
+    for (int t = 0; t < batch->workers; t++) {
+        queue_push(&batch->decoded, NULL);
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Wakes the io_uring stage after a slot was converted.
+ *
+ * @param batch The batch.
+ */
+
+static void wake_io(Batch *batch) {
+    if (batch->wake_fd < 0) {
+        return;
+    }
+    uint64_t one = 1;
+    if (write(batch->wake_fd, &one, sizeof(one)) != sizeof(one)) {
+        // the counter of the eventfd does not overflow, the stage wakes up for the next slot at the latest
+        fprintf(stderr, "Failed to wake the I/O thread\n");
+    }
+}
+
+
+/**
+ * @brief Second stage: converts the decoded images.
+ *
+ * @param arg Pointer to the Batch.
+ *
+ * @return Always NULL.
+ *
+ * The last worker to finish ends the writer.
+ */
+
+static void *convert_stage(void *arg) {
+    Batch *batch = (Batch *) arg;
+    Slot *slot;
+
+    while ((slot = queue_pop(&batch->decoded))) {
+        if (slot->error == IMGCONV_OK) {
+            slot->error = imgconv_process(&slot->ctx);
+        }
+        queue_push(&batch->converted, slot);
+        wake_io(batch);
+    }
+
+    pthread_mutex_lock(&batch->finished_mutex);
+    if (++batch->finished_workers == batch->workers) {
+        queue_push(&batch->converted, NULL);
+        wake_io(batch);
+    }
+    pthread_mutex_unlock(&batch->finished_mutex);
+    return NULL;
+}
+
+
+/**
+ * @brief Registers a buffer of a slot with the ring unless it is registered already.
+ *
+ * @param ring The ring.
+ * @param slot The slot.
+ * @param which 0 for the buffer of the input file, 1 for the grey values.
+ * @param data The buffer.
+ * @param capacity Size of the buffer.
+ *
+ * @return The index of the registered buffer, -1 if the buffer is used unregistered.
+ *
+ * The buffers of a slot change only when an image needs larger ones, so once
+ * the mix of sizes has been seen, every transfer uses a registered buffer and
+ * the kernel does not pin its pages again for every read or write.
+ */
+
+static int register_buffer(IoRing *ring, Slot *slot, int which, void *data, size_t capacity) {
+    unsigned index = (unsigned) (2 * slot->index + which);
+    if (!ring->registered) {
+        return -1;
+    }
+    if (slot->registered[which] == data && slot->registered_length[which] == capacity) {
+        return (int) index;
+    }
+
+    slot->registered[which] = NULL;
+    slot->registered_length[which] = 0;
+    if (capacity > IO_RING_MAX_REGISTERED) {
+        ring_update_buffer(ring, index, NULL, 0);
+        return -1;
+    }
+    if (!ring_update_buffer(ring, index, data, capacity)) {
+        return -1;
+    }
+    slot->registered[which] = data;
+    slot->registered_length[which] = capacity;
+    return (int) index;
+}
+
+
+/**
+ * @brief Queues the rest of a transfer.
+ *
+ * @param ring The ring.
+ * @param transfer The transfer.
+ *
+ * @return 1 on success, 0 if the operation could not be queued.
+ */
+
+static int queue_transfer(IoRing *ring, Transfer *transfer) {
+    Slot *slot = transfer->slot;
+    size_t length = transfer->length - transfer->done;
+    if (slot->direct) {
+        // the buffer has room for the rounded length, the read returns less at the end of the file
+        length = (length + BATCH_DIRECT_ALIGNMENT - 1) / BATCH_DIRECT_ALIGNMENT * BATCH_DIRECT_ALIGNMENT;
+    }
+    if (length > TRANSFER_CHUNK) {
+        length = TRANSFER_CHUNK;
+    }
+    return ring_queue(ring, slot->reading ? IO_RING_READ : IO_RING_WRITE, slot->fd, transfer->data + transfer->done,
+                      length, transfer->offset + (off_t) transfer->done, transfer->buffer_index,
+                      (uint64_t) (uintptr_t) transfer);
+}
+
+
+/**
+ * @brief Opens the input file of a slot and queues the read of the whole file.
+ *
+ * @param batch The batch.
+ * @param ring The ring.
+ * @param slot The slot with the names of its files.
+ * @param direct 1 to read files of at least BATCH_DIRECT_BYTES with O_DIRECT.
+ *
+ * @return 1 if the read is in flight, 0 if the slot is done reading. Its error is set then.
+ *
+ * Files that are not regular files are decoded with stdio right away.
+ */
+
+static int start_read(Batch *batch, IoRing *ring, Slot *slot, int direct) {
+    int fd = open(slot->input, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        slot->error = IMGCONV_ERROR_OPEN;
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        slot->error = imgconv_decode(&slot->ctx, slot->input);
+        return 0;
+    }
+
+    size_t size = (size_t) st.st_size;
+    int use_direct = direct && size >= BATCH_DIRECT_BYTES;
+    size_t capacity = use_direct
+                      ? (size + BATCH_DIRECT_ALIGNMENT - 1) / BATCH_DIRECT_ALIGNMENT * BATCH_DIRECT_ALIGNMENT
+                      : size;
+    if (slot->file.capacity < capacity) {
+        pool_release(&batch->pool, &slot->file);
+        if (!pool_acquire(&batch->pool, capacity, &slot->file)) {
+            close(fd);
+            slot->error = IMGCONV_ERROR_MEMORY;
+            return 0;
+        }
+    }
+    // buffered if the buffer is not aligned or the file system does not support O_DIRECT
+    if (use_direct && ((uintptr_t) slot->file.data % BATCH_DIRECT_ALIGNMENT ||
+                       fcntl(fd, F_SETFL, O_DIRECT))) {
+        use_direct = 0;
+    }
+
+    slot->fd = fd;
+    slot->reading = 1;
+    slot->direct = use_direct;
+    slot->in_flight = 1;
+    Transfer *transfer = &slot->transfers[0];
+    transfer->slot = slot;
+    transfer->data = slot->file.data;
+    transfer->length = size;
+    transfer->done = 0;
+    transfer->offset = 0;
+    transfer->buffer_index = register_buffer(ring, slot, 0, slot->file.data, slot->file.capacity);
+    if (!queue_transfer(ring, transfer)) {
+        close(fd);
+        slot->error = IMGCONV_ERROR_DATA;
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Opens the output file of a converted slot and queues the writes of the header and the grey values.
+ *
+ * @param ring The ring.
+ * @param slot The converted slot.
+ *
+ * @return 1 if the writes are in flight, 0 if the slot is done writing. Its error is set then.
+ */
+
+static int start_write(IoRing *ring, Slot *slot) {
+    int fd = open(slot->output, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        slot->error = IMGCONV_ERROR_OPEN;
+        return 0;
+    }
+    int header_length = snprintf(slot->header, sizeof(slot->header), "P5\n%zu %zu\n255\n", slot->ctx.width,
+                                 slot->ctx.height);
+
+    slot->fd = fd;
+    slot->reading = 0;
+    slot->direct = 0;
+    slot->in_flight = 2;
+    Transfer *header = &slot->transfers[0], *grey = &slot->transfers[1];
+    header->slot = slot;
+    header->data = (uint8_t *) slot->header;
+    header->length = (size_t) header_length;
+    header->done = 0;
+    header->offset = 0;
+    header->buffer_index = -1;
+    grey->slot = slot;
+    grey->data = slot->ctx.grey.data;
+    grey->length = slot->ctx.width * slot->ctx.height;
+    grey->done = 0;
+    grey->offset = header_length;
+    grey->buffer_index = register_buffer(ring, slot, 1, slot->ctx.grey.data, slot->ctx.grey.capacity);
+
+    if (!queue_transfer(ring, header)) {
+        close(fd);
+        slot->error = IMGCONV_ERROR_WRITE;
+        return 0;
+    }
+    if (!queue_transfer(ring, grey)) {
+        // the header is in flight already, the slot completes with it
+        slot->in_flight = 1;
+        slot->error = IMGCONV_ERROR_WRITE;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Handles the completion of an operation of a transfer.
+ *
+ * @param batch The batch.
+ * @param ring The ring.
+ * @param transfer The transfer.
+ * @param result Bytes transferred by the operation or a negative errno.
+ * @param stats The statistics.
+ *
+ * @return 1 if the slot of the transfer has no operation in flight anymore, 0 otherwise.
+ *
+ * A completed read is decoded in place and handed to the workers, a completed
+ * write frees the slot for the next input.
+ */
+
+static int complete_transfer(Batch *batch, IoRing *ring, Transfer *transfer, int32_t result, BatchStats *stats) {
+    Slot *slot = transfer->slot;
+    if (result <= 0) {
+        // a read returns 0 if the file was truncated after fstat()
+        slot->error = slot->reading ? IMGCONV_ERROR_DATA : IMGCONV_ERROR_WRITE;
+    } else {
+        transfer->done += (size_t) result;
+        if (transfer->done > transfer->length) {
+            // a read with O_DIRECT of a file that grew after fstat()
+            transfer->done = transfer->length;
+        }
+        if (transfer->done < transfer->length && slot->error == IMGCONV_OK) {
+            if (queue_transfer(ring, transfer)) {
+                return 0;
+            }
+            slot->error = slot->reading ? IMGCONV_ERROR_DATA : IMGCONV_ERROR_WRITE;
+        }
+    }
+    if (--slot->in_flight) {
+        return 0;
+    }
+
+    int closed = !close(slot->fd);
+    if (slot->reading) {
+        if (slot->error == IMGCONV_OK) {
+            const uint8_t *data = slot->file.data;
+            int binary = transfer->length >= 2 && data[0] == 'P' && data[1] == '6';
+            if (!binary || imgconv_decode_memory(&slot->ctx, data, transfer->length) != IMGCONV_OK) {
+                // plain, 16 bit and invalid images are decoded by stdio and report the same errors
+                slot->error = imgconv_decode(&slot->ctx, slot->input);
+            }
+        }
+        queue_push(&batch->decoded, slot);
+    } else {
+        if (slot->error == IMGCONV_OK && !closed) {
+            slot->error = IMGCONV_ERROR_WRITE;
+        }
+        count_slot(slot, stats);
+        queue_push(&batch->free_slots, slot);
+    }
+    return 1;
+}
+
+
+/**
+ * @brief First and third stage with io_uring: reads the input files and writes the converted images.
+ *
+ * @param batch The batch with running workers.
+ * @param ring The ring, with room for two operations of every slot and one more.
+ * @param direct 1 to read large files with O_DIRECT.
+ * @param stats The statistics.
+ *
+ * @return 1 on success, 0 if the ring failed.
+ *
+ * Every free slot starts the read of the next input at once and every converted
+ * slot starts its writes, so the reads and writes of all slots are in flight
+ * at the same time while the workers convert. A read of the eventfd the
+ * workers write to wakes the thread when a slot is converted.
+ */
+
+static int uring_stage(Batch *batch, IoRing *ring, int direct, BatchStats *stats) {
+    uint64_t wake_count;
+    int wake_armed = 0;
+    int inputs_done = 0;
+    int markers_sent = 0;
+    int workers_done = 0;
+    size_t reads = 0;            // slots with a read in flight
+    size_t busy = 0;             // slots with operations in flight
+
+    while (1) {
+        Slot *slot;
+        while (!inputs_done && queue_try_pop(&batch->free_slots, &slot)) {
+            const char *input = next_input(batch);
+            if (!input) {
+                inputs_done = 1;
+                queue_push(&batch->free_slots, slot);
+                break;
+            }
+            if (prepare_slot(batch, slot, input) && start_read(batch, ring, slot, direct)) {
+                reads++;
+                busy++;
+            } else {
+                queue_push(&batch->decoded, slot);
+            }
+        }
+        // one end marker for every worker, behind the slot of the last read
+        if (inputs_done && !reads && !markers_sent) {
+            for (int t = 0; t < batch->workers; t++) {
+                queue_push(&batch->decoded, NULL);
+            }
+            markers_sent = 1;
+        }
+
+        while (!workers_done && queue_try_pop(&batch->converted, &slot)) {
+            if (!slot) {
+                workers_done = 1;
+            } else if (slot->error == IMGCONV_OK && start_write(ring, slot)) {
+                busy++;
+            } else {
+                count_slot(slot, stats);
+                queue_push(&batch->free_slots, slot);
+            }
+        }
+
+        if (inputs_done && workers_done && !busy) {
+            return 1;
+        }
+        if (!wake_armed) {
+            wake_armed = ring_queue(ring, IO_RING_READ, batch->wake_fd, &wake_count, sizeof(wake_count), 0, -1, 0);
+        }
+        if (!wake_armed || !ring_submit(ring, 1)) {
+            fprintf(stderr, "io_uring failed\n");
+            if (!markers_sent) {
+                for (int t = 0; t < batch->workers; t++) {
+                    queue_push(&batch->decoded, NULL);
+                }
+            }
+            return 0;
+        }
+
+        uint64_t user_data;
+        int32_t result;
+        while (ring_complete(ring, &user_data, &result)) {
+            if (!user_data) {
+                wake_armed = 0;
+                continue;
+            }
+            Transfer *transfer = (Transfer *) (uintptr_t) user_data;
+            // read before the slot is handed to a worker
+            int reading = transfer->slot->reading;
+            if (complete_transfer(batch, ring, transfer, result, stats)) {
+                reads -= (size_t) reading;
+                busy--;
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Converts many PPM files with a pipeline of reading, converting and writing threads.
+ *
+ * @param inputs The input files.
+ * @param output Directory for the output files or a name template containing %s.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param workers Number of conversion threads.
+ * @param io The I/O backend, io_uring falls back to stdio if the kernel does not support it.
+ * @param stats Pointer where the throughput statistics will be stored.
+ *
+ * @return 1 if every image was converted, 0 otherwise.
+ *
+ * The files pass through three stages: one thread reads and decodes them, the
+ * workers convert them with the kernels of version 0 and the calling thread
+ * writes them. With io_uring the calling thread does both the reading and the
+ * writing and keeps the transfers of BATCH_URING_SLOTS_PER_WORKER images per
+ * worker in flight. Otherwise BATCH_SLOTS_PER_WORKER images per worker are in flight; every
+ * slot owns a libimgconv context whose buffers are reused for the next image.
+ * A context that needs larger buffers returns its old ones to a pool shared by
+ * all slots, so the pipeline stops allocating once the mix of sizes has been seen.
+ * Files that fail are reported and skipped.
+ */
+
+int batch_convert(const BatchInputs *inputs, const char *output, float a, float b, float c, int16_t brightness,
+                  float contrast, int workers, BatchIo io, BatchStats *stats) {
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    memset(stats, 0, sizeof(*stats));
+
+    Batch batch = {0};
+    batch.inputs = inputs;
+    batch.output = output;
+    batch.output_is_template = strstr(output, "%s") != NULL;
+    batch.wake_fd = -1;
+
+    struct stat st;
+    if (!batch.output_is_template && (stat(output, &st) || !S_ISDIR(st.st_mode))) {
+        fprintf(stderr, "Batch output '%s' must be a directory or a name template containing %%s\n", output);
+        return 0;
+    }
+
+    size_t num_workers = workers < 1 ? 1 : (size_t) workers;
+    IoRing ring = {.fd = -1};
+    if (io != BATCH_IO_STDIO) {
+        size_t uring_slots = BATCH_URING_SLOTS_PER_WORKER * num_workers + 2;
+        // two writes for every slot and the read of the eventfd
+        if (ring_init(&ring, (unsigned) (2 * uring_slots + 1)) &&
+            (batch.wake_fd = eventfd(0, EFD_CLOEXEC)) >= 0) {
+            ring_register_buffers(&ring, (unsigned) (2 * uring_slots));
+        } else {
+            fprintf(stderr, "io_uring is not available, using stdio\n");
+            ring_destroy(&ring);
+            io = BATCH_IO_STDIO;
+        }
+    }
+    size_t num_slots = (io == BATCH_IO_STDIO ? BATCH_SLOTS_PER_WORKER : BATCH_URING_SLOTS_PER_WORKER) * num_workers + 2;
+    Slot *slots = calloc(num_slots, sizeof(Slot));
+    pthread_t *threads = malloc(num_workers * sizeof(pthread_t));
+    int queues_ok = queue_init(&batch.free_slots, num_slots);
+    queues_ok &= queue_init(&batch.decoded, num_slots + num_workers);
+    queues_ok &= queue_init(&batch.converted, num_slots + 1);
+    // room for every buffer of the slots, so the pool never frees one and a
+    // registered buffer is never unmapped while the ring is set up
+    queues_ok &= pool_init(&batch.pool, 3 * num_slots);
+    pthread_mutex_init(&batch.finished_mutex, NULL);
+
+    int success = slots && threads && queues_ok;
+    if (!success) {
+        fprintf(stderr, "Failed to allocate memory for batch\n");
+    }
+
+    for (size_t s = 0; success && s < num_slots; s++) {
+        if (imgconv_init(&slots[s].ctx, a, b, c, brightness, contrast, NULL) != IMGCONV_OK) {
+            fprintf(stderr, "Invalid conversion parameters\n");
+            success = 0;
+        }
+        imgconv_use_pool(&slots[s].ctx, &batch.pool);
+        slots[s].index = s;
+        queue_push(&batch.free_slots, &slots[s]);
+    }
+
+    // the workers wait for the reader, so they are started first
+    for (size_t t = 0; success && t < num_workers; t++) {
+        if (pthread_create(&threads[t], NULL, convert_stage, &batch)) {
+            break;
+        }
+        batch.workers++;
+    }
+    pthread_t reader;
+    if (success && !batch.workers) {
+        fprintf(stderr, "Failed to create threads for batch\n");
+        success = 0;
+    } else if (success && io != BATCH_IO_STDIO) {
+        // first and third stage in the calling thread
+        if (!uring_stage(&batch, &ring, io == BATCH_IO_URING_DIRECT, stats)) {
+            success = -1;
+        }
+        // the workers may still hold slots if the ring failed
+        for (int t = 0; t < batch.workers; t++) {
+            pthread_join(threads[t], NULL);
+        }
+        success = success == 1 && !stats->failed;
+    } else if (success && pthread_create(&reader, NULL, read_stage, &batch)) {
+        fprintf(stderr, "Failed to create threads for batch\n");
+        for (int t = 0; t < batch.workers; t++) {
+            queue_push(&batch.decoded, NULL);
+        }
+        success = -1;
+    }
+
+    if (success && io == BATCH_IO_STDIO) {
+        // third stage: write the converted images and hand the slots back to the reader
+        Slot *slot;
+        while ((slot = queue_pop(&batch.converted))) {
+            if (slot->error == IMGCONV_OK) {
+                slot->error = imgconv_encode(&slot->ctx, slot->output);
+            }
+            count_slot(slot, stats);
+            queue_push(&batch.free_slots, slot);
+        }
+
+        if (success == 1) {
+            pthread_join(reader, NULL);
+        }
+        for (int t = 0; t < batch.workers; t++) {
+            pthread_join(threads[t], NULL);
+        }
+        success = success == 1 && !stats->failed;
+    }
+
+    // unregisters the buffers before they are freed
+    ring_destroy(&ring);
+    if (batch.wake_fd >= 0) {
+        close(batch.wake_fd);
+    }
+    for (size_t s = 0; slots && s < num_slots; s++) {
+        imgconv_free(&slots[s].ctx);
+        pool_release(&batch.pool, &slots[s].file);
+    }
+    pool_destroy(&batch.pool);
+    queue_destroy(&batch.free_slots);
+    queue_destroy(&batch.decoded);
+    queue_destroy(&batch.converted);
+    pthread_mutex_destroy(&batch.finished_mutex);
+    free(batch.line);
+    free(slots);
+    free(threads);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    stats->seconds = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
+    return success;
+}
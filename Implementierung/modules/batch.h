@@ -0,0 +1,60 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifndef TEAM120_BATCH_H
+#define TEAM120_BATCH_H
+
+// images in flight per conversion worker, so reading and writing overlap the conversion
+#define BATCH_SLOTS_PER_WORKER 2
+
+// images in flight per conversion worker with io_uring, so the device queue is kept busy
+#define BATCH_URING_SLOTS_PER_WORKER 8
+
+// input files of at least this size are read with O_DIRECT by BATCH_IO_URING_DIRECT
+#define BATCH_DIRECT_BYTES ((size_t) 4 << 20)
+
+// alignment of the offset, length and buffer of a read with O_DIRECT
+#define BATCH_DIRECT_ALIGNMENT 4096
+
+typedef enum {
+    BATCH_IO_STDIO,             // one thread reads with stdio, the calling thread writes
+    BATCH_IO_URING,             // the calling thread keeps the reads and writes of all slots in flight
+    BATCH_IO_URING_DIRECT,      // like BATCH_IO_URING, large files are read past the page cache
+} BatchIo;
+
+typedef struct {
+    char **names;               // input files given on the command line
+    size_t count;
+    FILE *manifest;             // file with one input file per line, read after names. May be NULL.
+} BatchInputs;
+
+typedef struct {
+    size_t images;              // number of converted images
+    size_t failed;              // number of skipped images
+    size_t bytes;               // bytes of rgb values read
+    double seconds;             // wall clock time of the whole batch
+} BatchStats;
+
+
+/**
+ * @brief Converts many PPM files with a pipeline of reading, converting and writing threads.
+ *
+ * @param inputs The input files.
+ * @param output Directory for the output files or a name template containing %s.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param workers Number of conversion threads.
+ * @param io The I/O backend, io_uring falls back to stdio if the kernel does not support it.
+ * @param stats Pointer where the throughput statistics will be stored.
+ *
+ * @return 1 if every image was converted, 0 otherwise.
+ */
+
+int batch_convert(const BatchInputs *inputs, const char *output, float a, float b, float c, int16_t brightness,
+                  float contrast, int workers, BatchIo io, BatchStats *stats);
+
+#endif
@@ -0,0 +1,295 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "benchmark.h"
+#include "brightness_contrast.h"
+#include "brightness_contrast_mt.h"
+#include "brightness_contrast_opencl.h"
+#include "brightness_contrast_simd.h"
+#include "buffer_pool.h"
+
+
+/**
+ * @brief Reads the time stamp counter.
+ *
+ * @return The counter, 0 on architectures without one.
+ */
+
+static uint64_t read_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+
+/**
+ * @brief Runs one conversion with the version it names.
+ *
+ * @param conversion The conversion.
+ *
+ * @return 1 if the conversion was successful, 0 otherwise.
+ */
+
+int run_conversion(const Conversion *conversion) {
+    // grey input has no grey pass, every version only applies the lookup table
+    if (conversion->grey) {
+        return brightness_contrast_grey(conversion->img, conversion->width, conversion->height,
+                                        conversion->brightness, conversion->contrast, conversion->result);
+    }
+    switch (conversion->version) {
+        case 4:
+            return brightness_contrast_V4(conversion->img, conversion->width, conversion->height,
+                                          conversion->a, conversion->b, conversion->c,
+                                          conversion->brightness, conversion->contrast, conversion->result);
+        case 3:
+            return brightness_contrast_V3(conversion->img, conversion->width, conversion->height,
+                                          conversion->a, conversion->b, conversion->c,
+                                          conversion->brightness, conversion->contrast, conversion->result,
+                                          conversion->threads);
+        case 2:
+            return brightness_contrast_V2(conversion->img, conversion->width, conversion->height,
+                                          conversion->a, conversion->b, conversion->c,
+                                          conversion->brightness, conversion->contrast, conversion->result);
+        case 1:
+            return brightness_contrast_V1(conversion->img, conversion->width, conversion->height,
+                                          conversion->a, conversion->b, conversion->c,
+                                          conversion->brightness, conversion->contrast, conversion->result);
+        case 0:
+        default:
+            if (conversion->maxval > 255) {
+                return brightness_contrast_V0_16(conversion->img, conversion->width, conversion->height,
+                                                 conversion->maxval, conversion->a, conversion->b, conversion->c,
+                                                 conversion->brightness, conversion->contrast, conversion->wide,
+                                                 conversion->result);
+            }
+            if (conversion->precise) {
+                return brightness_contrast_V0_precise(conversion->img, conversion->width, conversion->height,
+                                                      conversion->a, conversion->b, conversion->c,
+                                                      conversion->brightness, conversion->contrast,
+                                                      conversion->result);
+            }
+            if (conversion->sample_rate) {
+                return brightness_contrast_V0_sampled(conversion->img, conversion->width, conversion->height,
+                                                      conversion->a, conversion->b, conversion->c,
+                                                      conversion->brightness, conversion->contrast,
+                                                      conversion->sample_rate, conversion->statistics,
+                                                      conversion->result);
+            }
+            return brightness_contrast_V0(conversion->img, conversion->width, conversion->height,
+                                          conversion->a, conversion->b, conversion->c,
+                                          conversion->brightness, conversion->contrast, conversion->result);
+    }
+}
+
+
+/**
+ * @brief Compares two times for qsort().
+ */
+
+static int compare_times(const void *x, const void *y) {
+    double a = *(const double *) x;
+    double b = *(const double *) y;
+    return (a > b) - (a < b);
+}
+
+
+/**
+ * @brief Returns a percentile of sorted times using the nearest rank.
+ *
+ * @param sorted The times in ascending order.
+ * @param n Number of times, at least 1.
+ * @param percent The percentile in (0, 100].
+ *
+ * @return The smallest time that is not exceeded by percent percent of all times.
+ */
+
+static double percentile(const double *sorted, int n, int percent) {
+    int rank = (n * percent + 99) / 100;
+    return sorted[rank < 1 ? 0 : rank - 1];
+}
+
+
+/**
+ * @brief Returns the median of sorted values.
+ *
+ * @param sorted The values in ascending order.
+ * @param n Number of values, at least 1.
+ *
+ * @return The middle value or the mean of both middle values.
+ */
+
+static double median(const double *sorted, int n) {
+    return n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+}
+
+
+/**
+ * @brief Measures a conversion.
+ *
+ * @param conversion The conversion to be measured.
+ * @param config Number of iterations and warmup iterations, cache flushing.
+ * @param result Pointer where the statistics will be stored, free with free_benchmark().
+ *
+ * @return 1 if every iteration was successful, 0 otherwise.
+ *
+ * The warmup iterations are run first and not measured. Every measured
+ * iteration is timed on its own with CLOCK_MONOTONIC and the time stamp counter.
+ * Throughput and cycles per pixel are derived from the medians.
+ * If caches are flushed, a buffer of BENCHMARK_FLUSH_BYTES is written before
+ * every iteration, outside of the measurement, so every iteration starts cold.
+ */
+
+int benchmark_conversion(const Conversion *conversion, const BenchmarkConfig *config, BenchmarkResult *result) {
+
+    memset(result, 0, sizeof(*result));
+    int n = config->iterations < 1 ? 1 : config->iterations;
+    result->times = malloc(n * sizeof(double));
+    double *sorted = malloc(2 * n * sizeof(double));
+    double *cycles = sorted + n;
+    PoolBuffer flush = {NULL, 0};
+    if (!result->times || !sorted || (config->flush_cache && !buffer_alloc(BENCHMARK_FLUSH_BYTES, &flush))) {
+        fprintf(stderr, "Failed to allocate memory for benchmark\n");
+        free(sorted);
+        free_benchmark(result);
+        return 0;
+    }
+
+    for (int i = 0; i < config->warmup; i++) {
+        if (!run_conversion(conversion)) {
+            free(sorted);
+            buffer_free(&flush);
+            free_benchmark(result);
+            return 0;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (flush.data) {
+            // a new value every iteration, so the writes can not be skipped
+            memset(flush.data, i, BENCHMARK_FLUSH_BYTES);
+        }
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        uint64_t cycles_start = read_cycles();
+        int exec_res = run_conversion(conversion);
+        cycles[i] = (double) (read_cycles() - cycles_start);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        if (!exec_res) {
+            free(sorted);
+            buffer_free(&flush);
+            free_benchmark(result);
+            return 0;
+        }
+        result->times[i] = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
+        result->total += result->times[i];
+    }
+    buffer_free(&flush);
+
+    memcpy(sorted, result->times, n * sizeof(double));
+    qsort(sorted, n, sizeof(double), compare_times);
+    qsort(cycles, n, sizeof(double), compare_times);
+
+    double pixels = (double) conversion->width * (double) conversion->height;
+    result->iterations = n;
+    result->mean = result->total / n;
+    result->min = sorted[0];
+    result->median = median(sorted, n);
+    result->p95 = percentile(sorted, n, 95);
+    result->p99 = percentile(sorted, n, 99);
+    result->max = sorted[n - 1];
+    result->pixels_per_second = pixels / result->median;
+    int sample_bytes = conversion->maxval > 255 ? 2 : 1;
+    int samples = conversion->grey ? 1 : 3;
+    result->bytes_per_second = (samples * sample_bytes + (conversion->wide ? 2 : 1)) * pixels / result->median;
+    result->cycles_per_pixel = cycles[n - 1] > 0 ? median(cycles, n) / pixels : -1.0;
+    free(sorted);
+    return 1;
+}
+
+
+/**
+ * @brief Prints the statistics of a benchmark as text.
+ *
+ * @param result The statistics.
+ */
+
+void print_benchmark_text(const BenchmarkResult *result) {
+    printf("Per iteration: min %f, median %f, p95 %f, p99 %f, max %f seconds. ",
+           result->min, result->median, result->p95, result->p99, result->max);
+    printf("%.1f Mpixel/s, %.2f GB/s", result->pixels_per_second / 1e6, result->bytes_per_second / 1e9);
+    if (result->cycles_per_pixel >= 0) {
+        printf(", %.2f cycles/pixel", result->cycles_per_pixel);
+    }
+    printf(" (median)\n");
+}
+
+
+/**
+ * @brief Prints a benchmark as one JSON object on one line.
+ *
+ * @param conversion The measured conversion.
+ * @param config The configuration of the benchmark.
+ * @param kernels Name of the kernels used by versions 0 and 3.
+ * @param result The statistics.
+ *
+ * Times are given in seconds, every measured iteration is listed in "times".
+ */
+
+void print_benchmark_json(const Conversion *conversion, const BenchmarkConfig *config, const char *kernels,
+                          const BenchmarkResult *result) {
+    printf("{\"version\":%d,", conversion->version);
+    if (conversion->version == 0 || conversion->version == 3) {
+        printf("\"kernels\":\"%s\",", kernels);
+    } else {
+        printf("\"kernels\":null,");
+    }
+    printf("\"threads\":%d,\"width\":%zu,\"height\":%zu,\"maxval\":%u,",
+           conversion->version == 3 ? conversion->threads : 1, conversion->width, conversion->height, conversion->maxval);
+    printf("\"brightness\":%d,", conversion->brightness);
+    if (isnan(conversion->contrast)) {
+        printf("\"contrast\":null,");
+    } else {
+        printf("\"contrast\":%g,", conversion->contrast);
+    }
+    printf("\"sample_rate\":%zu,", conversion->sample_rate);
+    printf("\"iterations\":%d,\"warmup\":%d,\"flush_cache\":%s,",
+           result->iterations, config->warmup, config->flush_cache ? "true" : "false");
+    printf("\"total\":%.9f,\"mean\":%.9f,\"min\":%.9f,\"median\":%.9f,\"p95\":%.9f,\"p99\":%.9f,\"max\":%.9f,",
+           result->total, result->mean, result->min, result->median, result->p95, result->p99, result->max);
+    printf("\"pixels_per_second\":%.1f,\"bytes_per_second\":%.1f,",
+           result->pixels_per_second, result->bytes_per_second);
+    if (result->cycles_per_pixel >= 0) {
+        printf("\"cycles_per_pixel\":%.4f,", result->cycles_per_pixel);
+    } else {
+        printf("\"cycles_per_pixel\":null,");
+    }
+    printf("\"times\":[");
+    for (int i = 0; i < result->iterations; i++) {
+        printf(i ? ",%.9f" : "%.9f", result->times[i]);
+    }
+    printf("]}\n");
+}
+
+
+/**
+ * @brief Frees the per-iteration times of a benchmark.
+ *
+ * @param result The statistics.
+ */
+
+void free_benchmark(BenchmarkResult *result) {
+    free(result->times);
+    result->times = NULL;
+}
@@ -0,0 +1,98 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "brightness_contrast_simd.h"
+
+#ifndef TEAM120_BENCHMARK_H
+#define TEAM120_BENCHMARK_H
+
+// size of the buffer written between iterations to evict the image from the caches
+#define BENCHMARK_FLUSH_BYTES ((size_t) 64 << 20)
+
+typedef struct {
+    int version;                // version 0 to 3 of the implementation
+    int threads;                // threads of version 3
+    const uint8_t *img;
+    size_t width, height;
+    float a, b, c;
+    int16_t brightness;
+    float contrast;             // NaN if the contrast is not adjusted
+    uint8_t *result;
+    unsigned maxval;            // maximum color value, above 255 only supported by version 0
+    int wide;                   // 1 if the result holds 16 bit samples, only for maxval above 255
+    int precise;                // 1 for the results of version 1 with version 0, only for maxval up to 255
+    size_t sample_rate;         // 0 for exact statistics, else see brightness_contrast_V0_sampled()
+    SampledStatistics *statistics;  // estimated statistics of the last conversion with a sample rate, may be NULL
+    int grey;                   // 1 if img holds one grey value per pixel, e.g. the luma of a JPEG image
+} Conversion;
+
+typedef struct {
+    int iterations;             // measured iterations
+    int warmup;                 // iterations run before the measurement
+    int flush_cache;            // 1 to evict the caches before every iteration
+} BenchmarkConfig;
+
+typedef struct {
+    int iterations;
+    double *times;              // seconds of every measured iteration
+    double total, mean, min, median, p95, p99, max;
+    double pixels_per_second;   // at the median time
+    double bytes_per_second;    // 3 samples (1 for grey input) read and 1 grey value written per pixel, at the median time
+    double cycles_per_pixel;    // median time stamp counter cycles, negative if not available
+} BenchmarkResult;
+
+
+/**
+ * @brief Runs one conversion with the version it names.
+ *
+ * @param conversion The conversion.
+ *
+ * @return 1 if the conversion was successful, 0 otherwise.
+ */
+
+int run_conversion(const Conversion *conversion);
+
+
+/**
+ * @brief Measures a conversion.
+ *
+ * @param conversion The conversion to be measured.
+ * @param config Number of iterations and warmup iterations, cache flushing.
+ * @param result Pointer where the statistics will be stored, free with free_benchmark().
+ *
+ * @return 1 if every iteration was successful, 0 otherwise.
+ */
+
+int benchmark_conversion(const Conversion *conversion, const BenchmarkConfig *config, BenchmarkResult *result);
+
+
+/**
+ * @brief Prints the statistics of a benchmark as text.
+ *
+ * @param result The statistics.
+ */
+
+void print_benchmark_text(const BenchmarkResult *result);
+
+
+/**
+ * @brief Prints a benchmark as one JSON object on one line.
+ *
+ * @param conversion The measured conversion.
+ * @param config The configuration of the benchmark.
+ * @param kernels Name of the kernels used by versions 0 and 3.
+ * @param result The statistics.
+ */
+
+void print_benchmark_json(const Conversion *conversion, const BenchmarkConfig *config, const char *kernels,
+                          const BenchmarkResult *result);
+
+
+/**
+ * @brief Frees the per-iteration times of a benchmark.
+ *
+ * @param result The statistics.
+ */
+
+void free_benchmark(BenchmarkResult *result);
+
+#endif
@@ -1,6 +1,8 @@
 #include "brightness_contrast.h"
 #include <stdio.h>
 #include <math.h>
+#include "histogram.h"
+#include "instrument.h"
 #include "util.h"
 
 
@@ -24,7 +26,10 @@
  * The coefficients for grayscale conversion are normalized so their sum equals 1.
  * Depending on whether the contrast is set to NaN and brightness to 0, the function
  * handles four different cases: grayscale conversion only, grayscale with brightness,
- * grayscale with contrast, and grayscale with both brightness and contrast.
+ * grayscale with contrast, and grayscale with both brightness and contrast. Each
+ * case is a variant of grey_pass_precise_scalar chosen once before the conversion.
+ * For the contrast cases a histogram of the grey values is collected during the
+ * conversion, from which mean and variance are derived without another pass.
  * If the computation for contrast fails, it will output an error message and return 0.
  * The function uses a lookup table for efficient contrast adjustment.
  */
@@ -37,101 +42,41 @@ brightness_contrast_V1(const uint8_t *img, size_t width, size_t height, float a,
     size_t wh = width * height;
 
     // normalise parameters
-    // sum = 0 checked already in util.c > checkParams()
+    // sum = 0 checked already in cli.c > checkParams()
     float sum = a + b + c;
-    a /= sum;
-    b /= sum;
-    c /= sum;
+    float coeffs[3] = {a / sum, b / sum, c / sum};
 
-    float res;
+    // the variant for the case is chosen once, see grey_pass.h
+    PHASE_BEGIN(PHASE_GREY);
+    GreyPassPrecise grey_pass = grey_pass_precise_scalar[grey_pass_index(brightness != 0, !isnan(contrast))];
     if (isnan(contrast)) {
-        if (!brightness) {
-            // Case 0: Grey Scale
-            for (size_t i = 0; i < wh; i++) {
-                res = (a * img[i * 3] + b * img[i * 3 + 1] + c * img[i * 3 + 2]);
-                result[i] = (uint8_t) res;
-            }
-        } else {
-            // Case 1: Grey Scale + Brightness
-            for (size_t i = 0; i < wh; i++) {
-
-                res = (a * img[i * 3] + b * img[i * 3 + 1] + c * img[i * 3 + 2]);
-                res += brightness;
-                if (res > 255) {
-                    result[i] = 255;
-                } else if (res < 0) {
-                    result[i] = 0;
-                } else {
-                    result[i] = (uint8_t) res;
-                }
-            }
-        }
+        grey_pass(img, wh, coeffs, brightness, NULL, result);
+        PHASE_END(PHASE_GREY);
     } else {
-        double mean = 0.0;
-        double var = 0.0;
-
-        if (!brightness) {
-            // Case 3: Grey Scale + Contrast
-            for (size_t i = 0; i < wh; i++) {
-                res = (a * img[i * 3] + b * img[i * 3 + 1] + c * img[i * 3 + 2]);
-                result[i] = (uint8_t) res;
-                mean += (uint8_t) res;
-            }
-        } else {
-            // Case 2: Grey Scale + Brightness + Contrast
-            for (size_t i = 0; i < wh; i++) {
-                res = (a * img[i * 3] + b * img[i * 3 + 1] + c * img[i * 3 + 2]);
-                res += brightness;
-                if (res > 255) {
-                    result[i] = 255;
-                    mean += 255;
-                } else if (res < 0) {
-                    result[i] = 0;
-                } else {
-                    result[i] = (uint8_t) res;
-                    mean += (uint8_t) res;
-                }
-            }
+        // grey values are counted into sub-histograms, merged every HISTOGRAM_CHUNK pixels
+        uint64_t histogram[256] = {0};
+        SubHistograms hist = {{0}};
+        for (size_t i = 0; i < wh; i += HISTOGRAM_CHUNK) {
+            size_t chunk = wh - i < HISTOGRAM_CHUNK ? wh - i : HISTOGRAM_CHUNK;
+            grey_pass(img + 3 * i, chunk, coeffs, brightness, hist, result + i);
+            histogram_merge(histogram, hist);
         }
-        mean /= wh;
+        PHASE_END(PHASE_GREY);
 
-        // Calculate Variance
-        for (size_t i = 0; i < wh; i++) {
-            var += (result[i] - mean) * (result[i] - mean);
-        }
-        var /= wh;
-
-        float kstd = 0.0;
-        if (var != 0.0) {        // if var = 0 => kstd = 0 (Aufgabenstellung)
-            kstd = contrast / sqrtHeron(var);                // k/std = k / sqrt(var)
-            if (isnan(kstd) || isinf(kstd)) {
-                fprintf(stderr, "computation for contrast failed\n");
-                return 0;
-            }
-        }
-
-        float summand = (1 - kstd) * mean;                // pre calculation of (1-kstd)*mean
-        if (isnan(summand) || isinf(summand)) {
-            fprintf(stderr, "computation for contrast failed\n");
+        // build lookup table for contrast adjustment from the exact mean and variance
+        PHASE_BEGIN(PHASE_STATISTICS);
+        uint8_t lookup[256];
+        if (!build_contrast_lookup(histogram, contrast, lookup)) {
             return 0;
         }
+        PHASE_END(PHASE_STATISTICS);
 
-        // build lookup table for contrast adjustment
-        uint8_t lookup[256];
-        for (size_t i = 0; i < 256; i++) {
-            res = kstd * i + summand;                    // new_val = kstd * pix + (1-kstd)*mean
-            if (res > 255) {
-                lookup[i] = 255;
-            } else if (res < 0) {
-                lookup[i] = 0;
-            } else {
-                lookup[i] = (uint8_t) res;
-            }
-        }
         //use lookup table to adjust contrast
+        PHASE_BEGIN(PHASE_CONTRAST);
         for (size_t i = 0; i < wh; i++) {
             result[i] = lookup[result[i]];
         }
+        PHASE_END(PHASE_CONTRAST);
     }
     return 1;
 }
@@ -165,6 +110,7 @@ brightness_contrast_V2(const uint8_t *img, size_t width, size_t height, float a,
     double var = 0.0;
 
     // convert to grey scale
+    PHASE_BEGIN(PHASE_GREY);
     for (size_t i = 0; i < wh; i++) {
         // overflow for 3*width*height checked in main.c > readPPM()
         res = (a * img[i * 3] + b * img[i * 3 + 1] + c * img[i * 3 + 2]) / (a + b + c);
@@ -184,9 +130,11 @@ brightness_contrast_V2(const uint8_t *img, size_t width, size_t height, float a,
             }
         }
     }
+    PHASE_END(PHASE_GREY);
 
     if (!isnan(contrast)) {
         //calculate mean
+        PHASE_BEGIN(PHASE_STATISTICS);
         for (size_t i = 0; i < wh; i++) {
             mean += result[i];
         }
@@ -212,7 +160,9 @@ brightness_contrast_V2(const uint8_t *img, size_t width, size_t height, float a,
             fprintf(stderr, "computation for contrast failed\n");
             return 0;
         }
+        PHASE_END(PHASE_STATISTICS);
 
+        PHASE_BEGIN(PHASE_CONTRAST);
         for (size_t i = 0; i < wh; i++) {
             res = kstd * result[i] + (1 - kstd) * mean;
             if (res > 255) {
@@ -223,6 +173,233 @@ brightness_contrast_V2(const uint8_t *img, size_t width, size_t height, float a,
                 result[i] = (uint8_t) res;
             }
         }
+        PHASE_END(PHASE_CONTRAST);
     }
     return 1;
 }
+
+
+
+/**
+ * @brief Converts a range of pixels to grey scale and applies the brightness without SIMD operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range, at most HISTOGRAM_CHUNK if hist is set.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param hist If not NULL, the grey values are counted into these sub-histograms for the contrast calculation.
+ * @param result Pointer to the first grey value of the range.
+ *
+ * @param with_brightness, with_histogram Constant in every variant, see DEFINE_GREY_PASS_VARIANTS().
+ *
+ * Fallback for CPUs without SSE4.2. Uses the same integer arithmetic as the SIMD
+ * kernels, so the result is identical to grey_pass_V0. The SIMD kernels
+ * convert their remaining pixels with it. Without brightness the grey values
+ * cannot exceed 255, so the clamping is skipped.
+ */
+
+__attribute__((always_inline))
+static inline void grey_pass_scalar_body(const uint8_t *img, size_t n, const uint16_t *coeffs, int16_t brightness,
+                                         SubHistograms hist, uint8_t *result, const int with_brightness,
+                                         const int with_histogram) {
+
+    // stores to result may alias coeffs, local copies keep them in registers
+    int a = coeffs[0];
+    int b = coeffs[1];
+    int c = coeffs[2];
+
+    int res;
+    for (size_t i = 0; i < n; i++) {
+        res = (a * img[i * 3] + b * img[i * 3 + 1] + c * img[i * 3 + 2]) / 256;
+        if (with_brightness) {
+            res += brightness;
+            if (res > 255) {
+                res = 255;
+            } else if (res < 0) {
+                res = 0;
+            }
+        }
+        result[i] = (uint8_t) res;
+    }
+
+    if (with_histogram) {
+        histogram_count(hist, result, n);
+    }
+}
+
+DEFINE_GREY_PASS_VARIANTS(, GreyPass, uint16_t, grey_pass_scalar, grey_pass_scalar_body)
+
+
+/**
+ * @brief Replaces every grey value of a range by its entry in the lookup table without SIMD operations.
+ *
+ * @param pixels Pointer to the first grey value of the range.
+ * @param n Number of grey values in the range.
+ * @param lookup Lookup table with 256 entries.
+ */
+
+void apply_lookup_scalar(uint8_t *pixels, size_t n, const uint8_t *lookup) {
+    for (size_t i = 0; i < n; i++) {
+        pixels[i] = lookup[pixels[i]];
+    }
+}
+
+
+/**
+ * @brief Converts a range of pixels with 16 bit samples to grey scale and applies the brightness without SIMD operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range, every sample stored in two bytes, most significant first.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value, scaled to maxval.
+ * @param maxval Maximum color value of the image, the grey values are clamped to [0,maxval].
+ * @param result Pointer to the first grey value of the range.
+ *
+ * Fallback for CPUs without SSE4.2 and reference for the SIMD kernels. The
+ * weighted sum of three samples is below 2^25 and fits into 32 bit.
+ */
+
+void grey_pass_16_scalar(const uint8_t *img, size_t n, const uint16_t *coeffs, int32_t brightness, uint16_t maxval,
+                         uint16_t *result) {
+
+    int32_t res;
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t *p = img + 6 * i;
+        int32_t red = (p[0] << 8) | p[1];
+        int32_t green = (p[2] << 8) | p[3];
+        int32_t blue = (p[4] << 8) | p[5];
+        res = (coeffs[0] * red + coeffs[1] * green + coeffs[2] * blue) / 256;
+        res += brightness;
+        if (res > maxval) {
+            res = maxval;
+        } else if (res < 0) {
+            res = 0;
+        }
+        result[i] = (uint16_t) res;
+    }
+}
+
+
+/**
+ * @brief Converts a range of pixels to grey scale with the float arithmetic of Version 1 without SIMD operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range, at most HISTOGRAM_CHUNK if hist is set.
+ * @param coeffs Coefficients normalised to a sum of 1 like in brightness_contrast_V1().
+ * @param brightness Brightness adjustment value.
+ * @param hist If not NULL, the grey values are counted into these sub-histograms for the contrast calculation.
+ * @param result Pointer to the first grey value of the range.
+ *
+ * @param with_brightness, with_histogram Constant in every variant, see DEFINE_GREY_PASS_VARIANTS().
+ *
+ * Conversion of brightness_contrast_V1() and reference for the precise SIMD
+ * kernels. The operations are executed in the order of the SIMD kernels, so
+ * the results are identical. The coefficients are not negative and sum up to
+ * 1, so without brightness the grey values need no clamping.
+ */
+
+__attribute__((always_inline))
+static inline void grey_pass_precise_scalar_body(const uint8_t *img, size_t n, const float *coeffs,
+                                                 int16_t brightness, SubHistograms hist, uint8_t *result,
+                                                 const int with_brightness, const int with_histogram) {
+
+    // stores to result may alias coeffs, local copies keep them in registers
+    float a = coeffs[0];
+    float b = coeffs[1];
+    float c = coeffs[2];
+
+    float res;
+    for (size_t i = 0; i < n; i++) {
+        res = (a * img[i * 3] + b * img[i * 3 + 1] + c * img[i * 3 + 2]);
+        if (with_brightness) {
+            res += brightness;
+            if (res > 255) {
+                result[i] = 255;
+            } else if (res < 0) {
+                result[i] = 0;
+            } else {
+                result[i] = (uint8_t) res;
+            }
+        } else {
+            result[i] = (uint8_t) res;
+        }
+    }
+
+    if (with_histogram) {
+        histogram_count(hist, result, n);
+    }
+}
+
+DEFINE_GREY_PASS_VARIANTS(, GreyPassPrecise, float, grey_pass_precise_scalar, grey_pass_precise_scalar_body)
+
+
+/**
+ * @brief Parses the ascii samples of a plain PPM image without SIMD operations.
+ *
+ * @param text Pointer to the text, starting at a whitespace or at the first digit of a sample.
+ * @param length Number of bytes of text.
+ * @param maxval Maximum value of a sample.
+ * @param samples Pointer where the parsed samples will be stored.
+ * @param count Maximum number of samples to be parsed.
+ * @param parsed Pointer where the number of parsed samples will be stored.
+ *
+ * @return Number of bytes of text consumed, the text continues behind the last parsed sample.
+ *
+ * Only the common case is parsed: samples of at most three digits separated by
+ * spaces, tabs, carriage returns and line feeds. The parser stops in front of
+ * anything else, e.g. a comment, a sample above maxval, an invalid character or
+ * a sample that touches the end of text and may continue in the next block.
+ * The caller handles this case and reports errors.
+ */
+
+size_t parse_plain_scalar(const uint8_t *text, size_t length, uint8_t maxval, uint8_t *samples, size_t count,
+                          size_t *parsed) {
+
+    size_t pos = 0;
+    size_t done = 0;
+    while (done < count) {
+        size_t start = pos;
+        while (start < length && (text[start] == ' ' || text[start] == '\t' || text[start] == '\r' ||
+                                  text[start] == '\n')) {
+            start++;
+        }
+        size_t end = start;
+        unsigned value = 0;
+        while (end < length && end - start < 3 && text[end] >= '0' && text[end] <= '9') {
+            value = 10 * value + (unsigned) (text[end++] - '0');
+        }
+        // the sample has to be terminated by a whitespace inside text
+        if (end == start || end == length || value > maxval ||
+            (text[end] != ' ' && text[end] != '\t' && text[end] != '\r' && text[end] != '\n')) {
+            break;
+        }
+        samples[done++] = (uint8_t) value;
+        pos = end;
+    }
+    *parsed = done;
+    return pos;
+}
+
+
+/**
+ * @brief Adds the weighted sums of a range of pixels to their sums without SIMD operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param sums Pointer to the n sums, every weighted sum of at most 255 * 256 is added before the division by 256.
+ *
+ * Fallback for CPUs without SSE4.2 and reference for the SIMD kernels. The
+ * SIMD kernels add the weighted sums of their remaining pixels with it.
+ */
+
+void add_weights_scalar(const uint8_t *img, size_t n, const uint16_t *coeffs, uint32_t *sums) {
+    // stores to sums may alias coeffs, local copies keep them in registers
+    uint32_t a = coeffs[0];
+    uint32_t b = coeffs[1];
+    uint32_t c = coeffs[2];
+
+    for (size_t i = 0; i < n; i++) {
+        sums[i] += a * img[i * 3] + b * img[i * 3 + 1] + c * img[i * 3 + 2];
+    }
+}
@@ -1,5 +1,7 @@
 #include <stdint.h>
 #include <stdio.h>
+#include "grey_pass.h"
+#include "histogram.h"
 
 #ifndef TEAM120_BRIGHTNESS_CONTRAST_H
 #define TEAM120_BRIGHTNESS_CONTRAST_H
@@ -50,4 +52,85 @@ int brightness_contrast_V1(const uint8_t *img, size_t width, size_t height, floa
 
 int brightness_contrast_V2(const uint8_t *img, size_t width, size_t height, float a, float b, float c, int16_t brightness, float contrast, uint8_t *result);
 
+
+/**
+ * @brief Variants converting a range of pixels to grey scale and applying the brightness without SIMD operations.
+ *
+ * Indexed by grey_pass_index(), the parameters are described at GreyPass.
+ * Fallback for CPUs without SSE4.2. Uses the same integer arithmetic as the SIMD
+ * kernels, so the result is identical to grey_pass_V0.
+ */
+
+extern const GreyPass grey_pass_scalar[GREY_PASS_VARIANTS];
+
+
+/**
+ * @brief Replaces every grey value of a range by its entry in the lookup table without SIMD operations.
+ *
+ * @param pixels Pointer to the first grey value of the range.
+ * @param n Number of grey values in the range.
+ * @param lookup Lookup table with 256 entries.
+ */
+
+void apply_lookup_scalar(uint8_t *pixels, size_t n, const uint8_t *lookup);
+
+
+/**
+ * @brief Converts a range of pixels with 16 bit samples to grey scale and applies the brightness without SIMD operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range, every sample stored in two bytes, most significant first.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value, scaled to maxval.
+ * @param maxval Maximum color value of the image, the grey values are clamped to [0,maxval].
+ * @param result Pointer to the first grey value of the range.
+ */
+
+void grey_pass_16_scalar(const uint8_t *img, size_t n, const uint16_t *coeffs, int32_t brightness, uint16_t maxval,
+                         uint16_t *result);
+
+
+/**
+ * @brief Variants converting a range of pixels to grey scale with the float arithmetic of Version 1 without SIMD operations.
+ *
+ * Indexed by grey_pass_index(), the parameters are described at GreyPassPrecise.
+ * The coefficients are normalised to a sum of 1 like in brightness_contrast_V1().
+ */
+
+extern const GreyPassPrecise grey_pass_precise_scalar[GREY_PASS_VARIANTS];
+
+
+
+/**
+ * @brief Parses the ascii samples of a plain PPM image without SIMD operations.
+ *
+ * @param text Pointer to the text, starting at a whitespace or at the first digit of a sample.
+ * @param length Number of bytes of text.
+ * @param maxval Maximum value of a sample.
+ * @param samples Pointer where the parsed samples will be stored.
+ * @param count Maximum number of samples to be parsed.
+ * @param parsed Pointer where the number of parsed samples will be stored.
+ *
+ * @return Number of bytes of text consumed, the text continues behind the last parsed sample.
+ *
+ * Samples the parser can not handle are left to the caller, see readPlainSamples().
+ */
+
+size_t parse_plain_scalar(const uint8_t *text, size_t length, uint8_t maxval, uint8_t *samples, size_t count,
+                          size_t *parsed);
+
+
+/**
+ * @brief Adds the weighted sums of a range of pixels to their sums without SIMD operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param sums Pointer to the n sums, every weighted sum of at most 255 * 256 is added before the division by 256.
+ *
+ * Fallback for CPUs without SSE4.2 and reference for the SIMD kernels.
+ */
+
+void add_weights_scalar(const uint8_t *img, size_t n, const uint16_t *coeffs, uint32_t *sums);
+
 #endif
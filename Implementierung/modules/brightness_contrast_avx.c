@@ -0,0 +1,801 @@
+#include <immintrin.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "brightness_contrast_avx.h"
+#include "brightness_contrast_sse.h"
+#include "histogram.h"
+
+
+/**
+ * @brief Converts a range of pixels to grey scale and applies the brightness using AVX2 operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range, at most HISTOGRAM_CHUNK if hist is set.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param hist If not NULL, the grey values are counted into these sub-histograms for the contrast calculation.
+ * @param result Pointer to the first grey value of the range.
+ * @param with_brightness, with_histogram Constant in every variant, see DEFINE_GREY_PASS_VARIANTS().
+ *
+ * 32 pixels are processed per iteration. The two 128-bit lanes of every register
+ * hold 16 consecutive pixels each, so the shuffle masks of the SSE kernel can be
+ * used for both lanes and packing the grey values restores the pixel order without
+ * an additional permute. The remaining pixels are handed to grey_pass_V0.
+ */
+
+__attribute__((target("avx2"), always_inline))
+static inline void grey_pass_V0_avx2_body(const uint8_t *img, size_t n, const uint16_t *coeffs, int16_t brightness,
+                                          SubHistograms hist, uint8_t *result, const int with_brightness,
+                                          const int with_histogram) {
+
+    // parameters stored as 16 bit integers
+    __m256i a_coeff = _mm256_set1_epi16(coeffs[0]);
+    __m256i b_coeff = _mm256_set1_epi16(coeffs[1]);
+    __m256i c_coeff = _mm256_set1_epi16(coeffs[2]);
+
+    // bit masks for shuffling rgb values, identical for both lanes
+    __m256i mask_red1 = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, -1, 3, -1, 6, -1, 9, -1, 12, -1, 15, -1, -1, -1, -1, -1));
+    __m256i mask_green1 = _mm256_broadcastsi128_si256(_mm_setr_epi8(1, -1, 4, -1, 7, -1, 10, -1, 13, -1, -1, -1, -1, -1, -1, -1));
+    __m256i mask_blue1 = _mm256_broadcastsi128_si256(_mm_setr_epi8(2, -1, 5, -1, 8, -1, 11, -1, 14, -1, -1, -1, -1, -1, -1, -1));
+
+    __m256i mask_red2 = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, -1, 5, -1));
+    __m256i mask_green2 = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, -1, 3, -1, 6, -1));
+    __m256i mask_blue2 = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, -1, 4, -1, 7, -1));
+
+    __m256i mask_red3 = _mm256_broadcastsi128_si256(_mm_setr_epi8(8, -1, 11, -1, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    __m256i mask_green3 = _mm256_broadcastsi128_si256(_mm_setr_epi8(9, -1, 12, -1, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    __m256i mask_blue3 = _mm256_broadcastsi128_si256(_mm_setr_epi8(10, -1, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+
+    __m256i mask_red4 = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, 1, -1, 4, -1, 7, -1, 10, -1, 13, -1));
+    __m256i mask_green4 = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, -1, 5, -1, 8, -1, 11, -1, 14, -1));
+    __m256i mask_blue4 = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, 0, -1, 3, -1, 6, -1, 9, -1, 12, -1, 15, -1));
+
+    __m256i brightness_vector = _mm256_set1_epi16((short) brightness);
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        // lane 0 holds pixels i..i+15, lane 1 holds pixels i+16..i+31
+        const uint8_t *p = img + 3 * i;
+        __m256i pixels1 = _mm256_loadu2_m128i((__m128i *) (p + 48), (__m128i *) p);
+        __m256i pixels2 = _mm256_loadu2_m128i((__m128i *) (p + 64), (__m128i *) (p + 16));
+        __m256i pixels3 = _mm256_loadu2_m128i((__m128i *) (p + 80), (__m128i *) (p + 32));
+
+        __m256i red1 = _mm256_or_si256(_mm256_shuffle_epi8(pixels1, mask_red1), _mm256_shuffle_epi8(pixels2, mask_red2));
+        __m256i red2 = _mm256_or_si256(_mm256_shuffle_epi8(pixels2, mask_red3), _mm256_shuffle_epi8(pixels3, mask_red4));
+
+        __m256i green1 = _mm256_or_si256(_mm256_shuffle_epi8(pixels1, mask_green1), _mm256_shuffle_epi8(pixels2, mask_green2));
+        __m256i green2 = _mm256_or_si256(_mm256_shuffle_epi8(pixels2, mask_green3), _mm256_shuffle_epi8(pixels3, mask_green4));
+
+        __m256i blue1 = _mm256_or_si256(_mm256_shuffle_epi8(pixels1, mask_blue1), _mm256_shuffle_epi8(pixels2, mask_blue2));
+        __m256i blue2 = _mm256_or_si256(_mm256_shuffle_epi8(pixels2, mask_blue3), _mm256_shuffle_epi8(pixels3, mask_blue4));
+
+        // multiply color values by coefficients, sum them up and divide by 256
+        __m256i grey1 = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(red1, a_coeff),
+                                                          _mm256_mullo_epi16(green1, b_coeff)),
+                                         _mm256_mullo_epi16(blue1, c_coeff));
+        __m256i grey2 = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(red2, a_coeff),
+                                                          _mm256_mullo_epi16(green2, b_coeff)),
+                                         _mm256_mullo_epi16(blue2, c_coeff));
+        grey1 = _mm256_srli_epi16(grey1, 8);
+        grey2 = _mm256_srli_epi16(grey2, 8);
+
+        if (with_brightness) {
+            // add brightness, packus clamps to [0,255]
+            grey1 = _mm256_add_epi16(grey1, brightness_vector);
+            grey2 = _mm256_add_epi16(grey2, brightness_vector);
+        }
+
+        // per lane: 8 values of grey1 followed by 8 values of grey2 -> pixel order
+        _mm256_storeu_si256((__m256i *) (result + i), _mm256_packus_epi16(grey1, grey2));
+
+        if (with_histogram) {
+            histogram_count(hist, result + i, 32);
+        }
+    }
+
+    // process remaining pixels with the SSE kernel
+    grey_pass_V0[grey_pass_index(with_brightness, with_histogram)](img + 3 * i, n - i, coeffs, brightness, hist,
+                                                                   result + i);
+}
+
+DEFINE_GREY_PASS_VARIANTS(__attribute__((target("avx2"))), GreyPass, uint16_t, grey_pass_V0_avx2,
+                          grey_pass_V0_avx2_body)
+
+
+/**
+ * @brief Computes the weighted sums of 8 pixels with vpmaddubsw.
+ *
+ * @param p Pointer to the first of the 24 bytes of the pixels, 4 bytes behind them are read as well.
+ * @param mask Shuffle mask spreading every pixel to 4 bytes, identical for both lanes.
+ * @param coeff The coefficients as unsigned bytes, repeated for every pixel.
+ *
+ * @return Two 16 bit sums per pixel, lane 0 holds the first 4 pixels. See madd_grey4() in
+ *         brightness_contrast_sse.c for the bias of the RGB values.
+ */
+
+__attribute__((target("avx2")))
+static inline __m256i madd_grey8(const uint8_t *p, __m256i mask, __m256i coeff) {
+    __m256i pixels = _mm256_loadu2_m128i((__m128i *) (p + 12), (__m128i *) p);
+    __m256i spread = _mm256_xor_si256(_mm256_shuffle_epi8(pixels, mask), _mm256_set1_epi8((char) 0x80));
+    return _mm256_maddubs_epi16(coeff, spread);
+}
+
+
+/**
+ * @brief Converts a range of pixels to grey scale and applies the brightness using vpmaddubsw.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range, at most HISTOGRAM_CHUNK if hist is set.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param hist If not NULL, the grey values are counted into these sub-histograms for the contrast calculation.
+ * @param result Pointer to the first grey value of the range.
+ * @param with_brightness, with_histogram Constant in every variant, see DEFINE_GREY_PASS_VARIANTS().
+ *
+ * 32 pixels are processed per iteration as four groups of 8 pixels with the
+ * operations of grey_pass_madd_V0. vphaddw and packing interleave the groups of
+ * 4 pixels of both lanes, vpermd restores the pixel order. The remaining pixels
+ * are handed to grey_pass_madd_V0.
+ */
+
+__attribute__((target("avx2"), always_inline))
+static inline void grey_pass_madd_V0_avx2_body(const uint8_t *img, size_t n, const uint16_t *coeffs,
+                                               int16_t brightness, SubHistograms hist, uint8_t *result,
+                                               const int with_brightness, const int with_histogram) {
+
+    size_t variant = grey_pass_index(with_brightness, with_histogram);
+    if (coeffs[0] > 255 || coeffs[1] > 255 || coeffs[2] > 255) {
+        // a coefficient of 256 does not fit into a byte
+        grey_pass_V0_avx2[variant](img, n, coeffs, brightness, hist, result);
+        return;
+    }
+
+    // red, green and blue coefficient of every pixel, the fourth byte is 0
+    __m256i coeff = _mm256_set1_epi32(coeffs[0] | coeffs[1] << 8 | coeffs[2] << 16);
+    __m256i mask = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1));
+    __m256i sign = _mm256_set1_epi16((short) 0x8000);
+    __m256i brightness_vector = _mm256_set1_epi16((short) brightness);
+
+    // the groups of 4 pixels end up in the order 0, 2, 4, 6, 1, 3, 5, 7
+    __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    size_t i = 0;
+    for (; i + 34 <= n; i += 32) {
+        const uint8_t *p = img + 3 * i;
+        __m256i sum1 = madd_grey8(p, mask, coeff);
+        __m256i sum2 = madd_grey8(p + 24, mask, coeff);
+        __m256i sum3 = madd_grey8(p + 48, mask, coeff);
+        __m256i sum4 = madd_grey8(p + 72, mask, coeff);
+
+        // weighted sums of 16 pixels each, remove the bias and divide by 256
+        __m256i grey1 = _mm256_srli_epi16(_mm256_xor_si256(_mm256_hadd_epi16(sum1, sum2), sign), 8);
+        __m256i grey2 = _mm256_srli_epi16(_mm256_xor_si256(_mm256_hadd_epi16(sum3, sum4), sign), 8);
+
+        if (with_brightness) {
+            // add brightness, packus clamps to [0,255]
+            grey1 = _mm256_add_epi16(grey1, brightness_vector);
+            grey2 = _mm256_add_epi16(grey2, brightness_vector);
+        }
+        __m256i packed = _mm256_packus_epi16(grey1, grey2);
+        _mm256_storeu_si256((__m256i *) (result + i), _mm256_permutevar8x32_epi32(packed, order));
+
+        if (with_histogram) {
+            histogram_count(hist, result + i, 32);
+        }
+    }
+
+    // process remaining pixels with the SSE kernel
+    grey_pass_madd_V0[variant](img + 3 * i, n - i, coeffs, brightness, hist, result + i);
+}
+
+DEFINE_GREY_PASS_VARIANTS(__attribute__((target("avx2"))), GreyPass, uint16_t, grey_pass_madd_V0_avx2,
+                          grey_pass_madd_V0_avx2_body)
+
+
+/**
+ * @brief Returns a mask with the lowest count bits set.
+ *
+ * @param count Number of bits to set, at most 64.
+ */
+
+static inline __mmask64 low_mask64(size_t count) {
+    return count >= 64 ? ~(__mmask64) 0 : (((__mmask64) 1 << count) - 1);
+}
+
+
+/**
+ * @brief Converts 64 pixels to grey scale using AVX-512 VBMI byte permutes.
+ *
+ * @param pixels1, pixels2, pixels3 The 192 bytes of RGB data.
+ * @param idx_red, idx_green, idx_blue Permute indices selecting a channel from pixels1 and pixels2.
+ * @param idx_red3, idx_green3, idx_blue3 Permute indices completing a channel with pixels3.
+ * @param a_coeff, b_coeff, c_coeff Coefficients for each color channel.
+ * @param brightness_vector Brightness added to every grey value.
+ * @param with_brightness If zero, the brightness is skipped.
+ *
+ * @return The 64 grey values in pixel order.
+ */
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static inline __m512i convert_to_grey64(__m512i pixels1, __m512i pixels2, __m512i pixels3,
+                                        __m512i idx_red, __m512i idx_green, __m512i idx_blue,
+                                        __m512i idx_red3, __m512i idx_green3, __m512i idx_blue3,
+                                        __m512i a_coeff, __m512i b_coeff, __m512i c_coeff,
+                                        __m512i brightness_vector, const int with_brightness) {
+
+    // deinterleave: first gather from pixels1:pixels2, then fill in the bytes from pixels3
+    __m512i red = _mm512_permutex2var_epi8(_mm512_permutex2var_epi8(pixels1, idx_red, pixels2), idx_red3, pixels3);
+    __m512i green = _mm512_permutex2var_epi8(_mm512_permutex2var_epi8(pixels1, idx_green, pixels2), idx_green3, pixels3);
+    __m512i blue = _mm512_permutex2var_epi8(_mm512_permutex2var_epi8(pixels1, idx_blue, pixels2), idx_blue3, pixels3);
+
+    // widen to 16 bit, multiply by coefficients, sum up and divide by 256
+    __m512i grey_lo = _mm512_add_epi16(
+            _mm512_add_epi16(_mm512_mullo_epi16(_mm512_cvtepu8_epi16(_mm512_castsi512_si256(red)), a_coeff),
+                             _mm512_mullo_epi16(_mm512_cvtepu8_epi16(_mm512_castsi512_si256(green)), b_coeff)),
+            _mm512_mullo_epi16(_mm512_cvtepu8_epi16(_mm512_castsi512_si256(blue)), c_coeff));
+    __m512i grey_hi = _mm512_add_epi16(
+            _mm512_add_epi16(_mm512_mullo_epi16(_mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(red, 1)), a_coeff),
+                             _mm512_mullo_epi16(_mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(green, 1)), b_coeff)),
+            _mm512_mullo_epi16(_mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(blue, 1)), c_coeff));
+    grey_lo = _mm512_srli_epi16(grey_lo, 8);
+    grey_hi = _mm512_srli_epi16(grey_hi, 8);
+
+    if (with_brightness) {
+        // add brightness, packus clamps to [0,255]
+        grey_lo = _mm512_add_epi16(grey_lo, brightness_vector);
+        grey_hi = _mm512_add_epi16(grey_hi, brightness_vector);
+    }
+
+    // packus interleaves the two halves per 128-bit lane, restore the pixel order
+    __m512i packed = _mm512_packus_epi16(grey_lo, grey_hi);
+    return _mm512_permutexvar_epi64(_mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7), packed);
+}
+
+
+/**
+ * @brief Converts a range of pixels to grey scale and applies the brightness using AVX-512 operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range, at most HISTOGRAM_CHUNK if hist is set.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param hist If not NULL, the grey values are counted into these sub-histograms for the contrast calculation.
+ * @param result Pointer to the first grey value of the range.
+ * @param with_brightness, with_histogram Constant in every variant, see DEFINE_GREY_PASS_VARIANTS().
+ *
+ * 64 pixels are processed per iteration. The RGB channels are deinterleaved with
+ * two vpermt2b per channel. The last block is read with masked loads and written
+ * with a masked store, so no scalar remainder loop is needed.
+ */
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi"), always_inline))
+static inline void grey_pass_V0_avx512_body(const uint8_t *img, size_t n, const uint16_t *coeffs, int16_t brightness,
+                                            SubHistograms hist, uint8_t *result, const int with_brightness,
+                                            const int with_histogram) {
+
+    // byte j of a channel is at offset 3 * j + channel of the 192 rgb bytes
+    uint8_t idx[3][64];
+    uint8_t idx3[3][64];
+    for (int ch = 0; ch < 3; ch++) {
+        for (int j = 0; j < 64; j++) {
+            int offset = 3 * j + ch;
+            idx[ch][j] = (uint8_t) (offset < 128 ? offset : 0);
+            idx3[ch][j] = (uint8_t) (offset < 128 ? j : 64 + offset - 128);
+        }
+    }
+    __m512i idx_red = _mm512_loadu_si512(idx[0]);
+    __m512i idx_green = _mm512_loadu_si512(idx[1]);
+    __m512i idx_blue = _mm512_loadu_si512(idx[2]);
+    __m512i idx_red3 = _mm512_loadu_si512(idx3[0]);
+    __m512i idx_green3 = _mm512_loadu_si512(idx3[1]);
+    __m512i idx_blue3 = _mm512_loadu_si512(idx3[2]);
+
+    // parameters stored as 16 bit integers
+    __m512i a_coeff = _mm512_set1_epi16(coeffs[0]);
+    __m512i b_coeff = _mm512_set1_epi16(coeffs[1]);
+    __m512i c_coeff = _mm512_set1_epi16(coeffs[2]);
+    __m512i brightness_vector = _mm512_set1_epi16((short) brightness);
+
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        const uint8_t *p = img + 3 * i;
+        __m512i grey = convert_to_grey64(_mm512_loadu_si512(p), _mm512_loadu_si512(p + 64),
+                                         _mm512_loadu_si512(p + 128),
+                                         idx_red, idx_green, idx_blue, idx_red3, idx_green3, idx_blue3,
+                                         a_coeff, b_coeff, c_coeff, brightness_vector, with_brightness);
+        _mm512_storeu_si512(result + i, grey);
+
+        if (with_histogram) {
+            histogram_count(hist, result + i, 64);
+        }
+    }
+
+    if (i < n) {
+        // masked loads do not touch memory behind the image
+        size_t remaining = n - i;
+        size_t bytes = 3 * remaining;
+        const uint8_t *p = img + 3 * i;
+
+        __m512i pixels1 = _mm512_maskz_loadu_epi8(low_mask64(bytes), p);
+        __m512i pixels2 = _mm512_maskz_loadu_epi8(bytes > 64 ? low_mask64(bytes - 64) : 0, p + 64);
+        __m512i pixels3 = _mm512_maskz_loadu_epi8(bytes > 128 ? low_mask64(bytes - 128) : 0, p + 128);
+
+        __m512i grey = convert_to_grey64(pixels1, pixels2, pixels3,
+                                         idx_red, idx_green, idx_blue, idx_red3, idx_green3, idx_blue3,
+                                         a_coeff, b_coeff, c_coeff, brightness_vector, with_brightness);
+        _mm512_mask_storeu_epi8(result + i, low_mask64(remaining), grey);
+
+        if (with_histogram) {
+            histogram_count(hist, result + i, remaining);
+        }
+    }
+}
+
+DEFINE_GREY_PASS_VARIANTS(__attribute__((target("avx512f,avx512bw,avx512vbmi"))), GreyPass, uint16_t,
+                          grey_pass_V0_avx512, grey_pass_V0_avx512_body)
+
+
+
+
+/**
+ * @brief Replaces every grey value of a range by its entry in the lookup table using AVX2 operations.
+ *
+ * @param pixels Pointer to the first grey value of the range.
+ * @param n Number of grey values in the range.
+ * @param lookup Lookup table with 256 entries.
+ *
+ * Same scheme as apply_lookup_V0() with every sub-table broadcast to both lanes.
+ */
+
+__attribute__((target("avx2")))
+void apply_lookup_V0_avx2(uint8_t *pixels, size_t n, const uint8_t *lookup) {
+
+    __m256i table[16];
+    for (int k = 0; k < 16; k++) {
+        table[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *) (lookup + 16 * k)));
+    }
+    __m256i step = _mm256_set1_epi8(16);
+    __m256i offset = _mm256_set1_epi8(0x70);
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i idx = _mm256_loadu_si256((__m256i *) (pixels + i));
+        __m256i res = _mm256_shuffle_epi8(table[0], _mm256_adds_epu8(idx, offset));
+        for (int k = 1; k < 16; k++) {
+            idx = _mm256_sub_epi8(idx, step);
+            res = _mm256_or_si256(res, _mm256_shuffle_epi8(table[k], _mm256_adds_epu8(idx, offset)));
+        }
+        _mm256_storeu_si256((__m256i *) (pixels + i), res);
+    }
+
+    // process remaining grey values with the SSE kernel
+    apply_lookup_V0(pixels + i, n - i, lookup);
+}
+
+
+/**
+ * @brief Replaces every grey value of a range by its entry in the lookup table using AVX-512 operations.
+ *
+ * @param pixels Pointer to the first grey value of the range.
+ * @param n Number of grey values in the range.
+ * @param lookup Lookup table with 256 entries.
+ *
+ * The table is held in four registers. vpermi2b looks up the lower 7 bits of the
+ * index in either the lower or the upper half of the table, the highest bit of
+ * the index selects between both results. The last block uses masked loads and
+ * stores.
+ */
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+void apply_lookup_V0_avx512(uint8_t *pixels, size_t n, const uint8_t *lookup) {
+
+    __m512i table0 = _mm512_loadu_si512(lookup);
+    __m512i table1 = _mm512_loadu_si512(lookup + 64);
+    __m512i table2 = _mm512_loadu_si512(lookup + 128);
+    __m512i table3 = _mm512_loadu_si512(lookup + 192);
+
+    for (size_t i = 0; i < n; i += 64) {
+        __mmask64 mask = low_mask64(n - i);
+        __m512i idx = _mm512_maskz_loadu_epi8(mask, pixels + i);
+        __m512i lower = _mm512_permutex2var_epi8(table0, idx, table1);
+        __m512i upper = _mm512_permutex2var_epi8(table2, idx, table3);
+        __m512i res = _mm512_mask_blend_epi8(_mm512_movepi8_mask(idx), lower, upper);
+        _mm512_mask_storeu_epi8(pixels + i, mask, res);
+    }
+}
+
+
+/**
+ * @brief Copies a range of bytes with non-temporal stores using AVX2 operations.
+ *
+ * @param dst Pointer to the destination.
+ * @param src Pointer to the source, should be in the cache.
+ * @param n Number of bytes.
+ *
+ * Same scheme as stream_store_V0() with a 32 byte aligned destination.
+ */
+
+__attribute__((target("avx2")))
+void stream_store_V0_avx2(uint8_t *dst, const uint8_t *src, size_t n) {
+
+    size_t head = (32 - ((uintptr_t) dst & 31)) & 31;
+    size_t i = head < n ? head : n;
+    memcpy(dst, src, i);
+
+    for (; i + 32 <= n; i += 32) {
+        _mm256_stream_si256((__m256i *) (dst + i), _mm256_loadu_si256((const __m256i *) (src + i)));
+    }
+    memcpy(dst + i, src + i, n - i);
+    _mm_sfence();
+}
+
+
+/**
+ * @brief Copies a range of bytes with non-temporal stores using AVX-512 operations.
+ *
+ * @param dst Pointer to the destination.
+ * @param src Pointer to the source, should be in the cache.
+ * @param n Number of bytes.
+ *
+ * Same scheme as stream_store_V0() with a 64 byte aligned destination, every
+ * store writes one whole cache line.
+ */
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+void stream_store_V0_avx512(uint8_t *dst, const uint8_t *src, size_t n) {
+
+    size_t head = (64 - ((uintptr_t) dst & 63)) & 63;
+    size_t i = head < n ? head : n;
+    memcpy(dst, src, i);
+
+    for (; i + 64 <= n; i += 64) {
+        _mm512_stream_si512((__m512i *) (dst + i), _mm512_loadu_si512(src + i));
+    }
+    memcpy(dst + i, src + i, n - i);
+    _mm_sfence();
+}
+
+
+/**
+ * @brief Converts 8 pixels with 16 bit samples to grey scale using AVX2 operations.
+ *
+ * @param p Pointer to the first of the 48 bytes of the pixels.
+ * @param masks Shuffle masks for the red, green and blue samples, identical for both lanes.
+ * @param coeffs Coefficients for each color channel in 32 bit lanes.
+ *
+ * @return The 8 grey values in 32 bit lanes, not clamped. Lane 0 holds the first 4 pixels.
+ */
+
+__attribute__((target("avx2")))
+static inline __m256i convert_to_grey8_16(const uint8_t *p, const __m256i *masks, const __m256i *coeffs) {
+    __m256i low = _mm256_loadu2_m128i((__m128i *) (p + 24), (__m128i *) p);
+    __m256i high = _mm256_loadu2_m128i((__m128i *) (p + 32), (__m128i *) (p + 8));
+
+    __m256i red = _mm256_or_si256(_mm256_shuffle_epi8(low, masks[0]), _mm256_shuffle_epi8(high, masks[1]));
+    __m256i green = _mm256_or_si256(_mm256_shuffle_epi8(low, masks[2]), _mm256_shuffle_epi8(high, masks[3]));
+    __m256i blue = _mm256_or_si256(_mm256_shuffle_epi8(low, masks[4]), _mm256_shuffle_epi8(high, masks[5]));
+
+    __m256i sum = _mm256_add_epi32(_mm256_mullo_epi32(red, coeffs[0]), _mm256_mullo_epi32(green, coeffs[1]));
+    sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(blue, coeffs[2]));
+    return _mm256_srli_epi32(sum, 8);
+}
+
+
+/**
+ * @brief Converts a range of pixels with 16 bit samples to grey scale and applies the brightness using AVX2 operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range, every sample stored in two bytes, most significant first.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value, scaled to maxval.
+ * @param maxval Maximum color value of the image, the grey values are clamped to [0,maxval].
+ * @param result Pointer to the first grey value of the range.
+ *
+ * 16 pixels are processed per iteration. Every lane converts a group of 4 pixels
+ * with the masks of grey_pass_16_V0(), so the two lanes are not in pixel order
+ * after packing and vpermq restores it. The remaining pixels are handed to
+ * grey_pass_16_V0(). The AVX-512 kernels use this kernel as well.
+ */
+
+__attribute__((target("avx2")))
+void grey_pass_16_V0_avx2(const uint8_t *img, size_t n, const uint16_t *coeffs, int32_t brightness, uint16_t maxval,
+                          uint16_t *result) {
+
+    __m256i coeff[3] = {_mm256_set1_epi32(coeffs[0]), _mm256_set1_epi32(coeffs[1]), _mm256_set1_epi32(coeffs[2])};
+
+    // red, green and blue from bytes 0..15 and 8..23 of a group of 4 pixels, low byte first
+    __m256i masks[6] = {
+            _mm256_broadcastsi128_si256(_mm_setr_epi8(1, 0, -1, -1, 7, 6, -1, -1, 13, 12, -1, -1, -1, -1, -1, -1)),
+            _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 11, 10, -1, -1)),
+            _mm256_broadcastsi128_si256(_mm_setr_epi8(3, 2, -1, -1, 9, 8, -1, -1, 15, 14, -1, -1, -1, -1, -1, -1)),
+            _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 13, 12, -1, -1)),
+            _mm256_broadcastsi128_si256(_mm_setr_epi8(5, 4, -1, -1, 11, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 9, 8, -1, -1, 15, 14, -1, -1))};
+
+    __m256i zero = _mm256_setzero_si256();
+    __m256i max = _mm256_set1_epi32(maxval);
+    __m256i brightness_vector = _mm256_set1_epi32(brightness);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint8_t *p = img + 6 * i;
+        __m256i grey1 = convert_to_grey8_16(p, masks, coeff);
+        __m256i grey2 = convert_to_grey8_16(p + 48, masks, coeff);
+
+        // add brightness and clamp values in [0,maxval]
+        grey1 = _mm256_max_epi32(zero, _mm256_min_epi32(max, _mm256_add_epi32(grey1, brightness_vector)));
+        grey2 = _mm256_max_epi32(zero, _mm256_min_epi32(max, _mm256_add_epi32(grey2, brightness_vector)));
+
+        // packing gives pixels 0-3, 8-11, 4-7, 12-15
+        __m256i packed = _mm256_packus_epi32(grey1, grey2);
+        _mm256_storeu_si256((__m256i *) (result + i), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+
+    // process remaining pixels with SSE
+    grey_pass_16_V0(img + 6 * i, n - i, coeffs, brightness, maxval, result + i);
+}
+
+
+/**
+ * @brief Converts 8 pixels to grey scale with the float arithmetic of Version 1 using AVX2 operations.
+ *
+ * @param p Pointer to the first of the 24 bytes of the pixels, 4 bytes behind them are read as well.
+ * @param masks Shuffle masks moving the red, green and blue values into 32 bit lanes, identical for both lanes.
+ * @param coeffs Normalised coefficients for each color channel.
+ * @param brightness_vector Brightness adjustment value as float.
+ * @param with_brightness If zero, the brightness is skipped.
+ *
+ * @return The 8 grey values in 32 bit lanes, clamped to [0,255]. Lane 0 holds the first 4 pixels.
+ */
+
+__attribute__((target("avx2")))
+static inline __m256i convert_to_grey8_precise(const uint8_t *p, const __m256i *masks, const __m256 *coeffs,
+                                               __m256 brightness_vector, const int with_brightness) {
+    __m256i pixels = _mm256_loadu2_m128i((__m128i *) (p + 12), (__m128i *) p);
+    __m256 red = _mm256_cvtepi32_ps(_mm256_shuffle_epi8(pixels, masks[0]));
+    __m256 green = _mm256_cvtepi32_ps(_mm256_shuffle_epi8(pixels, masks[1]));
+    __m256 blue = _mm256_cvtepi32_ps(_mm256_shuffle_epi8(pixels, masks[2]));
+
+    __m256 res = _mm256_add_ps(_mm256_mul_ps(coeffs[0], red), _mm256_mul_ps(coeffs[1], green));
+    res = _mm256_add_ps(res, _mm256_mul_ps(coeffs[2], blue));
+    if (with_brightness) {
+        res = _mm256_add_ps(res, brightness_vector);
+    }
+
+    __m256i grey = _mm256_cvttps_epi32(res);
+    return _mm256_max_epi32(_mm256_setzero_si256(), _mm256_min_epi32(_mm256_set1_epi32(255), grey));
+}
+
+
+/**
+ * @brief Converts a range of pixels to grey scale with the float arithmetic of Version 1 using AVX2 operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range, at most HISTOGRAM_CHUNK if hist is set.
+ * @param coeffs Coefficients normalised to a sum of 1 like in brightness_contrast_V1().
+ * @param brightness Brightness adjustment value.
+ * @param hist If not NULL, the grey values are counted into these sub-histograms for the contrast calculation.
+ * @param result Pointer to the first grey value of the range.
+ * @param with_brightness, with_histogram Constant in every variant, see DEFINE_GREY_PASS_VARIANTS().
+ *
+ * 32 pixels are processed per iteration as four groups of 8 pixels with the
+ * operations of grey_pass_precise_V0. Packing interleaves the groups of 4
+ * pixels of both lanes, vpermd restores the pixel order. The remaining pixels
+ * are handed to grey_pass_precise_V0.
+ */
+
+__attribute__((target("avx2"), always_inline))
+static inline void grey_pass_precise_V0_avx2_body(const uint8_t *img, size_t n, const float *coeffs,
+                                                  int16_t brightness, SubHistograms hist, uint8_t *result,
+                                                  const int with_brightness, const int with_histogram) {
+
+    __m256 coeff[3] = {_mm256_set1_ps(coeffs[0]), _mm256_set1_ps(coeffs[1]), _mm256_set1_ps(coeffs[2])};
+    __m256 brightness_vector = _mm256_set1_ps(brightness);
+
+    // red, green and blue values of 4 pixels, extended to 32 bit
+    __m256i masks[3] = {
+            _mm256_broadcastsi128_si256(_mm_setr_epi8(0, -1, -1, -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1)),
+            _mm256_broadcastsi128_si256(_mm_setr_epi8(1, -1, -1, -1, 4, -1, -1, -1, 7, -1, -1, -1, 10, -1, -1, -1)),
+            _mm256_broadcastsi128_si256(_mm_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1))};
+
+    // packing gives the groups of 4 pixels in the order 0, 2, 4, 6, 1, 3, 5, 7
+    __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    size_t i = 0;
+    for (; i + 34 <= n; i += 32) {
+        const uint8_t *p = img + 3 * i;
+        __m256i grey1 = convert_to_grey8_precise(p, masks, coeff, brightness_vector, with_brightness);
+        __m256i grey2 = convert_to_grey8_precise(p + 24, masks, coeff, brightness_vector, with_brightness);
+        __m256i grey3 = convert_to_grey8_precise(p + 48, masks, coeff, brightness_vector, with_brightness);
+        __m256i grey4 = convert_to_grey8_precise(p + 72, masks, coeff, brightness_vector, with_brightness);
+
+        __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(grey1, grey2), _mm256_packs_epi32(grey3, grey4));
+        _mm256_storeu_si256((__m256i *) (result + i), _mm256_permutevar8x32_epi32(packed, order));
+
+        if (with_histogram) {
+            histogram_count(hist, result + i, 32);
+        }
+    }
+
+    // process remaining pixels with SSE
+    grey_pass_precise_V0[grey_pass_index(with_brightness, with_histogram)](img + 3 * i, n - i, coeffs, brightness,
+                                                                           hist, result + i);
+}
+
+DEFINE_GREY_PASS_VARIANTS(__attribute__((target("avx2"))), GreyPassPrecise, float, grey_pass_precise_V0_avx2,
+                          grey_pass_precise_V0_avx2_body)
+
+
+/**
+ * @brief Converts 16 pixels to grey scale with the float arithmetic of Version 1 using AVX-512 operations.
+ *
+ * @param p Pointer to the first of the 48 bytes of the pixels.
+ * @param idx Permute indices moving the red, green and blue values into the lowest byte of the 32 bit lanes.
+ * @param coeffs Normalised coefficients for each color channel.
+ * @param brightness_vector Brightness adjustment value as float.
+ * @param with_brightness If zero, the brightness is skipped.
+ *
+ * @return The 16 grey values in pixel order.
+ */
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static inline __m128i convert_to_grey16_precise(const uint8_t *p, const __m512i *idx, const __m512 *coeffs,
+                                                __m512 brightness_vector, const int with_brightness) {
+    // only the lowest byte of every 32 bit lane is kept
+    const __mmask64 low_bytes = 0x1111111111111111ULL;
+
+    __m512i pixels = _mm512_maskz_loadu_epi8(low_mask64(48), p);
+    __m512 red = _mm512_cvtepi32_ps(_mm512_maskz_permutexvar_epi8(low_bytes, idx[0], pixels));
+    __m512 green = _mm512_cvtepi32_ps(_mm512_maskz_permutexvar_epi8(low_bytes, idx[1], pixels));
+    __m512 blue = _mm512_cvtepi32_ps(_mm512_maskz_permutexvar_epi8(low_bytes, idx[2], pixels));
+
+    __m512 res = _mm512_add_ps(_mm512_mul_ps(coeffs[0], red), _mm512_mul_ps(coeffs[1], green));
+    res = _mm512_add_ps(res, _mm512_mul_ps(coeffs[2], blue));
+    if (with_brightness) {
+        res = _mm512_add_ps(res, brightness_vector);
+    }
+
+    // negative values are clamped first, vpmovusdb saturates values above 255
+    __m512i grey = _mm512_max_epi32(_mm512_setzero_si512(), _mm512_cvttps_epi32(res));
+    return _mm512_cvtusepi32_epi8(grey);
+}
+
+
+/**
+ * @brief Converts a range of pixels to grey scale with the float arithmetic of Version 1 using AVX-512 operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range, at most HISTOGRAM_CHUNK if hist is set.
+ * @param coeffs Coefficients normalised to a sum of 1 like in brightness_contrast_V1().
+ * @param brightness Brightness adjustment value.
+ * @param hist If not NULL, the grey values are counted into these sub-histograms for the contrast calculation.
+ * @param result Pointer to the first grey value of the range.
+ * @param with_brightness, with_histogram Constant in every variant, see DEFINE_GREY_PASS_VARIANTS().
+ *
+ * 64 pixels are processed per iteration as four groups of 16 pixels. The RGB
+ * values of a group are loaded with a masked load and spread to 32 bit lanes by
+ * one VBMI byte permute per channel. The remaining pixels are handed to
+ * grey_pass_precise_V0_avx2.
+ */
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi"), always_inline))
+static inline void grey_pass_precise_V0_avx512_body(const uint8_t *img, size_t n, const float *coeffs,
+                                                    int16_t brightness, SubHistograms hist, uint8_t *result,
+                                                    const int with_brightness, const int with_histogram) {
+
+    __m512 coeff[3] = {_mm512_set1_ps(coeffs[0]), _mm512_set1_ps(coeffs[1]), _mm512_set1_ps(coeffs[2])};
+    __m512 brightness_vector = _mm512_set1_ps(brightness);
+
+    // byte 4k of lane k is the channel of pixel k
+    uint8_t indices[3][64] = {{0}};
+    for (int ch = 0; ch < 3; ch++) {
+        for (int k = 0; k < 16; k++) {
+            indices[ch][4 * k] = (uint8_t) (3 * k + ch);
+        }
+    }
+    __m512i idx[3] = {_mm512_loadu_si512(indices[0]), _mm512_loadu_si512(indices[1]), _mm512_loadu_si512(indices[2])};
+
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        const uint8_t *p = img + 3 * i;
+        for (int g = 0; g < 4; g++) {
+            _mm_storeu_si128((__m128i *) (result + i + 16 * g),
+                             convert_to_grey16_precise(p + 48 * g, idx, coeff, brightness_vector,
+                                                       with_brightness));
+        }
+
+        if (with_histogram) {
+            histogram_count(hist, result + i, 64);
+        }
+    }
+
+    // process remaining pixels with AVX2
+    grey_pass_precise_V0_avx2[grey_pass_index(with_brightness, with_histogram)](img + 3 * i, n - i, coeffs,
+                                                                                brightness, hist, result + i);
+}
+
+DEFINE_GREY_PASS_VARIANTS(__attribute__((target("avx512f,avx512bw,avx512vbmi"))), GreyPassPrecise, float,
+                          grey_pass_precise_V0_avx512, grey_pass_precise_V0_avx512_body)
+
+
+/**
+ * @brief Computes the weighted sums of 32 pixels before the division by 256 using AVX2 operations.
+ *
+ * @param p Pointer to the first of the 96 bytes of the pixels.
+ * @param a_coeff, b_coeff, c_coeff Coefficients for each color channel packed into __m256i vectors.
+ * @param weights1, weights2 Pointers where the sums will be stored. Lane 0 of
+ *        weights1 holds pixels 0..7, lane 1 pixels 16..23; weights2 holds 8..15 and 24..31.
+ *
+ * The channels are separated like in grey_pass_V0_avx2_body().
+ */
+
+__attribute__((target("avx2"), always_inline))
+static inline void load_weights32(const uint8_t *p, __m256i a_coeff, __m256i b_coeff, __m256i c_coeff,
+                                  __m256i *weights1, __m256i *weights2) {
+
+    __m256i pixels1 = _mm256_loadu2_m128i((__m128i *) (p + 48), (__m128i *) p);
+    __m256i pixels2 = _mm256_loadu2_m128i((__m128i *) (p + 64), (__m128i *) (p + 16));
+    __m256i pixels3 = _mm256_loadu2_m128i((__m128i *) (p + 80), (__m128i *) (p + 32));
+
+    __m256i red1 = _mm256_or_si256(_mm256_shuffle_epi8(pixels1, _mm256_broadcastsi128_si256(_mm_setr_epi8(0, -1, 3, -1, 6, -1, 9, -1, 12, -1, 15, -1, -1, -1, -1, -1))),
+                                   _mm256_shuffle_epi8(pixels2, _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, -1, 5, -1))));
+    __m256i red2 = _mm256_or_si256(_mm256_shuffle_epi8(pixels2, _mm256_broadcastsi128_si256(_mm_setr_epi8(8, -1, 11, -1, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1))),
+                                   _mm256_shuffle_epi8(pixels3, _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, 1, -1, 4, -1, 7, -1, 10, -1, 13, -1))));
+
+    __m256i green1 = _mm256_or_si256(_mm256_shuffle_epi8(pixels1, _mm256_broadcastsi128_si256(_mm_setr_epi8(1, -1, 4, -1, 7, -1, 10, -1, 13, -1, -1, -1, -1, -1, -1, -1))),
+                                     _mm256_shuffle_epi8(pixels2, _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, -1, 3, -1, 6, -1))));
+    __m256i green2 = _mm256_or_si256(_mm256_shuffle_epi8(pixels2, _mm256_broadcastsi128_si256(_mm_setr_epi8(9, -1, 12, -1, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1))),
+                                     _mm256_shuffle_epi8(pixels3, _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, -1, 5, -1, 8, -1, 11, -1, 14, -1))));
+
+    __m256i blue1 = _mm256_or_si256(_mm256_shuffle_epi8(pixels1, _mm256_broadcastsi128_si256(_mm_setr_epi8(2, -1, 5, -1, 8, -1, 11, -1, 14, -1, -1, -1, -1, -1, -1, -1))),
+                                    _mm256_shuffle_epi8(pixels2, _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, -1, 4, -1, 7, -1))));
+    __m256i blue2 = _mm256_or_si256(_mm256_shuffle_epi8(pixels2, _mm256_broadcastsi128_si256(_mm_setr_epi8(10, -1, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1))),
+                                    _mm256_shuffle_epi8(pixels3, _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, 0, -1, 3, -1, 6, -1, 9, -1, 12, -1, 15, -1))));
+
+    *weights1 = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(red1, a_coeff), _mm256_mullo_epi16(green1, b_coeff)),
+                                 _mm256_mullo_epi16(blue1, c_coeff));
+    *weights2 = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(red2, a_coeff), _mm256_mullo_epi16(green2, b_coeff)),
+                                 _mm256_mullo_epi16(blue2, c_coeff));
+}
+
+
+/**
+ * @brief Adds the weighted sums of a range of pixels to their sums using AVX2 operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param sums Pointer to the n sums, every weighted sum of at most 255 * 256 is added before the division by 256.
+ *
+ * 32 pixels are processed per iteration, vperm2i128 brings the lanes of
+ * load_weights32() into the order of the pixels before the weighted sums are
+ * zero extended to 32 bit. The remaining pixels are handed to add_weights_V0.
+ */
+
+__attribute__((target("avx2")))
+void add_weights_V0_avx2(const uint8_t *img, size_t n, const uint16_t *coeffs, uint32_t *sums) {
+    __m256i a_coeff = _mm256_set1_epi16(coeffs[0]);
+    __m256i b_coeff = _mm256_set1_epi16(coeffs[1]);
+    __m256i c_coeff = _mm256_set1_epi16(coeffs[2]);
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i weights1, weights2;
+        load_weights32(img + 3 * i, a_coeff, b_coeff, c_coeff, &weights1, &weights2);
+        // pixels 0..15 and 16..31
+        __m256i first = _mm256_permute2x128_si256(weights1, weights2, 0x20);
+        __m256i second = _mm256_permute2x128_si256(weights1, weights2, 0x31);
+
+        __m256i *out = (__m256i *) (sums + i);
+        _mm256_storeu_si256(out, _mm256_add_epi32(_mm256_loadu_si256(out),
+                                                  _mm256_cvtepu16_epi32(_mm256_castsi256_si128(first))));
+        _mm256_storeu_si256(out + 1, _mm256_add_epi32(_mm256_loadu_si256(out + 1),
+                                                      _mm256_cvtepu16_epi32(_mm256_extracti128_si256(first, 1))));
+        _mm256_storeu_si256(out + 2, _mm256_add_epi32(_mm256_loadu_si256(out + 2),
+                                                      _mm256_cvtepu16_epi32(_mm256_castsi256_si128(second))));
+        _mm256_storeu_si256(out + 3, _mm256_add_epi32(_mm256_loadu_si256(out + 3),
+                                                      _mm256_cvtepu16_epi32(_mm256_extracti128_si256(second, 1))));
+    }
+    add_weights_V0(img + 3 * i, n - i, coeffs, sums + i);
+}
@@ -0,0 +1,145 @@
+#include <stdint.h>
+#include <stdio.h>
+#include "grey_pass.h"
+#include "histogram.h"
+
+#ifndef TEAM120_BRIGHTNESS_CONTRAST_AVX_H
+#define TEAM120_BRIGHTNESS_CONTRAST_AVX_H
+
+/**
+ * @brief Converts a range of pixels to grey scale and applies the brightness using AVX2 operations.
+ *
+ * Variants indexed by grey_pass_index(), the parameters are described at GreyPass.
+ *
+ * Must only be called if the CPU supports AVX2.
+ */
+
+extern const GreyPass grey_pass_V0_avx2[GREY_PASS_VARIANTS];
+
+
+/**
+ * @brief Converts a range of pixels to grey scale and applies the brightness using vpmaddubsw.
+ *
+ * Variants indexed by grey_pass_index(), the parameters are described at GreyPass.
+ * The grey values are identical to grey_pass_V0_avx2.
+ *
+ * Must only be called if the CPU supports AVX2.
+ */
+
+extern const GreyPass grey_pass_madd_V0_avx2[GREY_PASS_VARIANTS];
+
+
+/**
+ * @brief Converts a range of pixels to grey scale and applies the brightness using AVX-512 operations.
+ *
+ * Variants indexed by grey_pass_index(), the parameters are described at GreyPass.
+ *
+ * Must only be called if the CPU supports AVX-512 F, BW and VBMI.
+ */
+
+extern const GreyPass grey_pass_V0_avx512[GREY_PASS_VARIANTS];
+
+
+/**
+ * @brief Replaces every grey value of a range by its entry in the lookup table using AVX2 operations.
+ *
+ * @param pixels Pointer to the first grey value of the range.
+ * @param n Number of grey values in the range.
+ * @param lookup Lookup table with 256 entries.
+ *
+ * Must only be called if the CPU supports AVX2.
+ */
+
+void apply_lookup_V0_avx2(uint8_t *pixels, size_t n, const uint8_t *lookup);
+
+
+/**
+ * @brief Replaces every grey value of a range by its entry in the lookup table using AVX-512 operations.
+ *
+ * @param pixels Pointer to the first grey value of the range.
+ * @param n Number of grey values in the range.
+ * @param lookup Lookup table with 256 entries.
+ *
+ * Must only be called if the CPU supports AVX-512 F, BW and VBMI.
+ */
+
+void apply_lookup_V0_avx512(uint8_t *pixels, size_t n, const uint8_t *lookup);
+
+
+/**
+ * @brief Copies a range of bytes with non-temporal stores using AVX2 operations.
+ *
+ * @param dst Pointer to the destination.
+ * @param src Pointer to the source.
+ * @param n Number of bytes.
+ *
+ * Must only be called if the CPU supports AVX2.
+ */
+
+void stream_store_V0_avx2(uint8_t *dst, const uint8_t *src, size_t n);
+
+
+/**
+ * @brief Copies a range of bytes with non-temporal stores using AVX-512 operations.
+ *
+ * @param dst Pointer to the destination.
+ * @param src Pointer to the source.
+ * @param n Number of bytes.
+ *
+ * Must only be called if the CPU supports AVX-512 F, BW and VBMI.
+ */
+
+void stream_store_V0_avx512(uint8_t *dst, const uint8_t *src, size_t n);
+
+
+/**
+ * @brief Converts a range of pixels with 16 bit samples to grey scale and applies the brightness using AVX2 operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range, every sample stored in two bytes, most significant first.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value, scaled to maxval.
+ * @param maxval Maximum color value of the image, the grey values are clamped to [0,maxval].
+ * @param result Pointer to the first grey value of the range.
+ *
+ * Must only be called if the CPU supports AVX2.
+ */
+
+void grey_pass_16_V0_avx2(const uint8_t *img, size_t n, const uint16_t *coeffs, int32_t brightness, uint16_t maxval,
+                          uint16_t *result);
+
+
+/**
+ * @brief Converts a range of pixels to grey scale with the float arithmetic of Version 1 using AVX2 operations.
+ *
+ * Variants indexed by grey_pass_index(), the parameters are described at GreyPassPrecise.
+ *
+ * Must only be called if the CPU supports AVX2.
+ */
+
+extern const GreyPassPrecise grey_pass_precise_V0_avx2[GREY_PASS_VARIANTS];
+
+
+/**
+ * @brief Converts a range of pixels to grey scale with the float arithmetic of Version 1 using AVX-512 operations.
+ *
+ * Variants indexed by grey_pass_index(), the parameters are described at GreyPassPrecise.
+ *
+ * Must only be called if the CPU supports AVX-512 F, BW and VBMI.
+ */
+
+extern const GreyPassPrecise grey_pass_precise_V0_avx512[GREY_PASS_VARIANTS];
+
+
+/**
+ * @brief Adds the weighted sums of a range of pixels to their sums using AVX2 operations.
+ *
+ * The parameters are described at add_weights_scalar(), the sums are identical.
+ *
+ * Must only be called if the CPU supports AVX2.
+ */
+
+void add_weights_V0_avx2(const uint8_t *img, size_t n, const uint16_t *coeffs, uint32_t *sums);
+
+
+#endif
@@ -0,0 +1,270 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "brightness_contrast_mt.h"
+#include "brightness_contrast_simd.h"
+#include "dispatch.h"
+#include "instrument.h"
+#include "util.h"
+
+
+typedef struct {
+    const uint8_t *img;         // first rgb pixel of the band
+    uint8_t *result;            // first grey value of the band
+    size_t n;                   // number of pixels in the band
+    const uint16_t *coeffs;
+    const Kernels *kernels;
+    int16_t brightness;
+    int with_contrast;
+    int nontemporal;            // write the grey values with non-temporal stores, see use_nontemporal()
+    const uint8_t *lookup;
+    uint64_t histogram[256];    // partial histogram of grey values
+} Band;
+
+
+/**
+ * @brief Converts one band to grey scale and collects its partial statistics.
+ *
+ * @param arg Pointer to the Band to be processed.
+ *
+ * @return Always NULL.
+ */
+
+static void *grey_band(void *arg) {
+    Band *band = (Band *) arg;
+
+    if (band->with_contrast) {
+        grey_pass_histogram(band->kernels, band->img, band->n, band->coeffs, band->brightness, band->histogram,
+                            band->result);
+    } else if (band->nontemporal) {
+        grey_pass_nontemporal(band->kernels, band->img, band->n, band->coeffs, band->brightness, band->result);
+    } else {
+        GreyPass grey_pass = band->kernels->grey_pass[grey_pass_index(band->brightness != 0, 0)];
+        grey_pass(band->img, band->n, band->coeffs, band->brightness, NULL, band->result);
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Applies the contrast lookup table to one band.
+ *
+ * @param arg Pointer to the Band to be processed.
+ *
+ * @return Always NULL.
+ */
+
+static void *lookup_band(void *arg) {
+    Band *band = (Band *) arg;
+
+    band->kernels->apply_lookup(band->result, band->n, band->lookup);
+    return NULL;
+}
+
+
+// worker threads kept for all conversions, they take the bands of the current job from a queue
+typedef struct {
+    pthread_mutex_t busy;       // held by the conversion that uses the workers
+    pthread_mutex_t mutex;      // protects the fields below
+    pthread_cond_t start;       // signalled when a job is published
+    pthread_cond_t done;        // signalled when the last band of a job is processed
+    size_t workers;             // threads started so far
+    Band *bands;
+    size_t num_bands;
+    size_t next;                // next band nobody has taken, num_bands if all are taken
+    size_t pending;             // bands taken from the queue and not processed yet, or not taken
+    void *(*func)(void *);
+} WorkerPool;
+
+static WorkerPool pool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+                          PTHREAD_COND_INITIALIZER, 0, NULL, 0, 0, 0, NULL};
+
+
+/**
+ * @brief Processes the bands of every job published by run_bands(), until the program exits.
+ *
+ * @param arg Unused.
+ *
+ * @return Never returns.
+ */
+
+static void *pool_worker(void *arg) {
+    (void) arg;
+
+    pthread_mutex_lock(&pool.mutex);
+    for (;;) {
+        while (pool.next >= pool.num_bands) {
+            pthread_cond_wait(&pool.start, &pool.mutex);
+        }
+        Band *band = &pool.bands[pool.next++];
+        void *(*func)(void *) = pool.func;
+        pthread_mutex_unlock(&pool.mutex);
+
+        func(band);
+
+        pthread_mutex_lock(&pool.mutex);
+        if (--pool.pending == 0) {
+            pthread_cond_signal(&pool.done);
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Runs a function for every band on the worker threads of the pool.
+ *
+ * @param bands Array of bands.
+ * @param num_bands Number of bands.
+ * @param func Function to be executed for each band.
+ *
+ * The pool starts threads only when a job has more bands than there are
+ * workers, so a program converting many images creates its threads once
+ * instead of twice per conversion. The calling thread processes the first band
+ * and then every band no worker has taken yet, so the result never depends
+ * on the number of threads that could be created. A conversion that finds the
+ * pool busy with another one processes all its bands on the calling thread.
+ * Without bands nothing is done.
+ */
+
+static void run_bands(Band *bands, size_t num_bands, void *(*func)(void *)) {
+    // no band (an image without rows) would wrap num_bands - 1 below
+    if (num_bands <= 1 || pthread_mutex_trylock(&pool.busy)) {
+        for (size_t t = 0; t < num_bands; t++) {
+            func(&bands[t]);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool.mutex);
+    while (pool.workers < num_bands - 1) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, pool_worker, NULL)) {
+            break;
+        }
+        pthread_detach(thread);
+        pool.workers++;
+    }
+    pool.bands = bands;
+    pool.num_bands = num_bands;
+    pool.next = 1;
+    pool.pending = num_bands - 1;
+    pool.func = func;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.mutex);
+
+    func(&bands[0]);
+
+    pthread_mutex_lock(&pool.mutex);
+    while (pool.next < pool.num_bands) {
+        Band *band = &pool.bands[pool.next++];
+        pthread_mutex_unlock(&pool.mutex);
+        func(band);
+        pthread_mutex_lock(&pool.mutex);
+        pool.pending--;
+    }
+    while (pool.pending) {
+        pthread_cond_wait(&pool.done, &pool.mutex);
+    }
+    pthread_mutex_unlock(&pool.mutex);
+    pthread_mutex_unlock(&pool.busy);
+}
+
+
+/**
+ * @brief Performs brightness and contrast adjustment on an image using SIMD operations on multiple threads.
+ *
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ * @param threads Number of threads the image is split across.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ *
+ * The image is split into bands of whole rows, one band per thread. Every thread
+ * runs the grey pass of the kernel selected for version 0 on its band. For the
+ * contrast cases each band additionally returns the histogram of its grey values.
+ * These partial histograms are merged exactly, the lookup table is built once and
+ * then applied to all bands in parallel. Therefore the result
+ * is byte-identical to brightness_contrast_V0().
+ */
+
+int
+brightness_contrast_V3(const uint8_t *img, size_t width, size_t height, float a, float b, float c, int16_t brightness,
+                       float contrast, uint8_t *result, int threads) {
+
+    // every band contains at least one row
+    size_t num_bands = threads < 1 ? 1 : (size_t) threads;
+    if (num_bands > height) {
+        num_bands = height;
+    }
+
+    Band *bands = malloc(num_bands * sizeof(Band));
+    if (!bands) {
+        fprintf(stderr, "Failed to allocate memory for threads\n");
+        return 0;
+    }
+
+    // convert parameters to range [0,256]
+    uint16_t coeffs[3];
+    convert_coeffs_to_max256(a, b, c, coeffs);
+
+    const Kernels *kernels = get_kernels();
+    uint8_t lookup[256];
+    int with_contrast = !isnan(contrast);
+    // the threshold applies to the whole image, the bands share the last level cache
+    int nontemporal = use_nontemporal(kernels, width * height);
+
+    // distribute the rows evenly, the first bands receive one additional row
+    size_t row = 0;
+    for (size_t t = 0; t < num_bands; t++) {
+        size_t rows = height / num_bands + (t < height % num_bands);
+        bands[t].img = img + 3 * row * width;
+        bands[t].result = result + row * width;
+        bands[t].n = rows * width;
+        bands[t].coeffs = coeffs;
+        bands[t].kernels = kernels;
+        bands[t].brightness = brightness;
+        bands[t].with_contrast = with_contrast;
+        bands[t].nontemporal = nontemporal;
+        bands[t].lookup = lookup;
+        memset(bands[t].histogram, 0, sizeof(bands[t].histogram));
+        row += rows;
+    }
+
+    PHASE_BEGIN(PHASE_GREY);
+    run_bands(bands, num_bands, grey_band);
+    PHASE_END(PHASE_GREY);
+
+    if (with_contrast) {
+        // merge partial histograms
+        PHASE_BEGIN(PHASE_STATISTICS);
+        uint64_t histogram[256] = {0};
+        for (size_t t = 0; t < num_bands; t++) {
+            for (size_t v = 0; v < 256; v++) {
+                histogram[v] += bands[t].histogram[v];
+            }
+        }
+
+        if (!build_contrast_lookup(histogram, contrast, lookup)) {
+            free(bands);
+            return 0;
+        }
+        PHASE_END(PHASE_STATISTICS);
+        PHASE_BEGIN(PHASE_CONTRAST);
+        run_bands(bands, num_bands, lookup_band);
+        PHASE_END(PHASE_CONTRAST);
+    }
+
+    free(bands);
+    return 1;
+}
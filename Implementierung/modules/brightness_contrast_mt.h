@@ -0,0 +1,29 @@
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef TEAM120_BRIGHTNESS_CONTRAST_MT_H
+#define TEAM120_BRIGHTNESS_CONTRAST_MT_H
+
+/**
+ * @brief Performs brightness and contrast adjustment on an image using SIMD operations on multiple threads.
+ *
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ * @param threads Number of threads the image is split across.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ *
+ * The result is byte-identical to brightness_contrast_V0().
+ */
+
+int brightness_contrast_V3(const uint8_t *img, size_t width, size_t height, float a, float b, float c, int16_t brightness, float contrast, uint8_t *result, int threads);
+
+
+#endif
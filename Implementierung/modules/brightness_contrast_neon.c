@@ -0,0 +1,255 @@
+#include <arm_neon.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "brightness_contrast.h"
+#include "brightness_contrast_neon.h"
+#include "histogram.h"
+
+
+/**
+ * @brief Returns the index of a coefficient that equals 256, or -1 if there is none.
+ *
+ * @param coeffs Coefficients scaled to a sum of 256.
+ *
+ * A coefficient of 256 does not fit into the 8 bit operand of vmull_u8. In that
+ * case the other two coefficients are 0 and the grey value is the channel itself.
+ */
+
+static int full_weight_channel(const uint16_t *coeffs) {
+    for (int ch = 0; ch < 3; ch++) {
+        if (coeffs[ch] == 256) {
+            return ch;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * @brief Converts a range of pixels to grey scale and applies the brightness using NEON operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range, at most HISTOGRAM_CHUNK if hist is set.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param hist If not NULL, the grey values are counted into these sub-histograms for the contrast calculation.
+ * @param result Pointer to the first grey value of the range.
+ * @param with_brightness, with_histogram Constant in every variant, see DEFINE_GREY_PASS_VARIANTS().
+ *
+ * 16 pixels are processed per iteration. vld3q_u8 deinterleaves the RGB values
+ * while loading, the coefficients are applied with widening multiply-accumulate
+ * and vshrn divides by 256 while narrowing back to 8 bit. Saturating add and
+ * subtract clamp the brightness to [0,255]. The remaining pixels are handed to
+ * grey_pass_scalar.
+ */
+
+__attribute__((always_inline))
+static inline void grey_pass_V0_neon_body(const uint8_t *img, size_t n, const uint16_t *coeffs, int16_t brightness,
+                                          SubHistograms hist, uint8_t *result, const int with_brightness,
+                                          const int with_histogram) {
+
+    int full_channel = full_weight_channel(coeffs);
+    uint8x8_t a_coeff = vdup_n_u8((uint8_t) coeffs[0]);
+    uint8x8_t b_coeff = vdup_n_u8((uint8_t) coeffs[1]);
+    uint8x8_t c_coeff = vdup_n_u8((uint8_t) coeffs[2]);
+
+    // one of the two is zero, so adding and subtracting both needs no branch on the sign
+    uint8x16_t brightness_add = vdupq_n_u8((uint8_t) (brightness > 0 ? brightness : 0));
+    uint8x16_t brightness_sub = vdupq_n_u8((uint8_t) (brightness < 0 ? -brightness : 0));
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x3_t rgb = vld3q_u8(img + 3 * i);
+        uint8x16_t grey;
+
+        if (full_channel < 0) {
+            uint16x8_t lo = vmull_u8(vget_low_u8(rgb.val[0]), a_coeff);
+            lo = vmlal_u8(lo, vget_low_u8(rgb.val[1]), b_coeff);
+            lo = vmlal_u8(lo, vget_low_u8(rgb.val[2]), c_coeff);
+
+            uint16x8_t hi = vmull_u8(vget_high_u8(rgb.val[0]), a_coeff);
+            hi = vmlal_u8(hi, vget_high_u8(rgb.val[1]), b_coeff);
+            hi = vmlal_u8(hi, vget_high_u8(rgb.val[2]), c_coeff);
+
+            // divide by 256 and narrow to 8 bit
+            grey = vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8));
+        } else {
+            grey = rgb.val[full_channel];
+        }
+
+        if (with_brightness) {
+            grey = vqsubq_u8(vqaddq_u8(grey, brightness_add), brightness_sub);
+        }
+
+        vst1q_u8(result + i, grey);
+
+        if (with_histogram) {
+            histogram_count(hist, result + i, 16);
+        }
+    }
+
+    // process remaining pixels after SIMD
+    grey_pass_scalar[grey_pass_index(with_brightness, with_histogram)](img + 3 * i, n - i, coeffs, brightness, hist,
+                                                                       result + i);
+}
+
+DEFINE_GREY_PASS_VARIANTS(, GreyPass, uint16_t, grey_pass_V0_neon, grey_pass_V0_neon_body)
+
+
+/**
+ * @brief Replaces every grey value of a range by its entry in the lookup table using NEON operations.
+ *
+ * @param pixels Pointer to the first grey value of the range.
+ * @param n Number of grey values in the range.
+ * @param lookup Lookup table with 256 entries.
+ *
+ * The table is held in four groups of four registers. vqtbl4q_u8 looks up 64
+ * entries at once and returns 0 for indices out of range, so the four partial
+ * lookups with shifted indices can simply be combined with OR.
+ */
+
+void apply_lookup_V0_neon(uint8_t *pixels, size_t n, const uint8_t *lookup) {
+
+    uint8x16x4_t table0, table1, table2, table3;
+    for (int j = 0; j < 4; j++) {
+        table0.val[j] = vld1q_u8(lookup + 16 * j);
+        table1.val[j] = vld1q_u8(lookup + 64 + 16 * j);
+        table2.val[j] = vld1q_u8(lookup + 128 + 16 * j);
+        table3.val[j] = vld1q_u8(lookup + 192 + 16 * j);
+    }
+    uint8x16_t offset = vdupq_n_u8(64);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t idx = vld1q_u8(pixels + i);
+        uint8x16_t res = vqtbl4q_u8(table0, idx);
+        idx = vsubq_u8(idx, offset);
+        res = vorrq_u8(res, vqtbl4q_u8(table1, idx));
+        idx = vsubq_u8(idx, offset);
+        res = vorrq_u8(res, vqtbl4q_u8(table2, idx));
+        idx = vsubq_u8(idx, offset);
+        res = vorrq_u8(res, vqtbl4q_u8(table3, idx));
+        vst1q_u8(pixels + i, res);
+    }
+
+    // process remaining grey values after SIMD
+    for (; i < n; i++) {
+        pixels[i] = lookup[pixels[i]];
+    }
+}
+
+
+/**
+ * @brief Converts a range of pixels with 16 bit samples to grey scale and applies the brightness using NEON operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range, every sample stored in two bytes, most significant first.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value, scaled to maxval.
+ * @param maxval Maximum color value of the image, the grey values are clamped to [0,maxval].
+ * @param result Pointer to the first grey value of the range.
+ *
+ * 8 pixels are processed per iteration. vld3q_u16 deinterleaves the samples while
+ * loading and vrev16q_u8 swaps their bytes. The coefficients are applied with
+ * widening multiply-accumulate into 32 bit, vqmovun narrows the clamped grey values.
+ */
+
+void grey_pass_16_V0_neon(const uint8_t *img, size_t n, const uint16_t *coeffs, int32_t brightness, uint16_t maxval,
+                          uint16_t *result) {
+
+    int32x4_t zero = vdupq_n_s32(0);
+    int32x4_t max = vdupq_n_s32(maxval);
+    int32x4_t brightness_vector = vdupq_n_s32(brightness);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        // samples are 2 byte aligned, the image data is aligned by buffer_alloc()
+        uint16x8x3_t rgb = vld3q_u16((const uint16_t *) (img + 6 * i));
+        uint16x8_t red = vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(rgb.val[0])));
+        uint16x8_t green = vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(rgb.val[1])));
+        uint16x8_t blue = vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(rgb.val[2])));
+
+        uint32x4_t lo = vmull_n_u16(vget_low_u16(red), coeffs[0]);
+        lo = vmlal_n_u16(lo, vget_low_u16(green), coeffs[1]);
+        lo = vmlal_n_u16(lo, vget_low_u16(blue), coeffs[2]);
+        uint32x4_t hi = vmull_high_n_u16(red, coeffs[0]);
+        hi = vmlal_high_n_u16(hi, green, coeffs[1]);
+        hi = vmlal_high_n_u16(hi, blue, coeffs[2]);
+
+        // divide by 256, add brightness and clamp values in [0,maxval]
+        int32x4_t grey_lo = vaddq_s32(vreinterpretq_s32_u32(vshrq_n_u32(lo, 8)), brightness_vector);
+        int32x4_t grey_hi = vaddq_s32(vreinterpretq_s32_u32(vshrq_n_u32(hi, 8)), brightness_vector);
+        grey_lo = vmaxq_s32(zero, vminq_s32(max, grey_lo));
+        grey_hi = vmaxq_s32(zero, vminq_s32(max, grey_hi));
+
+        vst1q_u16(result + i, vcombine_u16(vqmovun_s32(grey_lo), vqmovun_s32(grey_hi)));
+    }
+
+    // process remaining pixels after SIMD
+    grey_pass_16_scalar(img + 6 * i, n - i, coeffs, brightness, maxval, result + i);
+}
+
+
+/**
+ * @brief Converts a range of pixels to grey scale with the float arithmetic of Version 1 using NEON operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range, at most HISTOGRAM_CHUNK if hist is set.
+ * @param coeffs Coefficients normalised to a sum of 1 like in brightness_contrast_V1().
+ * @param brightness Brightness adjustment value.
+ * @param hist If not NULL, the grey values are counted into these sub-histograms for the contrast calculation.
+ * @param result Pointer to the first grey value of the range.
+ * @param with_brightness, with_histogram Constant in every variant, see DEFINE_GREY_PASS_VARIANTS().
+ *
+ * 16 pixels are processed per iteration, widened to four groups of 4 floats per
+ * channel. Separate multiplies and adds keep the rounding of the scalar code,
+ * a fused multiply-add would change the results. vcvtq_u32_f32 truncates and
+ * clamps negative values to 0, the saturating narrowing clamps to 255.
+ */
+
+__attribute__((always_inline))
+static inline void grey_pass_precise_V0_neon_body(const uint8_t *img, size_t n, const float *coeffs,
+                                                  int16_t brightness, SubHistograms hist, uint8_t *result,
+                                                  const int with_brightness, const int with_histogram) {
+
+    float32x4_t brightness_vector = vdupq_n_f32(brightness);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x3_t rgb = vld3q_u8(img + 3 * i);
+        uint16x8_t channels[3][2];
+        for (int ch = 0; ch < 3; ch++) {
+            channels[ch][0] = vmovl_u8(vget_low_u8(rgb.val[ch]));
+            channels[ch][1] = vmovl_high_u8(rgb.val[ch]);
+        }
+
+        uint16x4_t grey[4];
+        for (int g = 0; g < 4; g++) {
+            float32x4_t values[3];
+            for (int ch = 0; ch < 3; ch++) {
+                uint16x8_t half = channels[ch][g / 2];
+                values[ch] = vcvtq_f32_u32(g % 2 ? vmovl_high_u16(half) : vmovl_u16(vget_low_u16(half)));
+            }
+            float32x4_t res = vaddq_f32(vmulq_n_f32(values[0], coeffs[0]), vmulq_n_f32(values[1], coeffs[1]));
+            res = vaddq_f32(res, vmulq_n_f32(values[2], coeffs[2]));
+            if (with_brightness) {
+                res = vaddq_f32(res, brightness_vector);
+            }
+            grey[g] = vqmovn_u32(vcvtq_u32_f32(res));
+        }
+
+        uint8x8_t low = vqmovn_u16(vcombine_u16(grey[0], grey[1]));
+        uint8x8_t high = vqmovn_u16(vcombine_u16(grey[2], grey[3]));
+        vst1q_u8(result + i, vcombine_u8(low, high));
+
+        if (with_histogram) {
+            histogram_count(hist, result + i, 16);
+        }
+    }
+
+    // process remaining pixels after SIMD
+    grey_pass_precise_scalar[grey_pass_index(with_brightness, with_histogram)](img + 3 * i, n - i, coeffs,
+                                                                               brightness, hist, result + i);
+}
+
+DEFINE_GREY_PASS_VARIANTS(, GreyPassPrecise, float, grey_pass_precise_V0_neon, grey_pass_precise_V0_neon_body)
@@ -0,0 +1,53 @@
+#include <stdint.h>
+#include <stdio.h>
+#include "grey_pass.h"
+#include "histogram.h"
+
+#ifndef TEAM120_BRIGHTNESS_CONTRAST_NEON_H
+#define TEAM120_BRIGHTNESS_CONTRAST_NEON_H
+
+/**
+ * @brief Converts a range of pixels to grey scale and applies the brightness using NEON operations.
+ *
+ * Variants indexed by grey_pass_index(), the parameters are described at GreyPass.
+ */
+
+extern const GreyPass grey_pass_V0_neon[GREY_PASS_VARIANTS];
+
+
+/**
+ * @brief Replaces every grey value of a range by its entry in the lookup table using NEON operations.
+ *
+ * @param pixels Pointer to the first grey value of the range.
+ * @param n Number of grey values in the range.
+ * @param lookup Lookup table with 256 entries.
+ */
+
+void apply_lookup_V0_neon(uint8_t *pixels, size_t n, const uint8_t *lookup);
+
+
+/**
+ * @brief Converts a range of pixels with 16 bit samples to grey scale and applies the brightness using NEON operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range, every sample stored in two bytes, most significant first.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value, scaled to maxval.
+ * @param maxval Maximum color value of the image, the grey values are clamped to [0,maxval].
+ * @param result Pointer to the first grey value of the range.
+ */
+
+void grey_pass_16_V0_neon(const uint8_t *img, size_t n, const uint16_t *coeffs, int32_t brightness, uint16_t maxval,
+                          uint16_t *result);
+
+
+/**
+ * @brief Converts a range of pixels to grey scale with the float arithmetic of Version 1 using NEON operations.
+ *
+ * Variants indexed by grey_pass_index(), the parameters are described at GreyPassPrecise.
+ */
+
+extern const GreyPassPrecise grey_pass_precise_V0_neon[GREY_PASS_VARIANTS];
+
+
+#endif
@@ -0,0 +1,608 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "brightness_contrast_opencl.h"
+#include "brightness_contrast_simd.h"
+#include "dispatch.h"
+#include "util.h"
+
+#ifdef TEAM120_OPENCL
+#define CL_TARGET_OPENCL_VERSION 120
+#include <CL/cl.h>
+#endif
+
+
+static size_t gpu_threshold = GPU_MIN_PIXELS;
+
+
+/**
+ * @brief Sets the number of pixels from which version 4 converts on the GPU.
+ *
+ * @param pixels The threshold, 0 converts every image on the GPU.
+ */
+
+void set_gpu_threshold(size_t pixels) {
+    gpu_threshold = pixels;
+}
+
+
+#ifdef TEAM120_OPENCL
+
+// work items per work group, every group counts its grey values in local memory
+#define OPENCL_GROUP_SIZE 256
+
+// the integer formula of the scalar kernel, so the results are byte-identical to version 0
+static const char *kernel_source =
+        "__kernel void grey(__global const uchar *rgb, const uint n, const uint a, const uint b, const uint c,\n"
+        "                   const int brightness, const ulong offset, __global uchar *grey,\n"
+        "                   const int with_histogram, __global uint *histogram) {\n"
+        "    __local uint counts[256];\n"
+        "    uint i = get_global_id(0);\n"
+        "    int value = 0;\n"
+        "    if (i < n) {\n"
+        "        value = (int) ((a * rgb[3 * i] + b * rgb[3 * i + 1] + c * rgb[3 * i + 2]) >> 8) + brightness;\n"
+        "        value = clamp(value, 0, 255);\n"
+        "        grey[offset + i] = (uchar) value;\n"
+        "    }\n"
+        "    if (!with_histogram) {\n"
+        "        return;\n"
+        "    }\n"
+        "    for (uint v = get_local_id(0); v < 256; v += get_local_size(0)) {\n"
+        "        counts[v] = 0;\n"
+        "    }\n"
+        "    barrier(CLK_LOCAL_MEM_FENCE);\n"
+        "    if (i < n) {\n"
+        "        atomic_inc(&counts[value]);\n"
+        "    }\n"
+        "    barrier(CLK_LOCAL_MEM_FENCE);\n"
+        "    for (uint v = get_local_id(0); v < 256; v += get_local_size(0)) {\n"
+        "        if (counts[v]) {\n"
+        "            atomic_add(&histogram[v], counts[v]);\n"
+        "        }\n"
+        "    }\n"
+        "}\n"
+        "\n"
+        "__kernel void lookup(__global const uchar *grey, const uint n, const ulong offset,\n"
+        "                     __constant uchar *table, __global uchar *result) {\n"
+        "    uint i = get_global_id(0);\n"
+        "    if (i < n) {\n"
+        "        result[i] = table[grey[offset + i]];\n"
+        "    }\n"
+        "}\n";
+
+typedef struct {
+    cl_context context;
+    cl_device_id device;
+    cl_program program;
+    cl_kernel grey;
+    cl_kernel lookup;
+    cl_command_queue queues[OPENCL_SLOTS];  // one in-order queue per slot, so the slots overlap
+    cl_ulong max_alloc;                     // largest buffer the device can allocate
+    char name[256];
+} Device;
+
+typedef struct {
+    cl_command_queue queue;
+    cl_mem rgb;                 // rgb values of the strip on the device
+    cl_mem output;              // grey values of the strip on the device
+    cl_mem histogram;           // histogram of the strip on the device
+    cl_mem pinned_rgb;          // page-locked host buffers the transfers are done from and to
+    cl_mem pinned_output;
+    uint8_t *host_rgb;          // pinned_rgb and pinned_output mapped into the address space
+    uint8_t *host_output;
+    cl_uint host_histogram[256];
+    cl_event done;              // last command of the strip in flight, NULL if the slot is free
+    size_t start;               // first pixel of the strip in flight
+    size_t length;              // number of pixels of the strip in flight
+} Slot;
+
+static Device device;
+static int device_ready = 0;
+static pthread_once_t device_once = PTHREAD_ONCE_INIT;
+
+
+/**
+ * @brief Prints an error message if an OpenCL call failed.
+ *
+ * @param err The error code returned by the call.
+ * @param call Name of the call.
+ *
+ * @return 1 if the call succeeded, 0 otherwise.
+ */
+
+static int check(cl_int err, const char *call) {
+    if (err != CL_SUCCESS) {
+        fprintf(stderr, "OpenCL error %d in %s\n", (int) err, call);
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Releases the objects of the device created so far.
+ */
+
+static void release_device(void) {
+    for (int j = 0; j < OPENCL_SLOTS; j++) {
+        if (device.queues[j]) {
+            clReleaseCommandQueue(device.queues[j]);
+        }
+    }
+    if (device.lookup) {
+        clReleaseKernel(device.lookup);
+    }
+    if (device.grey) {
+        clReleaseKernel(device.grey);
+    }
+    if (device.program) {
+        clReleaseProgram(device.program);
+    }
+    if (device.context) {
+        clReleaseContext(device.context);
+    }
+    memset(&device, 0, sizeof(device));
+}
+
+
+/**
+ * @brief Looks for the first GPU of all OpenCL platforms and builds the kernels for it.
+ *
+ * Called once by pthread_once(), device_ready is set if the GPU can be used.
+ * No message is printed if there is no platform or no GPU.
+ */
+
+static void init_device(void) {
+    cl_platform_id platforms[16];
+    cl_uint num_platforms = 0;
+    if (clGetPlatformIDs(16, platforms, &num_platforms) != CL_SUCCESS) {
+        return;
+    }
+    if (num_platforms > 16) {
+        num_platforms = 16;
+    }
+
+    int found = 0;
+    for (cl_uint p = 0; p < num_platforms && !found; p++) {
+        found = clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_GPU, 1, &device.device, NULL) == CL_SUCCESS;
+    }
+    if (!found) {
+        return;
+    }
+
+    cl_int err;
+    device.context = clCreateContext(NULL, 1, &device.device, NULL, NULL, &err);
+    if (!check(err, "clCreateContext")) {
+        release_device();
+        return;
+    }
+    device.program = clCreateProgramWithSource(device.context, 1, &kernel_source, NULL, &err);
+    if (!check(err, "clCreateProgramWithSource")) {
+        release_device();
+        return;
+    }
+    if (!check(clBuildProgram(device.program, 1, &device.device, "", NULL, NULL), "clBuildProgram")) {
+        char log[4096] = "";
+        clGetProgramBuildInfo(device.program, device.device, CL_PROGRAM_BUILD_LOG, sizeof(log) - 1, log, NULL);
+        fprintf(stderr, "%s\n", log);
+        release_device();
+        return;
+    }
+    device.grey = clCreateKernel(device.program, "grey", &err);
+    if (!check(err, "clCreateKernel")) {
+        release_device();
+        return;
+    }
+    device.lookup = clCreateKernel(device.program, "lookup", &err);
+    if (!check(err, "clCreateKernel")) {
+        release_device();
+        return;
+    }
+    for (int j = 0; j < OPENCL_SLOTS; j++) {
+        device.queues[j] = clCreateCommandQueue(device.context, device.device, 0, &err);
+        if (!check(err, "clCreateCommandQueue")) {
+            release_device();
+            return;
+        }
+    }
+
+    if (!check(clGetDeviceInfo(device.device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(device.max_alloc),
+                               &device.max_alloc, NULL), "clGetDeviceInfo") ||
+        !check(clGetDeviceInfo(device.device, CL_DEVICE_NAME, sizeof(device.name) - 1, device.name, NULL),
+               "clGetDeviceInfo")) {
+        release_device();
+        return;
+    }
+    device_ready = 1;
+}
+
+
+/**
+ * @brief Releases the buffers of the slots.
+ *
+ * @param slots The slots, buffers not created are NULL.
+ */
+
+static void release_slots(Slot *slots) {
+    for (int j = 0; j < OPENCL_SLOTS; j++) {
+        Slot *slot = &slots[j];
+        if (!slot->queue) {
+            continue;
+        }
+        if (slot->done) {
+            clWaitForEvents(1, &slot->done);
+            clReleaseEvent(slot->done);
+        }
+        if (slot->host_rgb) {
+            clEnqueueUnmapMemObject(slot->queue, slot->pinned_rgb, slot->host_rgb, 0, NULL, NULL);
+        }
+        if (slot->host_output) {
+            clEnqueueUnmapMemObject(slot->queue, slot->pinned_output, slot->host_output, 0, NULL, NULL);
+        }
+        clFinish(slot->queue);
+        cl_mem buffers[] = {slot->rgb, slot->output, slot->histogram, slot->pinned_rgb, slot->pinned_output};
+        for (size_t k = 0; k < sizeof(buffers) / sizeof(buffers[0]); k++) {
+            if (buffers[k]) {
+                clReleaseMemObject(buffers[k]);
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Creates the device buffers and the mapped pinned host buffers of the slots.
+ *
+ * @param slots The slots, zero-initialized.
+ *
+ * @return 1 if every buffer was created, 0 otherwise.
+ */
+
+static int create_slots(Slot *slots) {
+    cl_int err = CL_SUCCESS;
+    for (int j = 0; j < OPENCL_SLOTS && err == CL_SUCCESS; j++) {
+        Slot *slot = &slots[j];
+        slot->queue = device.queues[j];
+        slot->rgb = clCreateBuffer(device.context, CL_MEM_READ_ONLY, 3 * OPENCL_STRIP_PIXELS, NULL, &err);
+        if (err == CL_SUCCESS) {
+            slot->output = clCreateBuffer(device.context, CL_MEM_READ_WRITE, OPENCL_STRIP_PIXELS, NULL, &err);
+        }
+        if (err == CL_SUCCESS) {
+            slot->histogram = clCreateBuffer(device.context, CL_MEM_READ_WRITE, 256 * sizeof(cl_uint), NULL, &err);
+        }
+        if (err == CL_SUCCESS) {
+            slot->pinned_rgb = clCreateBuffer(device.context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR,
+                                              3 * OPENCL_STRIP_PIXELS, NULL, &err);
+        }
+        if (err == CL_SUCCESS) {
+            slot->pinned_output = clCreateBuffer(device.context, CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR,
+                                                 OPENCL_STRIP_PIXELS, NULL, &err);
+        }
+        if (err == CL_SUCCESS) {
+            slot->host_rgb = clEnqueueMapBuffer(slot->queue, slot->pinned_rgb, CL_TRUE, CL_MAP_WRITE, 0,
+                                                3 * OPENCL_STRIP_PIXELS, 0, NULL, NULL, &err);
+        }
+        if (err == CL_SUCCESS) {
+            slot->host_output = clEnqueueMapBuffer(slot->queue, slot->pinned_output, CL_TRUE, CL_MAP_READ, 0,
+                                                   OPENCL_STRIP_PIXELS, 0, NULL, NULL, &err);
+        }
+    }
+    return check(err, "clCreateBuffer");
+}
+
+
+/**
+ * @brief Waits for the strip in flight in a slot and copies its results out of the pinned buffers.
+ *
+ * @param slot The slot, nothing is done if it is free.
+ * @param result The grey values of the image, NULL if the strip has no grey values to copy.
+ * @param histogram The histogram the strip is added to, NULL if the strip has no histogram.
+ *
+ * @return 1 if the strip was completed, 0 otherwise.
+ */
+
+static int finish_slot(Slot *slot, uint8_t *result, uint64_t *histogram) {
+    if (!slot->done) {
+        return 1;
+    }
+    cl_int err = clWaitForEvents(1, &slot->done);
+    clReleaseEvent(slot->done);
+    slot->done = NULL;
+    if (!check(err, "clWaitForEvents")) {
+        return 0;
+    }
+    if (result) {
+        memcpy(result + slot->start, slot->host_output, slot->length);
+    }
+    for (int v = 0; histogram && v < 256; v++) {
+        histogram[v] += slot->host_histogram[v];
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Enqueues the grey conversion of a strip: upload, kernel and download of its results.
+ *
+ * @param slot The free slot the strip is converted in.
+ * @param img Pointer to the original image data.
+ * @param start First pixel of the strip.
+ * @param length Number of pixels of the strip, at most OPENCL_STRIP_PIXELS.
+ * @param coeffs Coefficients scaled to a sum of 256.
+ * @param brightness Brightness adjustment value.
+ * @param grey Buffer with the grey values of the whole image, NULL to download the grey values of the strip.
+ * @param with_histogram 1 to count and download the grey values of the strip.
+ *
+ * @return 1 if every command was enqueued, 0 otherwise.
+ *
+ * The rgb values are copied into the pinned buffer of the slot while the
+ * device still works on the strip of the other slot.
+ */
+
+static int enqueue_grey(Slot *slot, const uint8_t *img, size_t start, size_t length, const uint16_t *coeffs,
+                        int16_t brightness, cl_mem grey, int with_histogram) {
+    memcpy(slot->host_rgb, img + 3 * start, 3 * length);
+    slot->start = start;
+    slot->length = length;
+
+    cl_uint n = (cl_uint) length;
+    cl_uint a = coeffs[0], b = coeffs[1], c = coeffs[2];
+    cl_int bright = brightness;
+    cl_ulong offset = grey ? start : 0;
+    cl_mem target = grey ? grey : slot->output;
+    cl_int histogram_flag = with_histogram;
+    cl_uint zero = 0;
+    size_t global = (length + OPENCL_GROUP_SIZE - 1) / OPENCL_GROUP_SIZE * OPENCL_GROUP_SIZE;
+    size_t local = OPENCL_GROUP_SIZE;
+
+    cl_int err = clEnqueueWriteBuffer(slot->queue, slot->rgb, CL_FALSE, 0, 3 * length, slot->host_rgb, 0, NULL,
+                                      NULL);
+    if (err == CL_SUCCESS && with_histogram) {
+        err = clEnqueueFillBuffer(slot->queue, slot->histogram, &zero, sizeof(zero), 0, 256 * sizeof(cl_uint), 0,
+                                  NULL, NULL);
+    }
+    err |= clSetKernelArg(device.grey, 0, sizeof(cl_mem), &slot->rgb);
+    err |= clSetKernelArg(device.grey, 1, sizeof(n), &n);
+    err |= clSetKernelArg(device.grey, 2, sizeof(a), &a);
+    err |= clSetKernelArg(device.grey, 3, sizeof(b), &b);
+    err |= clSetKernelArg(device.grey, 4, sizeof(c), &c);
+    err |= clSetKernelArg(device.grey, 5, sizeof(bright), &bright);
+    err |= clSetKernelArg(device.grey, 6, sizeof(offset), &offset);
+    err |= clSetKernelArg(device.grey, 7, sizeof(cl_mem), &target);
+    err |= clSetKernelArg(device.grey, 8, sizeof(histogram_flag), &histogram_flag);
+    err |= clSetKernelArg(device.grey, 9, sizeof(cl_mem), &slot->histogram);
+    if (err == CL_SUCCESS) {
+        err = clEnqueueNDRangeKernel(slot->queue, device.grey, 1, NULL, &global, &local, 0, NULL, NULL);
+    }
+    if (err == CL_SUCCESS && with_histogram) {
+        err = clEnqueueReadBuffer(slot->queue, slot->histogram, CL_FALSE, 0, 256 * sizeof(cl_uint),
+                                  slot->host_histogram, 0, NULL, NULL);
+    }
+    if (err == CL_SUCCESS && !grey) {
+        err = clEnqueueReadBuffer(slot->queue, slot->output, CL_FALSE, 0, length, slot->host_output, 0, NULL, NULL);
+    }
+    if (err == CL_SUCCESS) {
+        err = clEnqueueMarkerWithWaitList(slot->queue, 0, NULL, &slot->done);
+    }
+    if (err == CL_SUCCESS) {
+        err = clFlush(slot->queue);
+    }
+    return check(err, "enqueueing the grey conversion");
+}
+
+
+/**
+ * @brief Enqueues the contrast adjustment of a strip whose grey values stay on the device.
+ *
+ * @param slot The free slot the strip is adjusted in.
+ * @param start First pixel of the strip.
+ * @param length Number of pixels of the strip, at most OPENCL_STRIP_PIXELS.
+ * @param grey Buffer with the grey values of the whole image.
+ * @param table Buffer with the lookup table.
+ *
+ * @return 1 if every command was enqueued, 0 otherwise.
+ */
+
+static int enqueue_lookup(Slot *slot, size_t start, size_t length, cl_mem grey, cl_mem table) {
+    slot->start = start;
+    slot->length = length;
+
+    cl_uint n = (cl_uint) length;
+    cl_ulong offset = start;
+    size_t global = (length + OPENCL_GROUP_SIZE - 1) / OPENCL_GROUP_SIZE * OPENCL_GROUP_SIZE;
+    size_t local = OPENCL_GROUP_SIZE;
+
+    cl_int err = clSetKernelArg(device.lookup, 0, sizeof(cl_mem), &grey);
+    err |= clSetKernelArg(device.lookup, 1, sizeof(n), &n);
+    err |= clSetKernelArg(device.lookup, 2, sizeof(offset), &offset);
+    err |= clSetKernelArg(device.lookup, 3, sizeof(cl_mem), &table);
+    err |= clSetKernelArg(device.lookup, 4, sizeof(cl_mem), &slot->output);
+    if (err == CL_SUCCESS) {
+        err = clEnqueueNDRangeKernel(slot->queue, device.lookup, 1, NULL, &global, &local, 0, NULL, NULL);
+    }
+    if (err == CL_SUCCESS) {
+        err = clEnqueueReadBuffer(slot->queue, slot->output, CL_FALSE, 0, length, slot->host_output, 0, NULL, NULL);
+    }
+    if (err == CL_SUCCESS) {
+        err = clEnqueueMarkerWithWaitList(slot->queue, 0, NULL, &slot->done);
+    }
+    if (err == CL_SUCCESS) {
+        err = clFlush(slot->queue);
+    }
+    return check(err, "enqueueing the contrast adjustment");
+}
+
+
+/**
+ * @brief Performs brightness and contrast adjustment on the GPU.
+ *
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param n Number of pixels of the image.
+ * @param coeffs Coefficients scaled to a sum of 256.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 if the contrast could not be computed,
+ *         -1 if the device failed.
+ *
+ * The image is converted in strips of OPENCL_STRIP_PIXELS that alternate
+ * between two slots, each with its own queue and pinned buffers, so the upload
+ * of one strip overlaps the kernel and the download of the other one. If the
+ * contrast is adjusted, the grey values stay on the device when the whole
+ * image fits into one buffer, and only the histogram of every strip is
+ * downloaded; the lookup table is then applied on the device in a second pass
+ * over the strips. Otherwise the grey values are downloaded and the lookup
+ * table is applied by the CPU kernels.
+ */
+
+static int convert_opencl(const uint8_t *img, size_t n, const uint16_t *coeffs, int16_t brightness, float contrast,
+                          uint8_t *result) {
+    int with_contrast = !isnan(contrast);
+    Slot slots[OPENCL_SLOTS];
+    memset(slots, 0, sizeof(slots));
+    if (!create_slots(slots)) {
+        release_slots(slots);
+        return -1;
+    }
+
+    // the grey values stay on the device for the lookup table if the whole image fits into one buffer
+    cl_mem grey = NULL;
+    if (with_contrast && n <= device.max_alloc) {
+        cl_int err;
+        grey = clCreateBuffer(device.context, CL_MEM_READ_WRITE, n, NULL, &err);
+        if (err != CL_SUCCESS) {
+            grey = NULL;
+        }
+    }
+    uint64_t histogram[256] = {0};
+    uint8_t *grey_result = grey ? NULL : result;
+    uint64_t *strip_histogram = with_contrast ? histogram : NULL;
+
+    int success = 1;
+    int j = 0;
+    for (size_t start = 0; success && start < n; start += OPENCL_STRIP_PIXELS, j = (j + 1) % OPENCL_SLOTS) {
+        size_t length = n - start < OPENCL_STRIP_PIXELS ? n - start : OPENCL_STRIP_PIXELS;
+        success = finish_slot(&slots[j], grey_result, strip_histogram) &&
+                  enqueue_grey(&slots[j], img, start, length, coeffs, brightness, grey, with_contrast);
+    }
+    for (int k = 0; k < OPENCL_SLOTS; k++) {
+        success &= finish_slot(&slots[k], grey_result, strip_histogram);
+    }
+    if (!success || !with_contrast) {
+        if (grey) {
+            clReleaseMemObject(grey);
+        }
+        release_slots(slots);
+        return success ? 1 : -1;
+    }
+
+    uint8_t lookup[256];
+    if (!build_contrast_lookup(histogram, contrast, lookup)) {
+        if (grey) {
+            clReleaseMemObject(grey);
+        }
+        release_slots(slots);
+        return 0;
+    }
+    if (!grey) {
+        release_slots(slots);
+        get_kernels()->apply_lookup(result, n, lookup);
+        return 1;
+    }
+
+    cl_int err;
+    cl_mem table = clCreateBuffer(device.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(lookup), lookup,
+                                  &err);
+    success = check(err, "clCreateBuffer");
+    j = 0;
+    for (size_t start = 0; success && start < n; start += OPENCL_STRIP_PIXELS, j = (j + 1) % OPENCL_SLOTS) {
+        size_t length = n - start < OPENCL_STRIP_PIXELS ? n - start : OPENCL_STRIP_PIXELS;
+        success = finish_slot(&slots[j], result, NULL) && enqueue_lookup(&slots[j], start, length, grey, table);
+    }
+    for (int k = 0; k < OPENCL_SLOTS; k++) {
+        success &= finish_slot(&slots[k], result, NULL);
+    }
+
+    release_slots(slots);
+    if (table) {
+        clReleaseMemObject(table);
+    }
+    clReleaseMemObject(grey);
+    return success ? 1 : -1;
+}
+
+#endif
+
+
+/**
+ * @brief Returns the name of the GPU used by version 4.
+ *
+ * @return The name of the device, NULL if the program was built without OpenCL or no GPU was found.
+ */
+
+const char *gpu_device_name(void) {
+#ifdef TEAM120_OPENCL
+    pthread_once(&device_once, init_device);
+    return device_ready ? device.name : NULL;
+#else
+    return NULL;
+#endif
+}
+
+
+/**
+ * @brief Returns whether version 4 converts an image on the GPU.
+ *
+ * @param n Number of pixels of the image.
+ *
+ * @return 1 if a GPU was found and the image has at least the threshold pixels, 0 otherwise.
+ */
+
+int use_gpu(size_t n) {
+    return n >= gpu_threshold && gpu_device_name() != NULL;
+}
+
+
+/**
+ * @brief Performs brightness and contrast adjustment on the GPU if the image is large enough.
+ *
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ *
+ * Images with fewer pixels than the threshold (see set_gpu_threshold()), and
+ * every image if the program was built without OpenCL or no GPU was found,
+ * are converted by the kernels of version 0. If the device fails during the
+ * conversion, the image is converted by the CPU as well.
+ */
+
+int brightness_contrast_V4(const uint8_t *img, size_t width, size_t height, float a, float b, float c,
+                           int16_t brightness, float contrast, uint8_t *result) {
+
+    size_t n = width * height;
+    uint16_t coeffs[3];
+    convert_coeffs_to_max256(a, b, c, coeffs);
+
+#ifdef TEAM120_OPENCL
+    if (use_gpu(n)) {
+        int res = convert_opencl(img, n, coeffs, brightness, contrast, result);
+        if (res >= 0) {
+            return res;
+        }
+        fprintf(stderr, "The GPU failed, converting on the CPU\n");
+    }
+#endif
+
+    return brightness_contrast_kernels(get_kernels(), img, n, coeffs, brightness, contrast, result);
+}
@@ -0,0 +1,65 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef TEAM120_BRIGHTNESS_CONTRAST_OPENCL_H
+#define TEAM120_BRIGHTNESS_CONTRAST_OPENCL_H
+
+// pixels transferred and converted at once, one strip is copied while the other one is converted
+#define OPENCL_STRIP_PIXELS ((size_t) 1 << 22)
+#define OPENCL_SLOTS 2
+
+// images below this number of pixels are converted on the CPU, the transfers would take longer
+#define GPU_MIN_PIXELS ((size_t) 1 << 23)
+
+
+/**
+ * @brief Sets the number of pixels from which version 4 converts on the GPU.
+ *
+ * @param pixels The threshold, 0 converts every image on the GPU.
+ */
+
+void set_gpu_threshold(size_t pixels);
+
+
+/**
+ * @brief Returns the name of the GPU used by version 4.
+ *
+ * @return The name of the device, NULL if the program was built without OpenCL or no GPU was found.
+ */
+
+const char *gpu_device_name(void);
+
+
+/**
+ * @brief Returns whether version 4 converts an image on the GPU.
+ *
+ * @param n Number of pixels of the image.
+ *
+ * @return 1 if a GPU was found and the image has at least the threshold pixels, 0 otherwise.
+ */
+
+int use_gpu(size_t n);
+
+
+/**
+ * @brief Performs brightness and contrast adjustment on the GPU if the image is large enough.
+ *
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ *
+ * The result is byte-identical to brightness_contrast_V0().
+ */
+
+int brightness_contrast_V4(const uint8_t *img, size_t width, size_t height, float a, float b, float c,
+                           int16_t brightness, float contrast, uint8_t *result);
+
+#endif
@@ -0,0 +1,907 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "brightness_contrast_simd.h"
+#include "buffer_pool.h"
+#include "dispatch.h"
+#include "histogram.h"
+#include "instrument.h"
+#include "util.h"
+
+// grey values of 16 bit images counted at once, small enough to stay in the L1 cache
+#define GREY_16_CHUNK 8192
+
+// grey values converted at once before they are written with non-temporal stores, stay in the L1 cache
+#define NONTEMPORAL_BLOCK 4096
+
+// pixels converted by one call of the grey pass, the input of the next call is prefetched meanwhile
+#define PREFETCH_BLOCK 512
+
+// size of the last level cache if the operating system does not report it
+#define DEFAULT_LLC_SIZE (32 * 1024 * 1024)
+
+// seed of the positions of the sampled blocks, fixed so that the results are reproducible
+#define SAMPLE_SEED 0x9E3779B97F4A7C15ULL
+
+static size_t nontemporal_threshold = 0;
+static int nontemporal_threshold_set = 0;
+
+
+/**
+ * @brief Converts color coefficients to a scale with a maximum of 256.
+ * 
+ * @param a The coefficient for the red component.
+ * @param b The coefficient for the green component.
+ * @param c The coefficient for the blue component.
+ * @param coeffs Pointer to an array where the scaled coefficients will be stored.
+ * 
+ * This function scales the given color coefficients so that their sum equals 256.
+ * It is used to prepare the coefficients for SIMD operations that require integer
+ * values. The function iteratively adjusts the coefficients to ensure they sum up
+ * to 256 while staying as close as possible to their original ratios.
+ */
+
+void convert_coeffs_to_max256(float a, float b, float c, uint16_t *coeffs) {
+
+    float sum = a + b + c;
+    // checked of sum == 0 in cli.c > checkParams()
+    coeffs[0] = 256 * (a / sum);
+    coeffs[1] = 256 * (b / sum);
+    coeffs[2] = 256 * (c / sum);
+
+    while (1) {
+        int total = coeffs[0] + coeffs[1] + coeffs[2];
+        if (total == 256) {
+            // return if sum of coefficients is 256
+            return;
+        } else {
+            float a_diff = 256.0 * a / sum - coeffs[0];
+            float b_diff = 256.0 * b / sum - coeffs[1];
+            float c_diff = 256.0 * c / sum - coeffs[2];
+
+            if (sum < 256) {
+                // increase one coefficient by 1, if sum < 256
+                if (a_diff > b_diff) {
+                    if (a_diff > c_diff) {
+                        coeffs[0]++;
+                    } else {
+                        coeffs[2]++;
+                    }
+                } else {
+                    if (b_diff > c_diff) {
+                        coeffs[1]++;
+                    } else {
+                        coeffs[2]++;
+                    }
+                }
+            } else {
+                // decrease one coefficient by 1, if sum > 256
+                if (a_diff < b_diff) {
+                    if (a_diff < c_diff) {
+                        coeffs[0]--;
+                    } else {
+                        coeffs[2]--;
+                    }
+                } else {
+                    if (b_diff < c_diff) {
+                        coeffs[1]--;
+                    } else {
+                        coeffs[2]--;
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Converts a range of pixels to grey scale and adds the grey values to a histogram.
+ *
+ * @param kernels The kernels used for the conversion.
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param histogram Histogram with 256 entries the grey values are added to.
+ * @param result Pointer to the first grey value of the range.
+ *
+ * The kernels count into 32 bit sub-histograms, so the range is processed in
+ * chunks of HISTOGRAM_CHUNK pixels that are merged into the 64 bit histogram.
+ */
+
+void grey_pass_histogram(const Kernels *kernels, const uint8_t *img, size_t n, const uint16_t *coeffs,
+                         int16_t brightness, uint64_t *histogram, uint8_t *result) {
+
+    GreyPass grey_pass = kernels->grey_pass[grey_pass_index(brightness != 0, 1)];
+    SubHistograms hist = {{0}};
+    for (size_t i = 0; i < n; i += HISTOGRAM_CHUNK) {
+        size_t chunk = n - i < HISTOGRAM_CHUNK ? n - i : HISTOGRAM_CHUNK;
+        grey_pass(img + 3 * i, chunk, coeffs, brightness, hist, result + i);
+        histogram_merge(histogram, hist);
+    }
+}
+
+
+/**
+ * @brief Converts a range of pixels to grey scale and applies a lookup table to the grey values.
+ *
+ * @param kernels The kernels used for the conversion.
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param lookup Lookup table with 256 entries.
+ * @param histogram Histogram with 256 entries the grey values before the lookup are added to, may be NULL.
+ * @param result Pointer to the first adjusted grey value of the range.
+ *
+ * The lookup table is applied to every block of LOOKUP_BLOCK grey values right
+ * after the grey pass while they are in the L1 cache, so the range is read and
+ * written once instead of the grey values being written, read and written again.
+ */
+
+void grey_pass_lookup(const Kernels *kernels, const uint8_t *img, size_t n, const uint16_t *coeffs,
+                      int16_t brightness, const uint8_t *lookup, uint64_t *histogram, uint8_t *result) {
+
+    GreyPass grey_pass = kernels->grey_pass[grey_pass_index(brightness != 0, histogram != NULL)];
+    SubHistograms hist = {{0}};
+    size_t counted = 0;
+    for (size_t i = 0; i < n; i += LOOKUP_BLOCK) {
+        size_t block = n - i < LOOKUP_BLOCK ? n - i : LOOKUP_BLOCK;
+        grey_pass(img + 3 * i, block, coeffs, brightness, hist, result + i);
+        kernels->apply_lookup(result + i, block, lookup);
+
+        // merge before a 32 bit counter can overflow
+        counted += block;
+        if (histogram && counted > HISTOGRAM_CHUNK - LOOKUP_BLOCK) {
+            histogram_merge(histogram, hist);
+            counted = 0;
+        }
+    }
+    if (histogram) {
+        histogram_merge(histogram, hist);
+    }
+}
+
+
+/**
+ * @brief Sets the number of pixels from which the grey values are written with non-temporal stores.
+ *
+ * @param pixels Minimum number of pixels of an image, 0 for every image.
+ */
+
+void set_nontemporal_threshold(size_t pixels) {
+    nontemporal_threshold = pixels;
+    nontemporal_threshold_set = 1;
+}
+
+
+/**
+ * @brief Decides whether the grey values of an image are written with non-temporal stores.
+ *
+ * @param kernels The kernels used for the conversion.
+ * @param n Number of pixels of the image.
+ *
+ * @return 1 if grey_pass_nontemporal() should be used, 0 otherwise.
+ *
+ * Without a threshold from set_nontemporal_threshold(), images whose input and
+ * output together do not fit into the last level cache are converted with
+ * non-temporal stores. For smaller images, the grey values are likely read
+ * again from the cache, e.g. when they are written to the output file.
+ */
+
+int use_nontemporal(const Kernels *kernels, size_t n) {
+    if (!kernels->stream_store) {
+        return 0;
+    }
+    if (nontemporal_threshold_set) {
+        return n >= nontemporal_threshold;
+    }
+
+    // not cached in a static variable, the batch workers call this concurrently
+    long llc_size = -1;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    llc_size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+    // 3 bytes of input and 1 byte of output per pixel
+    return n >= (llc_size > 0 ? (size_t) llc_size : DEFAULT_LLC_SIZE) / 4;
+}
+
+
+/**
+ * @brief Converts a range of pixels to grey scale and writes the grey values with non-temporal stores.
+ *
+ * @param kernels The kernels used for the conversion, kernels->stream_store must not be NULL.
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param result Pointer to the first grey value of the range.
+ *
+ * Normal stores read every cache line of the result from memory before it is
+ * written and evict the rgb input that is still needed. Instead, blocks of
+ * NONTEMPORAL_BLOCK grey values are converted into a buffer in the L1 cache
+ * and copied to the result with non-temporal stores, which write whole cache
+ * lines directly to memory. The blocks end at cache line boundaries of the
+ * result, so only the first and the last line are written normally. The grey
+ * pass runs on PREFETCH_BLOCK pixels at a time while the input of the next
+ * PREFETCH_BLOCK pixels is prefetched into the L1 cache; prefetching whole
+ * blocks at once or further ahead was slower than the hardware prefetcher.
+ */
+
+void grey_pass_nontemporal(const Kernels *kernels, const uint8_t *img, size_t n, const uint16_t *coeffs,
+                           int16_t brightness, uint8_t *result) {
+
+    GreyPass grey_pass = kernels->grey_pass[grey_pass_index(brightness != 0, 0)];
+    _Alignas(64) uint8_t block[NONTEMPORAL_BLOCK];
+
+    size_t chunk = NONTEMPORAL_BLOCK - ((uintptr_t) result & 63);
+    for (size_t i = 0; i < n; i += chunk, chunk = NONTEMPORAL_BLOCK) {
+        if (chunk > n - i) {
+            chunk = n - i;
+        }
+        for (size_t j = 0; j < chunk; j += PREFETCH_BLOCK) {
+            size_t count = chunk - j < PREFETCH_BLOCK ? chunk - j : PREFETCH_BLOCK;
+            const uint8_t *pixels = img + 3 * (i + j);
+            for (size_t offset = 3 * PREFETCH_BLOCK; offset < 6 * PREFETCH_BLOCK && offset < 3 * (n - i - j);
+                 offset += 64) {
+                __builtin_prefetch(pixels + offset, 0, 3);
+            }
+            grey_pass(pixels, count, coeffs, brightness, NULL, block + j);
+        }
+        kernels->stream_store(result + i, block, chunk);
+    }
+}
+
+
+/**
+ * @brief Adjusts the contrast of the grey values with a lookup table built from their histogram.
+ *
+ * @param kernels The kernels used for the lookup.
+ * @param histogram Histogram with 256 entries of the grey values.
+ * @param contrast Contrast adjustment value.
+ * @param n Number of grey values.
+ * @param result Pointer to the grey values, which are replaced.
+ *
+ * @return 1 if the operation was successful, 0 if the computation for contrast failed.
+ */
+
+static int adjust_contrast(const Kernels *kernels, const uint64_t *histogram, float contrast, size_t n,
+                           uint8_t *result) {
+
+    // Adjust contrast with lookup table
+    PHASE_BEGIN(PHASE_STATISTICS);
+    uint8_t lookup[256];
+    if (!build_contrast_lookup(histogram, contrast, lookup)) {
+        return 0;
+    }
+    PHASE_END(PHASE_STATISTICS);
+    PHASE_BEGIN(PHASE_CONTRAST);
+    kernels->apply_lookup(result, n, lookup);
+    PHASE_END(PHASE_CONTRAST);
+    return 1;
+}
+
+
+/**
+ * @brief Performs brightness and contrast adjustment with the given kernels.
+ *
+ * @param kernels The kernels used for the conversion.
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param n Number of pixels of the image.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ */
+
+int brightness_contrast_kernels(const Kernels *kernels, const uint8_t *img, size_t n, const uint16_t *coeffs,
+                                int16_t brightness, float contrast, uint8_t *result) {
+
+    PHASE_BEGIN(PHASE_GREY);
+    if (isnan(contrast)) {
+        if (use_nontemporal(kernels, n)) {
+            grey_pass_nontemporal(kernels, img, n, coeffs, brightness, result);
+        } else {
+            kernels->grey_pass[grey_pass_index(brightness != 0, 0)](img, n, coeffs, brightness, NULL, result);
+        }
+        PHASE_END(PHASE_GREY);
+        return 1;
+    }
+
+    uint64_t histogram[256] = {0};
+    grey_pass_histogram(kernels, img, n, coeffs, brightness, histogram, result);
+    PHASE_END(PHASE_GREY);
+
+    return adjust_contrast(kernels, histogram, contrast, n, result);
+}
+
+
+/**
+ * @brief Performs brightness and contrast adjustment on an image using SIMD operations.
+ * 
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ * 
+ * @return 1 if the operation was successful, 0 otherwise.
+ *
+ * The function converts the provided coefficients to the [0,256] range and runs
+ * the grey pass of the selected kernel (SSE4.2, AVX2, AVX-512, NEON or scalar,
+ * see dispatch.c) over the whole image. Based on the presence of NaN in the contrast
+ * or zero in the brightness, it handles four cases: grayscale conversion only,
+ * grayscale with brightness adjustment, grayscale with contrast adjustment, and
+ * grayscale with both adjustments. For the contrast cases a histogram of the grey
+ * values is collected during the grey pass, from which the exact mean and variance
+ * are derived without another pass over the image. The contrast adjustment uses a
+ * precomputed lookup table.
+ */
+
+
+int
+brightness_contrast_V0(const uint8_t *img, size_t width, size_t height, float a, float b, float c, int16_t brightness,
+                       float contrast, uint8_t *result) {
+
+    //checked for overflow in cli.c > checkParams()
+    size_t wh = width * height;
+
+    // convert parameters to range [0,256]
+    uint16_t coeffs[3];
+    convert_coeffs_to_max256(a, b, c, coeffs);
+
+    // widest kernel supported by the cpu, see dispatch.c
+    return brightness_contrast_kernels(get_kernels(), img, wh, coeffs, brightness, contrast, result);
+}
+
+
+/**
+ * @brief Performs brightness and contrast adjustment with the precise grey pass of the given kernels.
+ *
+ * @param kernels The kernels used for the conversion.
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param n Number of pixels of the image.
+ * @param coeffs Coefficients normalised to a sum of 1 like in brightness_contrast_V1().
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ *
+ * The grey values and therefore the histogram are identical to Version 1, so
+ * the lookup table and the result are identical as well.
+ */
+
+int brightness_contrast_kernels_precise(const Kernels *kernels, const uint8_t *img, size_t n, const float *coeffs,
+                                        int16_t brightness, float contrast, uint8_t *result) {
+
+    PHASE_BEGIN(PHASE_GREY);
+    if (isnan(contrast)) {
+        kernels->grey_pass_precise[grey_pass_index(brightness != 0, 0)](img, n, coeffs, brightness, NULL, result);
+        PHASE_END(PHASE_GREY);
+        return 1;
+    }
+
+    // the kernels count into 32 bit sub-histograms, merged every HISTOGRAM_CHUNK pixels
+    GreyPassPrecise grey_pass = kernels->grey_pass_precise[grey_pass_index(brightness != 0, 1)];
+    uint64_t histogram[256] = {0};
+    SubHistograms hist = {{0}};
+    for (size_t i = 0; i < n; i += HISTOGRAM_CHUNK) {
+        size_t chunk = n - i < HISTOGRAM_CHUNK ? n - i : HISTOGRAM_CHUNK;
+        grey_pass(img + 3 * i, chunk, coeffs, brightness, hist, result + i);
+        histogram_merge(histogram, hist);
+    }
+    PHASE_END(PHASE_GREY);
+
+    return adjust_contrast(kernels, histogram, contrast, n, result);
+}
+
+
+/**
+ * @brief Performs brightness and contrast adjustment with the results of Version 1 using SIMD operations.
+ *
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ *
+ * The coefficients are normalised in float like in brightness_contrast_V1()
+ * instead of being quantised to a sum of 256, the grey pass runs in single
+ * precision SIMD lanes.
+ */
+
+int brightness_contrast_V0_precise(const uint8_t *img, size_t width, size_t height, float a, float b, float c,
+                                   int16_t brightness, float contrast, uint8_t *result) {
+
+    //checked for overflow in cli.c > checkParams()
+    size_t wh = width * height;
+
+    // normalise parameters
+    // sum = 0 checked already in cli.c > checkParams()
+    float sum = a + b + c;
+    float coeffs[3] = {a / sum, b / sum, c / sum};
+
+    // widest kernel supported by the cpu, see dispatch.c
+    return brightness_contrast_kernels_precise(get_kernels(), img, wh, coeffs, brightness, contrast, result);
+}
+
+
+/**
+ * @brief Returns the next value of a xorshift64* generator.
+ *
+ * @param state Pointer to the state of the generator, must not be zero.
+ *
+ * @return 64 pseudo random bits.
+ */
+
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+
+/**
+ * @brief Performs brightness and contrast adjustment with statistics estimated from a sample of the pixels.
+ *
+ * @param kernels The kernels used for the conversion.
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param n Number of pixels of the image.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param sample_rate One of every sample_rate blocks of SAMPLE_BLOCK pixels is sampled, at least 1.
+ * @param statistics Pointer where the estimated statistics will be stored, may be NULL.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ *
+ * The blocks are split into groups of sample_rate blocks and one block at a
+ * pseudo random position of every group is converted with the histogram, so
+ * the sample covers the whole image without following a period of it. The
+ * lookup table is built from the histogram of the sample and applied together
+ * with the grey pass over the whole image by grey_pass_lookup(), so the image
+ * is read once and the grey values are written once like without contrast.
+ * The standard errors are estimated from the differences between the sampled
+ * blocks, which includes the correlation of neighbouring pixels, and are
+ * corrected for the fraction of sampled blocks. A sample rate of 1 samples
+ * every block and gives the exact result of brightness_contrast_kernels().
+ */
+
+int brightness_contrast_kernels_sampled(const Kernels *kernels, const uint8_t *img, size_t n, const uint16_t *coeffs,
+                                        int16_t brightness, float contrast, size_t sample_rate,
+                                        SampledStatistics *statistics, uint8_t *result) {
+
+    if (isnan(contrast)) {
+        if (statistics) {
+            memset(statistics, 0, sizeof(*statistics));
+        }
+        return brightness_contrast_kernels(kernels, img, n, coeffs, brightness, contrast, result);
+    }
+
+    PHASE_BEGIN(PHASE_STATISTICS);
+    size_t blocks = (n + SAMPLE_BLOCK - 1) / SAMPLE_BLOCK;
+    size_t groups = (blocks + sample_rate - 1) / sample_rate;
+    double *moments = malloc(2 * groups * sizeof(double));
+    if (!moments) {
+        fprintf(stderr, "Failed to allocate memory for the sampled statistics\n");
+        return 0;
+    }
+
+    GreyPass grey_pass = kernels->grey_pass[grey_pass_index(brightness != 0, 1)];
+    uint64_t histogram[256] = {0};
+    SubHistograms hist = {{0}};
+    uint64_t state = SAMPLE_SEED;
+    size_t pixels = 0;
+    for (size_t g = 0; g < groups; g++) {
+        size_t first = g * sample_rate;
+        size_t count = blocks - first < sample_rate ? blocks - first : sample_rate;
+        size_t start = (first + next_random(&state) % count) * SAMPLE_BLOCK;
+        size_t m = n - start < SAMPLE_BLOCK ? n - start : SAMPLE_BLOCK;
+
+        // the grey values of the sample are overwritten by the conversion afterwards
+        grey_pass(img + 3 * start, m, coeffs, brightness, hist, result + start);
+        histogram_merge(histogram, hist);
+
+        uint64_t sum = 0;
+        uint64_t sum_sq = 0;
+        for (size_t i = 0; i < m; i++) {
+            uint64_t v = result[start + i];
+            sum += v;
+            sum_sq += v * v;
+        }
+        moments[2 * g] = (double) sum / m;
+        moments[2 * g + 1] = (double) sum_sq / m;
+        pixels += m;
+    }
+
+    uint64_t sum = 0;
+    uint64_t sum_sq = 0;
+    for (uint64_t v = 0; v < 256; v++) {
+        sum += v * histogram[v];
+        sum_sq += v * v * histogram[v];
+    }
+    double mean = (double) sum / pixels;
+    double var = (double) sum_sq / pixels - mean * mean;
+    if (var < 0.0) {
+        var = 0.0;
+    }
+    double std = sqrtHeron((float) var);
+
+    // variances of the block means and of the block variances around the estimated mean
+    double mean_error = NAN;
+    double std_error = NAN;
+    if (groups == blocks) {
+        mean_error = 0.0;
+        std_error = 0.0;
+    } else if (groups > 1) {
+        double var_means = 0.0;
+        double var_vars = 0.0;
+        for (size_t g = 0; g < groups; g++) {
+            double block_mean = moments[2 * g];
+            double block_var = moments[2 * g + 1] - 2 * mean * block_mean + mean * mean;
+            var_means += (block_mean - mean) * (block_mean - mean);
+            var_vars += (block_var - var) * (block_var - var);
+        }
+        double correction = (1.0 - (double) groups / blocks) / ((double) groups * (groups - 1));
+        mean_error = sqrtHeron((float) (var_means * correction));
+        std_error = std > 0.0 ? sqrtHeron((float) (var_vars * correction)) / (2 * std) : 0.0;
+    }
+    free(moments);
+
+    if (statistics) {
+        statistics->pixels = pixels;
+        statistics->blocks = groups;
+        statistics->mean = mean;
+        statistics->std = std;
+        statistics->mean_error = mean_error;
+        statistics->std_error = std_error;
+    }
+
+    uint8_t lookup[256];
+    if (!build_contrast_lookup(histogram, contrast, lookup)) {
+        return 0;
+    }
+    PHASE_END(PHASE_STATISTICS);
+
+    // the contrast is adjusted in the same pass
+    PHASE_BEGIN(PHASE_GREY);
+    grey_pass_lookup(kernels, img, n, coeffs, brightness, lookup, NULL, result);
+    PHASE_END(PHASE_GREY);
+    return 1;
+}
+
+
+/**
+ * @brief Performs brightness and contrast adjustment with sampled statistics using SIMD operations.
+ *
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value.
+ * @param sample_rate One of every sample_rate blocks of SAMPLE_BLOCK pixels is sampled, at least 1.
+ * @param statistics Pointer where the estimated statistics will be stored, may be NULL.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ */
+
+int brightness_contrast_V0_sampled(const uint8_t *img, size_t width, size_t height, float a, float b, float c,
+                                   int16_t brightness, float contrast, size_t sample_rate,
+                                   SampledStatistics *statistics, uint8_t *result) {
+
+    //checked for overflow in cli.c > checkParams()
+    size_t wh = width * height;
+
+    uint16_t coeffs[3];
+    convert_coeffs_to_max256(a, b, c, coeffs);
+
+    // widest kernel supported by the cpu, see dispatch.c
+    return brightness_contrast_kernels_sampled(get_kernels(), img, wh, coeffs, brightness, contrast, sample_rate,
+                                               statistics, result);
+}
+
+
+/**
+ * @brief Converts a lookup table of grey values into a table of output values in place.
+ *
+ * @param lookup Lookup table with maxval + 1 grey values in [0,maxval].
+ * @param maxval Maximum color value of the image.
+ * @param wide 1 for 16 bit output values with the most significant byte first,
+ *             0 for 8 bit output values, which are stored in the first maxval + 1 bytes of the table.
+ */
+
+static void convert_lookup_16(uint16_t *lookup, unsigned maxval, int wide) {
+    if (wide) {
+        for (size_t v = 0; v <= maxval; v++) {
+            uint8_t bytes[2] = {(uint8_t) (lookup[v] >> 8), (uint8_t) lookup[v]};
+            memcpy(&lookup[v], bytes, sizeof(bytes));
+        }
+    } else {
+        // byte v is written after entry v has been read, entries above v are not touched
+        uint8_t *lookup_8 = (uint8_t *) lookup;
+        for (size_t v = 0; v <= maxval; v++) {
+            lookup_8[v] = (uint8_t) ((lookup[v] * 255 + maxval / 2) / maxval);
+        }
+    }
+}
+
+
+/**
+ * @brief Replaces every grey value of a range by its output value from the lookup table.
+ *
+ * @param grey Pointer to the first grey value of the range.
+ * @param n Number of grey values in the range.
+ * @param lookup Lookup table converted by convert_lookup_16().
+ * @param wide 1 for 16 bit output values, 0 for 8 bit output values.
+ * @param result Pointer to the first output value of the range, may be equal to grey if wide is set.
+ */
+
+static void apply_lookup_16(const uint16_t *grey, size_t n, const uint16_t *lookup, int wide, uint8_t *result) {
+    if (wide) {
+        uint16_t *result_16 = (uint16_t *) result;
+        for (size_t i = 0; i < n; i++) {
+            result_16[i] = lookup[grey[i]];
+        }
+    } else {
+        const uint8_t *lookup_8 = (const uint8_t *) lookup;
+        for (size_t i = 0; i < n; i++) {
+            result[i] = lookup_8[grey[i]];
+        }
+    }
+}
+
+
+/**
+ * @brief Performs brightness and contrast adjustment of an image with 16 bit samples with the given kernels.
+ *
+ * @param kernels The kernels used for the conversion.
+ * @param img Pointer to the original image data, every sample stored in two bytes, most significant first.
+ * @param n Number of pixels of the image.
+ * @param maxval Maximum color value of the image, in [256,65535].
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value in [-255,255], scaled to maxval.
+ * @param contrast Contrast adjustment value in [-255,255], scaled to maxval. NaN if the contrast is not adjusted.
+ * @param wide 1 to store 16 bit grey values with maxval, 0 to scale them to 8 bit.
+ * @param result Pointer to the array where the adjusted image will be stored, 2 * n bytes if wide is set.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ *
+ * Every grey value is mapped through a table with maxval + 1 entries that applies
+ * the contrast and converts to the output: big endian 16 bit samples or 8 bit
+ * values. Without contrast the table is known in advance and every chunk of
+ * GREY_16_CHUNK grey values is mapped while it is in the L1 cache. With contrast
+ * the 16 bit grey values of the whole image are counted into a histogram with
+ * maxval + 1 entries and kept until the table is built.
+ */
+
+int brightness_contrast_kernels_16(const Kernels *kernels, const uint8_t *img, size_t n, unsigned maxval,
+                                   const uint16_t *coeffs, int16_t brightness, float contrast, int wide,
+                                   uint8_t *result) {
+
+    // round brightness * maxval / 255 to the nearest integer
+    int32_t scaled_brightness = brightness * (int32_t) maxval;
+    scaled_brightness = (scaled_brightness >= 0 ? scaled_brightness + 127 : scaled_brightness - 127) / 255;
+
+    uint16_t *lookup = malloc((maxval + 1) * sizeof(uint16_t));
+    if (!lookup) {
+        fprintf(stderr, "Unable to allocate memory for 16 bit conversion\n");
+        return 0;
+    }
+
+    if (isnan(contrast)) {
+        // Case 0 and 1: Grey Scale (+ Brightness)
+        for (size_t v = 0; v <= maxval; v++) {
+            lookup[v] = (uint16_t) v;
+        }
+        convert_lookup_16(lookup, maxval, wide);
+
+        PHASE_BEGIN(PHASE_GREY);
+        uint16_t chunk_grey[GREY_16_CHUNK];
+        for (size_t i = 0; i < n; i += GREY_16_CHUNK) {
+            size_t chunk = n - i < GREY_16_CHUNK ? n - i : GREY_16_CHUNK;
+            uint16_t *grey = wide ? (uint16_t *) result + i : chunk_grey;
+            kernels->grey_pass_16(img + 6 * i, chunk, coeffs, scaled_brightness, (uint16_t) maxval, grey);
+            apply_lookup_16(grey, chunk, lookup, wide, wide ? (uint8_t *) grey : result + i);
+        }
+        PHASE_END(PHASE_GREY);
+        free(lookup);
+        return 1;
+    }
+
+    // Case 2 and 3: Grey Scale (+ Brightness) + Contrast, wide results are converted in place
+    PoolBuffer grey_buffer = {NULL, 0};
+    uint16_t *grey = (uint16_t *) result;
+    uint64_t *histogram = calloc(maxval + 1, sizeof(uint64_t));
+    int success = histogram != NULL;
+    if (success && !wide) {
+        success = buffer_alloc(n * sizeof(uint16_t), &grey_buffer);
+        grey = (uint16_t *) grey_buffer.data;
+    }
+    if (!success) {
+        fprintf(stderr, "Unable to allocate memory for 16 bit conversion\n");
+        free(lookup);
+        free(histogram);
+        return 0;
+    }
+
+    PHASE_BEGIN(PHASE_GREY);
+    for (size_t i = 0; i < n; i += GREY_16_CHUNK) {
+        size_t chunk = n - i < GREY_16_CHUNK ? n - i : GREY_16_CHUNK;
+        kernels->grey_pass_16(img + 6 * i, chunk, coeffs, scaled_brightness, (uint16_t) maxval, grey + i);
+        for (size_t j = i; j < i + chunk; j++) {
+            histogram[grey[j]]++;
+        }
+    }
+    PHASE_END(PHASE_GREY);
+
+    PHASE_BEGIN(PHASE_STATISTICS);
+    success = build_contrast_lookup_16(histogram, maxval, contrast * maxval / 255, lookup);
+    PHASE_END(PHASE_STATISTICS);
+
+    if (success) {
+        PHASE_BEGIN(PHASE_CONTRAST);
+        convert_lookup_16(lookup, maxval, wide);
+        apply_lookup_16(grey, n, lookup, wide, result);
+        PHASE_END(PHASE_CONTRAST);
+    }
+
+    free(lookup);
+    free(histogram);
+    buffer_free(&grey_buffer);
+    return success;
+}
+
+
+/**
+ * @brief Adjusts the brightness and contrast of an image with 16 bit samples using Version 0 implementation.
+ *
+ * @param img Pointer to the original image data, every sample stored in two bytes, most significant first.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param maxval Maximum color value of the image, in [256,65535].
+ * @param a The coefficient for the red component in the grayscale conversion.
+ * @param b The coefficient for the green component in the grayscale conversion.
+ * @param c The coefficient for the blue component in the grayscale conversion.
+ * @param brightness The brightness adjustment value, relative to a maximum value of 255.
+ * @param contrast The contrast adjustment value, relative to a maximum value of 255.
+ * @param wide 1 to store 16 bit grey values with maxval, 0 to scale them to 8 bit.
+ * @param result Pointer to the array where the adjusted image will be stored, 2 * width * height bytes if wide is set.
+ *
+ * @return Returns 1 on successful completion, 0 on failure.
+ */
+
+int brightness_contrast_V0_16(const uint8_t *img, size_t width, size_t height, unsigned maxval, float a, float b,
+                              float c, int16_t brightness, float contrast, int wide, uint8_t *result) {
+
+    //checked for overflow in ppm.c > parsePPMHeader()
+    size_t wh = width * height;
+
+    uint16_t coeffs[3];
+    convert_coeffs_to_max256(a, b, c, coeffs);
+
+    // widest kernel supported by the cpu, see dispatch.c
+    return brightness_contrast_kernels_16(get_kernels(), img, wh, maxval, coeffs, brightness, contrast, wide, result);
+}
+
+
+/**
+ * @brief Builds the lookup table that adds the brightness to grey values and adjusts their contrast.
+ *
+ * @param histogram Histogram of the grey values without brightness, only used if the contrast is adjusted.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param lookup Lookup table with 256 entries.
+ *
+ * @return 1 on success, 0 if the contrast lookup table could not be built.
+ *
+ * Adding the brightness and clamping maps every grey value to a single one,
+ * so the histogram of the grey values with brightness is the shifted
+ * histogram, and the contrast table is applied to the shifted values. The
+ * result equals a conversion of version 0 with the brightness in the grey pass.
+ */
+
+int build_adjust_lookup(const uint64_t *histogram, int brightness, float contrast, uint8_t *lookup) {
+    uint8_t shifted[256];
+    for (int v = 0; v < 256; v++) {
+        int value = v + brightness;
+        shifted[v] = (uint8_t) (value < 0 ? 0 : value > 255 ? 255 : value);
+    }
+    if (isnan(contrast)) {
+        memcpy(lookup, shifted, sizeof(shifted));
+        return 1;
+    }
+
+    uint64_t shifted_histogram[256] = {0};
+    for (int v = 0; v < 256; v++) {
+        shifted_histogram[shifted[v]] += histogram[v];
+    }
+    uint8_t contrast_lookup[256];
+    if (!build_contrast_lookup(shifted_histogram, contrast, contrast_lookup)) {
+        return 0;
+    }
+    for (int v = 0; v < 256; v++) {
+        lookup[v] = contrast_lookup[shifted[v]];
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Adjusts the brightness and contrast of an image that already holds grey values.
+ *
+ * @param grey Pointer to the grey values, one byte per pixel, e.g. the luma of a JPEG image.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param brightness The brightness adjustment value.
+ * @param contrast The contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ *
+ * The grey pass of version 0 is skipped: the grey values are counted if the
+ * contrast is adjusted, and copied through the lookup table of
+ * build_adjust_lookup() in blocks of LOOKUP_BLOCK values that stay in the L1
+ * cache.
+ */
+
+int brightness_contrast_grey(const uint8_t *grey, size_t width, size_t height, int16_t brightness, float contrast,
+                             uint8_t *result) {
+    size_t n = width * height;
+    const Kernels *kernels = get_kernels();
+
+    uint64_t histogram[256] = {0};
+    if (!isnan(contrast)) {
+        PHASE_BEGIN(PHASE_GREY);
+        SubHistograms hist = {{0}};
+        for (size_t i = 0; i < n; i += HISTOGRAM_CHUNK) {
+            size_t chunk = n - i < HISTOGRAM_CHUNK ? n - i : HISTOGRAM_CHUNK;
+            histogram_count(hist, grey + i, chunk);
+            histogram_merge(histogram, hist);
+        }
+        PHASE_END(PHASE_GREY);
+    }
+
+    PHASE_BEGIN(PHASE_STATISTICS);
+    uint8_t lookup[256];
+    int success = build_adjust_lookup(histogram, brightness, contrast, lookup);
+    PHASE_END(PHASE_STATISTICS);
+    if (!success) {
+        return 0;
+    }
+
+    PHASE_BEGIN(PHASE_CONTRAST);
+    if (!brightness && isnan(contrast)) {
+        memcpy(result, grey, n);
+    } else {
+        for (size_t i = 0; i < n; i += LOOKUP_BLOCK) {
+            size_t block = n - i < LOOKUP_BLOCK ? n - i : LOOKUP_BLOCK;
+            memcpy(result + i, grey + i, block);
+            kernels->apply_lookup(result + i, block, lookup);
+        }
+    }
+    PHASE_END(PHASE_CONTRAST);
+    return 1;
+}
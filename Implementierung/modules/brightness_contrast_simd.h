@@ -0,0 +1,304 @@
+#include <stdint.h>
+#include <stdio.h>
+#include "dispatch.h"
+
+#ifndef TEAM120_BRIGHTNESS_CONTRAST_SIMD_H
+#define TEAM120_BRIGHTNESS_CONTRAST_SIMD_H
+
+// pixels converted and adjusted at once by grey_pass_lookup(), the grey values stay in the L1 cache
+#define LOOKUP_BLOCK 4096
+
+// pixels of a block sampled by brightness_contrast_kernels_sampled()
+#define SAMPLE_BLOCK 4096
+
+typedef struct {
+    size_t pixels;              // number of sampled pixels
+    size_t blocks;              // number of sampled blocks
+    double mean, std;           // estimated mean and standard deviation of the grey values
+    double mean_error;          // standard error of the mean, 0 if every block and NaN if one block was sampled
+    double std_error;           // standard error of the standard deviation, like mean_error
+} SampledStatistics;
+
+/**
+ * @brief Converts color coefficients to a scale with a maximum of 256.
+ * 
+ * @param a The coefficient for the red component.
+ * @param b The coefficient for the green component.
+ * @param c The coefficient for the blue component.
+ * @param coeffs Pointer to an array where the scaled coefficients will be stored.
+ * 
+ * This function scales the given color coefficients so that their sum equals 256.
+ * It is used to prepare the coefficients for SIMD operations that require integer
+ * values. The function iteratively adjusts the coefficients to ensure they sum up
+ * to the desired total while staying as close as possible to their original ratios.
+ */
+
+void convert_coeffs_to_max256(float a, float b, float c, uint16_t *coeffs);
+
+
+/**
+ * @brief Sets the number of pixels from which the grey values are written with non-temporal stores.
+ *
+ * @param pixels Minimum number of pixels of an image, 0 for every image.
+ *
+ * Without a call, the threshold is derived from the size of the last level cache.
+ */
+
+void set_nontemporal_threshold(size_t pixels);
+
+
+/**
+ * @brief Decides whether the grey values of an image are written with non-temporal stores.
+ *
+ * @param kernels The kernels used for the conversion.
+ * @param n Number of pixels of the image.
+ *
+ * @return 1 if grey_pass_nontemporal() should be used, 0 otherwise.
+ */
+
+int use_nontemporal(const Kernels *kernels, size_t n);
+
+
+/**
+ * @brief Converts a range of pixels to grey scale and writes the grey values with non-temporal stores.
+ *
+ * @param kernels The kernels used for the conversion, kernels->stream_store must not be NULL.
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param result Pointer to the first grey value of the range.
+ */
+
+void grey_pass_nontemporal(const Kernels *kernels, const uint8_t *img, size_t n, const uint16_t *coeffs,
+                           int16_t brightness, uint8_t *result);
+
+
+/**
+ * @brief Converts a range of pixels to grey scale and adds the grey values to a histogram.
+ *
+ * @param kernels The kernels used for the conversion.
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param histogram Histogram with 256 entries the grey values are added to.
+ * @param result Pointer to the first grey value of the range.
+ */
+
+void grey_pass_histogram(const Kernels *kernels, const uint8_t *img, size_t n, const uint16_t *coeffs,
+                         int16_t brightness, uint64_t *histogram, uint8_t *result);
+
+
+/**
+ * @brief Converts a range of pixels to grey scale and applies a lookup table to the grey values.
+ *
+ * @param kernels The kernels used for the conversion.
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param lookup Lookup table with 256 entries.
+ * @param histogram Histogram with 256 entries the grey values before the lookup are added to, may be NULL.
+ * @param result Pointer to the first adjusted grey value of the range.
+ */
+
+void grey_pass_lookup(const Kernels *kernels, const uint8_t *img, size_t n, const uint16_t *coeffs,
+                      int16_t brightness, const uint8_t *lookup, uint64_t *histogram, uint8_t *result);
+
+
+/**
+ * @brief Performs brightness and contrast adjustment with the given kernels.
+ *
+ * @param kernels The kernels used for the conversion.
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param n Number of pixels of the image.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ */
+
+int brightness_contrast_kernels(const Kernels *kernels, const uint8_t *img, size_t n, const uint16_t *coeffs,
+                                int16_t brightness, float contrast, uint8_t *result);
+
+
+/**
+ * @brief Performs brightness and contrast adjustment on an image using SIMD operations.
+ *
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ */
+
+int brightness_contrast_V0(const uint8_t *img, size_t width, size_t height, float a, float b, float c, int16_t brightness, float contrast, uint8_t *result);
+
+
+/**
+ * @brief Performs brightness and contrast adjustment with the precise grey pass of the given kernels.
+ *
+ * @param kernels The kernels used for the conversion.
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param n Number of pixels of the image.
+ * @param coeffs Coefficients normalised to a sum of 1 like in brightness_contrast_V1().
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ */
+
+int brightness_contrast_kernels_precise(const Kernels *kernels, const uint8_t *img, size_t n, const float *coeffs,
+                                        int16_t brightness, float contrast, uint8_t *result);
+
+
+/**
+ * @brief Performs brightness and contrast adjustment with the results of Version 1 using SIMD operations.
+ *
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ */
+
+int brightness_contrast_V0_precise(const uint8_t *img, size_t width, size_t height, float a, float b, float c,
+                                   int16_t brightness, float contrast, uint8_t *result);
+
+
+
+/**
+ * @brief Performs brightness and contrast adjustment with statistics estimated from a sample of the pixels.
+ *
+ * @param kernels The kernels used for the conversion.
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param n Number of pixels of the image.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param sample_rate One of every sample_rate blocks of SAMPLE_BLOCK pixels is sampled, at least 1.
+ * @param statistics Pointer where the estimated statistics will be stored, may be NULL.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ */
+
+int brightness_contrast_kernels_sampled(const Kernels *kernels, const uint8_t *img, size_t n, const uint16_t *coeffs,
+                                        int16_t brightness, float contrast, size_t sample_rate,
+                                        SampledStatistics *statistics, uint8_t *result);
+
+
+/**
+ * @brief Performs brightness and contrast adjustment with sampled statistics using SIMD operations.
+ *
+ * @param img Pointer to the original image data in uint8_t array.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value.
+ * @param sample_rate One of every sample_rate blocks of SAMPLE_BLOCK pixels is sampled, at least 1.
+ * @param statistics Pointer where the estimated statistics will be stored, may be NULL.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ */
+
+int brightness_contrast_V0_sampled(const uint8_t *img, size_t width, size_t height, float a, float b, float c,
+                                   int16_t brightness, float contrast, size_t sample_rate,
+                                   SampledStatistics *statistics, uint8_t *result);
+
+
+/**
+ * @brief Performs brightness and contrast adjustment of an image with 16 bit samples with the given kernels.
+ *
+ * @param kernels The kernels used for the conversion.
+ * @param img Pointer to the original image data, every sample stored in two bytes, most significant first.
+ * @param n Number of pixels of the image.
+ * @param maxval Maximum color value of the image, in [256,65535].
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value in [-255,255], scaled to maxval.
+ * @param contrast Contrast adjustment value in [-255,255], scaled to maxval. NaN if the contrast is not adjusted.
+ * @param wide 1 to store 16 bit grey values with maxval, 0 to scale them to 8 bit.
+ * @param result Pointer to the array where the adjusted image will be stored, 2 * n bytes if wide is set.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ */
+
+int brightness_contrast_kernels_16(const Kernels *kernels, const uint8_t *img, size_t n, unsigned maxval,
+                                   const uint16_t *coeffs, int16_t brightness, float contrast, int wide,
+                                   uint8_t *result);
+
+
+/**
+ * @brief Adjusts the brightness and contrast of an image with 16 bit samples using Version 0 implementation.
+ *
+ * @param img Pointer to the original image data, every sample stored in two bytes, most significant first.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param maxval Maximum color value of the image, in [256,65535].
+ * @param a The coefficient for the red component in the grayscale conversion.
+ * @param b The coefficient for the green component in the grayscale conversion.
+ * @param c The coefficient for the blue component in the grayscale conversion.
+ * @param brightness The brightness adjustment value, relative to a maximum value of 255.
+ * @param contrast The contrast adjustment value, relative to a maximum value of 255.
+ * @param wide 1 to store 16 bit grey values with maxval, 0 to scale them to 8 bit.
+ * @param result Pointer to the array where the adjusted image will be stored, 2 * width * height bytes if wide is set.
+ *
+ * @return Returns 1 on successful completion, 0 on failure.
+ */
+
+int brightness_contrast_V0_16(const uint8_t *img, size_t width, size_t height, unsigned maxval, float a, float b,
+                              float c, int16_t brightness, float contrast, int wide, uint8_t *result);
+
+
+/**
+ * @brief Builds the lookup table that adds the brightness to grey values and adjusts their contrast.
+ *
+ * @param histogram Histogram of the grey values without brightness, only used if the contrast is adjusted.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param lookup Lookup table with 256 entries.
+ *
+ * @return 1 on success, 0 if the contrast lookup table could not be built.
+ */
+
+int build_adjust_lookup(const uint64_t *histogram, int brightness, float contrast, uint8_t *lookup);
+
+
+/**
+ * @brief Adjusts the brightness and contrast of an image that already holds grey values.
+ *
+ * @param grey Pointer to the grey values, one byte per pixel, e.g. the luma of a JPEG image.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param brightness The brightness adjustment value.
+ * @param contrast The contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param result Pointer to the array where the adjusted image will be stored.
+ *
+ * @return 1 if the operation was successful, 0 otherwise.
+ */
+
+int brightness_contrast_grey(const uint8_t *grey, size_t width, size_t height, int16_t brightness, float contrast,
+                             uint8_t *result);
+
+
+#endif
@@ -1,95 +1,13 @@
 #include <immintrin.h>
 #include <emmintrin.h>
 #include <tmmintrin.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
-#include <math.h>
-#include "util.h"
-
-
-/**
- * @brief Converts color coefficients to a scale with a maximum of 256.
- * 
- * @param a The coefficient for the red component.
- * @param b The coefficient for the green component.
- * @param c The coefficient for the blue component.
- * @param coeffs Pointer to an array where the scaled coefficients will be stored.
- * 
- * This function scales the given color coefficients so that their sum equals 256.
- * It is used to prepare the coefficients for SIMD operations that require integer
- * values. The function iteratively adjusts the coefficients to ensure they sum up
- * to 256 while staying as close as possible to their original ratios.
- */
-
-void convert_coeffs_to_max256(float a, float b, float c, uint16_t *coeffs) {
-
-    float sum = a + b + c;
-    // checked of sum == 0 in util.c > checkParams()
-    coeffs[0] = 256 * (a / sum);
-    coeffs[1] = 256 * (b / sum);
-    coeffs[2] = 256 * (c / sum);
-
-    while (1) {
-        int total = coeffs[0] + coeffs[1] + coeffs[2];
-        if (total == 256) {
-            // return if sum of coefficients is 256
-            return;
-        } else {
-            float a_diff = 256.0 * a / sum - coeffs[0];
-            float b_diff = 256.0 * b / sum - coeffs[1];
-            float c_diff = 256.0 * c / sum - coeffs[2];
-
-            if (sum < 256) {
-                // increase one coefficient by 1, if sum < 256
-                if (a_diff > b_diff) {
-                    if (a_diff > c_diff) {
-                        coeffs[0]++;
-                    } else {
-                        coeffs[2]++;
-                    }
-                } else {
-                    if (b_diff > c_diff) {
-                        coeffs[1]++;
-                    } else {
-                        coeffs[2]++;
-                    }
-                }
-            } else {
-                // decrease one coefficient by 1, if sum > 256
-                if (a_diff < b_diff) {
-                    if (a_diff < c_diff) {
-                        coeffs[0]--;
-                    } else {
-                        coeffs[2]--;
-                    }
-                } else {
-                    if (b_diff < c_diff) {
-                        coeffs[1]--;
-                    } else {
-                        coeffs[2]--;
-                    }
-                }
-            }
-        }
-    }
-}
-
-
-/**
- * @brief Sums all elements of a 128-bit vector containing 16-bit integers.
- * 
- * @param vector The __m128i vector to be summed.
- * 
- * @return The sum of all eight 16-bit integers within the vector.
- */
-
-int sum_mm_epi16(__m128i vector) {
-    __m128i sum1 = _mm_add_epi16(vector, _mm_srli_si128(vector, 8));
-    __m128i sum2 = _mm_add_epi16(sum1, _mm_srli_si128(sum1, 4));
-    __m128i sum3 = _mm_add_epi16(sum2, _mm_srli_si128(sum2, 2));
-
-    return _mm_extract_epi16(sum3, 0);
-}
+#include <string.h>
+#include "brightness_contrast.h"
+#include "brightness_contrast_sse.h"
+#include "histogram.h"
 
 
 /**
@@ -110,6 +28,7 @@ int sum_mm_epi16(__m128i vector) {
  * vectors representing the grayscale values of the 16 pixels.
  */
 
+__attribute__((target("sse4.2")))
 void load_and_convert_to_grey16(const uint8_t *img, size_t i,
                                 __m128i mask_red, __m128i mask_red2, __m128i mask_red3, __m128i mask_red4,
                                 __m128i mask_green, __m128i mask_green2, __m128i mask_green3, __m128i mask_green4,
@@ -147,41 +66,26 @@ void load_and_convert_to_grey16(const uint8_t *img, size_t i,
 
 
 /**
- * @brief Performs brightness and contrast adjustment on an image using SIMD operations.
- * 
- * @param img Pointer to the original image data in uint8_t array.
- * @param width Width of the image.
- * @param height Height of the image.
- * @param a Coefficient for the red component in the grayscale conversion.
- * @param b Coefficient for the green component in the grayscale conversion.
- * @param c Coefficient for the blue component in the grayscale conversion.
+ * @brief Converts a range of pixels to grey scale and applies the brightness using SIMD operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range, at most HISTOGRAM_CHUNK if hist is set.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
  * @param brightness Brightness adjustment value.
- * @param contrast Contrast adjustment value.
- * @param result Pointer to the array where the adjusted image will be stored.
- * 
- * @return 1 if the operation was successful, 0 otherwise.
+ * @param hist If not NULL, the grey values are counted into these sub-histograms for the contrast calculation.
+ * @param result Pointer to the first grey value of the range.
+ * @param with_brightness, with_histogram Constant in every variant, see DEFINE_GREY_PASS_VARIANTS().
  *
- * The function first checks for overflow when calculating the size needed for the image.
- * Then it converts the provided coefficients to the [0,256] range and sets up the necessary
- * SIMD constants. Based on the presence of NaN in the contrast or zero in the brightness,
- * it handles four cases: grayscale conversion only, grayscale with brightness adjustment,
- * grayscale with contrast adjustment, and grayscale with both adjustments. The function
- * uses SIMD instructions to load and process blocks of pixels in parallel, applying the
- * grayscale conversion and brightness and contrast adjustments as needed. The contrast
- * adjustment uses a precomputed lookup table.
+ * The range is processed in blocks of 16 pixels, remaining pixels are converted
+ * by grey_pass_scalar. The histogram is counted from the 16 grey values just stored,
+ * which are still in the L1 cache. Since every range is independent of all others,
+ * the function can be called for disjoint bands of the same image in parallel.
  */
 
-
-int
-brightness_contrast_V0(const uint8_t *img, size_t width, size_t height, float a, float b, float c, int16_t brightness,
-                       float contrast, uint8_t *result) {
-
-    //checked for overflow in util.c > checkParams()
-    size_t wh = width * height;
-
-    // convert parameters to range [0,256]
-    uint16_t coeffs[3];
-    convert_coeffs_to_max256(a, b, c, coeffs);
+__attribute__((target("sse4.2"), always_inline))
+static inline void grey_pass_V0_body(const uint8_t *img, size_t n, const uint16_t *coeffs, int16_t brightness,
+                                     SubHistograms hist, uint8_t *result, const int with_brightness,
+                                     const int with_histogram) {
 
     // parameters stored as 16 bit integers
     __m128i a_coeff = _mm_set1_epi16(coeffs[0]);
@@ -213,228 +117,584 @@ brightness_contrast_V0(const uint8_t *img, size_t width, size_t height, float a,
     __m128i zero = _mm_setzero_si128();
     __m128i max = _mm_set1_epi16(255);
     __m128i brightness_vector = _mm_set1_epi16((short) brightness);
-    __m128i mean_vector = _mm_setzero_si128();
-
-    __m128i grey1;
-    __m128i grey2;
-    int16_t res;
-
-    if (isnan(contrast)) {
-        if (!brightness) {
-            // Case 0: Grey Scale
-            for (size_t i = 0; i < wh - (wh % 16); i += 16) {
-                // convert next 16 pixels to grey -> grey1, grey2
-                load_and_convert_to_grey16(img, i,
-                                           mask_red1, mask_red2, mask_red3, mask_red4,
-                                           mask_green1, mask_green2, mask_green3, mask_green4,
-                                           mask_blue1, mask_blue2, mask_blue3, mask_blue4,
-                                           a_coeff, b_coeff, c_coeff,
-                                           &grey1, &grey2);
-
-                // combine first 8 and last 8 grey values and store result
-                grey1 = _mm_shuffle_epi8(grey1, mask_grey);
-                grey2 = _mm_shuffle_epi8(grey2, mask_grey2);
-                _mm_storeu_si128((__m128i *) (result + i), _mm_or_si128(grey1, grey2));
-            }
-            // process remaining pixels after SIMD
-            for (size_t i = wh - (wh % 16); i < wh; i++) {
-                res = (coeffs[0] * img[i * 3] + coeffs[1] * img[i * 3 + 1] + coeffs[2] * img[i * 3 + 2]) / 256;
-                result[i] = (uint8_t) res;
-            }
-        } else {
-            for (size_t i = 0; i < wh - (wh % 16); i += 16) {
-                // convert next 16 pixels to grey -> grey1, grey2
-                load_and_convert_to_grey16(img, i,
-                                           mask_red1, mask_red2, mask_red3, mask_red4,
-                                           mask_green1, mask_green2, mask_green3, mask_green4,
-                                           mask_blue1, mask_blue2, mask_blue3, mask_blue4,
-                                           a_coeff, b_coeff, c_coeff,
-                                           &grey1, &grey2);
-
-                // add brightness to grey values
-                grey1 = _mm_add_epi16(grey1, brightness_vector);
-                grey2 = _mm_add_epi16(grey2, brightness_vector);
-
-                // clamp values in [0,255]
-                grey1 = _mm_min_epi16(max, grey1);
-                grey1 = _mm_max_epi16(zero, grey1);
-                grey2 = _mm_min_epi16(max, grey2);
-                grey2 = _mm_max_epi16(zero, grey2);
-
-                // combine first 8 and last 8 grey values and store result
-                grey1 = _mm_shuffle_epi8(grey1, mask_grey);
-                grey2 = _mm_shuffle_epi8(grey2, mask_grey2);
-                _mm_storeu_si128((__m128i *) (result + i), _mm_or_si128(grey1, grey2));
-            }
-            // process remaining pixels after SIMD
-            for (size_t i = wh - (wh % 16); i < wh; i++) {
-                res = (coeffs[0] * img[i * 3] + coeffs[1] * img[i * 3 + 1] + coeffs[2] * img[i * 3 + 2]) / 256;
-                res += brightness;
-                if (res > 255) {
-                    result[i] = 255;
-                } else if (res < 0) {
-                    result[i] = 0;
-                } else {
-                    result[i] = (uint8_t) res;
-                }
-            }
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        // convert next 16 pixels to grey -> grey1, grey2
+        __m128i grey1;
+        __m128i grey2;
+        load_and_convert_to_grey16(img, i,
+                                   mask_red1, mask_red2, mask_red3, mask_red4,
+                                   mask_green1, mask_green2, mask_green3, mask_green4,
+                                   mask_blue1, mask_blue2, mask_blue3, mask_blue4,
+                                   a_coeff, b_coeff, c_coeff,
+                                   &grey1, &grey2);
+
+        if (with_brightness) {
+            // add brightness to grey values
+            grey1 = _mm_add_epi16(grey1, brightness_vector);
+            grey2 = _mm_add_epi16(grey2, brightness_vector);
+
+            // clamp values in [0,255]
+            grey1 = _mm_min_epi16(max, grey1);
+            grey1 = _mm_max_epi16(zero, grey1);
+            grey2 = _mm_min_epi16(max, grey2);
+            grey2 = _mm_max_epi16(zero, grey2);
         }
-    } else {
-        double mean = 0;
-        double var = 0;
-
-        if (!brightness) {
-            // Case 2: Grey Scale + Contrast
-            for (size_t i = 0; i < wh - (wh % 16); i += 16) {
-                // convert next 16 pixels to grey -> grey1, grey2
-                load_and_convert_to_grey16(img, i,
-                                           mask_red1, mask_red2, mask_red3, mask_red4,
-                                           mask_green1, mask_green2, mask_green3, mask_green4,
-                                           mask_blue1, mask_blue2, mask_blue3, mask_blue4,
-                                           a_coeff, b_coeff, c_coeff,
-                                           &grey1, &grey2);
-
-                // calculate mean by summing grey values
-                mean_vector = _mm_add_epi16(mean_vector, grey1);
-                mean_vector = _mm_add_epi16(mean_vector, grey2);
-
-                // store sum in mean and reset mean_vector to avoid overflow
-                if (i % 128 == 0) {
-                    mean += sum_mm_epi16(mean_vector);
-                    mean_vector = _mm_setzero_si128();
-                }
-                grey1 = _mm_shuffle_epi8(grey1, mask_grey);
-                grey2 = _mm_shuffle_epi8(grey2, mask_grey2);
-                _mm_storeu_si128((__m128i *) (result + i), _mm_or_si128(grey1, grey2));
-            }
-            mean += sum_mm_epi16(mean_vector);
 
-            // process remaining pixels after SIMD
-            for (size_t i = wh - (wh % 16); i < wh; i++) {
-                res = (coeffs[0] * img[i * 3] + coeffs[1] * img[i * 3 + 1] + coeffs[2] * img[i * 3 + 2]) / 256;
-                result[i] = (uint8_t) res;
-                mean += res;
-            }
-        } else {
-            // Case 3: Grey Scale + Brightness + Contrast
-            for (size_t i = 0; i < wh - (wh % 16); i += 16) {
-                // convert next 16 pixels to grey -> grey1, grey2
-                load_and_convert_to_grey16(img, i,
-                                           mask_red1, mask_red2, mask_red3, mask_red4,
-                                           mask_green1, mask_green2, mask_green3, mask_green4,
-                                           mask_blue1, mask_blue2, mask_blue3, mask_blue4,
-                                           a_coeff, b_coeff, c_coeff,
-                                           &grey1, &grey2);
-
-                // add brightness
-                grey1 = _mm_add_epi16(grey1, brightness_vector);
-                grey2 = _mm_add_epi16(grey2, brightness_vector);
-
-                // clamp values in [0,255]
-                grey1 = _mm_min_epi16(max, grey1);
-                grey1 = _mm_max_epi16(zero, grey1);
-                grey2 = _mm_min_epi16(max, grey2);
-                grey2 = _mm_max_epi16(zero, grey2);
-
-                // calculate mean by summing grey values
-                mean_vector = _mm_add_epi16(mean_vector, grey1);
-                mean_vector = _mm_add_epi16(mean_vector, grey2);
-
-                // store sum in mean and reset mean_vector to avoid overflow
-                if (i % 128 == 0) {
-                    mean += sum_mm_epi16(mean_vector);
-                    mean_vector = _mm_setzero_si128();
-                }
-
-                // combine first 8 and last 8 grey values and store result 
-                grey1 = _mm_shuffle_epi8(grey1, mask_grey);
-                grey2 = _mm_shuffle_epi8(grey2, mask_grey2);
-                _mm_storeu_si128((__m128i *) (result + i), _mm_or_si128(grey1, grey2));
-            }
-            mean += sum_mm_epi16(mean_vector);
-
-            // convert remaining pixels 
-            for (size_t i = wh - (wh % 16); i < wh; i++) {
-                res = (coeffs[0] * img[i * 3] + coeffs[1] * img[i * 3 + 1] + coeffs[2] * img[i * 3 + 2]) / 256;
-                res += brightness;
-                if (res > 255) {
-                    result[i] = 255;
-                    mean += 255;
-                } else if (res < 0) {
-                    result[i] = 0;
-                } else {
-                    result[i] = (uint8_t) res;
-                    mean += res;
-                }
-            }
+        // combine first 8 and last 8 grey values and store result
+        grey1 = _mm_shuffle_epi8(grey1, mask_grey);
+        grey2 = _mm_shuffle_epi8(grey2, mask_grey2);
+        _mm_storeu_si128((__m128i *) (result + i), _mm_or_si128(grey1, grey2));
+
+        if (with_histogram) {
+            histogram_count(hist, result + i, 16);
         }
-        mean /= wh;
+    }
 
-        // calcualte variance		
-        __m128 neg_mean_vec = _mm_set1_ps((float) (-1.0 * mean));
-        __m128 var_vec = _mm_set1_ps(0.0f);
-        __m128 acc;
-        __m128 pix_flt;
+    // process remaining pixels without SIMD
+    grey_pass_scalar[grey_pass_index(with_brightness, with_histogram)](img + 3 * i, n - i, coeffs, brightness, hist,
+                                                                       result + i);
+}
 
-        for (size_t i = 0; i < wh - (wh % 16); i += 16) {
-            // load next 16 grey values
-            __m128i pixels = _mm_loadu_si128((__m128i *) (result + i));
-            for (size_t j = 0; j < 4; j++) {
+DEFINE_GREY_PASS_VARIANTS(__attribute__((target("sse4.2"))), GreyPass, uint16_t, grey_pass_V0, grey_pass_V0_body)
 
-                // load 4 grey values as float into pix_flt -> 4 iterations
-                pix_flt = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(pixels));
 
-                // acc = grey_val - mean
-                acc = _mm_add_ps(pix_flt, neg_mean_vec);
+/**
+ * @brief Computes the weighted sums of 4 pixels with pmaddubsw.
+ *
+ * @param pixels 16 bytes starting at the first of the 12 bytes of the pixels.
+ * @param mask Shuffle mask spreading every pixel to 4 bytes, the fourth one is 0.
+ * @param coeff The coefficients as unsigned bytes, repeated for every pixel.
+ *
+ * @return Two 16 bit sums per pixel, the red and green products and the blue product.
+ *
+ * pmaddubsw multiplies unsigned with signed bytes. The coefficients can be
+ * larger than 127, so they are the unsigned operand and the RGB values are
+ * moved into the signed range by subtracting 128 (xor 0x80). Since the
+ * coefficients sum up to 256, no sum can saturate.
+ */
 
-                // acc = (grey_val - mean)^2
-                acc = _mm_mul_ps(acc, acc);
-                var_vec = _mm_add_ps(var_vec, acc);
+__attribute__((target("sse4.2")))
+static inline __m128i madd_grey4(__m128i pixels, __m128i mask, __m128i coeff) {
+    __m128i spread = _mm_xor_si128(_mm_shuffle_epi8(pixels, mask), _mm_set1_epi8((char) 0x80));
+    return _mm_maddubs_epi16(coeff, spread);
+}
 
-                // shift left to process next 4 bytes in next round
-                pixels = _mm_srli_si128(pixels, 4);
-            }
+
+/**
+ * @brief Converts a range of pixels to grey scale and applies the brightness using pmaddubsw.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range, at most HISTOGRAM_CHUNK if hist is set.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value.
+ * @param hist If not NULL, the grey values are counted into these sub-histograms for the contrast calculation.
+ * @param result Pointer to the first grey value of the range.
+ * @param with_brightness, with_histogram Constant in every variant, see DEFINE_GREY_PASS_VARIANTS().
+ *
+ * Alternative to grey_pass_V0 with one shuffle and one multiply-add per 4 pixels
+ * instead of six shuffles and three multiplies per 8 pixels. phaddw adds the two
+ * sums of every pixel, which gives the weighted sum of the RGB values minus
+ * 128 * 256. Flipping the sign bit removes that bias, so the grey values are
+ * identical to grey_pass_V0. The load of the last group reads 4 bytes behind
+ * the 16 pixels of an iteration. A coefficient of 256 does not fit into a byte,
+ * in that case grey_pass_V0 is used.
+ */
+
+__attribute__((target("sse4.2"), always_inline))
+static inline void grey_pass_madd_V0_body(const uint8_t *img, size_t n, const uint16_t *coeffs, int16_t brightness,
+                                          SubHistograms hist, uint8_t *result, const int with_brightness,
+                                          const int with_histogram) {
+
+    size_t variant = grey_pass_index(with_brightness, with_histogram);
+    if (coeffs[0] > 255 || coeffs[1] > 255 || coeffs[2] > 255) {
+        grey_pass_V0[variant](img, n, coeffs, brightness, hist, result);
+        return;
+    }
+
+    // red, green and blue coefficient of every pixel, the fourth byte is 0
+    __m128i coeff = _mm_set1_epi32(coeffs[0] | coeffs[1] << 8 | coeffs[2] << 16);
+    __m128i mask = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    __m128i sign = _mm_set1_epi16((short) 0x8000);
+    __m128i brightness_vector = _mm_set1_epi16((short) brightness);
+
+    size_t i = 0;
+    for (; i + 18 <= n; i += 16) {
+        const uint8_t *p = img + 3 * i;
+        __m128i sum1 = madd_grey4(_mm_loadu_si128((__m128i *) p), mask, coeff);
+        __m128i sum2 = madd_grey4(_mm_loadu_si128((__m128i *) (p + 12)), mask, coeff);
+        __m128i sum3 = madd_grey4(_mm_loadu_si128((__m128i *) (p + 24)), mask, coeff);
+        __m128i sum4 = madd_grey4(_mm_loadu_si128((__m128i *) (p + 36)), mask, coeff);
+
+        // weighted sums of 8 pixels each, remove the bias and divide by 256
+        __m128i grey1 = _mm_srli_epi16(_mm_xor_si128(_mm_hadd_epi16(sum1, sum2), sign), 8);
+        __m128i grey2 = _mm_srli_epi16(_mm_xor_si128(_mm_hadd_epi16(sum3, sum4), sign), 8);
+
+        if (with_brightness) {
+            // add brightness, packus clamps to [0,255]
+            grey1 = _mm_add_epi16(grey1, brightness_vector);
+            grey2 = _mm_add_epi16(grey2, brightness_vector);
         }
-        var_vec = _mm_hadd_ps(var_vec, var_vec);
-        var_vec = _mm_hadd_ps(var_vec, var_vec);
-        var = _mm_cvtss_f32(var_vec);
+        _mm_storeu_si128((__m128i *) (result + i), _mm_packus_epi16(grey1, grey2));
 
-        // process remaining grey values for the variance after SIMD
-        for (size_t i = wh - (wh % 16); i < wh; i++) {
-            var += (result[i] - mean) * (result[i] - mean);
+        if (with_histogram) {
+            histogram_count(hist, result + i, 16);
         }
-        var /= wh;
-
-        float kstd = 0.0;
-        if (var != 0.0) {        // if var = 0 => kstd = 0 (Aufgabenstellung)
-            kstd = contrast / sqrtHeron(var);       // k/std = k / sqrt(var)
-            if (isnan(kstd) || isinf(kstd)) {
-                fprintf(stderr, "computation for contrast failed\n");
-                return 0;
-            }
+    }
+
+    // process remaining pixels without SIMD
+    grey_pass_scalar[variant](img + 3 * i, n - i, coeffs, brightness, hist, result + i);
+}
+
+DEFINE_GREY_PASS_VARIANTS(__attribute__((target("sse4.2"))), GreyPass, uint16_t, grey_pass_madd_V0,
+                          grey_pass_madd_V0_body)
+
+
+/**
+ * @brief Replaces every grey value of a range by its entry in the lookup table using SIMD operations.
+ *
+ * @param pixels Pointer to the first grey value of the range.
+ * @param n Number of grey values in the range.
+ * @param lookup Lookup table with 256 entries.
+ *
+ * The table is split into 16 sub-tables of 16 entries that each fit into one
+ * register. For sub-table k the index x - 16k is moved into [0x70, 0x7f] by a
+ * saturating add of 0x70 only if x lies in the sub-table, otherwise the highest
+ * bit is set and pshufb returns 0. The 16 partial results are combined with OR.
+ */
+
+__attribute__((target("sse4.2")))
+void apply_lookup_V0(uint8_t *pixels, size_t n, const uint8_t *lookup) {
+
+    __m128i table[16];
+    for (int k = 0; k < 16; k++) {
+        table[k] = _mm_loadu_si128((__m128i *) (lookup + 16 * k));
+    }
+    __m128i step = _mm_set1_epi8(16);
+    __m128i offset = _mm_set1_epi8(0x70);
+
+    for (size_t i = 0; i < n - (n % 16); i += 16) {
+        __m128i idx = _mm_loadu_si128((__m128i *) (pixels + i));
+        __m128i res = _mm_shuffle_epi8(table[0], _mm_adds_epu8(idx, offset));
+        for (int k = 1; k < 16; k++) {
+            idx = _mm_sub_epi8(idx, step);
+            res = _mm_or_si128(res, _mm_shuffle_epi8(table[k], _mm_adds_epu8(idx, offset)));
         }
+        _mm_storeu_si128((__m128i *) (pixels + i), res);
+    }
+
+    // process remaining grey values after SIMD
+    for (size_t i = n - (n % 16); i < n; i++) {
+        pixels[i] = lookup[pixels[i]];
+    }
+}
+
+
+/**
+ * @brief Copies a range of bytes with non-temporal stores using SIMD operations.
+ *
+ * @param dst Pointer to the destination.
+ * @param src Pointer to the source, should be in the cache.
+ * @param n Number of bytes.
+ *
+ * movntdq writes whole cache lines to memory without reading them first and
+ * without evicting other data from the caches. It needs a 16 byte aligned
+ * destination, so the bytes up to the first boundary and after the last
+ * boundary are copied normally. The sfence orders the stores before any later
+ * store of this thread.
+ */
+
+__attribute__((target("sse4.2")))
+void stream_store_V0(uint8_t *dst, const uint8_t *src, size_t n) {
+
+    size_t head = (16 - ((uintptr_t) dst & 15)) & 15;
+    size_t i = head < n ? head : n;
+    memcpy(dst, src, i);
+
+    for (; i + 16 <= n; i += 16) {
+        _mm_stream_si128((__m128i *) (dst + i), _mm_loadu_si128((const __m128i *) (src + i)));
+    }
+    memcpy(dst + i, src + i, n - i);
+    _mm_sfence();
+}
+
+
+/**
+ * @brief Converts 4 pixels with 16 bit samples to grey scale using SIMD operations.
+ *
+ * @param low The first 16 bytes of the 24 bytes of the pixels.
+ * @param high The last 16 bytes of the 24 bytes of the pixels.
+ * @param masks Shuffle masks for the red, green and blue samples in low and high.
+ * @param coeffs Coefficients for each color channel in 32 bit lanes.
+ *
+ * @return The 4 grey values in 32 bit lanes, not clamped.
+ *
+ * pshufb swaps the two bytes of every big endian sample and extends it to 32 bit
+ * in the same step. The weighted sum of three samples is below 2^25, so the
+ * products are accumulated with pmulld in 32 bit lanes.
+ */
+
+__attribute__((target("sse4.2")))
+static inline __m128i convert_to_grey4_16(__m128i low, __m128i high, const __m128i *masks, const __m128i *coeffs) {
+    __m128i red = _mm_or_si128(_mm_shuffle_epi8(low, masks[0]), _mm_shuffle_epi8(high, masks[1]));
+    __m128i green = _mm_or_si128(_mm_shuffle_epi8(low, masks[2]), _mm_shuffle_epi8(high, masks[3]));
+    __m128i blue = _mm_or_si128(_mm_shuffle_epi8(low, masks[4]), _mm_shuffle_epi8(high, masks[5]));
+
+    __m128i sum = _mm_add_epi32(_mm_mullo_epi32(red, coeffs[0]), _mm_mullo_epi32(green, coeffs[1]));
+    sum = _mm_add_epi32(sum, _mm_mullo_epi32(blue, coeffs[2]));
+    return _mm_srli_epi32(sum, 8);
+}
+
 
-        float summand = (1 - kstd) * mean;         // pre calculation of (1-kstd)*mean
-        if (isnan(summand) || isinf(summand)) {
-            fprintf(stderr, "computation for contrast failed\n");
-            return 0;
+/**
+ * @brief Converts a range of pixels with 16 bit samples to grey scale and applies the brightness using SIMD operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range, every sample stored in two bytes, most significant first.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value, scaled to maxval.
+ * @param maxval Maximum color value of the image, the grey values are clamped to [0,maxval].
+ * @param result Pointer to the first grey value of the range.
+ *
+ * 8 pixels are processed per iteration as two groups of 4 pixels, which are loaded
+ * with two overlapping 16 byte loads each. packusdw narrows the clamped grey values
+ * of both groups to 16 bit. The remaining pixels are handed to grey_pass_16_scalar().
+ */
+
+__attribute__((target("sse4.2")))
+void grey_pass_16_V0(const uint8_t *img, size_t n, const uint16_t *coeffs, int32_t brightness, uint16_t maxval,
+                     uint16_t *result) {
+
+    __m128i coeff[3] = {_mm_set1_epi32(coeffs[0]), _mm_set1_epi32(coeffs[1]), _mm_set1_epi32(coeffs[2])};
+
+    // red, green and blue from bytes 0..15 and 8..23 of a group of 4 pixels, low byte first
+    __m128i masks[6] = {
+            _mm_setr_epi8(1, 0, -1, -1, 7, 6, -1, -1, 13, 12, -1, -1, -1, -1, -1, -1),
+            _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 11, 10, -1, -1),
+            _mm_setr_epi8(3, 2, -1, -1, 9, 8, -1, -1, 15, 14, -1, -1, -1, -1, -1, -1),
+            _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 13, 12, -1, -1),
+            _mm_setr_epi8(5, 4, -1, -1, 11, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+            _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 9, 8, -1, -1, 15, 14, -1, -1)};
+
+    __m128i zero = _mm_setzero_si128();
+    __m128i max = _mm_set1_epi32(maxval);
+    __m128i brightness_vector = _mm_set1_epi32(brightness);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const uint8_t *p = img + 6 * i;
+        __m128i grey1 = convert_to_grey4_16(_mm_loadu_si128((__m128i *) p), _mm_loadu_si128((__m128i *) (p + 8)),
+                                            masks, coeff);
+        __m128i grey2 = convert_to_grey4_16(_mm_loadu_si128((__m128i *) (p + 24)),
+                                            _mm_loadu_si128((__m128i *) (p + 32)), masks, coeff);
+
+        // add brightness and clamp values in [0,maxval]
+        grey1 = _mm_max_epi32(zero, _mm_min_epi32(max, _mm_add_epi32(grey1, brightness_vector)));
+        grey2 = _mm_max_epi32(zero, _mm_min_epi32(max, _mm_add_epi32(grey2, brightness_vector)));
+
+        _mm_storeu_si128((__m128i *) (result + i), _mm_packus_epi32(grey1, grey2));
+    }
+
+    // process remaining pixels after SIMD
+    grey_pass_16_scalar(img + 6 * i, n - i, coeffs, brightness, maxval, result + i);
+}
+
+
+/**
+ * @brief Converts 4 pixels to grey scale with the float arithmetic of Version 1 using SIMD operations.
+ *
+ * @param pixels 16 bytes starting at the first of the 12 bytes of the pixels.
+ * @param masks Shuffle masks moving the red, green and blue values into 32 bit lanes.
+ * @param coeffs Normalised coefficients for each color channel.
+ * @param brightness_vector Brightness adjustment value as float.
+ * @param with_brightness If zero, the brightness is skipped.
+ *
+ * @return The 4 grey values in 32 bit lanes, clamped to [0,255].
+ *
+ * The products are added in the order of brightness_contrast_V1() and every
+ * operation rounds to float like the scalar code, so the results are identical.
+ * cvttps2dq truncates like the conversion to uint8_t.
+ */
+
+__attribute__((target("sse4.2")))
+static inline __m128i convert_to_grey4_precise(__m128i pixels, const __m128i *masks, const __m128 *coeffs,
+                                               __m128 brightness_vector, const int with_brightness) {
+    __m128 red = _mm_cvtepi32_ps(_mm_shuffle_epi8(pixels, masks[0]));
+    __m128 green = _mm_cvtepi32_ps(_mm_shuffle_epi8(pixels, masks[1]));
+    __m128 blue = _mm_cvtepi32_ps(_mm_shuffle_epi8(pixels, masks[2]));
+
+    __m128 res = _mm_add_ps(_mm_mul_ps(coeffs[0], red), _mm_mul_ps(coeffs[1], green));
+    res = _mm_add_ps(res, _mm_mul_ps(coeffs[2], blue));
+    if (with_brightness) {
+        res = _mm_add_ps(res, brightness_vector);
+    }
+
+    __m128i grey = _mm_cvttps_epi32(res);
+    return _mm_max_epi32(_mm_setzero_si128(), _mm_min_epi32(_mm_set1_epi32(255), grey));
+}
+
+
+/**
+ * @brief Converts a range of pixels to grey scale with the float arithmetic of Version 1 using SIMD operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range, at most HISTOGRAM_CHUNK if hist is set.
+ * @param coeffs Coefficients normalised to a sum of 1 like in brightness_contrast_V1().
+ * @param brightness Brightness adjustment value.
+ * @param hist If not NULL, the grey values are counted into these sub-histograms for the contrast calculation.
+ * @param result Pointer to the first grey value of the range.
+ * @param with_brightness, with_histogram Constant in every variant, see DEFINE_GREY_PASS_VARIANTS().
+ *
+ * 16 pixels are processed per iteration as four groups of 4 pixels, every group
+ * is one 16 byte load. The load of the last group reads 4 bytes behind the 16
+ * pixels, so the loop stops early enough to stay inside the image. The grey
+ * values are identical to grey_pass_precise_scalar.
+ */
+
+__attribute__((target("sse4.2"), always_inline))
+static inline void grey_pass_precise_V0_body(const uint8_t *img, size_t n, const float *coeffs, int16_t brightness,
+                                             SubHistograms hist, uint8_t *result, const int with_brightness,
+                                             const int with_histogram) {
+
+    __m128 coeff[3] = {_mm_set1_ps(coeffs[0]), _mm_set1_ps(coeffs[1]), _mm_set1_ps(coeffs[2])};
+    __m128 brightness_vector = _mm_set1_ps(brightness);
+
+    // red, green and blue values of 4 pixels, extended to 32 bit
+    __m128i masks[3] = {
+            _mm_setr_epi8(0, -1, -1, -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1),
+            _mm_setr_epi8(1, -1, -1, -1, 4, -1, -1, -1, 7, -1, -1, -1, 10, -1, -1, -1),
+            _mm_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1)};
+
+    size_t i = 0;
+    for (; i + 18 <= n; i += 16) {
+        const uint8_t *p = img + 3 * i;
+        __m128i grey1 = convert_to_grey4_precise(_mm_loadu_si128((__m128i *) p), masks, coeff, brightness_vector,
+                                                 with_brightness);
+        __m128i grey2 = convert_to_grey4_precise(_mm_loadu_si128((__m128i *) (p + 12)), masks, coeff,
+                                                 brightness_vector, with_brightness);
+        __m128i grey3 = convert_to_grey4_precise(_mm_loadu_si128((__m128i *) (p + 24)), masks, coeff,
+                                                 brightness_vector, with_brightness);
+        __m128i grey4 = convert_to_grey4_precise(_mm_loadu_si128((__m128i *) (p + 36)), masks, coeff,
+                                                 brightness_vector, with_brightness);
+
+        // narrow the grey values to 8 bit, they are already in [0,255]
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(grey1, grey2), _mm_packs_epi32(grey3, grey4));
+        _mm_storeu_si128((__m128i *) (result + i), packed);
+
+        if (with_histogram) {
+            histogram_count(hist, result + i, 16);
         }
+    }
+
+    // process remaining pixels after SIMD
+    grey_pass_precise_scalar[grey_pass_index(with_brightness, with_histogram)](img + 3 * i, n - i, coeffs,
+                                                                               brightness, hist, result + i);
+}
+
+DEFINE_GREY_PASS_VARIANTS(__attribute__((target("sse4.2"))), GreyPassPrecise, float, grey_pass_precise_V0,
+                          grey_pass_precise_V0_body)
+
+
+// shuffle masks moving the bytes selected by an 8 bit mask to the front, see init_pack_table()
+static uint64_t pack_table[256];
+static pthread_once_t pack_table_once = PTHREAD_ONCE_INIT;
 
-        // Adjust contrast with lookup table
-        uint8_t lookup[256];
-        for (size_t i = 0; i < 256; i++) {
-            res = kstd * i + summand;   // new_val = kstd * pix + (1-kstd)*mean
-            if (res > 255) {
-                lookup[i] = 255;
-            } else if (res < 0) {
-                lookup[i] = 0;
-            } else {
-                lookup[i] = (uint8_t) res;
+
+/**
+ * @brief Fills pack_table, entry m selects the bytes at the set bits of m in ascending order.
+ */
+
+static void init_pack_table(void) {
+    for (unsigned m = 0; m < 256; m++) {
+        uint8_t shuffle[8];
+        memset(shuffle, 0x80, sizeof(shuffle));
+        unsigned k = 0;
+        for (unsigned bit = 0; bit < 8; bit++) {
+            if (m & (1u << bit)) {
+                shuffle[k++] = (uint8_t) bit;
             }
         }
-        for (size_t i = 0; i < wh; i++) {
-            result[i] = lookup[result[i]];
+        memcpy(&pack_table[m], shuffle, sizeof(shuffle));
+    }
+}
+
+
+/**
+ * @brief Parses the ascii samples of a plain PPM image using SIMD operations.
+ *
+ * @param text Pointer to the text, starting at a whitespace or at the first digit of a sample.
+ * @param length Number of bytes of text.
+ * @param maxval Maximum value of a sample.
+ * @param samples Pointer where the parsed samples will be stored.
+ * @param count Maximum number of samples to be parsed.
+ * @param parsed Pointer where the number of parsed samples will be stored.
+ *
+ * @return Number of bytes of text consumed, the text continues behind the last parsed sample.
+ *
+ * Parses the same samples as parse_plain_scalar(). Every 16 bytes are
+ * classified into digits and whitespace. A sample ends at a digit followed by a
+ * whitespace, its value is the digit plus 10 times the previous and 100 times
+ * the second previous digit, each only if they belong to the same sample.
+ * The values for all 16 positions are computed at once and the values at the
+ * ends are moved to the front with pshufb masks from pack_table, eight bytes
+ * at a time. A window stops in front of the first invalid character, sample
+ * with more than three digits or sample above maxval, which are left to the
+ * caller. The next window starts at the whitespace behind the last sample.
+ */
+
+__attribute__((target("sse4.2")))
+size_t parse_plain_V0(const uint8_t *text, size_t length, uint8_t maxval, uint8_t *samples, size_t count,
+                      size_t *parsed) {
+
+    pthread_once(&pack_table_once, init_pack_table);
+
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i two = _mm_set1_epi8(2);
+    const __m128i max_vector = _mm_set1_epi8((char) maxval);
+    // 100 times the digit, digits above 2 are rejected separately
+    const __m128i hundreds_table = _mm_setr_epi8(0, 100, (char) 200, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    size_t pos = 0;
+    size_t done = 0;
+    // a window ends at most 8 samples, which are stored with two 8 byte stores
+    while (pos + 16 <= length && count - done >= 16) {
+        __m128i chars = _mm_loadu_si128((const __m128i *) (text + pos));
+        __m128i digits = _mm_sub_epi8(chars, zero_char);
+        __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digits, nine), digits);
+        __m128i is_space = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chars, _mm_set1_epi8('\n'))),
+                _mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(chars, _mm_set1_epi8('\r'))));
+        unsigned digit_mask = (unsigned) _mm_movemask_epi8(is_digit);
+        unsigned space_mask = (unsigned) _mm_movemask_epi8(is_space);
+
+        // digits of other positions are zero, the second previous digit counts only after a previous digit
+        __m128i ones = _mm_and_si128(digits, is_digit);
+        __m128i tens = _mm_slli_si128(ones, 1);
+        __m128i hundreds = _mm_and_si128(_mm_slli_si128(ones, 2), _mm_slli_si128(is_digit, 1));
+
+        // 10 * tens as 8 * tens + 2 * tens, no bit crosses into the next byte
+        __m128i low = _mm_add_epi8(ones, _mm_add_epi8(_mm_slli_epi16(tens, 3), _mm_slli_epi16(tens, 1)));
+        __m128i high = _mm_shuffle_epi8(hundreds_table, hundreds);
+        __m128i value = _mm_adds_epu8(low, high);
+
+        // valid if the addition did not saturate, the hundreds digit is at most 2 and the value at most maxval
+        __m128i valid = _mm_and_si128(_mm_cmpeq_epi8(_mm_sub_epi8(value, high), low),
+                                      _mm_cmpeq_epi8(_mm_min_epu8(value, max_vector), value));
+        valid = _mm_andnot_si128(_mm_cmpgt_epi8(hundreds, two), valid);
+
+        // bit p is set if a sample ends at position p, only the ends in front of the first problem are used
+        unsigned ends = digit_mask & (space_mask >> 1);
+        unsigned invalid = ~(digit_mask | space_mask) & 0xFFFF;
+        unsigned long_samples = digit_mask & (digit_mask << 1) & (digit_mask << 2) & (digit_mask << 3) & 0xFFFF;
+        unsigned too_large = ends & ~(unsigned) _mm_movemask_epi8(valid);
+        unsigned stop = invalid | long_samples | too_large;
+        if (stop) {
+            ends &= (1u << __builtin_ctz(stop)) - 1;
+        }
+
+        if (!ends) {
+            // only skip leading whitespace, a sample starting in this window is completed by the next one
+            unsigned skip = space_mask == 0xFFFF ? 16 : (unsigned) __builtin_ctz(~space_mask);
+            if (!skip) {
+                break;
+            }
+            pos += skip;
+            continue;
         }
+
+        unsigned ends_low = ends & 0xFF;
+        unsigned ends_high = ends >> 8;
+        __m128i shuffle_low = _mm_loadl_epi64((const __m128i *) &pack_table[ends_low]);
+        __m128i shuffle_high = _mm_loadl_epi64((const __m128i *) &pack_table[ends_high]);
+        _mm_storel_epi64((__m128i *) (samples + done), _mm_shuffle_epi8(value, shuffle_low));
+        done += (size_t) __builtin_popcount(ends_low);
+        _mm_storel_epi64((__m128i *) (samples + done), _mm_shuffle_epi8(_mm_srli_si128(value, 8), shuffle_high));
+        done += (size_t) __builtin_popcount(ends_high);
+
+        // continue at the whitespace behind the last sample
+        pos += 32 - (unsigned) __builtin_clz(ends);
+    }
+
+    // the remaining samples are parsed without SIMD operations
+    size_t rest;
+    pos += parse_plain_scalar(text + pos, length - pos, maxval, samples + done, count - done, &rest);
+    *parsed = done + rest;
+    return pos;
+}
+
+
+/**
+ * @brief Computes the weighted sums of 16 pixels before the division by 256 using SIMD operations.
+ *
+ * @param p Pointer to the first of the 48 bytes of the pixels.
+ * @param a_coeff, b_coeff, c_coeff Coefficients for each color channel packed into __m128i vectors.
+ * @param weights1, weights2 Pointers where the sums of the first and the last 8 pixels will be stored.
+ *
+ * The channels are separated like in load_and_convert_to_grey16(). The sums are
+ * at most 255 * 256 and fit into unsigned 16 bit values.
+ */
+
+__attribute__((target("sse4.2"), always_inline))
+static inline void load_weights16(const uint8_t *p, __m128i a_coeff, __m128i b_coeff, __m128i c_coeff,
+                                  __m128i *weights1, __m128i *weights2) {
+
+    __m128i pixels1 = _mm_loadu_si128((__m128i *) p);
+    __m128i pixels2 = _mm_loadu_si128((__m128i *) (p + 16));
+    __m128i pixels3 = _mm_loadu_si128((__m128i *) (p + 32));
+
+    __m128i red1 = _mm_or_si128(_mm_shuffle_epi8(pixels1, _mm_setr_epi8(0, -1, 3, -1, 6, -1, 9, -1, 12, -1, 15, -1, -1, -1, -1, -1)),
+                                _mm_shuffle_epi8(pixels2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, -1, 5, -1)));
+    __m128i red2 = _mm_or_si128(_mm_shuffle_epi8(pixels2, _mm_setr_epi8(8, -1, 11, -1, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+                                _mm_shuffle_epi8(pixels3, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 1, -1, 4, -1, 7, -1, 10, -1, 13, -1)));
+
+    __m128i green1 = _mm_or_si128(_mm_shuffle_epi8(pixels1, _mm_setr_epi8(1, -1, 4, -1, 7, -1, 10, -1, 13, -1, -1, -1, -1, -1, -1, -1)),
+                                  _mm_shuffle_epi8(pixels2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, -1, 3, -1, 6, -1)));
+    __m128i green2 = _mm_or_si128(_mm_shuffle_epi8(pixels2, _mm_setr_epi8(9, -1, 12, -1, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+                                  _mm_shuffle_epi8(pixels3, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, -1, 5, -1, 8, -1, 11, -1, 14, -1)));
+
+    __m128i blue1 = _mm_or_si128(_mm_shuffle_epi8(pixels1, _mm_setr_epi8(2, -1, 5, -1, 8, -1, 11, -1, 14, -1, -1, -1, -1, -1, -1, -1)),
+                                 _mm_shuffle_epi8(pixels2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, -1, 4, -1, 7, -1)));
+    __m128i blue2 = _mm_or_si128(_mm_shuffle_epi8(pixels2, _mm_setr_epi8(10, -1, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+                                 _mm_shuffle_epi8(pixels3, _mm_setr_epi8(-1, -1, -1, -1, 0, -1, 3, -1, 6, -1, 9, -1, 12, -1, 15, -1)));
+
+    *weights1 = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(red1, a_coeff), _mm_mullo_epi16(green1, b_coeff)),
+                              _mm_mullo_epi16(blue1, c_coeff));
+    *weights2 = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(red2, a_coeff), _mm_mullo_epi16(green2, b_coeff)),
+                              _mm_mullo_epi16(blue2, c_coeff));
+}
+
+
+/**
+ * @brief Adds the weighted sums of a range of pixels to their sums using SIMD operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param sums Pointer to the n sums, every weighted sum of at most 255 * 256 is added before the division by 256.
+ *
+ * The range is processed in blocks of 16 pixels whose 16 bit weighted sums are
+ * zero extended to 32 bit, remaining pixels are added by add_weights_scalar.
+ */
+
+__attribute__((target("sse4.2")))
+void add_weights_V0(const uint8_t *img, size_t n, const uint16_t *coeffs, uint32_t *sums) {
+    __m128i a_coeff = _mm_set1_epi16(coeffs[0]);
+    __m128i b_coeff = _mm_set1_epi16(coeffs[1]);
+    __m128i c_coeff = _mm_set1_epi16(coeffs[2]);
+    __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i weights1, weights2;
+        load_weights16(img + 3 * i, a_coeff, b_coeff, c_coeff, &weights1, &weights2);
+
+        __m128i *out = (__m128i *) (sums + i);
+        _mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), _mm_unpacklo_epi16(weights1, zero)));
+        _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), _mm_unpackhi_epi16(weights1, zero)));
+        _mm_storeu_si128(out + 2, _mm_add_epi32(_mm_loadu_si128(out + 2), _mm_unpacklo_epi16(weights2, zero)));
+        _mm_storeu_si128(out + 3, _mm_add_epi32(_mm_loadu_si128(out + 3), _mm_unpackhi_epi16(weights2, zero)));
     }
-    return 1;
-}
\ No newline at end of file
+    add_weights_scalar(img + 3 * i, n - i, coeffs, sums + i);
+}
@@ -1,24 +1,117 @@
 #include <stdint.h>
 #include <stdio.h>
+#include "grey_pass.h"
+#include "histogram.h"
 
 #ifndef TEAM120_BRIGHTNESS_CONTRAST_SSE_H
 #define TEAM120_BRIGHTNESS_CONTRAST_SSE_H
 
 /**
- * @brief Converts color coefficients to a scale with a maximum of 256.
- * 
- * @param a The coefficient for the red component.
- * @param b The coefficient for the green component.
- * @param c The coefficient for the blue component.
- * @param coeffs Pointer to an array where the scaled coefficients will be stored.
- * 
- * This function scales the given color coefficients so that their sum equals 256.
- * It is used to prepare the coefficients for SIMD operations that require integer
- * values. The function iteratively adjusts the coefficients to ensure they sum up
- * to the desired total while staying as close as possible to their original ratios.
+ * @brief Converts a range of pixels to grey scale and applies the brightness using SIMD operations.
+ *
+ * Variants indexed by grey_pass_index(), the parameters are described at GreyPass.
+ *
+ * Must only be called if the CPU supports SSE4.2.
  */
 
-int brightness_contrast_V0(const uint8_t *img, size_t width, size_t height, float a, float b, float c, int16_t brightness, float contrast, uint8_t *result);
+extern const GreyPass grey_pass_V0[GREY_PASS_VARIANTS];
 
 
+/**
+ * @brief Converts a range of pixels to grey scale and applies the brightness using pmaddubsw.
+ *
+ * Variants indexed by grey_pass_index(), the parameters are described at GreyPass.
+ * The grey values are identical to grey_pass_V0.
+ *
+ * Must only be called if the CPU supports SSE4.2.
+ */
+
+extern const GreyPass grey_pass_madd_V0[GREY_PASS_VARIANTS];
+
+
+/**
+ * @brief Replaces every grey value of a range by its entry in the lookup table using SIMD operations.
+ *
+ * @param pixels Pointer to the first grey value of the range.
+ * @param n Number of grey values in the range.
+ * @param lookup Lookup table with 256 entries.
+ *
+ * Must only be called if the CPU supports SSE4.2.
+ */
+
+void apply_lookup_V0(uint8_t *pixels, size_t n, const uint8_t *lookup);
+
+
+/**
+ * @brief Copies a range of bytes with non-temporal stores using SIMD operations.
+ *
+ * @param dst Pointer to the destination.
+ * @param src Pointer to the source.
+ * @param n Number of bytes.
+ *
+ * Must only be called if the CPU supports SSE4.2.
+ */
+
+void stream_store_V0(uint8_t *dst, const uint8_t *src, size_t n);
+
+
+/**
+ * @brief Converts a range of pixels with 16 bit samples to grey scale and applies the brightness using SIMD operations.
+ *
+ * @param img Pointer to the first RGB pixel of the range, every sample stored in two bytes, most significant first.
+ * @param n Number of pixels in the range.
+ * @param coeffs Coefficients scaled to a sum of 256 (see convert_coeffs_to_max256()).
+ * @param brightness Brightness adjustment value, scaled to maxval.
+ * @param maxval Maximum color value of the image, the grey values are clamped to [0,maxval].
+ * @param result Pointer to the first grey value of the range.
+ *
+ * Must only be called if the CPU supports SSE4.2.
+ */
+
+void grey_pass_16_V0(const uint8_t *img, size_t n, const uint16_t *coeffs, int32_t brightness, uint16_t maxval,
+                     uint16_t *result);
+
+
+/**
+ * @brief Converts a range of pixels to grey scale with the float arithmetic of Version 1 using SIMD operations.
+ *
+ * Variants indexed by grey_pass_index(), the parameters are described at GreyPassPrecise.
+ *
+ * Must only be called if the CPU supports SSE4.2.
+ */
+
+extern const GreyPassPrecise grey_pass_precise_V0[GREY_PASS_VARIANTS];
+
+
+/**
+ * @brief Parses the ascii samples of a plain PPM image using SIMD operations.
+ *
+ * @param text Pointer to the text, starting at a whitespace or at the first digit of a sample.
+ * @param length Number of bytes of text.
+ * @param maxval Maximum value of a sample.
+ * @param samples Pointer where the parsed samples will be stored.
+ * @param count Maximum number of samples to be parsed.
+ * @param parsed Pointer where the number of parsed samples will be stored.
+ *
+ * @return Number of bytes of text consumed, the text continues behind the last parsed sample.
+ *
+ * Parses the same samples as parse_plain_scalar().
+ *
+ * Must only be called if the CPU supports SSE4.2.
+ */
+
+size_t parse_plain_V0(const uint8_t *text, size_t length, uint8_t maxval, uint8_t *samples, size_t count,
+                      size_t *parsed);
+
+
+/**
+ * @brief Adds the weighted sums of a range of pixels to their sums using SIMD operations.
+ *
+ * The parameters are described at add_weights_scalar(), the sums are identical.
+ *
+ * Must only be called if the CPU supports SSE4.2.
+ */
+
+void add_weights_V0(const uint8_t *img, size_t n, const uint16_t *coeffs, uint32_t *sums);
+
 #endif
@@ -0,0 +1,181 @@
+#define _DEFAULT_SOURCE
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "buffer_pool.h"
+
+
+/**
+ * @brief Allocates an aligned buffer.
+ *
+ * @param size The required size in bytes.
+ * @param buffer Pointer where the buffer will be stored.
+ *
+ * @return 1 on success, 0 if the memory could not be allocated.
+ *
+ * Small buffers come from aligned_alloc() with their size rounded up to
+ * BUFFER_ALIGNMENT. Buffers of BUFFER_HUGE_PAGE_SIZE and more are rounded up to
+ * whole huge pages, mapped anonymously and advised to use transparent huge
+ * pages, which removes most page faults when the image is first touched. The
+ * capacity tells buffer_free() which of both was used.
+ */
+
+int buffer_alloc(size_t size, PoolBuffer *buffer) {
+    size_t capacity;
+
+    // the rounded capacity of a small buffer stays below BUFFER_HUGE_PAGE_SIZE
+    if (size <= BUFFER_HUGE_PAGE_SIZE - BUFFER_ALIGNMENT) {
+        capacity = size ? (size + BUFFER_ALIGNMENT - 1) & ~(size_t) (BUFFER_ALIGNMENT - 1) : BUFFER_ALIGNMENT;
+        buffer->data = aligned_alloc(BUFFER_ALIGNMENT, capacity);
+    } else {
+        if (size > SIZE_MAX - BUFFER_HUGE_PAGE_SIZE) {
+            buffer->data = NULL;
+            buffer->capacity = 0;
+            return 0;
+        }
+        capacity = (size + BUFFER_HUGE_PAGE_SIZE - 1) & ~(BUFFER_HUGE_PAGE_SIZE - 1);
+        void *data = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        buffer->data = data == MAP_FAILED ? NULL : data;
+#ifdef MADV_HUGEPAGE
+        if (buffer->data) {
+            madvise(buffer->data, capacity, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    buffer->capacity = buffer->data ? capacity : 0;
+    return buffer->data != NULL;
+}
+
+
+/**
+ * @brief Frees a buffer allocated by buffer_alloc().
+ *
+ * @param buffer The buffer, which is empty afterwards.
+ */
+
+void buffer_free(PoolBuffer *buffer) {
+    if (buffer->data) {
+        if (buffer->capacity < BUFFER_HUGE_PAGE_SIZE) {
+            free(buffer->data);
+        } else {
+            munmap(buffer->data, buffer->capacity);
+        }
+    }
+    buffer->data = NULL;
+    buffer->capacity = 0;
+}
+
+
+/**
+ * @brief Initializes a buffer pool.
+ *
+ * @param pool The pool.
+ * @param max_count Maximum number of buffers kept for reuse.
+ *
+ * @return 1 on success, 0 if the memory could not be allocated.
+ */
+
+int pool_init(BufferPool *pool, size_t max_count) {
+    pool->buffers = malloc((max_count ? max_count : 1) * sizeof(PoolBuffer));
+    pool->count = 0;
+    pool->max_count = pool->buffers ? max_count : 0;
+    pthread_mutex_init(&pool->mutex, NULL);
+    return pool->buffers != NULL;
+}
+
+
+/**
+ * @brief Hands out a buffer of at least the given size.
+ *
+ * @param pool The pool, NULL to allocate without a pool.
+ * @param size The required size in bytes.
+ * @param buffer Pointer where the buffer will be stored.
+ *
+ * @return 1 on success, 0 if the memory could not be allocated.
+ *
+ * The smallest kept buffer that fits is reused, unless it is more than twice as
+ * large as required, so small images do not occupy the buffers of large ones.
+ * The content of a reused buffer is undefined.
+ */
+
+int pool_acquire(BufferPool *pool, size_t size, PoolBuffer *buffer) {
+    if (pool) {
+        pthread_mutex_lock(&pool->mutex);
+        size_t best = pool->count;
+        for (size_t i = 0; i < pool->count; i++) {
+            size_t capacity = pool->buffers[i].capacity;
+            if (capacity >= size && capacity / 2 <= size &&
+                (best == pool->count || capacity < pool->buffers[best].capacity)) {
+                best = i;
+            }
+        }
+        if (best < pool->count) {
+            *buffer = pool->buffers[best];
+            pool->buffers[best] = pool->buffers[--pool->count];
+            pthread_mutex_unlock(&pool->mutex);
+            return 1;
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    return buffer_alloc(size, buffer);
+}
+
+
+/**
+ * @brief Returns a buffer to the pool.
+ *
+ * @param pool The pool, NULL to free the buffer.
+ * @param buffer The buffer, which is empty afterwards.
+ *
+ * If the pool is full, the smallest of the kept buffers and the returned one is freed.
+ */
+
+void pool_release(BufferPool *pool, PoolBuffer *buffer) {
+    if (!buffer->data) {
+        return;
+    }
+    if (pool) {
+        pthread_mutex_lock(&pool->mutex);
+        if (pool->count < pool->max_count) {
+            pool->buffers[pool->count++] = *buffer;
+            buffer->data = NULL;
+            buffer->capacity = 0;
+        } else if (pool->count) {
+            size_t smallest = 0;
+            for (size_t i = 1; i < pool->count; i++) {
+                if (pool->buffers[i].capacity < pool->buffers[smallest].capacity) {
+                    smallest = i;
+                }
+            }
+            if (pool->buffers[smallest].capacity < buffer->capacity) {
+                PoolBuffer kept = pool->buffers[smallest];
+                pool->buffers[smallest] = *buffer;
+                *buffer = kept;
+            }
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    buffer_free(buffer);
+}
+
+
+/**
+ * @brief Frees a pool and every buffer kept in it.
+ *
+ * @param pool The pool.
+ */
+
+void pool_destroy(BufferPool *pool) {
+    for (size_t i = 0; i < pool->count; i++) {
+        buffer_free(&pool->buffers[i]);
+    }
+    free(pool->buffers);
+    pool->buffers = NULL;
+    pool->count = 0;
+    pthread_mutex_destroy(&pool->mutex);
+}
@@ -0,0 +1,92 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "export.h"
+
+#ifndef TEAM120_BUFFER_POOL_H
+#define TEAM120_BUFFER_POOL_H
+
+// alignment of every buffer, one cache line and one AVX-512 vector
+#define BUFFER_ALIGNMENT 64
+
+// buffers of at least this size are mapped and backed by huge pages where available
+#define BUFFER_HUGE_PAGE_SIZE ((size_t) 2 << 20)
+
+typedef struct {
+    uint8_t *data;
+    size_t capacity;            // usable size in bytes, decides how the buffer is freed
+} PoolBuffer;
+
+typedef struct {
+    PoolBuffer *buffers;        // buffers ready for reuse
+    size_t count;
+    size_t max_count;
+    pthread_mutex_t mutex;
+} BufferPool;
+
+
+/**
+ * @brief Allocates an aligned buffer.
+ *
+ * @param size The required size in bytes.
+ * @param buffer Pointer where the buffer will be stored.
+ *
+ * @return 1 on success, 0 if the memory could not be allocated.
+ */
+
+int buffer_alloc(size_t size, PoolBuffer *buffer);
+
+
+/**
+ * @brief Frees a buffer allocated by buffer_alloc().
+ *
+ * @param buffer The buffer, which is empty afterwards.
+ */
+
+void buffer_free(PoolBuffer *buffer);
+
+
+/**
+ * @brief Initializes a buffer pool.
+ *
+ * @param pool The pool.
+ * @param max_count Maximum number of buffers kept for reuse.
+ *
+ * @return 1 on success, 0 if the memory could not be allocated.
+ */
+
+IMGCONV_API int pool_init(BufferPool *pool, size_t max_count);
+
+
+/**
+ * @brief Hands out a buffer of at least the given size.
+ *
+ * @param pool The pool, NULL to allocate without a pool.
+ * @param size The required size in bytes.
+ * @param buffer Pointer where the buffer will be stored.
+ *
+ * @return 1 on success, 0 if the memory could not be allocated.
+ */
+
+int pool_acquire(BufferPool *pool, size_t size, PoolBuffer *buffer);
+
+
+/**
+ * @brief Returns a buffer to the pool.
+ *
+ * @param pool The pool, NULL to free the buffer.
+ * @param buffer The buffer, which is empty afterwards.
+ */
+
+void pool_release(BufferPool *pool, PoolBuffer *buffer);
+
+
+/**
+ * @brief Frees a pool and every buffer kept in it.
+ *
+ * @param pool The pool.
+ */
+
+IMGCONV_API void pool_destroy(BufferPool *pool);
+
+#endif
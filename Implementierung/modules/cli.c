@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <math.h>
+#include "cli.h"
+
+// highest version accepted by -V
+static const int MAX_VERSION = 4;
+
+
+/**
+ * @brief Prints the help message for the program.
+ */
+
+void printHelp() {
+    printf("Usage:\n"
+           "  program_name input_file [options] \n\n"
+           "Options:\n"
+           "  -o <file>\t\t Specifies output file path (default: output.pgm)\n"
+           "  -V <val>\t\t Use variant <val> (integer) of the algorithm, or auto for the variant, threads, kernels and store mode of the autotune profile for the image size (default: auto, variant 0 without a profile).\n"
+           "  -t <val>\t\t Number of threads used by variant 3 and by --batch (default: number of online cores).\n"
+           "  -B <val>\t\t Measures the runtime of the specified implementation. The optional argument <val> (integer) specifies the number of repetitions of the function call.\n"
+           "  --warmup <val>\t Number of unmeasured iterations before -B measures (default: 1).\n"
+           "  --flush-cache\t\t Evict the caches before every iteration measured by -B.\n"
+           "  --json\t\t Print the results of -B as one JSON object per line.\n"
+           "  --coeffs <a,b,c>\t Specify coefficients for grayscale conversion (default: 0.21,0.72,0.07).\n"
+           "  --brightness <val>\t Adjust brightness by <val> (integer).\n"
+           "  --contrast <val>\t Adjust contrast by <val> (integer).\n"
+           "  --isa <name>\t\t Instruction set used by variants 0 and 3: scalar, sse4.2, avx2, avx512 (x86) or neon (ARM) (default: widest supported). sse4.2-madd and avx2-madd convert to grey with pmaddubsw.\n"
+           "  --stream[=<rows>]\t Convert the image in strips of <rows> rows with bounded memory, version 0 only (default: 4 MiB strips).\n"
+           "  --mmap\t\t Map the input and output files into memory instead of copying the image data.\n"
+           "  --batch[=<list>]\t Convert every input file and every line of the file <list> (- for stdin) with -t workers. -o names an output directory or a template where %%s is replaced by the input name (default: .).\n"
+           "  --io-uring[=direct]\t Read and write the files of --batch with io_uring, keeping many transfers in flight. With direct, inputs of at least 4 MiB are read with O_DIRECT.\n"
+           "  --pgm16\t\t Write 16 bit images with their maximum value instead of scaling them to 255.\n"
+           "  --precise\t\t Compute the results of version 1 with the SIMD kernels of version 0.\n");
+    printf("  --frames\t\t Convert concatenated P6 frames from the input file (default: stdin) to P5 frames in the output file (default: stdout), version 0 only.\n"
+           "  --previous-contrast\t Adjust the contrast of every frame but the first with the statistics of the previous frame, so every frame is converted in one pass.\n"
+           "  --sample <val>\t Estimate the mean and variance for --contrast from one of every <val> blocks of 4096 pixels and adjust the contrast in the same pass as the grey conversion, version 0 only. The estimates and their standard errors are printed.\n"
+           "  --roi <x,y,w,h>\t Convert only the region of w x h pixels from column x and row y, reading only its rows (with --mmap only its pages), version 0 only. The contrast uses the statistics of the whole image.\n"
+           "  --roi-statistics\t Adjust the contrast of --roi with the statistics of the region, so the rest of the image is not read.\n"
+           "  --downscale <val>\t Reduce the image by the factor <val> (1 to 256) in both directions while converting it, every output pixel averages a block of <val> x <val> pixels. Brightness and contrast are applied to the reduced image, version 0 only.\n"
+           "  --variant <spec>\t Convert the image once more for every given parameter set brightness=<val>:contrast=<val>:coeffs=<a>,<b>,<c>:output=<file> (output last, other fields default to the options) from a single decode and one grey pass per distinct coefficients, version 0 only. Up to 64 times.\n"
+           "  --nontemporal <val>\t Images with at least <val> pixels are written with non-temporal stores by variants 0 and 3 without contrast (default: a quarter of the last level cache size).\n"
+           "  --daemon <socket>\t Serve conversion requests on the Unix domain socket <socket> with -t workers until SIGINT or SIGTERM, with the coefficients and adjustments given here. The pixels are passed in shared memory, see modules/daemon.h.\n"
+           "  --connect <socket>\t Let the daemon on <socket> convert the input file with its coefficients and adjustments.\n"
+           "  --daemon-metrics\t With --connect, print the request count and latency percentiles of the daemon as JSON.\n"
+           "  --autotune\t\t Measure variants 0, 3 and 4 with every instruction set, store mode and thread count up to -t for image sizes from 4096 to 16777216 pixels with the given coefficients and adjustments and save the fastest choices to the profile. -B sets the iterations (default: 5).\n"
+           "  --profile <file>\t Profile written by --autotune and read by -V auto (default: $XDG_CONFIG_HOME/imgconv/<host>.profile or ~/.config/imgconv/<host>.profile).\n"
+           "  --gpu-threshold <val>\t Images with at least <val> pixels are converted on the GPU by variant 4 (default: 8388608).\n"
+           "  -h, --help\t\t Display this help and exit.\n\n");
+    printf("Description:\n"
+           "This program converts PPM (P6 or plain P3 format) images to grayscale PGM images. It allows adjustment of brightness and contrast.\n"
+           "JPEG images are read directly if the program was built with make JPEG=1. With --coeffs 0.299,0.587,0.114 (BT.601) and version 0, only their luma is decoded, greyscale JPEG images are never converted to rgb.\n"
+           "The grayscale conversion uses the specified coefficients for the red, green, and blue channels.\n"
+           "Brightness and contrast adjustments are optional.\n"
+           "Images with a maximum value above 255 (16 bit samples) are converted by variant 0, brightness and contrast are given relative to 255.\n"
+           "The program supports five variants of the algorithm: V0, V1, V2, the multi-threaded V3, and V4, which converts large images on the GPU if the program was built with make OPENCL=1 and with the kernels of V0 otherwise.\n"
+           "With -B, variant 3 reports the runtime for 1, 2, 4, ... threads up to the number given by -t.\n\n"
+           "Examples:\n"
+           "  program_name input.ppm -o output.pgm\n"
+           "  program_name input.ppm -o output.pgm --coeffs 0.3,0.59,0.11 --brightness 20 --contrast 10\n"
+           "  program_name input.ppm -o output.pgm -V 1 -B 2\n"
+           "  ffmpeg -i video.mp4 -f image2pipe -vcodec ppm - | program_name --frames --contrast 20 --previous-contrast > frames.pgm\n\n");
+}
+
+
+/**
+ * @brief Validates the input parameters provided to the program.
+ * 
+ * @param V_option The version of the algorithm to use.
+ * @param B_option The number of repetitions for the function call.
+ * @param threads The number of threads for version 3.
+ * @param input_filename The name of the input file.
+ * @param output_filename The name of the output file.
+ * @param a The coefficient for the red component.
+ * @param b The coefficient for the green component.
+ * @param c The coefficient for the blue component.
+ * @param brightness The brightness adjustment value.
+ * @param contrast The contrast adjustment value.
+ * 
+ * @return 1 if all parameters are valid, 0 otherwise.
+ */
+
+int checkParams(int V_option, int B_option, int threads, char *input_filename, char *output_filename, double a, double b, double c,
+                int brightness, float contrast) {
+
+    if (brightness < -255 || brightness > 255) {
+        fprintf(stderr, "The brightness must be in [-255, 255].\n");
+        return 0;
+    }
+
+    if (!isnan(contrast)) {
+        if (contrast < -255 || contrast > 255) {
+            fprintf(stderr, "The contrast must be in [-255, 255].\n");
+            return 0;
+        }
+    }
+
+    if (a < 0 || b < 0 || c < 0) {
+        fprintf(stderr, "The coefficients must greater or equal to zero.\n");
+        return 0;
+    }
+
+    if (V_option < 0 || V_option > MAX_VERSION) {
+        fprintf(stderr, "Version %d does not exist. Choose a version from [0, %d].\n", V_option, MAX_VERSION);
+        return 0;
+    }
+
+    if (B_option < 0) {
+        fprintf(stderr, "Option -B can not be negative.\n");
+        return 0;
+    }
+
+    if (threads < 1) {
+        fprintf(stderr, "Option -t must be at least 1.\n");
+        return 0;
+    }
+
+    if (!output_filename) {
+        fprintf(stderr, "Output filename has to be set.\n");
+        return 0;
+    }
+
+    if (!input_filename) {
+        fprintf(stderr, "Input filename has to be set.\n");
+        return 0;
+    }
+
+    if (a + b + c == 0.0) {
+        fprintf(stderr, "Sum of coefficients can not be 0.\n");
+        return 0;
+    }
+
+    return 1;
+}
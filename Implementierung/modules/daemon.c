@@ -0,0 +1,711 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "daemon.h"
+#include "brightness_contrast_simd.h"
+#include "dispatch.h"
+#include "imgconv.h"
+#include "ppm.h"
+
+
+typedef struct {
+    pthread_mutex_t mutex;
+    uint64_t requests;
+    uint64_t failed;
+    uint64_t pixels;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t buckets[DAEMON_LATENCY_BUCKETS];   // bucket k counts latencies in [2^k, 2^(k+1)) ns
+} Metrics;
+
+typedef struct {
+    int listener;
+    const Kernels *kernels;     // selected once for every request
+    uint16_t coeffs[3];         // scaled once for every request
+    int16_t brightness;
+    float contrast;
+    Metrics metrics;
+    pthread_mutex_t mutex;      // protects connections and stopping
+    int *connections;           // connection served by every worker, -1 if none
+    int stopping;
+} Daemon;
+
+typedef struct {
+    Daemon *daemon;
+    int index;
+} Worker;
+
+// mapping of the last segment of a connection, reused as long as the client sends the same segment
+typedef struct {
+    uint8_t *data;
+    size_t length;
+    dev_t dev;
+    ino_t ino;
+} Segment;
+
+
+/**
+ * @brief Returns the time of the monotonic clock.
+ *
+ * @return The time in nanoseconds.
+ */
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+
+/**
+ * @brief Adds a served request to the metrics.
+ *
+ * @param metrics The metrics.
+ * @param pixels Number of pixels converted.
+ * @param nanoseconds Latency of the request.
+ * @param failed 1 if the request failed.
+ */
+
+static void record_request(Metrics *metrics, size_t pixels, uint64_t nanoseconds, int failed) {
+    int bucket = 63 - __builtin_clzll(nanoseconds | 1);
+    pthread_mutex_lock(&metrics->mutex);
+    metrics->requests++;
+    metrics->failed += failed;
+    metrics->pixels += pixels;
+    metrics->total_ns += nanoseconds;
+    if (nanoseconds > metrics->max_ns) {
+        metrics->max_ns = nanoseconds;
+    }
+    metrics->buckets[bucket]++;
+    pthread_mutex_unlock(&metrics->mutex);
+}
+
+
+/**
+ * @brief Returns a percentile of the latencies.
+ *
+ * @param metrics The metrics, locked by the caller.
+ * @param percent The percentile in (0, 100].
+ *
+ * @return The upper bound of the bucket holding the percentile, at most the maximum latency.
+ */
+
+static uint64_t percentile(const Metrics *metrics, unsigned percent) {
+    uint64_t rank = (metrics->requests * percent + 99) / 100;
+    uint64_t count = 0;
+    for (int k = 0; k < DAEMON_LATENCY_BUCKETS - 1; k++) {
+        count += metrics->buckets[k];
+        if (count >= rank) {
+            uint64_t bound = (uint64_t) 1 << (k + 1);
+            return bound < metrics->max_ns ? bound : metrics->max_ns;
+        }
+    }
+    return metrics->max_ns;
+}
+
+
+/**
+ * @brief Takes a snapshot of the metrics.
+ *
+ * @param metrics The metrics.
+ * @param snapshot Pointer where the snapshot will be stored.
+ */
+
+static void snapshot_metrics(Metrics *metrics, DaemonMetrics *snapshot) {
+    pthread_mutex_lock(&metrics->mutex);
+    snapshot->requests = metrics->requests;
+    snapshot->failed = metrics->failed;
+    snapshot->pixels = metrics->pixels;
+    snapshot->total_ns = metrics->total_ns;
+    snapshot->max_ns = metrics->max_ns;
+    snapshot->p50_ns = percentile(metrics, 50);
+    snapshot->p90_ns = percentile(metrics, 90);
+    snapshot->p99_ns = percentile(metrics, 99);
+    pthread_mutex_unlock(&metrics->mutex);
+}
+
+
+/**
+ * @brief Prints the metrics of a daemon as one JSON object.
+ *
+ * @param out The stream, e.g. stdout.
+ * @param metrics The metrics.
+ */
+
+void print_daemon_metrics(FILE *out, const DaemonMetrics *metrics) {
+    double mean = metrics->requests ? (double) metrics->total_ns / (double) metrics->requests : 0.0;
+    fprintf(out, "{\"requests\": %llu, \"failed\": %llu, \"pixels\": %llu, \"mean_us\": %.3f, \"p50_us\": %.3f, "
+                 "\"p90_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f}\n",
+            (unsigned long long) metrics->requests, (unsigned long long) metrics->failed,
+            (unsigned long long) metrics->pixels, mean / 1e3, (double) metrics->p50_ns / 1e3,
+            (double) metrics->p90_ns / 1e3, (double) metrics->p99_ns / 1e3, (double) metrics->max_ns / 1e3);
+}
+
+
+/**
+ * @brief Maps the segment of a request, reusing the mapping of the previous request if it is the same segment.
+ *
+ * @param segment The mapping of the connection.
+ * @param fd File descriptor of the segment, closed by the function.
+ * @param length Number of bytes the request needs.
+ *
+ * @return IMGCONV_OK on success, IMGCONV_ERROR_DATA if the segment is not sealed against
+ *         shrinking or too small, IMGCONV_ERROR_MEMORY if it could not be mapped.
+ *
+ * A client that shrinks a mapped segment would make the accesses behind the new
+ * end raise SIGBUS in the daemon, so only segments with F_SEAL_SHRINK are mapped.
+ * The seal can not be removed, so the size checked here stays valid.
+ */
+
+static ImgconvError map_segment(Segment *segment, int fd, size_t length) {
+    struct stat st;
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals < 0 || !(seals & F_SEAL_SHRINK) || fstat(fd, &st) || (uint64_t) st.st_size < length) {
+        close(fd);
+        return IMGCONV_ERROR_DATA;
+    }
+    if (segment->data && segment->dev == st.st_dev && segment->ino == st.st_ino &&
+        segment->length == (size_t) st.st_size) {
+        close(fd);
+        return IMGCONV_OK;
+    }
+
+    if (segment->data) {
+        munmap(segment->data, segment->length);
+        segment->data = NULL;
+    }
+    // the pages are populated at once instead of faulting in one by one during the conversion
+    void *data = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return IMGCONV_ERROR_MEMORY;
+    }
+    segment->data = data;
+    segment->length = (size_t) st.st_size;
+    segment->dev = st.st_dev;
+    segment->ino = st.st_ino;
+    return IMGCONV_OK;
+}
+
+
+/**
+ * @brief Receives a request and the file descriptor sent with it.
+ *
+ * @param connection The connection.
+ * @param request Pointer where the request will be stored.
+ * @param fd Pointer where the file descriptor will be stored, -1 if none was sent.
+ *
+ * @return The length of the request, 0 if the connection was closed, -1 on failure.
+ */
+
+static ssize_t receive_request(int connection, DaemonRequest *request, int *fd) {
+    struct iovec iov = {request, sizeof(*request)};
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    *fd = -1;
+    ssize_t length = recvmsg(connection, &msg, MSG_CMSG_CLOEXEC);
+    if (length <= 0) {
+        return length;
+    }
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+            cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+            memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+    return length;
+}
+
+
+/**
+ * @brief Converts the image of a request in its segment.
+ *
+ * @param daemon The daemon.
+ * @param segment The mapping of the connection.
+ * @param request The request.
+ * @param fd File descriptor of the segment, -1 if none was sent. Closed by the function.
+ *
+ * @return IMGCONV_OK on success, an error code otherwise.
+ */
+
+static ImgconvError convert_request(Daemon *daemon, Segment *segment, const DaemonRequest *request, int fd) {
+    size_t width = (size_t) request->width, height = (size_t) request->height;
+    if (fd < 0) {
+        return IMGCONV_ERROR_PARAMS;
+    }
+    if (!width || !height || width > SIZE_MAX / 4 / height) {
+        close(fd);
+        return IMGCONV_ERROR_PARAMS;
+    }
+
+    size_t n = width * height;
+    ImgconvError error = map_segment(segment, fd, 4 * n);
+    if (error != IMGCONV_OK) {
+        return error;
+    }
+    if (!brightness_contrast_kernels(daemon->kernels, segment->data, n, daemon->coeffs, daemon->brightness,
+                                     daemon->contrast, segment->data + 3 * n)) {
+        return IMGCONV_ERROR_PARAMS;
+    }
+    return IMGCONV_OK;
+}
+
+
+/**
+ * @brief Serves the requests of a connection until the client closes it.
+ *
+ * @param daemon The daemon.
+ * @param connection The connection.
+ */
+
+static void serve_connection(Daemon *daemon, int connection) {
+    Segment segment = {NULL, 0, 0, 0};
+
+    while (1) {
+        DaemonRequest request;
+        int fd;
+        ssize_t length = receive_request(connection, &request, &fd);
+        if (length <= 0) {
+            break;
+        }
+        uint64_t start = now_ns();
+
+        if (length == sizeof(request) && request.magic == DAEMON_MAGIC && request.type == DAEMON_METRICS) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            DaemonMetrics metrics;
+            snapshot_metrics(&daemon->metrics, &metrics);
+            if (send(connection, &metrics, sizeof(metrics), MSG_NOSIGNAL) != sizeof(metrics)) {
+                break;
+            }
+            continue;
+        }
+
+        ImgconvError status = IMGCONV_ERROR_PARAMS;
+        if (length == sizeof(request) && request.magic == DAEMON_MAGIC && request.type == DAEMON_CONVERT) {
+            status = convert_request(daemon, &segment, &request, fd);
+        } else if (fd >= 0) {
+            close(fd);
+        }
+
+        DaemonReply reply = {status, 0, now_ns() - start};
+        size_t pixels = status == IMGCONV_OK ? (size_t) (request.width * request.height) : 0;
+        record_request(&daemon->metrics, pixels, reply.nanoseconds, status != IMGCONV_OK);
+        if (send(connection, &reply, sizeof(reply), MSG_NOSIGNAL) != sizeof(reply)) {
+            break;
+        }
+    }
+
+    if (segment.data) {
+        munmap(segment.data, segment.length);
+    }
+}
+
+
+/**
+ * @brief Accepts connections and serves them one after the other until the daemon stops.
+ *
+ * @param arg The worker.
+ *
+ * @return NULL.
+ */
+
+static void *worker_main(void *arg) {
+    Worker *worker = arg;
+    Daemon *daemon = worker->daemon;
+
+    while (1) {
+        int connection = accept4(daemon->listener, NULL, NULL, SOCK_CLOEXEC);
+        if (connection < 0 && (errno == EINTR || errno == ECONNABORTED)) {
+            continue;
+        }
+        pthread_mutex_lock(&daemon->mutex);
+        if (connection < 0 || daemon->stopping) {
+            pthread_mutex_unlock(&daemon->mutex);
+            if (connection >= 0) {
+                close(connection);
+            }
+            break;
+        }
+        daemon->connections[worker->index] = connection;
+        pthread_mutex_unlock(&daemon->mutex);
+
+        serve_connection(daemon, connection);
+
+        pthread_mutex_lock(&daemon->mutex);
+        daemon->connections[worker->index] = -1;
+        pthread_mutex_unlock(&daemon->mutex);
+        close(connection);
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Fills the address of a socket.
+ *
+ * @param socket_path Path of the socket.
+ * @param address Pointer where the address will be stored.
+ *
+ * @return 1 on success, 0 if the path is too long.
+ */
+
+static int socket_address(const char *socket_path, struct sockaddr_un *address) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(address->sun_path)) {
+        fprintf(stderr, "Socket path '%s' is too long\n", socket_path);
+        return 0;
+    }
+    strcpy(address->sun_path, socket_path);
+    return 1;
+}
+
+
+/**
+ * @brief Creates the listening socket of the daemon.
+ *
+ * @param socket_path Path of the socket, an existing socket file is replaced.
+ *
+ * @return The socket, -1 on failure.
+ *
+ * The socket is bound to a temporary name next to socket_path and renamed
+ * once it listens. A client that waits for the file to appear is therefore
+ * never refused in the moment between bind() and listen().
+ */
+
+static int create_listener(const char *socket_path) {
+    struct sockaddr_un address;
+    char temporary[sizeof(address.sun_path)];
+    if (snprintf(temporary, sizeof(temporary), "%s.%ld", socket_path, (long) getpid()) >= (int) sizeof(temporary)) {
+        fprintf(stderr, "Socket path '%s' is too long\n", socket_path);
+        return -1;
+    }
+    if (!socket_address(temporary, &address)) {
+        return -1;
+    }
+    struct stat st;
+    if (!lstat(socket_path, &st)) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "'%s' exists and is not a socket\n", socket_path);
+            return -1;
+        }
+        unlink(socket_path);
+    }
+
+    int listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listener < 0) {
+        fprintf(stderr, "Unable to create socket: %s\n", strerror(errno));
+        return -1;
+    }
+    unlink(temporary);
+    if (bind(listener, (struct sockaddr *) &address, sizeof(address)) || listen(listener, DAEMON_BACKLOG) ||
+        rename(temporary, socket_path)) {
+        fprintf(stderr, "Unable to listen on '%s': %s\n", socket_path, strerror(errno));
+        unlink(temporary);
+        close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+
+/**
+ * @brief Serves conversion requests on a Unix domain socket until SIGINT or SIGTERM.
+ *
+ * @param socket_path Path of the socket, an existing socket file is replaced.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param workers Number of worker threads, each serves one connection at a time.
+ *
+ * @return 1 if the daemon was stopped by a signal, 0 if it could not be started.
+ *
+ * The kernels and the scaled coefficients are prepared once at start-up and
+ * the workers are started before the first request. A request converts the
+ * rgb values in the segment of the client in place into the grey values
+ * behind them, so no pixel is copied between the processes and the daemon
+ * allocates nothing per request. The mapping of a segment is kept for the
+ * next request of the connection, so a client that reuses its segment
+ * causes no mmap and no page faults either. The metrics of all requests are
+ * printed to stderr when the daemon stops.
+ */
+
+int run_daemon(const char *socket_path, float a, float b, float c, int16_t brightness, float contrast,
+               int workers) {
+
+    Daemon daemon;
+    memset(&daemon, 0, sizeof(daemon));
+    daemon.kernels = get_kernels();
+    convert_coeffs_to_max256(a, b, c, daemon.coeffs);
+    daemon.brightness = brightness;
+    daemon.contrast = contrast;
+    size_t num_workers = workers < 1 ? 1 : (size_t) workers;
+
+    daemon.connections = malloc(num_workers * sizeof(int));
+    Worker *worker_args = malloc(num_workers * sizeof(Worker));
+    pthread_t *threads = malloc(num_workers * sizeof(pthread_t));
+    if (!daemon.connections || !worker_args || !threads) {
+        fprintf(stderr, "Failed to allocate memory for workers\n");
+        free(daemon.connections);
+        free(worker_args);
+        free(threads);
+        return 0;
+    }
+    daemon.listener = create_listener(socket_path);
+    if (daemon.listener < 0) {
+        free(daemon.connections);
+        free(worker_args);
+        free(threads);
+        return 0;
+    }
+    pthread_mutex_init(&daemon.mutex, NULL);
+    pthread_mutex_init(&daemon.metrics.mutex, NULL);
+
+    // only this thread receives the signals that stop the daemon, the workers inherit the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    size_t started = 0;
+    for (; started < num_workers; started++) {
+        daemon.connections[started] = -1;
+        worker_args[started].daemon = &daemon;
+        worker_args[started].index = (int) started;
+        if (pthread_create(&threads[started], NULL, worker_main, &worker_args[started])) {
+            fprintf(stderr, "Failed to create thread\n");
+            break;
+        }
+    }
+
+    int success = started == num_workers;
+    if (success) {
+        fprintf(stderr, "Listening on '%s' with %zu worker(s)\n", socket_path, num_workers);
+        int signal;
+        sigwait(&signals, &signal);
+    }
+
+    // wake the workers waiting in accept() and the ones waiting for the next request
+    pthread_mutex_lock(&daemon.mutex);
+    daemon.stopping = 1;
+    shutdown(daemon.listener, SHUT_RDWR);
+    for (size_t t = 0; t < started; t++) {
+        if (daemon.connections[t] >= 0) {
+            shutdown(daemon.connections[t], SHUT_RDWR);
+        }
+    }
+    pthread_mutex_unlock(&daemon.mutex);
+    for (size_t t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+
+    close(daemon.listener);
+    unlink(socket_path);
+    if (success) {
+        DaemonMetrics metrics;
+        snapshot_metrics(&daemon.metrics, &metrics);
+        print_daemon_metrics(stderr, &metrics);
+    }
+
+    pthread_mutex_destroy(&daemon.metrics.mutex);
+    pthread_mutex_destroy(&daemon.mutex);
+    free(daemon.connections);
+    free(worker_args);
+    free(threads);
+    return success;
+}
+
+
+/**
+ * @brief Connects to a daemon.
+ *
+ * @param socket_path Path of the socket of the daemon.
+ *
+ * @return The connected socket, -1 on failure.
+ */
+
+int daemon_connect(const char *socket_path) {
+    struct sockaddr_un address;
+    if (!socket_address(socket_path, &address)) {
+        return -1;
+    }
+    int connection = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (connection < 0 || connect(connection, (struct sockaddr *) &address, sizeof(address))) {
+        fprintf(stderr, "Unable to connect to '%s': %s\n", socket_path, strerror(errno));
+        if (connection >= 0) {
+            close(connection);
+        }
+        return -1;
+    }
+    return connection;
+}
+
+
+/**
+ * @brief Lets the daemon convert the image in a shared memory segment.
+ *
+ * @param connection The socket returned by daemon_connect().
+ * @param segment File descriptor of the segment, see DaemonRequest for the layout.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param reply Pointer where the reply of the daemon will be stored.
+ *
+ * @return 1 if a reply was received, 0 otherwise. The conversion succeeded if reply->status is 0.
+ */
+
+int daemon_convert(int connection, int segment, size_t width, size_t height, DaemonReply *reply) {
+    DaemonRequest request = {DAEMON_MAGIC, DAEMON_CONVERT, width, height};
+    struct iovec iov = {&request, sizeof(request)};
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &segment, sizeof(int));
+
+    if (sendmsg(connection, &msg, MSG_NOSIGNAL) != sizeof(request) ||
+        recv(connection, reply, sizeof(*reply), 0) != sizeof(*reply)) {
+        fprintf(stderr, "The connection to the daemon failed\n");
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Queries the metrics of a daemon.
+ *
+ * @param connection The socket returned by daemon_connect().
+ * @param metrics Pointer where the metrics will be stored.
+ *
+ * @return 1 if the metrics were received, 0 otherwise.
+ */
+
+int daemon_metrics(int connection, DaemonMetrics *metrics) {
+    DaemonRequest request = {DAEMON_MAGIC, DAEMON_METRICS, 0, 0};
+    if (send(connection, &request, sizeof(request), MSG_NOSIGNAL) != sizeof(request) ||
+        recv(connection, metrics, sizeof(*metrics), 0) != sizeof(*metrics)) {
+        fprintf(stderr, "The connection to the daemon failed\n");
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Converts a PPM file to a PGM file with a daemon.
+ *
+ * @param socket_path Path of the socket of the daemon.
+ * @param input_filename The path to the P6 file to be read.
+ * @param output_filename The path where the PGM file will be written.
+ * @param reply Pointer where the reply of the daemon will be stored.
+ *
+ * @return 1 on success, 0 on failure.
+ *
+ * The pixel data is read directly into a memfd that is shared with the daemon
+ * and the grey values are written from it.
+ */
+
+int daemon_convert_file(const char *socket_path, const char *input_filename, const char *output_filename,
+                        DaemonReply *reply) {
+    FILE *fp = fopen(input_filename, "rb");
+    if (!fp) {
+        fprintf(stderr, "Unable to open file '%s'\n", input_filename);
+        return 0;
+    }
+    size_t width, height;
+    unsigned maxval;
+    int plain;
+    if (!readPPMHeader(fp, input_filename, &width, &height, &maxval, &plain)) {
+        fclose(fp);
+        return 0;
+    }
+    if (maxval > 255 || plain) {
+        fprintf(stderr, "Only P6 images with 8 bit samples are supported with --connect\n");
+        fclose(fp);
+        return 0;
+    }
+
+    size_t n = width * height;
+    // the daemon only maps segments that can not shrink, see DaemonRequest
+    int segment = memfd_create("imgconv", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (segment < 0 || ftruncate(segment, (off_t) (4 * n)) ||
+        fcntl(segment, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)) {
+        fprintf(stderr, "Unable to create shared memory: %s\n", strerror(errno));
+        if (segment >= 0) {
+            close(segment);
+        }
+        fclose(fp);
+        return 0;
+    }
+    uint8_t *data = mmap(NULL, 4 * n, PROT_READ | PROT_WRITE, MAP_SHARED, segment, 0);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Unable to map shared memory: %s\n", strerror(errno));
+        close(segment);
+        fclose(fp);
+        return 0;
+    }
+
+    int success = fread(data, 3 * n, 1, fp) == 1;
+    fclose(fp);
+    if (!success) {
+        fprintf(stderr, "Error loading image data from '%s'\n", input_filename);
+    }
+
+    int connection = success ? daemon_connect(socket_path) : -1;
+    success = connection >= 0 && daemon_convert(connection, segment, width, height, reply);
+    if (connection >= 0) {
+        close(connection);
+    }
+    if (success && reply->status != IMGCONV_OK) {
+        fprintf(stderr, "The daemon failed to convert '%s': %s\n", input_filename,
+                imgconv_strerror((ImgconvError) reply->status));
+        success = 0;
+    }
+    if (success) {
+        success = writePGM(output_filename, data + 3 * n, width, height);
+    }
+
+    munmap(data, 4 * n);
+    close(segment);
+    return success;
+}
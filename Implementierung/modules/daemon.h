@@ -0,0 +1,137 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifndef TEAM120_DAEMON_H
+#define TEAM120_DAEMON_H
+
+// first field of every request, so stray connections are rejected
+#define DAEMON_MAGIC 0x30323154u
+
+// connections waiting for a free worker
+#define DAEMON_BACKLOG 64
+
+// latencies are counted in buckets of powers of two nanoseconds
+#define DAEMON_LATENCY_BUCKETS 64
+
+typedef enum {
+    DAEMON_CONVERT = 1,         // convert the image in the segment sent with the request
+    DAEMON_METRICS = 2,         // reply with the metrics of all requests so far
+} DaemonRequestType;
+
+/*
+ * A DAEMON_CONVERT request carries a shared memory segment (e.g. a memfd) as
+ * SCM_RIGHTS. The segment holds the 3 * width * height rgb values at offset 0
+ * and receives the width * height grey values right behind them. It has to be
+ * sealed with F_SEAL_SHRINK (memfd_create() with MFD_ALLOW_SEALING and
+ * F_ADD_SEALS), other segments are rejected with IMGCONV_ERROR_DATA.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t type;              // DaemonRequestType
+    uint64_t width;
+    uint64_t height;
+} DaemonRequest;
+
+typedef struct {
+    int32_t status;             // ImgconvError of the conversion
+    uint32_t reserved;
+    uint64_t nanoseconds;       // time from receiving the request to sending the reply
+} DaemonReply;
+
+typedef struct {
+    uint64_t requests;          // conversions served, failed ones included
+    uint64_t failed;
+    uint64_t pixels;            // pixels converted
+    uint64_t total_ns;          // sum of the latencies
+    uint64_t max_ns;
+    uint64_t p50_ns;            // percentiles, upper bounds of their latency bucket
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+} DaemonMetrics;
+
+
+/**
+ * @brief Serves conversion requests on a Unix domain socket until SIGINT or SIGTERM.
+ *
+ * @param socket_path Path of the socket, an existing socket file is replaced.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param workers Number of worker threads, each serves one connection at a time.
+ *
+ * @return 1 if the daemon was stopped by a signal, 0 if it could not be started.
+ */
+
+int run_daemon(const char *socket_path, float a, float b, float c, int16_t brightness, float contrast,
+               int workers);
+
+
+/**
+ * @brief Prints the metrics of a daemon as one JSON object.
+ *
+ * @param out The stream, e.g. stdout.
+ * @param metrics The metrics.
+ */
+
+void print_daemon_metrics(FILE *out, const DaemonMetrics *metrics);
+
+
+/**
+ * @brief Connects to a daemon.
+ *
+ * @param socket_path Path of the socket of the daemon.
+ *
+ * @return The connected socket, -1 on failure.
+ */
+
+int daemon_connect(const char *socket_path);
+
+
+/**
+ * @brief Lets the daemon convert the image in a shared memory segment.
+ *
+ * @param connection The socket returned by daemon_connect().
+ * @param segment File descriptor of the segment, see DaemonRequest for the layout.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param reply Pointer where the reply of the daemon will be stored.
+ *
+ * @return 1 if a reply was received, 0 otherwise. The conversion succeeded if reply->status is 0.
+ */
+
+int daemon_convert(int connection, int segment, size_t width, size_t height, DaemonReply *reply);
+
+
+/**
+ * @brief Queries the metrics of a daemon.
+ *
+ * @param connection The socket returned by daemon_connect().
+ * @param metrics Pointer where the metrics will be stored.
+ *
+ * @return 1 if the metrics were received, 0 otherwise.
+ */
+
+int daemon_metrics(int connection, DaemonMetrics *metrics);
+
+
+/**
+ * @brief Converts a PPM file to a PGM file with a daemon.
+ *
+ * @param socket_path Path of the socket of the daemon.
+ * @param input_filename The path to the P6 file to be read.
+ * @param output_filename The path where the PGM file will be written.
+ * @param reply Pointer where the reply of the daemon will be stored.
+ *
+ * @return 1 on success, 0 on failure.
+ *
+ * The pixel data is read directly into a memfd that is shared with the daemon
+ * and the grey values are written from it.
+ */
+
+int daemon_convert_file(const char *socket_path, const char *input_filename, const char *output_filename,
+                        DaemonReply *reply);
+
+#endif
@@ -0,0 +1,214 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "dispatch.h"
+#include "brightness_contrast.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include "brightness_contrast_sse.h"
+#include "brightness_contrast_avx.h"
+#elif defined(__aarch64__)
+#include "brightness_contrast_neon.h"
+#endif
+
+
+/**
+ * @brief Support check for kernels that run on every cpu of the architecture.
+ *
+ * @return Always 1.
+ */
+
+static int supports_always(void) {
+    return 1;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/*
+ * Support checks for the x86 kernels. __builtin_cpu_supports() evaluates cpuid
+ * and also checks that the operating system saves the wider registers.
+ */
+
+static int supports_sse42(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+}
+
+static int supports_avx2(void) {
+    return supports_sse42() && __builtin_cpu_supports("avx2");
+}
+
+static int supports_avx512(void) {
+    return supports_sse42() && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+           __builtin_cpu_supports("avx512vbmi");
+}
+
+#endif
+
+
+typedef struct {
+    Kernels kernels;
+    int (*supported)(void);
+} KernelEntry;
+
+// ordered from the narrowest to the widest instruction set
+static const KernelEntry kernel_table[] = {
+        {{"scalar",      grey_pass_scalar,       apply_lookup_scalar,    grey_pass_16_scalar,
+                         grey_pass_precise_scalar,    NULL,                   parse_plain_scalar,
+                         add_weights_scalar}, supports_always},
+#if defined(__x86_64__) || defined(__i386__)
+        // the madd entries only replace the grey pass of the following entry and are never the default
+        {{"sse4.2-madd", grey_pass_madd_V0,      apply_lookup_V0,        grey_pass_16_V0,
+                         grey_pass_precise_V0,        stream_store_V0,        parse_plain_V0,
+                         add_weights_V0}, supports_sse42},
+        {{"sse4.2",      grey_pass_V0,           apply_lookup_V0,        grey_pass_16_V0,
+                         grey_pass_precise_V0,        stream_store_V0,        parse_plain_V0,
+                         add_weights_V0}, supports_sse42},
+        {{"avx2-madd",   grey_pass_madd_V0_avx2, apply_lookup_V0_avx2,   grey_pass_16_V0_avx2,
+                         grey_pass_precise_V0_avx2,   stream_store_V0_avx2,   parse_plain_V0,
+                         add_weights_V0_avx2}, supports_avx2},
+        {{"avx2",        grey_pass_V0_avx2,      apply_lookup_V0_avx2,   grey_pass_16_V0_avx2,
+                         grey_pass_precise_V0_avx2,   stream_store_V0_avx2,   parse_plain_V0,
+                         add_weights_V0_avx2}, supports_avx2},
+        // there are no AVX-512 kernels for 16 bit samples and weighted sums, the AVX2 kernels are used
+        // the SSE parser is used for plain images by every x86 entry
+        {{"avx512",      grey_pass_V0_avx512,    apply_lookup_V0_avx512, grey_pass_16_V0_avx2,
+                         grey_pass_precise_V0_avx512, stream_store_V0_avx512, parse_plain_V0,
+                         add_weights_V0_avx2}, supports_avx512},
+#elif defined(__aarch64__)
+        // NEON is part of every AArch64 cpu, it has no intrinsic for non-temporal stores, no plain parser and no kernel for weighted sums
+        {{"neon",        grey_pass_V0_neon,      apply_lookup_V0_neon,   grey_pass_16_V0_neon,
+                         grey_pass_precise_V0_neon,   NULL,                   parse_plain_scalar,
+                         add_weights_scalar}, supports_always},
+#endif
+};
+
+static const size_t NUM_KERNELS = sizeof(kernel_table) / sizeof(kernel_table[0]);
+
+static const Kernels *selected = NULL;
+static const Kernels *default_kernels = NULL;
+static pthread_once_t default_once = PTHREAD_ONCE_INIT;
+
+
+/**
+ * @brief Looks for the kernels of the widest instruction set supported by the cpu.
+ *
+ * Called once by pthread_once(), so threads of a library user calling
+ * get_kernels() at the same time do not race on the detection.
+ */
+
+static void init_default_kernels(void) {
+    for (size_t i = NUM_KERNELS; i > 0; i--) {
+        if (kernel_table[i - 1].supported()) {
+            default_kernels = &kernel_table[i - 1].kernels;
+            return;
+        }
+    }
+}
+
+
+/**
+ * @brief Returns the selected kernels.
+ *
+ * @return The kernels chosen by select_kernels() or, if none were chosen, the
+ *         kernels for the widest instruction set supported by the cpu.
+ */
+
+const Kernels *get_kernels(void) {
+    if (selected) {
+        return selected;
+    }
+    pthread_once(&default_once, init_default_kernels);
+    return default_kernels;
+}
+
+
+/**
+ * @brief Looks up the kernels for an instruction set without printing anything.
+ *
+ * @param name One of "scalar", "sse4.2", "sse4.2-madd", "avx2", "avx2-madd", "avx512" (x86) and "neon" (AArch64).
+ *
+ * @return The kernels for the instruction set, NULL if the name is unknown or
+ *         the instruction set is not supported by the cpu.
+ */
+
+const Kernels *lookup_kernels(const char *name) {
+    for (size_t i = 0; i < NUM_KERNELS; i++) {
+        if (!strcmp(kernel_table[i].kernels.name, name)) {
+            return kernel_table[i].supported() ? &kernel_table[i].kernels : NULL;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Looks up the kernels for an instruction set.
+ *
+ * @param name One of "scalar", "sse4.2", "sse4.2-madd", "avx2", "avx2-madd", "avx512" (x86) and "neon" (AArch64).
+ *
+ * @return The kernels for the instruction set, NULL if the name is unknown or
+ *         the instruction set is not supported by the cpu. The reason is printed.
+ */
+
+const Kernels *find_kernels(const char *name) {
+    const Kernels *kernels = lookup_kernels(name);
+    if (kernels) {
+        return kernels;
+    }
+    for (size_t i = 0; i < NUM_KERNELS; i++) {
+        if (!strcmp(kernel_table[i].kernels.name, name)) {
+            fprintf(stderr, "Instruction set '%s' is not supported by this cpu.\n", name);
+            return NULL;
+        }
+    }
+    fprintf(stderr, "Unknown instruction set '%s'. Choose from:", name);
+    for (size_t i = 0; i < NUM_KERNELS; i++) {
+        fprintf(stderr, " %s", kernel_table[i].kernels.name);
+    }
+    fprintf(stderr, "\n");
+    return NULL;
+}
+
+
+/**
+ * @brief Selects the kernels for an instruction set.
+ *
+ * @param name One of "scalar", "sse4.2", "sse4.2-madd", "avx2", "avx2-madd", "avx512" (x86) and "neon" (AArch64).
+ *
+ * @return 1 if the kernels were selected, 0 if the name is unknown or the
+ *         instruction set is not supported by the cpu.
+ *
+ * Not synchronised with get_kernels(), select the kernels before other
+ * threads convert images.
+ */
+
+int select_kernels(const char *name) {
+    const Kernels *kernels = find_kernels(name);
+    if (!kernels) {
+        return 0;
+    }
+    selected = kernels;
+    return 1;
+}
+
+
+/**
+ * @brief Lists the kernels supported by the cpu.
+ *
+ * @param list Array where the kernels will be stored, ordered from the narrowest to the widest instruction set.
+ * @param max Size of the array.
+ *
+ * @return Number of kernels stored.
+ */
+
+size_t supported_kernels(const Kernels **list, size_t max) {
+    size_t count = 0;
+    for (size_t i = 0; i < NUM_KERNELS && count < max; i++) {
+        if (kernel_table[i].supported()) {
+            list[count++] = &kernel_table[i].kernels;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,101 @@
+#include <stdint.h>
+#include <stdio.h>
+#include "grey_pass.h"
+#include "histogram.h"
+
+#ifndef TEAM120_DISPATCH_H
+#define TEAM120_DISPATCH_H
+
+/**
+ * @brief Set of kernels for one instruction set, used by versions 0 and 3.
+ */
+
+typedef struct {
+    const char *name;
+
+    // variants converting n pixels to grey and optionally counting them into hist, indexed by grey_pass_index()
+    const GreyPass *grey_pass;
+
+    // replaces n grey values by their entries in the 256 entry lookup table
+    void (*apply_lookup)(uint8_t *pixels, size_t n, const uint8_t *lookup);
+
+    // converts n pixels with 16 bit samples to grey values in [0,maxval], see grey_pass_16_scalar()
+    void (*grey_pass_16)(const uint8_t *img, size_t n, const uint16_t *coeffs, int32_t brightness, uint16_t maxval,
+                         uint16_t *result);
+
+    // variants converting n pixels to grey with the float arithmetic of version 1, indexed by grey_pass_index()
+    const GreyPassPrecise *grey_pass_precise;
+
+    // copies n bytes with non-temporal stores past the caches, NULL if the instruction set has none
+    void (*stream_store)(uint8_t *dst, const uint8_t *src, size_t n);
+
+    // parses at most count ascii samples of a plain PPM image, see parse_plain_scalar()
+    size_t (*parse_plain)(const uint8_t *text, size_t length, uint8_t maxval, uint8_t *samples, size_t count,
+                          size_t *parsed);
+
+    // adds the weighted sums of n pixels before the division by 256 to sums, see add_weights_scalar()
+    void (*add_weights)(const uint8_t *img, size_t n, const uint16_t *coeffs, uint32_t *sums);
+} Kernels;
+
+
+/**
+ * @brief Returns the selected kernels.
+ *
+ * @return The kernels chosen by select_kernels() or, if none were chosen, the
+ *         kernels for the widest instruction set supported by the cpu.
+ */
+
+const Kernels *get_kernels(void);
+
+
+/**
+ * @brief Looks up the kernels for an instruction set without printing anything.
+ *
+ * @param name One of "scalar", "sse4.2", "sse4.2-madd", "avx2", "avx2-madd", "avx512" (x86) and "neon" (AArch64).
+ *
+ * @return The kernels for the instruction set, NULL if the name is unknown or
+ *         the instruction set is not supported by the cpu.
+ */
+
+const Kernels *lookup_kernels(const char *name);
+
+
+/**
+ * @brief Looks up the kernels for an instruction set.
+ *
+ * @param name One of "scalar", "sse4.2", "sse4.2-madd", "avx2", "avx2-madd", "avx512" (x86) and "neon" (AArch64).
+ *
+ * @return The kernels for the instruction set, NULL if the name is unknown or
+ *         the instruction set is not supported by the cpu. The reason is printed.
+ */
+
+const Kernels *find_kernels(const char *name);
+
+
+/**
+ * @brief Selects the kernels for an instruction set.
+ *
+ * @param name One of "scalar", "sse4.2", "sse4.2-madd", "avx2", "avx2-madd", "avx512" (x86) and "neon" (AArch64).
+ *
+ * @return 1 if the kernels were selected, 0 if the name is unknown or the
+ *         instruction set is not supported by the cpu.
+ *
+ * Not synchronised with get_kernels(), select the kernels before other
+ * threads convert images.
+ */
+
+int select_kernels(const char *name);
+
+
+/**
+ * @brief Lists the kernels supported by the cpu.
+ *
+ * @param list Array where the kernels will be stored, ordered from the narrowest to the widest instruction set.
+ * @param max Size of the array.
+ *
+ * @return Number of kernels stored.
+ */
+
+size_t supported_kernels(const Kernels **list, size_t max);
+
+#endif
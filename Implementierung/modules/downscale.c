@@ -0,0 +1,247 @@
+#define _DEFAULT_SOURCE
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "downscale.h"
+#include "brightness_contrast_simd.h"
+#include "buffer_pool.h"
+#include "dispatch.h"
+#include "mapped_io.h"
+#include "ppm.h"
+#include "util.h"
+
+
+/**
+ * @brief Adds up the column sums of the whole blocks of a row.
+ *
+ * @param columns The weighted sums of the columns of the rows of the blocks.
+ * @param n Number of blocks.
+ * @param factor Number of columns per block, constant in the calls of sum_blocks().
+ * @param sums Pointer where the sums of the n blocks will be stored.
+ */
+
+__attribute__((always_inline))
+static inline void sum_whole_blocks(const uint32_t *columns, size_t n, size_t factor, uint32_t *sums) {
+    for (size_t block = 0; block < n; block++) {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < factor; i++) {
+            sum += columns[block * factor + i];
+        }
+        sums[block] = sum;
+    }
+}
+
+
+/**
+ * @brief Adds up the column sums of a row of blocks.
+ *
+ * @param columns The weighted sums of the columns of the rows of the blocks.
+ * @param width Number of columns.
+ * @param factor Number of columns per block, the last block may have less.
+ * @param sums Pointer where the sums of the (width + factor - 1) / factor blocks will be stored.
+ *
+ * The common small factors get loops with a constant factor, which the compiler unrolls.
+ */
+
+static void sum_blocks(const uint32_t *columns, size_t width, size_t factor, uint32_t *sums) {
+    size_t n = width / factor;
+    switch (factor) {
+        case 2:
+            sum_whole_blocks(columns, n, 2, sums);
+            break;
+        case 3:
+            sum_whole_blocks(columns, n, 3, sums);
+            break;
+        case 4:
+            sum_whole_blocks(columns, n, 4, sums);
+            break;
+        default:
+            sum_whole_blocks(columns, n, factor, sums);
+    }
+    if (n * factor < width) {
+        sum_whole_blocks(columns + n * factor, 1, width - n * factor, sums + n);
+    }
+}
+
+
+/**
+ * @brief Divides the sums of a row of blocks and adds the brightness.
+ *
+ * @param sums The weighted sums of the blocks.
+ * @param n Number of blocks.
+ * @param pixels Number of pixels per block.
+ * @param brightness Brightness adjustment value.
+ * @param grey Pointer where the grey values will be stored.
+ *
+ * The grey value of a block is its weighted sum divided by 256 * pixels and
+ * rounded down, like the grey pass of version 0 does for a single pixel.
+ * Blocks of a power of two pixels are divided with a shift. Otherwise a sum
+ * below 2^32 plus one half keeps a distance of at least 0.5 / pixels from the
+ * next integer after the division, so the multiplication with the reciprocal
+ * in double precision rounds down exactly.
+ */
+
+static void divide_sums(const uint32_t *sums, size_t n, size_t pixels, int16_t brightness, uint8_t *grey) {
+    if (!(pixels & (pixels - 1))) {
+        // blocks of a power of two pixels are divided with a shift
+        int shift = 8;
+        while ((size_t) 1 << (shift - 8) < pixels) {
+            shift++;
+        }
+        for (size_t x = 0; x < n; x++) {
+            int value = (int) (sums[x] >> shift) + brightness;
+            grey[x] = (uint8_t) (value < 0 ? 0 : value > 255 ? 255 : value);
+        }
+        return;
+    }
+
+    double reciprocal = 1.0 / (256.0 * (double) pixels);
+    for (size_t x = 0; x < n; x++) {
+        int value = (int) (((double) sums[x] + 0.5) * reciprocal) + brightness;
+        grey[x] = (uint8_t) (value < 0 ? 0 : value > 255 ? 255 : value);
+    }
+}
+
+
+/**
+ * @brief Converts a PPM file to a PGM file reduced by an integer factor in both directions.
+ *
+ * @param input_filename The path to the PPM file to be read.
+ * @param output_filename The path where the PGM file will be written.
+ * @param factor Every output pixel averages a block of factor x factor pixels, 1 to DOWNSCALE_MAX_FACTOR.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param use_mmap 1 to map the input file instead of reading it row by row.
+ *
+ * @return 1 on success, 0 on failure.
+ *
+ * The kernels of version 0 separate the channels of factor rows at a time and
+ * add the weighted sums of their pixels to the sums of the columns, so the
+ * work per pixel does not depend on the factor and no grey image of the full
+ * size is written. The columns are added up to blocks once per output row.
+ * The blocks of the last column and the last row are smaller if the size of
+ * the image is not a multiple of the factor and are averaged over their pixels.
+ * The brightness and the contrast are applied to the reduced image, which with
+ * factor 1 equals the output of version 0.
+ */
+
+int brightness_contrast_downscale(const char *input_filename, const char *output_filename, size_t factor, float a,
+                                  float b, float c, int16_t brightness, float contrast, int use_mmap) {
+
+    MappedFile map;
+    FILE *fp = NULL;
+    size_t width, height;
+
+    if (use_mmap) {
+        if (!mapPPM(input_filename, &map)) {
+            return 0;
+        }
+        madvise(map.base, map.length, MADV_SEQUENTIAL);
+        width = map.width;
+        height = map.height;
+    } else {
+        unsigned maxval;
+        int plain;
+        fp = fopen(input_filename, "rb");
+        if (!fp) {
+            fprintf(stderr, "Unable to open file '%s'\n", input_filename);
+            return 0;
+        }
+        if (!readPPMHeader(fp, input_filename, &width, &height, &maxval, &plain)) {
+            fclose(fp);
+            return 0;
+        }
+        if (maxval > 255 || plain) {
+            fprintf(stderr, "Only P6 images with 8 bit samples are supported with --downscale\n");
+            fclose(fp);
+            return 0;
+        }
+    }
+
+    size_t out_width = (width + factor - 1) / factor;
+    size_t out_height = (height + factor - 1) / factor;
+    size_t full_blocks = width / factor;
+    size_t last_width = width - full_blocks * factor;       // pixels of the smaller last block, 0 if none
+    size_t row_bytes = 3 * width;
+
+    PoolBuffer output_buffer = {NULL, 0}, rgb_buffer = {NULL, 0}, columns_buffer = {NULL, 0},
+               sums_buffer = {NULL, 0};
+    int success = buffer_alloc(out_width * out_height, &output_buffer);
+    success &= buffer_alloc(width * sizeof(uint32_t), &columns_buffer);
+    success &= buffer_alloc(out_width * sizeof(uint32_t), &sums_buffer);
+    if (!use_mmap) {
+        success &= buffer_alloc(row_bytes * factor, &rgb_buffer);
+    }
+    uint64_t *histogram = calloc(256, sizeof(uint64_t));
+    if (!success || !histogram) {
+        fprintf(stderr, "Unable to allocate memory for downscaling\n");
+        success = 0;
+    }
+
+    const Kernels *kernels = get_kernels();
+    uint16_t coeffs[3];
+    convert_coeffs_to_max256(a, b, c, coeffs);
+    uint8_t *output = output_buffer.data;
+    uint32_t *columns = (uint32_t *) columns_buffer.data;
+    uint32_t *sums = (uint32_t *) sums_buffer.data;
+
+    for (size_t y = 0; success && y < out_height; y++) {
+        size_t rows = height - y * factor < factor ? height - y * factor : factor;
+        const uint8_t *rgb;
+        if (use_mmap) {
+            rgb = map.data + y * factor * row_bytes;
+        } else if (fread(rgb_buffer.data, row_bytes, rows, fp) != rows) {
+            fprintf(stderr, "Error loading image data from '%s'\n", input_filename);
+            success = 0;
+            break;
+        } else {
+            rgb = rgb_buffer.data;
+        }
+
+        memset(columns, 0, width * sizeof(uint32_t));
+        for (size_t r = 0; r < rows; r++) {
+            kernels->add_weights(rgb + r * row_bytes, width, coeffs, columns);
+        }
+        sum_blocks(columns, width, factor, sums);
+
+        uint8_t *grey = output + y * out_width;
+        divide_sums(sums, full_blocks, factor * rows, brightness, grey);
+        if (last_width) {
+            divide_sums(sums + full_blocks, 1, last_width * rows, brightness, grey + full_blocks);
+        }
+    }
+
+    if (success && !isnan(contrast)) {
+        // the reduced image is small, a single histogram with 64 bit counters suffices
+        for (size_t i = 0; i < out_width * out_height; i++) {
+            histogram[output[i]]++;
+        }
+        uint8_t lookup[256];
+        success = build_contrast_lookup(histogram, contrast, lookup);
+        if (success) {
+            kernels->apply_lookup(output, out_width * out_height, lookup);
+        }
+    }
+    if (success) {
+        success = writePGM(output_filename, output, out_width, out_height);
+    }
+
+    free(histogram);
+    buffer_free(&output_buffer);
+    buffer_free(&rgb_buffer);
+    buffer_free(&columns_buffer);
+    buffer_free(&sums_buffer);
+    if (use_mmap) {
+        unmapFile(&map);
+    } else {
+        fclose(fp);
+    }
+    return success;
+}
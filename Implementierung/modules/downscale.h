@@ -0,0 +1,30 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef TEAM120_DOWNSCALE_H
+#define TEAM120_DOWNSCALE_H
+
+// largest factor whose sums of weighted pixels fit into 32 bit
+#define DOWNSCALE_MAX_FACTOR 256
+
+
+/**
+ * @brief Converts a PPM file to a PGM file reduced by an integer factor in both directions.
+ *
+ * @param input_filename The path to the PPM file to be read.
+ * @param output_filename The path where the PGM file will be written.
+ * @param factor Every output pixel averages a block of factor x factor pixels, 1 to DOWNSCALE_MAX_FACTOR.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param use_mmap 1 to map the input file instead of reading it row by row.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+
+int brightness_contrast_downscale(const char *input_filename, const char *output_filename, size_t factor, float a,
+                                  float b, float c, int16_t brightness, float contrast, int use_mmap);
+
+#endif
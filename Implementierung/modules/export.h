@@ -0,0 +1,7 @@
+#ifndef TEAM120_EXPORT_H
+#define TEAM120_EXPORT_H
+
+// marks a function exported by libimgconv, its objects are built with -fvisibility=hidden
+#define IMGCONV_API __attribute__((visibility("default")))
+
+#endif
@@ -0,0 +1,396 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "frames.h"
+#include "brightness_contrast_simd.h"
+#include "buffer_pool.h"
+#include "dispatch.h"
+#include "grey_pass.h"
+#include "ppm.h"
+#include "util.h"
+
+
+typedef enum {
+    SLOT_FREE,                  // ready to be read into
+    SLOT_READ,                  // holds the rgb values of a frame or the end of the stream
+    SLOT_CONVERTED,             // holds the grey values of a frame or the end of the stream
+} SlotState;
+
+typedef struct {
+    PoolBuffer rgb, grey;       // reused for every frame of the slot, only replaced by larger frames
+    size_t width, height;
+    int last;                   // the stream has ended, the slot holds no frame
+    SlotState state;
+} FrameSlot;
+
+typedef struct {
+    FILE *in, *out;
+    const char *input_name, *output_name;
+    FrameSlot slots[FRAME_SLOTS];   // used in turn by every stage
+    int failed;                 // set by the stage that fails, stops the others
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    FrameStats *stats;
+} FrameStream;
+
+typedef struct {
+    const Kernels *kernels;
+    uint16_t coeffs[3];
+    int16_t brightness;
+    float contrast;
+    int previous_contrast;
+    uint8_t lookup[256];        // built from the statistics of the previous frame
+    int have_lookup;
+} FrameConversion;
+
+
+/**
+ * @brief Waits until a slot reaches a state or a stage has failed.
+ *
+ * @param stream The frame stream.
+ * @param slot The slot.
+ * @param state The state to wait for.
+ *
+ * @return 1 if the slot is in the state, 0 if a stage has failed before.
+ */
+
+static int wait_slot(FrameStream *stream, FrameSlot *slot, SlotState state) {
+    pthread_mutex_lock(&stream->mutex);
+    while (slot->state != state && !stream->failed) {
+        pthread_cond_wait(&stream->changed, &stream->mutex);
+    }
+    int reached = slot->state == state;
+    pthread_mutex_unlock(&stream->mutex);
+    return reached;
+}
+
+
+/**
+ * @brief Hands a slot to the next stage.
+ *
+ * @param stream The frame stream.
+ * @param slot The slot.
+ * @param state The new state of the slot.
+ */
+
+static void set_slot(FrameStream *stream, FrameSlot *slot, SlotState state) {
+    pthread_mutex_lock(&stream->mutex);
+    slot->state = state;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->mutex);
+}
+
+
+/**
+ * @brief Stops every stage waiting for a slot.
+ *
+ * @param stream The frame stream.
+ */
+
+static void fail_stream(FrameStream *stream) {
+    pthread_mutex_lock(&stream->mutex);
+    stream->failed = 1;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->mutex);
+}
+
+
+/**
+ * @brief Makes sure that a buffer holds at least size bytes.
+ *
+ * @param buffer The buffer, kept if it is large enough.
+ * @param size Number of bytes needed.
+ *
+ * @return 1 on success, 0 if the memory could not be allocated.
+ */
+
+static int reserve_buffer(PoolBuffer *buffer, size_t size) {
+    if (buffer->data && buffer->capacity >= size) {
+        return 1;
+    }
+    buffer_free(buffer);
+    return buffer_alloc(size, buffer);
+}
+
+
+/**
+ * @brief Reads the header of the next frame without reading past it.
+ *
+ * @param in The stream positioned at the start of a frame.
+ * @param name Name of the stream, used for error messages.
+ * @param width Pointer where the width of the frame will be stored.
+ * @param height Pointer where the height of the frame will be stored.
+ *
+ * @return 1 if a valid header was read, 0 if it is invalid and -1 if the stream ends before the frame.
+ *
+ * readPPMHeader() does not tell the end of the stream from a truncated header,
+ * so the header is read byte by byte here. As parsePPMHeader() ends on the
+ * single whitespace behind the maximum value, the first complete parse
+ * consumes exactly the header.
+ */
+
+static int read_frame_header(FILE *in, const char *name, size_t *width, size_t *height) {
+    uint8_t header[FRAME_HEADER_LENGTH];
+    size_t length = 0;
+    size_t header_length;
+    unsigned maxval;
+    int plain;
+    int c;
+
+    while ((c = getc(in)) != EOF) {
+        if (length == FRAME_HEADER_LENGTH) {
+            fprintf(stderr, "Frame header in '%s' is too long\n", name);
+            return 0;
+        }
+        header[length++] = (uint8_t) c;
+        int res = parsePPMHeader(header, length, name, width, height, &maxval, &plain, &header_length);
+        if (res == 0) {
+            return 0;
+        }
+        if (res > 0) {
+            if (plain || maxval > 255) {
+                fprintf(stderr, "Frames in '%s' must be P6 images with at most 8 bit samples\n", name);
+                return 0;
+            }
+            return 1;
+        }
+    }
+
+    if (length || ferror(in)) {
+        fprintf(stderr, "Error reading frame header from '%s'\n", name);
+        return 0;
+    }
+    return -1;
+}
+
+
+/**
+ * @brief First stage: reads the frames into the slots.
+ *
+ * @param arg Pointer to the FrameStream.
+ *
+ * @return Always NULL.
+ *
+ * The end of the stream is passed on as a slot without a frame.
+ */
+
+static void *read_stage(void *arg) {
+    FrameStream *stream = (FrameStream *) arg;
+
+    for (size_t k = 0;; k++) {
+        FrameSlot *slot = &stream->slots[k % FRAME_SLOTS];
+        if (!wait_slot(stream, slot, SLOT_FREE)) {
+            return NULL;
+        }
+
+        int res = read_frame_header(stream->in, stream->input_name, &slot->width, &slot->height);
+        slot->last = res < 0;
+        if (res > 0) {
+            // 3*width*height checked for overflow in parsePPMHeader()
+            size_t n = slot->width * slot->height;
+            if (!reserve_buffer(&slot->rgb, 3 * n) || !reserve_buffer(&slot->grey, n)) {
+                fprintf(stderr, "Unable to allocate memory for frame\n");
+                res = 0;
+            } else if (fread(slot->rgb.data, 1, 3 * n, stream->in) != 3 * n) {
+                fprintf(stderr, "Error loading frame %zu from '%s'\n", k, stream->input_name);
+                res = 0;
+            }
+        }
+        if (!res) {
+            fail_stream(stream);
+            return NULL;
+        }
+
+        int last = slot->last;
+        set_slot(stream, slot, SLOT_READ);
+        if (last) {
+            return NULL;
+        }
+    }
+}
+
+
+/**
+ * @brief Third stage: writes the converted frames and hands the slots back to the reader.
+ *
+ * @param arg Pointer to the FrameStream.
+ *
+ * @return Always NULL.
+ *
+ * Every frame is flushed, so that the next program of the pipeline receives
+ * it without waiting for the following frames.
+ */
+
+static void *write_stage(void *arg) {
+    FrameStream *stream = (FrameStream *) arg;
+
+    for (size_t k = 0;; k++) {
+        FrameSlot *slot = &stream->slots[k % FRAME_SLOTS];
+        if (!wait_slot(stream, slot, SLOT_CONVERTED) || slot->last) {
+            return NULL;
+        }
+
+        size_t n = slot->width * slot->height;
+        if (fprintf(stream->out, "P5\n%zu %zu\n255\n", slot->width, slot->height) < 0 ||
+            fwrite(slot->grey.data, 1, n, stream->out) != n || fflush(stream->out)) {
+            fprintf(stderr, "Error writing frame %zu to '%s'\n", k, stream->output_name);
+            fail_stream(stream);
+            return NULL;
+        }
+        stream->stats->frames++;
+        stream->stats->bytes += 3 * n;
+
+        set_slot(stream, slot, SLOT_FREE);
+    }
+}
+
+
+/**
+ * @brief Converts one frame.
+ *
+ * @param conversion The parameters of the conversion and the lookup table of the previous frame.
+ * @param rgb Pointer to the rgb values of the frame.
+ * @param n Number of pixels of the frame.
+ * @param grey Pointer where the grey values will be stored.
+ *
+ * @return 1 on success, 0 if the computation for contrast failed.
+ *
+ * With previous_contrast, the lookup table of the previous frame is applied
+ * together with the grey pass by grey_pass_lookup(), and the histogram of the
+ * frame builds the table for the next one.
+ * Every frame is then read and written once. The first frame has no previous
+ * statistics and is adjusted with its own like a single image.
+ */
+
+static int convert_frame(FrameConversion *conversion, const uint8_t *rgb, size_t n, uint8_t *grey) {
+    const Kernels *kernels = conversion->kernels;
+    const uint16_t *coeffs = conversion->coeffs;
+    int16_t brightness = conversion->brightness;
+
+    if (isnan(conversion->contrast)) {
+        kernels->grey_pass[grey_pass_index(brightness != 0, 0)](rgb, n, coeffs, brightness, NULL, grey);
+        return 1;
+    }
+    if (!conversion->previous_contrast) {
+        return brightness_contrast_kernels(kernels, rgb, n, coeffs, brightness, conversion->contrast, grey);
+    }
+
+    uint64_t histogram[256] = {0};
+    if (!conversion->have_lookup) {
+        grey_pass_histogram(kernels, rgb, n, coeffs, brightness, histogram, grey);
+        if (!build_contrast_lookup(histogram, conversion->contrast, conversion->lookup)) {
+            return 0;
+        }
+        kernels->apply_lookup(grey, n, conversion->lookup);
+        conversion->have_lookup = 1;
+        return 1;
+    }
+
+    grey_pass_lookup(kernels, rgb, n, coeffs, brightness, conversion->lookup, histogram, grey);
+    conversion->have_lookup = build_contrast_lookup(histogram, conversion->contrast, conversion->lookup);
+    return conversion->have_lookup;
+}
+
+
+/**
+ * @brief Converts a stream of concatenated PPM frames to a stream of PGM frames.
+ *
+ * @param in The stream of P6 frames, e.g. stdin.
+ * @param input_name Name of the input stream, used for error messages.
+ * @param out The stream the P5 frames are written to, e.g. stdout.
+ * @param output_name Name of the output stream, used for error messages.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param previous_contrast 1 to adjust the contrast of a frame with the statistics of the previous frame.
+ * @param stats Pointer where the throughput statistics will be stored.
+ *
+ * @return 1 if every frame up to the end of in was converted, 0 otherwise.
+ *
+ * The frames pass through three stages: one thread reads them, the calling
+ * thread converts them with the kernels of version 0 and one thread writes
+ * them. Each of the FRAME_SLOTS slots owns the buffers of one frame, which are
+ * reused for the following frames, so a stream of frames of the same size only
+ * allocates for the first FRAME_SLOTS frames. The frames may differ in size.
+ * The frames converted before an error are still written.
+ */
+
+int convert_frames(FILE *in, const char *input_name, FILE *out, const char *output_name, float a, float b, float c,
+                   int16_t brightness, float contrast, int previous_contrast, FrameStats *stats) {
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    memset(stats, 0, sizeof(*stats));
+
+    FrameStream stream = {0};
+    stream.in = in;
+    stream.out = out;
+    stream.input_name = input_name;
+    stream.output_name = output_name;
+    stream.stats = stats;
+    pthread_mutex_init(&stream.mutex, NULL);
+    pthread_cond_init(&stream.changed, NULL);
+
+    FrameConversion conversion = {0};
+    conversion.kernels = get_kernels();
+    convert_coeffs_to_max256(a, b, c, conversion.coeffs);
+    conversion.brightness = brightness;
+    conversion.contrast = contrast;
+    conversion.previous_contrast = previous_contrast;
+
+    pthread_t reader, writer;
+    int success = 1;
+    if (pthread_create(&reader, NULL, read_stage, &stream)) {
+        fprintf(stderr, "Failed to create threads for frames\n");
+        success = 0;
+    } else if (pthread_create(&writer, NULL, write_stage, &stream)) {
+        fprintf(stderr, "Failed to create threads for frames\n");
+        fail_stream(&stream);
+        pthread_join(reader, NULL);
+        success = 0;
+    }
+
+    if (success) {
+        // second stage: convert the frames in the order they were read
+        for (size_t k = 0;; k++) {
+            FrameSlot *slot = &stream.slots[k % FRAME_SLOTS];
+            if (!wait_slot(&stream, slot, SLOT_READ)) {
+                break;
+            }
+            // the slot may be reused as soon as it is handed on
+            int last = slot->last;
+            if (!last && !convert_frame(&conversion, slot->rgb.data, slot->width * slot->height, slot->grey.data)) {
+                fprintf(stderr, "Conversion of frame %zu failed\n", k);
+                fail_stream(&stream);
+                break;
+            }
+            set_slot(&stream, slot, SLOT_CONVERTED);
+            if (last) {
+                break;
+            }
+        }
+
+        pthread_join(reader, NULL);
+        pthread_join(writer, NULL);
+        success = !stream.failed;
+    }
+
+    for (size_t s = 0; s < FRAME_SLOTS; s++) {
+        buffer_free(&stream.slots[s].rgb);
+        buffer_free(&stream.slots[s].grey);
+    }
+    pthread_mutex_destroy(&stream.mutex);
+    pthread_cond_destroy(&stream.changed);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    stats->seconds = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
+    return success;
+}
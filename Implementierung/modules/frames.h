@@ -0,0 +1,42 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifndef TEAM120_FRAMES_H
+#define TEAM120_FRAMES_H
+
+// frames in flight, one is read while the previous one is converted and the one before is written
+#define FRAME_SLOTS 3
+
+// longest header of a frame, comments included
+#define FRAME_HEADER_LENGTH 4096
+
+typedef struct {
+    size_t frames;              // number of converted frames
+    size_t bytes;               // bytes of rgb values read
+    double seconds;             // wall clock time of the whole stream
+} FrameStats;
+
+
+/**
+ * @brief Converts a stream of concatenated PPM frames to a stream of PGM frames.
+ *
+ * @param in The stream of P6 frames, e.g. stdin.
+ * @param input_name Name of the input stream, used for error messages.
+ * @param out The stream the P5 frames are written to, e.g. stdout.
+ * @param output_name Name of the output stream, used for error messages.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param previous_contrast 1 to adjust the contrast of a frame with the statistics of the previous frame.
+ * @param stats Pointer where the throughput statistics will be stored.
+ *
+ * @return 1 if every frame up to the end of in was converted, 0 otherwise.
+ */
+
+int convert_frames(FILE *in, const char *input_name, FILE *out, const char *output_name, float a, float b, float c,
+                   int16_t brightness, float contrast, int previous_contrast, FrameStats *stats);
+
+#endif
@@ -0,0 +1,67 @@
+#include <stdint.h>
+#include <stdio.h>
+#include "histogram.h"
+
+#ifndef TEAM120_GREY_PASS_H
+#define TEAM120_GREY_PASS_H
+
+/*
+ * Every grey pass exists in four variants, specialised at compile time on
+ * whether a brightness is added and whether the grey values are counted into
+ * sub-histograms. The variant is chosen once per image, so the hot loops do
+ * not test either condition.
+ */
+#define GREY_PASS_BRIGHTNESS 1
+#define GREY_PASS_HISTOGRAM 2
+#define GREY_PASS_VARIANTS 4
+
+// converts n pixels with coefficients scaled to a sum of 256, see grey_pass_scalar_body()
+typedef void (*GreyPass)(const uint8_t *img, size_t n, const uint16_t *coeffs, int16_t brightness,
+                         SubHistograms hist, uint8_t *result);
+
+// converts n pixels with the float arithmetic of version 1, see grey_pass_precise_scalar_body()
+typedef void (*GreyPassPrecise)(const uint8_t *img, size_t n, const float *coeffs, int16_t brightness,
+                                SubHistograms hist, uint8_t *result);
+
+
+/**
+ * @brief Returns the index of a grey pass variant.
+ *
+ * @param with_brightness Non-zero if the variant adds the brightness.
+ * @param with_histogram Non-zero if the variant counts the grey values into hist.
+ *
+ * @return Index into a table of GREY_PASS_VARIANTS grey passes.
+ */
+
+static inline size_t grey_pass_index(int with_brightness, int with_histogram) {
+    return (with_brightness ? GREY_PASS_BRIGHTNESS : 0) | (with_histogram ? GREY_PASS_HISTOGRAM : 0);
+}
+
+
+/*
+ * Defines one variant of a grey pass as a static function that calls body
+ * with constant flags, so the compiler removes the branches on them.
+ */
+#define GREY_PASS_VARIANT(attributes, coeff_type, name, body, with_brightness, with_histogram)                \
+    attributes static void name(const uint8_t *img, size_t n, const coeff_type *coeffs, int16_t brightness,   \
+                                SubHistograms hist, uint8_t *result) {                                      \
+        body(img, n, coeffs, brightness, hist, result, with_brightness, with_histogram);                     \
+    }
+
+/*
+ * Defines the table name[GREY_PASS_VARIANTS] of type table_type, indexed by
+ * grey_pass_index(). body must be an always_inline function with the
+ * parameters of the grey pass followed by the flags with_brightness and
+ * with_histogram. A variant without brightness ignores the brightness, a
+ * variant without histogram ignores hist. attributes are added to every
+ * variant, e.g. the target instruction set.
+ */
+#define DEFINE_GREY_PASS_VARIANTS(attributes, table_type, coeff_type, name, body)                             \
+    GREY_PASS_VARIANT(attributes, coeff_type, name##_grey, body, 0, 0)                                       \
+    GREY_PASS_VARIANT(attributes, coeff_type, name##_brightness, body, 1, 0)                                 \
+    GREY_PASS_VARIANT(attributes, coeff_type, name##_histogram, body, 0, 1)                                  \
+    GREY_PASS_VARIANT(attributes, coeff_type, name##_brightness_histogram, body, 1, 1)                       \
+    const table_type name[GREY_PASS_VARIANTS] = {name##_grey, name##_brightness, name##_histogram,           \
+                                                 name##_brightness_histogram};
+
+#endif
@@ -0,0 +1,64 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef TEAM120_HISTOGRAM_H
+#define TEAM120_HISTOGRAM_H
+
+/*
+ * Number of interleaved sub-histograms. Consecutive grey values are counted in
+ * different copies, so runs of equal values do not stall on the store-to-load
+ * dependency of a single counter.
+ */
+#define HISTOGRAM_COPIES 4
+
+/*
+ * Maximum number of pixels counted into one set of sub-histograms before it is
+ * merged, so that no 32 bit counter can overflow.
+ */
+#define HISTOGRAM_CHUNK ((size_t) 1 << 30)
+
+typedef uint32_t SubHistograms[HISTOGRAM_COPIES][256];
+
+
+/**
+ * @brief Counts grey values into the sub-histograms.
+ *
+ * @param hist The sub-histograms.
+ * @param grey Pointer to the first grey value.
+ * @param n Number of grey values.
+ */
+
+static inline void histogram_count(SubHistograms hist, const uint8_t *grey, size_t n) {
+    size_t i = 0;
+    // load 8 grey values at once and split them with shifts instead of 8 byte loads
+    for (; i + 8 <= n; i += 8) {
+        uint64_t values;
+        memcpy(&values, grey + i, sizeof(values));
+        for (size_t j = 0; j < 8; j++) {
+            hist[j % HISTOGRAM_COPIES][(values >> (8 * j)) & 0xff]++;
+        }
+    }
+    for (; i < n; i++) {
+        hist[i % HISTOGRAM_COPIES][grey[i]]++;
+    }
+}
+
+
+/**
+ * @brief Adds the sub-histograms to a histogram with 64 bit counters and clears them.
+ *
+ * @param total Histogram with 256 entries.
+ * @param hist The sub-histograms.
+ */
+
+static inline void histogram_merge(uint64_t *total, SubHistograms hist) {
+    for (size_t v = 0; v < 256; v++) {
+        for (size_t j = 0; j < HISTOGRAM_COPIES; j++) {
+            total[v] += hist[j][v];
+            hist[j][v] = 0;
+        }
+    }
+}
+
+#endif
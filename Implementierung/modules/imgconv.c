@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "imgconv.h"
+#include "brightness_contrast_simd.h"
+#include "dispatch.h"
+#include "ppm.h"
+
+
+/**
+ * @brief Makes sure a buffer holds at least size bytes.
+ *
+ * @param ctx The context owning the buffer.
+ * @param buffer The buffer, replaced if it is too small.
+ * @param size The required size.
+ *
+ * @return 1 on success, 0 if the memory could not be allocated.
+ *
+ * A buffer that is too small goes back to the pool of the context, so another
+ * context can use it for smaller images. The content is not preserved.
+ */
+
+static int reserve(ImgconvContext *ctx, PoolBuffer *buffer, size_t size) {
+    if (buffer->capacity >= size) {
+        return 1;
+    }
+    pool_release(ctx->pool, buffer);
+    return pool_acquire(ctx->pool, size, buffer);
+}
+
+
+/**
+ * @brief Initializes a conversion context.
+ *
+ * @param ctx The context to be initialized.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value in [-255, 255].
+ * @param contrast Contrast adjustment value in [-255, 255], NaN if the contrast is not adjusted.
+ * @param isa Name of the instruction set (see find_kernels()), NULL for the widest supported.
+ *
+ * @return IMGCONV_OK on success, IMGCONV_ERROR_PARAMS if a parameter is invalid.
+ *
+ * The parameters are checked like checkParams() does for the command line and
+ * the coefficients are scaled once, so every image converted with the context
+ * only runs the kernels. Nothing is printed.
+ */
+
+ImgconvError imgconv_init(ImgconvContext *ctx, float a, float b, float c, int brightness, float contrast,
+                          const char *isa) {
+
+    memset(ctx, 0, sizeof(*ctx));
+
+    if (brightness < -255 || brightness > 255) {
+        return IMGCONV_ERROR_PARAMS;
+    }
+    if (!isnan(contrast) && (contrast < -255 || contrast > 255)) {
+        return IMGCONV_ERROR_PARAMS;
+    }
+    if (a < 0 || b < 0 || c < 0 || a + b + c == 0.0) {
+        return IMGCONV_ERROR_PARAMS;
+    }
+
+    ctx->kernels = isa ? lookup_kernels(isa) : get_kernels();
+    if (!ctx->kernels) {
+        return IMGCONV_ERROR_PARAMS;
+    }
+
+    convert_coeffs_to_max256(a, b, c, ctx->coeffs);
+    ctx->brightness = (int16_t) brightness;
+    ctx->contrast = contrast;
+    return IMGCONV_OK;
+}
+
+
+/**
+ * @brief Lets a context take its buffers from a pool shared with other contexts.
+ *
+ * @param ctx The initialized context without buffers.
+ * @param pool The pool, which must outlive the context.
+ */
+
+void imgconv_use_pool(ImgconvContext *ctx, BufferPool *pool) {
+    ctx->pool = pool;
+}
+
+
+/**
+ * @brief Decodes a PPM file into the buffer of the context.
+ *
+ * @param ctx The initialized context.
+ * @param filename The path to the PPM file to be read.
+ *
+ * @return IMGCONV_OK on success, an error code otherwise.
+ *
+ * The rgb buffer of the context only grows, so decoding images of the same
+ * size does not allocate. Buffers are aligned to BUFFER_ALIGNMENT.
+ * The ascii samples of a plain image are parsed with the kernels of the context.
+ * Errors are only returned, nothing is printed.
+ */
+
+ImgconvError imgconv_decode(ImgconvContext *ctx, const char *filename) {
+
+    ctx->input = NULL;
+    ctx->processed = 0;
+
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        return IMGCONV_ERROR_OPEN;
+    }
+
+    size_t width, height;
+    unsigned maxval;
+    int plain;
+    if (scanPPMHeader(fp, &width, &height, &maxval, &plain) != PPM_HEADER_OK || maxval > 255) {
+        fclose(fp);
+        return IMGCONV_ERROR_FORMAT;
+    }
+
+    // overflow checked in scanPPMHeader()
+    size_t three_height = 3 * height;
+    if (!reserve(ctx, &ctx->rgb, three_height * width)) {
+        fclose(fp);
+        return IMGCONV_ERROR_MEMORY;
+    }
+    int loaded;
+    if (plain) {
+        PlainReader reader;
+        if (!initPlainReader(&reader, fp, NULL, maxval, ctx->kernels)) {
+            fclose(fp);
+            return IMGCONV_ERROR_MEMORY;
+        }
+        loaded = readPlainSamples(&reader, ctx->rgb.data, three_height * width);
+        freePlainReader(&reader);
+    } else {
+        loaded = fread(ctx->rgb.data, three_height, width, fp) == width;
+    }
+    if (!loaded) {
+        fclose(fp);
+        return IMGCONV_ERROR_DATA;
+    }
+    fclose(fp);
+
+    ctx->width = width;
+    ctx->height = height;
+    ctx->input = ctx->rgb.data;
+    return IMGCONV_OK;
+}
+
+
+/**
+ * @brief Decodes a PPM image held in memory without copying the pixel data.
+ *
+ * @param ctx The initialized context.
+ * @param data The PPM image, must stay valid until the image is processed.
+ * @param size Size of the PPM image in bytes.
+ *
+ * @return IMGCONV_OK on success, an error code otherwise.
+ *
+ * The header is parsed in place by scanPPMHeaderBlock(), the kernels read the
+ * pixel data directly from the given buffer. Nothing is printed.
+ */
+
+ImgconvError imgconv_decode_memory(ImgconvContext *ctx, const uint8_t *data, size_t size) {
+
+    ctx->input = NULL;
+    ctx->processed = 0;
+
+    size_t width, height, header_length;
+    unsigned maxval;
+    int plain;
+    PPMHeaderStatus status = scanPPMHeaderBlock(data, size, &width, &height, &maxval, &plain, &header_length);
+    if (status == PPM_HEADER_INCOMPLETE) {
+        return IMGCONV_ERROR_DATA;
+    }
+    // the pixel data of a plain image can not be used in place
+    if (status != PPM_HEADER_OK || maxval > 255 || plain) {
+        return IMGCONV_ERROR_FORMAT;
+    }
+
+    // overflow checked in scanPPMHeaderBlock()
+    if (size - header_length < 3 * width * height) {
+        return IMGCONV_ERROR_DATA;
+    }
+
+    ctx->width = width;
+    ctx->height = height;
+    ctx->input = data + header_length;
+    return IMGCONV_OK;
+}
+
+
+/**
+ * @brief Converts the decoded image to grey scale and adjusts brightness and contrast.
+ *
+ * @param ctx The context holding a decoded image.
+ *
+ * @return IMGCONV_OK on success, an error code otherwise. The grey values are
+ *         stored in ctx->grey.data.
+ *
+ * The conversion is the one of version 0 with the kernels of the context.
+ */
+
+ImgconvError imgconv_process(ImgconvContext *ctx) {
+
+    if (!ctx->input) {
+        return IMGCONV_ERROR_STATE;
+    }
+
+    size_t wh = ctx->width * ctx->height;
+    if (!reserve(ctx, &ctx->grey, wh)) {
+        return IMGCONV_ERROR_MEMORY;
+    }
+    if (!brightness_contrast_kernels(ctx->kernels, ctx->input, wh, ctx->coeffs, ctx->brightness, ctx->contrast,
+                                     ctx->grey.data)) {
+        return IMGCONV_ERROR_PARAMS;
+    }
+    ctx->processed = 1;
+    return IMGCONV_OK;
+}
+
+
+/**
+ * @brief Writes the processed image to a PGM file.
+ *
+ * @param ctx The context holding a processed image.
+ * @param output_filename The path where the PGM file will be written.
+ *
+ * @return IMGCONV_OK on success, an error code otherwise.
+ */
+
+ImgconvError imgconv_encode(ImgconvContext *ctx, const char *output_filename) {
+
+    if (!ctx->processed) {
+        return IMGCONV_ERROR_STATE;
+    }
+
+    FILE *fp = fopen(output_filename, "wb");
+    if (!fp) {
+        return IMGCONV_ERROR_OPEN;
+    }
+
+    size_t wh = ctx->width * ctx->height;
+    int header_ok = fprintf(fp, "P5\n%zu %zu\n255\n", ctx->width, ctx->height) > 0;
+    int data_ok = fwrite(ctx->grey.data, 1, wh, fp) == wh;
+    if (fclose(fp) || !header_ok || !data_ok) {
+        return IMGCONV_ERROR_WRITE;
+    }
+    return IMGCONV_OK;
+}
+
+
+/**
+ * @brief Frees the buffers of a context or returns them to its pool.
+ *
+ * @param ctx The context, which can be initialized again afterwards.
+ */
+
+void imgconv_free(ImgconvContext *ctx) {
+    pool_release(ctx->pool, &ctx->rgb);
+    pool_release(ctx->pool, &ctx->grey);
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+
+/**
+ * @brief Describes an error code.
+ *
+ * @param error The error code.
+ *
+ * @return A static string describing the error.
+ */
+
+const char *imgconv_strerror(ImgconvError error) {
+    switch (error) {
+        case IMGCONV_OK:
+            return "Success";
+        case IMGCONV_ERROR_PARAMS:
+            return "Invalid conversion parameters";
+        case IMGCONV_ERROR_OPEN:
+            return "Unable to open file";
+        case IMGCONV_ERROR_FORMAT:
+            return "Invalid image format";
+        case IMGCONV_ERROR_DATA:
+            return "Image data incomplete";
+        case IMGCONV_ERROR_MEMORY:
+            return "Unable to allocate memory";
+        case IMGCONV_ERROR_STATE:
+            return "No image decoded or processed";
+        case IMGCONV_ERROR_WRITE:
+            return "Error writing image data";
+    }
+    return "Unknown error";
+}
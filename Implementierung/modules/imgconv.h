@@ -0,0 +1,133 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "buffer_pool.h"
+#include "dispatch.h"
+#include "export.h"
+
+#ifndef TEAM120_IMGCONV_H
+#define TEAM120_IMGCONV_H
+
+typedef enum {
+    IMGCONV_OK = 0,
+    IMGCONV_ERROR_PARAMS,       // invalid coefficients, brightness, contrast or instruction set
+    IMGCONV_ERROR_OPEN,         // file could not be opened
+    IMGCONV_ERROR_FORMAT,       // header is not a valid P6 or P3 header with 8 bit samples
+    IMGCONV_ERROR_DATA,         // pixel data is missing
+    IMGCONV_ERROR_MEMORY,       // buffer could not be allocated
+    IMGCONV_ERROR_STATE,        // no image decoded or processed yet
+    IMGCONV_ERROR_WRITE,        // output could not be written
+} ImgconvError;
+
+typedef struct {
+    uint16_t coeffs[3];         // coefficients scaled by convert_coeffs_to_max256()
+    int16_t brightness;
+    float contrast;             // NaN if the contrast is not adjusted
+    const Kernels *kernels;
+
+    size_t width, height;       // size of the decoded image
+    const uint8_t *input;       // rgb values of the decoded image
+    PoolBuffer rgb;             // buffer for decoded files, reused by every decode
+    PoolBuffer grey;            // grey values of the processed image, reused by every process
+    BufferPool *pool;           // source of the buffers, NULL if they are allocated directly
+    int processed;              // 1 if grey holds the result for input
+} ImgconvContext;
+
+
+/**
+ * @brief Initializes a conversion context.
+ *
+ * @param ctx The context to be initialized.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value in [-255, 255].
+ * @param contrast Contrast adjustment value in [-255, 255], NaN if the contrast is not adjusted.
+ * @param isa Name of the instruction set (see find_kernels()), NULL for the widest supported.
+ *
+ * @return IMGCONV_OK on success, IMGCONV_ERROR_PARAMS if a parameter is invalid.
+ */
+
+IMGCONV_API ImgconvError imgconv_init(ImgconvContext *ctx, float a, float b, float c, int brightness, float contrast,
+                                      const char *isa);
+
+
+/**
+ * @brief Lets a context take its buffers from a pool shared with other contexts.
+ *
+ * @param ctx The initialized context without buffers.
+ * @param pool The pool, which must outlive the context.
+ */
+
+IMGCONV_API void imgconv_use_pool(ImgconvContext *ctx, BufferPool *pool);
+
+
+/**
+ * @brief Decodes a PPM file into the buffer of the context.
+ *
+ * @param ctx The initialized context.
+ * @param filename The path to the PPM file to be read, P6 or plain P3.
+ *
+ * @return IMGCONV_OK on success, an error code otherwise.
+ */
+
+IMGCONV_API ImgconvError imgconv_decode(ImgconvContext *ctx, const char *filename);
+
+
+/**
+ * @brief Decodes a PPM image held in memory without copying the pixel data.
+ *
+ * @param ctx The initialized context.
+ * @param data The PPM image, must stay valid until the image is processed.
+ * @param size Size of the PPM image in bytes.
+ *
+ * @return IMGCONV_OK on success, an error code otherwise. Plain images (P3)
+ *         are rejected with IMGCONV_ERROR_FORMAT.
+ */
+
+IMGCONV_API ImgconvError imgconv_decode_memory(ImgconvContext *ctx, const uint8_t *data, size_t size);
+
+
+/**
+ * @brief Converts the decoded image to grey scale and adjusts brightness and contrast.
+ *
+ * @param ctx The context holding a decoded image.
+ *
+ * @return IMGCONV_OK on success, an error code otherwise. The grey values are
+ *         stored in ctx->grey.data.
+ */
+
+IMGCONV_API ImgconvError imgconv_process(ImgconvContext *ctx);
+
+
+/**
+ * @brief Writes the processed image to a PGM file.
+ *
+ * @param ctx The context holding a processed image.
+ * @param output_filename The path where the PGM file will be written.
+ *
+ * @return IMGCONV_OK on success, an error code otherwise.
+ */
+
+IMGCONV_API ImgconvError imgconv_encode(ImgconvContext *ctx, const char *output_filename);
+
+
+/**
+ * @brief Frees the buffers of a context or returns them to its pool.
+ *
+ * @param ctx The context, which can be initialized again afterwards.
+ */
+
+IMGCONV_API void imgconv_free(ImgconvContext *ctx);
+
+
+/**
+ * @brief Describes an error code.
+ *
+ * @param error The error code.
+ *
+ * @return A static string describing the error.
+ */
+
+IMGCONV_API const char *imgconv_strerror(ImgconvError error);
+
+#endif
@@ -0,0 +1,232 @@
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#endif
+#include "instrument.h"
+
+
+typedef struct {
+    uint64_t calls;
+    double seconds;
+    uint64_t counters[NUM_COUNTERS];
+    double start;               // time at phase_begin()
+    uint64_t start_counters[NUM_COUNTERS];
+    int running;
+} PhaseTotals;
+
+static const char *phase_names[NUM_PHASES] = {"header", "load", "grey", "statistics", "contrast", "write"};
+static const char *counter_names[NUM_COUNTERS] = {"cycles", "instructions", "llc_misses", "stalled_cycles"};
+
+static PhaseTotals phases[NUM_PHASES];
+static int counter_fds[NUM_COUNTERS] = {-1, -1, -1, -1};
+static int initialized = 0;
+static pthread_t owner;         // only the thread that recorded the first phase records phases
+
+
+/**
+ * @brief Opens the hardware counters of the calling thread and its future threads.
+ *
+ * Counters that the cpu, the kernel or the permissions do not provide stay
+ * closed and are reported as not available.
+ */
+
+static void open_counters(void) {
+#if defined(__linux__) && defined(SYS_perf_event_open)
+    static const uint64_t configs[NUM_COUNTERS] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_STALLED_CYCLES_BACKEND};
+
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // threads of version 3 are added when they are joined
+        attr.inherit = 1;
+        counter_fds[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#endif
+}
+
+
+/**
+ * @brief Reads the current values of the hardware counters.
+ *
+ * @param values Array of NUM_COUNTERS values, unavailable counters are set to 0.
+ */
+
+static void read_counters(uint64_t *values) {
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        values[i] = 0;
+        if (counter_fds[i] >= 0 && read(counter_fds[i], &values[i], sizeof(uint64_t)) != sizeof(uint64_t)) {
+            values[i] = 0;
+        }
+    }
+}
+
+
+/**
+ * @brief Returns the time of CLOCK_MONOTONIC in seconds.
+ */
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+/**
+ * @brief Starts the measurement of a phase.
+ *
+ * @param phase The phase.
+ *
+ * The first call opens the counters. Calls from threads other than the first
+ * one, such as the batch workers, are ignored.
+ */
+
+void phase_begin(Phase phase) {
+    if (!initialized) {
+        initialized = 1;
+        owner = pthread_self();
+        open_counters();
+    }
+    if (!pthread_equal(owner, pthread_self())) {
+        return;
+    }
+    PhaseTotals *totals = &phases[phase];
+    read_counters(totals->start_counters);
+    totals->start = now();
+    totals->running = 1;
+}
+
+
+/**
+ * @brief Ends the measurement of a phase and adds it to the totals of the phase.
+ *
+ * @param phase The phase.
+ *
+ * A phase that was not started, for example because an error ended it early,
+ * is ignored.
+ */
+
+void phase_end(Phase phase) {
+    if (!initialized || !pthread_equal(owner, pthread_self()) || !phases[phase].running) {
+        return;
+    }
+    PhaseTotals *totals = &phases[phase];
+    double end = now();
+    uint64_t values[NUM_COUNTERS];
+    read_counters(values);
+
+    totals->seconds += end - totals->start;
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        totals->counters[i] += values[i] - totals->start_counters[i];
+    }
+    totals->calls++;
+    totals->running = 0;
+}
+
+
+/**
+ * @brief Checks if the program records phases.
+ *
+ * @return 1 if the program was built with make INSTRUMENT=1, 0 otherwise.
+ */
+
+int instrument_enabled(void) {
+#ifdef TEAM120_INSTRUMENT
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+
+/**
+ * @brief Prints one column of the table of instrument_report().
+ *
+ * @param fp The output stream.
+ * @param counter The counter.
+ * @param values The totals of a phase.
+ * @param width Width of the column.
+ */
+
+static void print_counter(FILE *fp, Counter counter, const uint64_t *values, int width) {
+    if (counter_fds[counter] >= 0) {
+        fprintf(fp, " %*lu", width, (unsigned long) values[counter]);
+    } else {
+        fprintf(fp, " %*s", width, "n/a");
+    }
+}
+
+
+/**
+ * @brief Prints the totals of every recorded phase.
+ *
+ * @param fp The output stream.
+ * @param json 1 to print one JSON object on one line, 0 to print a table.
+ *
+ * Phases without calls are left out, unavailable counters are printed as n/a
+ * or null.
+ */
+
+void instrument_report(FILE *fp, int json) {
+    if (json) {
+        fprintf(fp, "{\"phases\":{");
+    } else {
+        fprintf(fp, "%-12s %8s %14s %16s %16s %8s %14s %16s\n", "phase", "calls", "seconds", "cycles",
+                "instructions", "IPC", "llc_misses", "stalled_cycles");
+    }
+
+    int first = 1;
+    for (int p = 0; p < NUM_PHASES; p++) {
+        const PhaseTotals *totals = &phases[p];
+        if (!totals->calls) {
+            continue;
+        }
+
+        if (json) {
+            fprintf(fp, "%s\"%s\":{\"calls\":%lu,\"seconds\":%.9f", first ? "" : ",", phase_names[p],
+                    (unsigned long) totals->calls, totals->seconds);
+            for (int i = 0; i < NUM_COUNTERS; i++) {
+                if (counter_fds[i] >= 0) {
+                    fprintf(fp, ",\"%s\":%lu", counter_names[i], (unsigned long) totals->counters[i]);
+                } else {
+                    fprintf(fp, ",\"%s\":null", counter_names[i]);
+                }
+            }
+            fprintf(fp, "}");
+        } else {
+            fprintf(fp, "%-12s %8lu %14.9f", phase_names[p], (unsigned long) totals->calls, totals->seconds);
+            print_counter(fp, COUNTER_CYCLES, totals->counters, 16);
+            print_counter(fp, COUNTER_INSTRUCTIONS, totals->counters, 16);
+            if (counter_fds[COUNTER_CYCLES] >= 0 && counter_fds[COUNTER_INSTRUCTIONS] >= 0 &&
+                totals->counters[COUNTER_CYCLES]) {
+                fprintf(fp, " %8.2f", (double) totals->counters[COUNTER_INSTRUCTIONS] /
+                                      (double) totals->counters[COUNTER_CYCLES]);
+            } else {
+                fprintf(fp, " %8s", "n/a");
+            }
+            print_counter(fp, COUNTER_LLC_MISSES, totals->counters, 14);
+            print_counter(fp, COUNTER_STALLED_CYCLES, totals->counters, 16);
+            fprintf(fp, "\n");
+        }
+        first = 0;
+    }
+
+    if (json) {
+        fprintf(fp, "}}\n");
+    }
+}
@@ -0,0 +1,71 @@
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef TEAM120_INSTRUMENT_H
+#define TEAM120_INSTRUMENT_H
+
+typedef enum {
+    PHASE_HEADER,               // parsing the PPM header
+    PHASE_LOAD,                 // reading the pixel data
+    PHASE_GREY,                 // grey pass including brightness and histogram
+    PHASE_STATISTICS,           // mean, variance and lookup table
+    PHASE_CONTRAST,             // applying the contrast
+    PHASE_WRITE,                // writing the PGM file
+    NUM_PHASES
+} Phase;
+
+typedef enum {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_LLC_MISSES,
+    COUNTER_STALLED_CYCLES,     // cycles stalled in the backend
+    NUM_COUNTERS
+} Counter;
+
+// the phases are only recorded if the program is built with make INSTRUMENT=1
+#ifdef TEAM120_INSTRUMENT
+#define PHASE_BEGIN(phase) phase_begin(phase)
+#define PHASE_END(phase) phase_end(phase)
+#else
+#define PHASE_BEGIN(phase) ((void) 0)
+#define PHASE_END(phase) ((void) 0)
+#endif
+
+
+/**
+ * @brief Starts the measurement of a phase.
+ *
+ * @param phase The phase.
+ */
+
+void phase_begin(Phase phase);
+
+
+/**
+ * @brief Ends the measurement of a phase and adds it to the totals of the phase.
+ *
+ * @param phase The phase.
+ */
+
+void phase_end(Phase phase);
+
+
+/**
+ * @brief Checks if the program records phases.
+ *
+ * @return 1 if the program was built with make INSTRUMENT=1, 0 otherwise.
+ */
+
+int instrument_enabled(void);
+
+
+/**
+ * @brief Prints the totals of every recorded phase.
+ *
+ * @param fp The output stream.
+ * @param json 1 to print one JSON object on one line, 0 to print a table.
+ */
+
+void instrument_report(FILE *fp, int json);
+
+#endif
@@ -0,0 +1,263 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include "io_ring.h"
+
+
+/**
+ * @brief Sets up an io_uring instance with the raw system calls.
+ *
+ * @param ring The ring.
+ * @param entries Minimum number of operations in flight at once.
+ *
+ * @return 1 on success, 0 if io_uring is not available, e.g. on kernels
+ *         before 5.6 or if it is disabled.
+ *
+ * The kernel rounds the entries up to a power of two and sizes the completion
+ * queue twice as large, so a completion is never dropped as long as no more
+ * than entries operations are in flight.
+ */
+
+int ring_init(IoRing *ring, unsigned entries) {
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+        return 0;
+    }
+    // completions must not be dropped if the completion queue runs full
+    if (!(params.features & IORING_FEAT_NODROP)) {
+        close(fd);
+        return 0;
+    }
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                         IORING_OFF_SQ_RING);
+    ring->cq_ring = single_mmap || ring->sq_ring == MAP_FAILED
+                    ? ring->sq_ring
+                    : mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                           IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        if (ring->sqes != MAP_FAILED) {
+            munmap(ring->sqes, params.sq_entries * sizeof(struct io_uring_sqe));
+        }
+        if (ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring) {
+            munmap(ring->cq_ring, ring->cq_ring_size);
+        }
+        if (ring->sq_ring != MAP_FAILED) {
+            munmap(ring->sq_ring, ring->sq_ring_size);
+        }
+        close(fd);
+        memset(ring, 0, sizeof(*ring));
+        ring->fd = -1;
+        return 0;
+    }
+
+    uint8_t *sq = ring->sq_ring, *cq = ring->cq_ring;
+    ring->fd = fd;
+    ring->entries = params.sq_entries;
+    ring->sq_head = (unsigned *) (sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+    ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = cq + params.cq_off.cqes;
+    return 1;
+}
+
+
+/**
+ * @brief Reserves a table of buffer slots the buffers of the caller can be registered in.
+ *
+ * @param ring The ring.
+ * @param count Number of buffer slots.
+ *
+ * @return 1 on success, 0 if the kernel does not support sparse buffer tables (before 5.19).
+ */
+
+int ring_register_buffers(IoRing *ring, unsigned count) {
+    struct io_uring_rsrc_register table;
+    memset(&table, 0, sizeof(table));
+    table.nr = count;
+    table.flags = IORING_RSRC_REGISTER_SPARSE;
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS2, &table, sizeof(table)) < 0) {
+        return 0;
+    }
+    ring->registered = count;
+    return 1;
+}
+
+
+/**
+ * @brief Registers a buffer in a buffer slot, replacing the buffer registered before.
+ *
+ * @param ring The ring with a buffer table.
+ * @param index The buffer slot.
+ * @param data The buffer, NULL to empty the slot.
+ * @param length Size of the buffer, at most IO_RING_MAX_REGISTERED.
+ *
+ * @return 1 on success, 0 if the buffer could not be registered, e.g. because
+ *         of the limit for locked memory; the slot is empty then.
+ *
+ * The slot must not be used by an operation in flight.
+ */
+
+int ring_update_buffer(IoRing *ring, unsigned index, void *data, size_t length) {
+    struct iovec iov = {data, data ? length : 0};
+    struct io_uring_rsrc_update2 update;
+    memset(&update, 0, sizeof(update));
+    update.offset = index;
+    update.data = (uint64_t) (uintptr_t) &iov;
+    update.nr = 1;
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update)) == 1) {
+        return 1;
+    }
+    if (data) {
+        // leave the slot empty, the old buffer may be freed by the caller
+        ring_update_buffer(ring, index, NULL, 0);
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Queues a read or write at an offset of a file.
+ *
+ * @param ring The ring.
+ * @param op IO_RING_READ or IO_RING_WRITE.
+ * @param fd The file.
+ * @param buffer The buffer, inside the registered buffer of buffer_index if it is not negative.
+ * @param length Number of bytes, at most UINT32_MAX.
+ * @param offset Offset in the file.
+ * @param buffer_index Slot of a registered buffer, -1 for an unregistered buffer.
+ * @param user_data Returned with the completion.
+ *
+ * @return 1 on success, 0 if the submission queue is full and could not be submitted.
+ *
+ * A full submission queue is submitted first, the kernel takes the entries
+ * over at once and keeps their completions even if the completion queue runs full.
+ */
+
+int ring_queue(IoRing *ring, IoRingOp op, int fd, void *buffer, size_t length, off_t offset, int buffer_index,
+               uint64_t user_data) {
+    unsigned tail = *ring->sq_tail;
+    if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->entries &&
+        (!ring_submit(ring, 0) || tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->entries)) {
+        return 0;
+    }
+
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = (struct io_uring_sqe *) ring->sqes + index;
+    memset(sqe, 0, sizeof(*sqe));
+    if (buffer_index >= 0) {
+        sqe->opcode = op == IO_RING_READ ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+        sqe->buf_index = (uint16_t) buffer_index;
+    } else {
+        sqe->opcode = op == IO_RING_READ ? IORING_OP_READ : IORING_OP_WRITE;
+    }
+    sqe->fd = fd;
+    sqe->addr = (uint64_t) (uintptr_t) buffer;
+    sqe->len = (uint32_t) length;
+    sqe->off = (uint64_t) offset;
+    sqe->user_data = user_data;
+
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->pending++;
+    return 1;
+}
+
+
+/**
+ * @brief Submits the queued operations and waits for completions.
+ *
+ * @param ring The ring.
+ * @param wait Number of completions to wait for, 0 to return at once.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+
+int ring_submit(IoRing *ring, unsigned wait) {
+    while (ring->pending || wait) {
+        long submitted = syscall(__NR_io_uring_enter, ring->fd, ring->pending, wait,
+                                 wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (submitted < 0 && errno == EINTR) {
+            continue;
+        }
+        if (submitted < 0) {
+            return 0;
+        }
+        ring->pending -= (unsigned) submitted;
+        if (!ring->pending) {
+            break;
+        }
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Takes the next completion.
+ *
+ * @param ring The ring.
+ * @param user_data Pointer where the user data of the operation will be stored.
+ * @param result Pointer where the result will be stored, the number of bytes or a negative errno.
+ *
+ * @return 1 if a completion was taken, 0 if there is none.
+ */
+
+int ring_complete(IoRing *ring, uint64_t *user_data, int32_t *result) {
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    struct io_uring_cqe *cqe = (struct io_uring_cqe *) ring->cqes + (head & *ring->cq_mask);
+    *user_data = cqe->user_data;
+    *result = cqe->res;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+
+/**
+ * @brief Tears down an io_uring instance.
+ *
+ * @param ring The ring.
+ */
+
+void ring_destroy(IoRing *ring) {
+    if (ring->fd < 0) {
+        return;
+    }
+    munmap(ring->sqes, ring->entries * sizeof(struct io_uring_sqe));
+    if (ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+    ring->fd = -1;
+}
@@ -0,0 +1,124 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#ifndef TEAM120_IO_RING_H
+#define TEAM120_IO_RING_H
+
+// largest buffer io_uring accepts for registration
+#define IO_RING_MAX_REGISTERED ((size_t) 1 << 30)
+
+typedef enum {
+    IO_RING_READ,
+    IO_RING_WRITE,
+} IoRingOp;
+
+typedef struct {
+    int fd;                     // the io_uring instance, -1 if not set up
+    unsigned entries;           // number of submission queue entries
+    unsigned pending;           // entries queued since the last submission
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    void *sqes;                 // struct io_uring_sqe[entries]
+    void *cqes;                 // struct io_uring_cqe[cq entries]
+    void *sq_ring, *cq_ring;    // the mappings
+    size_t sq_ring_size, cq_ring_size;
+    unsigned registered;        // number of slots for registered buffers, 0 if none
+} IoRing;
+
+
+/**
+ * @brief Sets up an io_uring instance with the raw system calls.
+ *
+ * @param ring The ring.
+ * @param entries Minimum number of operations in flight at once.
+ *
+ * @return 1 on success, 0 if io_uring is not available, e.g. on kernels
+ *         before 5.6 or if it is disabled.
+ */
+
+int ring_init(IoRing *ring, unsigned entries);
+
+
+/**
+ * @brief Reserves a table of buffer slots the buffers of the caller can be registered in.
+ *
+ * @param ring The ring.
+ * @param count Number of buffer slots.
+ *
+ * @return 1 on success, 0 if the kernel does not support sparse buffer tables (before 5.19).
+ */
+
+int ring_register_buffers(IoRing *ring, unsigned count);
+
+
+/**
+ * @brief Registers a buffer in a buffer slot, replacing the buffer registered before.
+ *
+ * @param ring The ring with a buffer table.
+ * @param index The buffer slot.
+ * @param data The buffer, NULL to empty the slot.
+ * @param length Size of the buffer, at most IO_RING_MAX_REGISTERED.
+ *
+ * @return 1 on success, 0 if the buffer could not be registered, e.g. because
+ *         of the limit for locked memory; the slot is empty then.
+ *
+ * The slot must not be used by an operation in flight.
+ */
+
+int ring_update_buffer(IoRing *ring, unsigned index, void *data, size_t length);
+
+
+/**
+ * @brief Queues a read or write at an offset of a file.
+ *
+ * @param ring The ring.
+ * @param op IO_RING_READ or IO_RING_WRITE.
+ * @param fd The file.
+ * @param buffer The buffer, inside the registered buffer of buffer_index if it is not negative.
+ * @param length Number of bytes, at most UINT32_MAX.
+ * @param offset Offset in the file.
+ * @param buffer_index Slot of a registered buffer, -1 for an unregistered buffer.
+ * @param user_data Returned with the completion.
+ *
+ * @return 1 on success, 0 if the submission queue is full and could not be submitted.
+ */
+
+int ring_queue(IoRing *ring, IoRingOp op, int fd, void *buffer, size_t length, off_t offset, int buffer_index,
+               uint64_t user_data);
+
+
+/**
+ * @brief Submits the queued operations and waits for completions.
+ *
+ * @param ring The ring.
+ * @param wait Number of completions to wait for, 0 to return at once.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+
+int ring_submit(IoRing *ring, unsigned wait);
+
+
+/**
+ * @brief Takes the next completion.
+ *
+ * @param ring The ring.
+ * @param user_data Pointer where the user data of the operation will be stored.
+ * @param result Pointer where the result will be stored, the number of bytes or a negative errno.
+ *
+ * @return 1 if a completion was taken, 0 if there is none.
+ */
+
+int ring_complete(IoRing *ring, uint64_t *user_data, int32_t *result);
+
+
+/**
+ * @brief Tears down an io_uring instance.
+ *
+ * @param ring The ring.
+ */
+
+void ring_destroy(IoRing *ring);
+
+#endif
@@ -0,0 +1,184 @@
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jpeg.h"
+#include "brightness_contrast_simd.h"
+#include "buffer_pool.h"
+#include "instrument.h"
+
+#ifdef TEAM120_JPEG
+#include <jpeglib.h>
+#endif
+
+
+/**
+ * @brief Checks whether a stream starts like a JPEG image without consuming anything.
+ *
+ * @param fp The stream positioned at the start of the image.
+ *
+ * @return 1 if the first byte is the 0xFF of the start of image marker, 0 otherwise.
+ *
+ * A PPM image starts with 'P', so the first byte tells both formats apart. It is
+ * put back with ungetc(), so the stream can be a pipe and is read only once.
+ */
+
+int isJPEG(FILE *fp) {
+    int c = getc(fp);
+    if (c == EOF) {
+        return 0;
+    }
+    ungetc(c, fp);
+    return c == 0xFF;
+}
+
+
+#ifdef TEAM120_JPEG
+
+typedef struct {
+    struct jpeg_error_mgr manager;  // first member, libjpeg only knows this part
+    jmp_buf jump;
+    const char *filename;
+} JPEGError;
+
+
+/**
+ * @brief Reports a fatal error of libjpeg and returns to readJPEG().
+ *
+ * @param cinfo The decompressor.
+ */
+
+static void exit_jpeg_error(j_common_ptr cinfo) {
+    JPEGError *error = (JPEGError *) cinfo->err;
+    char message[JMSG_LENGTH_MAX];
+    cinfo->err->format_message(cinfo, message);
+    fprintf(stderr, "Unable to decode JPEG file '%s': %s\n", error->filename, message);
+    longjmp(error->jump, 1);
+}
+
+
+/**
+ * @brief Checks whether coefficients convert to the luma of JPEG images.
+ *
+ * @param coeffs Coefficients for the red, green and blue component.
+ *
+ * @return 1 if the coefficients scaled to a sum of 256 equal the scaled weights of BT.601, 0 otherwise.
+ *
+ * Version 0 can not tell coefficients apart that are scaled to the same
+ * integers, so they all get the luma.
+ */
+
+static int is_luma(const float *coeffs) {
+    uint16_t scaled[3], luma[3];
+    convert_coeffs_to_max256(coeffs[0], coeffs[1], coeffs[2], scaled);
+    convert_coeffs_to_max256(JPEG_LUMA_A, JPEG_LUMA_B, JPEG_LUMA_C, luma);
+    return !memcmp(scaled, luma, sizeof(scaled));
+}
+
+
+/**
+ * @brief Decodes a JPEG image.
+ *
+ * @param fp The stream positioned at the start of the image, it is not closed.
+ * @param filename The path of the file, used for error messages.
+ * @param coeffs The coefficients of a conversion with version 0, NULL if the image has to be decoded to rgb values.
+ * @param grey Pointer where 1 is stored if the image holds one grey value per pixel, 0 for rgb values.
+ *
+ * @return A pointer to the image with a maximum value of 255, free with freePPM(). NULL on
+ *         failure or if the program was built without libjpeg.
+ *
+ * A YCbCr image converted with the weights of BT.601 is decoded to its Y
+ * component only: libjpeg skips the inverse DCT of the chroma components, the
+ * upsampling and the colour conversion. A greyscale image holds the grey image
+ * for every coefficients of version 0, as they are scaled to a sum of 256.
+ * Every other image is decoded to rgb values. The luma is rounded by libjpeg
+ * and differs by at most 1 from version 0 on the decoded rgb values, besides
+ * the clamping of the rgb values by the colour conversion.
+ */
+
+PPMImage *readJPEG(FILE *fp, const char *filename, const float *coeffs, int *grey) {
+    // volatile, as the pointer is read again after longjmp()
+    PPMImage *volatile img = (PPMImage *) malloc(sizeof(PPMImage));
+    if (!img) {
+        fprintf(stderr, "Failed to allocate memeory for image\n");
+        return NULL;
+    }
+    img->data = NULL;
+    img->capacity = 0;
+
+    struct jpeg_decompress_struct cinfo;
+    JPEGError error;
+    cinfo.err = jpeg_std_error(&error.manager);
+    error.manager.error_exit = exit_jpeg_error;
+    error.filename = filename;
+    if (setjmp(error.jump)) {
+        // the buffer is only referenced by img, which is not changed after setjmp()
+        jpeg_destroy_decompress(&cinfo);
+        PoolBuffer buffer = {img->data, img->capacity};
+        buffer_free(&buffer);
+        free(img);
+        return NULL;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, fp);
+    PHASE_BEGIN(PHASE_HEADER);
+    jpeg_read_header(&cinfo, TRUE);
+    PHASE_END(PHASE_HEADER);
+
+    if (cinfo.jpeg_color_space != JCS_GRAYSCALE && cinfo.jpeg_color_space != JCS_YCbCr &&
+        cinfo.jpeg_color_space != JCS_RGB) {
+        fprintf(stderr, "Unable to decode JPEG file '%s': only greyscale, YCbCr and RGB images are supported\n",
+                filename);
+        longjmp(error.jump, 1);
+    }
+    *grey = coeffs && (cinfo.jpeg_color_space == JCS_GRAYSCALE ||
+                       (cinfo.jpeg_color_space == JCS_YCbCr && is_luma(coeffs)));
+    cinfo.out_color_space = *grey ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_start_decompress(&cinfo);
+
+    // at most 65500 x 65500 pixels, so the size can not overflow
+    img->width = cinfo.output_width;
+    img->height = cinfo.output_height;
+    img->maxval = 255;
+    size_t row_bytes = img->width * (size_t) cinfo.output_components;
+    PoolBuffer buffer;
+    if (!buffer_alloc(row_bytes * img->height, &buffer)) {
+        fprintf(stderr, "Unable to allocate memory for image\n");
+        longjmp(error.jump, 1);
+    }
+    img->data = buffer.data;
+    img->capacity = buffer.capacity;
+
+    PHASE_BEGIN(PHASE_LOAD);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW rows[JPEG_ROWS];
+        JDIMENSION count = cinfo.output_height - cinfo.output_scanline;
+        if (count > JPEG_ROWS) {
+            count = JPEG_ROWS;
+        }
+        for (JDIMENSION r = 0; r < count; r++) {
+            rows[r] = img->data + (cinfo.output_scanline + r) * row_bytes;
+        }
+        jpeg_read_scanlines(&cinfo, rows, count);
+    }
+    PHASE_END(PHASE_LOAD);
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return img;
+}
+
+#else
+
+PPMImage *readJPEG(FILE *fp, const char *filename, const float *coeffs, int *grey) {
+    (void) fp;
+    (void) coeffs;
+    *grey = 0;
+    fprintf(stderr, "Unable to decode JPEG file '%s': the program was built without libjpeg, build it with make JPEG=1\n",
+            filename);
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#include <stddef.h>
+#include <stdio.h>
+#include "ppm.h"
+
+#ifndef TEAM120_JPEG_H
+#define TEAM120_JPEG_H
+
+// weights of the luma of JPEG images (BT.601), the Y component is the grey image for them
+#define JPEG_LUMA_A 0.299f
+#define JPEG_LUMA_B 0.587f
+#define JPEG_LUMA_C 0.114f
+
+// scanlines handed to the decoder at once
+#define JPEG_ROWS 16
+
+
+/**
+ * @brief Checks whether a stream starts like a JPEG image without consuming anything.
+ *
+ * @param fp The stream positioned at the start of the image.
+ *
+ * @return 1 if the first byte is the 0xFF of the start of image marker, 0 otherwise.
+ */
+
+int isJPEG(FILE *fp);
+
+
+/**
+ * @brief Decodes a JPEG image.
+ *
+ * @param fp The stream positioned at the start of the image, it is not closed.
+ * @param filename The path of the file, used for error messages.
+ * @param coeffs The coefficients of a conversion with version 0, NULL if the image has to be decoded to rgb values.
+ * @param grey Pointer where 1 is stored if the image holds one grey value per pixel, 0 for rgb values.
+ *
+ * @return A pointer to the image with a maximum value of 255, free with freePPM(). NULL on
+ *         failure or if the program was built without libjpeg.
+ */
+
+PPMImage *readJPEG(FILE *fp, const char *filename, const float *coeffs, int *grey);
+
+#endif
@@ -0,0 +1,180 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mapped_io.h"
+#include "ppm.h"
+
+
+/**
+ * @brief Maps a PPM image into memory without copying the pixel data.
+ *
+ * @param filename The path to the PPM file to be mapped.
+ * @param file Pointer where the mapping will be stored.
+ *
+ * @return 1 on success, 0 on failure.
+ *
+ * The whole file is mapped read-only and the header is parsed directly in the
+ * mapping by parsePPMHeader(). file->data points to the pixel data behind the
+ * header, so the kernels read the page cache directly. The mapping is advised as sequential
+ * to let the kernel read ahead aggressively and drop pages behind the reader.
+ */
+
+int mapPPM(const char *filename, MappedFile *file) {
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to open file '%s'\n", filename);
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st)) {
+        fprintf(stderr, "Unable to stat file '%s'\n", filename);
+        close(fd);
+        return 0;
+    }
+    if (st.st_size == 0) {
+        // nothing to map, the header is missing
+        fprintf(stderr, "Error reading file.\n");
+        close(fd);
+        return 0;
+    }
+
+    file->length = (size_t) st.st_size;
+    void *base = mmap(NULL, file->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Unable to map file '%s'\n", filename);
+        return 0;
+    }
+    madvise(base, file->length, MADV_SEQUENTIAL);
+    file->base = base;
+
+    // the header is parsed directly in the mapping
+    size_t header_length;
+    unsigned maxval;
+    int plain;
+    int res = parsePPMHeader(file->base, file->length, filename, &file->width, &file->height, &maxval, &plain,
+                             &header_length);
+    if (res < 0) {
+        fprintf(stderr, "Error reading file.\n");
+    }
+    if (res == 1 && maxval > 255) {
+        fprintf(stderr, "16 bit images are not supported with --mmap\n");
+        res = 0;
+    }
+    if (res == 1 && plain) {
+        // the ascii samples have to be parsed into a buffer anyway
+        fprintf(stderr, "Plain images (P3) are not supported with --mmap\n");
+        res = 0;
+    }
+
+    // overflow checked in parsePPMHeader()
+    if (res == 1 && file->length - header_length < 3 * file->width * file->height) {
+        fprintf(stderr, "Error loading image data from '%s'\n", filename);
+        res = 0;
+    }
+    if (res != 1) {
+        munmap(base, file->length);
+        return 0;
+    }
+
+    file->data = file->base + header_length;
+    file->dev = st.st_dev;
+    file->ino = st.st_ino;
+    return 1;
+}
+
+
+/**
+ * @brief Creates a PGM file of the given size and maps it into memory.
+ *
+ * @param output_filename The path where the PGM file will be written.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param input The mapped input image, which must not be overwritten. May be NULL.
+ * @param file Pointer where the mapping will be stored.
+ *
+ * @return 1 on success, 0 on failure.
+ *
+ * The file is sized with ftruncate() and mapped shared, so the kernels store the
+ * grey values directly into the page cache of the output file. The header is
+ * written into the mapping, file->data points behind it. Huge pages are requested
+ * where the system supports them for file mappings; failure of the advice is ignored.
+ * Writing onto the mapped input would truncate it under the reader, so that case
+ * is rejected.
+ */
+
+int mapPGM(const char *output_filename, size_t width, size_t height, const MappedFile *input, MappedFile *file) {
+
+    char header[64];
+    int header_length = snprintf(header, sizeof(header), "P5\n%zu %zu\n255\n", width, height);
+
+    int fd = open(output_filename, O_RDWR | O_CREAT, 0666);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to open file '%s' for writing\n", output_filename);
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st)) {
+        fprintf(stderr, "Unable to stat file '%s'\n", output_filename);
+        close(fd);
+        return 0;
+    }
+    if (input && st.st_dev == input->dev && st.st_ino == input->ino) {
+        fprintf(stderr, "Output file '%s' must differ from the input file\n", output_filename);
+        close(fd);
+        return 0;
+    }
+
+    // overflow of width * height checked in readPPMHeader()
+    file->length = (size_t) header_length + width * height;
+    if (ftruncate(fd, 0) || ftruncate(fd, (off_t) file->length)) {
+        fprintf(stderr, "Unable to resize file '%s'\n", output_filename);
+        close(fd);
+        return 0;
+    }
+
+    void *base = mmap(NULL, file->length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Unable to map file '%s'\n", output_filename);
+        return 0;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(base, file->length, MADV_HUGEPAGE);
+#endif
+
+    file->base = base;
+    memcpy(file->base, header, header_length);
+    file->data = file->base + header_length;
+    file->width = width;
+    file->height = height;
+    file->dev = st.st_dev;
+    file->ino = st.st_ino;
+    return 1;
+}
+
+
+/**
+ * @brief Unmaps a file mapped by mapPPM() or mapPGM().
+ *
+ * @param file Pointer to the mapping.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+
+int unmapFile(MappedFile *file) {
+    if (munmap(file->base, file->length)) {
+        fprintf(stderr, "Unable to unmap file\n");
+        return 0;
+    }
+    return 1;
+}
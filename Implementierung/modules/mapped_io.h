@@ -0,0 +1,55 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#ifndef TEAM120_MAPPED_IO_H
+#define TEAM120_MAPPED_IO_H
+
+typedef struct {
+    uint8_t *base;              // start of the mapping
+    size_t length;              // length of the mapping in bytes
+    uint8_t *data;              // first byte of the pixel data inside the mapping
+    size_t width, height;
+    dev_t dev;                  // identifies the mapped file
+    ino_t ino;
+} MappedFile;
+
+
+/**
+ * @brief Maps a PPM image into memory without copying the pixel data.
+ *
+ * @param filename The path to the PPM file to be mapped.
+ * @param file Pointer where the mapping will be stored.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+
+int mapPPM(const char *filename, MappedFile *file);
+
+
+/**
+ * @brief Creates a PGM file of the given size and maps it into memory.
+ *
+ * @param output_filename The path where the PGM file will be written.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param input The mapped input image, which must not be overwritten. May be NULL.
+ * @param file Pointer where the mapping will be stored.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+
+int mapPGM(const char *output_filename, size_t width, size_t height, const MappedFile *input, MappedFile *file);
+
+
+/**
+ * @brief Unmaps a file mapped by mapPPM() or mapPGM().
+ *
+ * @param file Pointer to the mapping.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+
+int unmapFile(MappedFile *file);
+
+#endif
@@ -0,0 +1,689 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+#include "buffer_pool.h"
+#include "dispatch.h"
+#include "instrument.h"
+#include "ppm.h"
+#include "util.h"
+
+
+/**
+ * @brief Checks if a character separates the tokens of a PPM header.
+ *
+ * @param c The character.
+ *
+ * @return 1 for space, tab, carriage return and line feed, 0 otherwise.
+ */
+
+static int isHeaderWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+
+typedef struct {
+    FILE *fp;                   // source of the bytes, NULL if they are taken from block
+    const uint8_t *block;
+    size_t length;              // number of bytes in block
+    size_t pos;                 // number of bytes consumed
+} HeaderSource;
+
+
+/**
+ * @brief Consumes the next byte of a header.
+ *
+ * @param source The source of the header.
+ *
+ * @return The byte, EOF at the end of the block or file.
+ */
+
+static int nextHeaderByte(HeaderSource *source) {
+    int c;
+    if (source->fp) {
+        // the caller holds the lock of the file
+        c = getc_unlocked(source->fp);
+    } else {
+        c = source->pos < source->length ? source->block[source->pos] : EOF;
+    }
+    source->pos += c != EOF;
+    return c;
+}
+
+
+/**
+ * @brief Parses the header of a PPM image byte by byte.
+ *
+ * @param source The source of the header.
+ * @param width Pointer where the width of the image will be stored.
+ * @param height Pointer where the height of the image will be stored.
+ * @param maxval Pointer where the maximum color value of the image will be stored.
+ * @param plain Pointer where 1 is stored for a plain image (P3) with ascii samples, 0 for P6.
+ *
+ * @return PPM_HEADER_OK if a valid P6 or P3 header was parsed, the reason otherwise.
+ *
+ * The function expects the PPM file to be in the P6 or P3 format.
+ * It performs several checks to ensure the format is correct, including checking
+ * the file header (must be 'P6' or 'P3'), the image dimensions, and the maximum color value.
+ * The function handles whitespace and comments in the PPM file format. A comment
+ * inside a token is skipped and the token continues after the end of the line.
+ * Tokens are limited to PPM_TOKEN_LENGTH - 1 characters. A JPEG image, which
+ * starts with 0xFF, is reported as such, as only readJPEG() decodes it.
+ * A maximum value above 255 stores every sample in two bytes, most significant
+ * byte first. It also checks that the size of the pixel data fits into size_t.
+ * The header ends on the single whitespace behind the maximum value, no byte
+ * behind it is consumed. Nothing is printed.
+ */
+
+static PPMHeaderStatus scanHeader(HeaderSource *source, size_t *width, size_t *height, unsigned *maxval, int *plain) {
+
+    char buffer[PPM_TOKEN_LENGTH];
+    size_t i = 0;               // write position in buffer
+    long maxval_val = -1;
+    int numWP = 0;              // Number of tokens read
+    int token_switch = 0;       // 0: currently reading token 1: between tokens
+    int c;
+
+    while (1) {
+        if (i >= PPM_TOKEN_LENGTH - 1) {
+            return PPM_HEADER_CORRUPTED;
+        }
+        if ((c = nextHeaderByte(source)) == EOF) {
+            return PPM_HEADER_INCOMPLETE;
+        }
+        if (c == 0xFF && source->pos == 1) {
+            return PPM_HEADER_JPEG;
+        }
+        char curr = (char) c;
+
+        if (token_switch && isHeaderWhitespace(curr)) {
+            // Whitespace character between tokens are ignored
+            continue;
+        }
+        if (curr == '#') {
+            // Ignore everything in the comment, a token is continued after the comment
+            while (curr != '\r' && curr != '\n') {
+                if ((c = nextHeaderByte(source)) == EOF) {
+                    return PPM_HEADER_INCOMPLETE;
+                }
+                curr = (char) c;
+            }
+            continue;
+        }
+        // Whitespace between tokens has ended. Start reading token
+        token_switch = 0;
+
+        if (!isHeaderWhitespace(curr)) {
+            buffer[i++] = curr;
+            continue;
+        }
+
+        //token has ended
+        buffer[i] = '\0';
+        if (numWP == 0) {    //current token: image format
+
+            if (buffer[0] != 'P' || (buffer[1] != '6' && buffer[1] != '3')) {
+                return PPM_HEADER_MAGIC;
+            }
+            *plain = buffer[1] == '3';
+        } else if (numWP == 1) {    //current token: width
+
+            long width_val;
+            int check = stringToLong(buffer, &width_val);
+            if (!check || width_val <= 0) {
+                return PPM_HEADER_WIDTH;
+            }
+            *width = (size_t) width_val;
+        } else if (numWP == 2) {    //current token: height
+            long height_val;
+            int check = stringToLong(buffer, &height_val);
+            if (!check || height_val <= 0) {
+                return PPM_HEADER_HEIGHT;
+            }
+            *height = (size_t) height_val;
+        } else {    // curent token: maximum_value
+
+            if (stringToLong(buffer, &maxval_val) != 1) {
+                return PPM_HEADER_MAXVAL;
+            }
+            if (maxval_val > PPM_MAX_MAXVAL || maxval_val <= 0) {
+                return PPM_HEADER_MAXVAL_RANGE;
+            }
+            *maxval = (unsigned) maxval_val;
+            // the single whitespace after the maximum value belongs to the header
+            break;
+        }
+
+        token_switch = 1;        // token has ended
+        i = 0;
+        numWP++;
+    }
+
+    // check for overflow: 3*width*height samples
+    size_t three_height;
+    size_t pix_mem_size;
+    if (__builtin_umull_overflow(3 * PPM_SAMPLE_BYTES(*maxval), *height, &three_height) ||
+        __builtin_umull_overflow(three_height, *width, &pix_mem_size)) {
+        return PPM_HEADER_TOO_BIG;
+    }
+    return PPM_HEADER_OK;
+}
+
+
+/**
+ * @brief Parses the header of a PPM image held in memory without printing anything.
+ *
+ * @param block The first bytes of the image.
+ * @param length Number of bytes in block.
+ * @param width Pointer where the width of the image will be stored.
+ * @param height Pointer where the height of the image will be stored.
+ * @param maxval Pointer where the maximum color value of the image will be stored.
+ * @param plain Pointer where 1 is stored for a plain image (P3) with ascii samples, 0 for P6.
+ * @param header_length Pointer where the offset of the pixel data will be stored.
+ *
+ * @return PPM_HEADER_OK if a valid P6 or P3 header was parsed, the reason
+ *         otherwise. PPM_HEADER_INCOMPLETE if block ends before the header is complete.
+ */
+
+PPMHeaderStatus scanPPMHeaderBlock(const uint8_t *block, size_t length, size_t *width, size_t *height,
+                                   unsigned *maxval, int *plain, size_t *header_length) {
+
+    HeaderSource source = {NULL, block, length, 0};
+    PPMHeaderStatus status = scanHeader(&source, width, height, maxval, plain);
+    if (status == PPM_HEADER_OK) {
+        *header_length = source.pos;
+    }
+    return status;
+}
+
+
+/**
+ * @brief Reads the header of a PPM image without printing anything.
+ *
+ * @param fp The file positioned at the start of the image.
+ * @param width Pointer where the width of the image will be stored.
+ * @param height Pointer where the height of the image will be stored.
+ * @param maxval Pointer where the maximum color value of the image will be stored.
+ * @param plain Pointer where 1 is stored for a plain image (P3) with ascii samples, 0 for P6.
+ *
+ * @return PPM_HEADER_OK if a valid P6 or P3 header was read, the reason
+ *         otherwise. On success fp is positioned at the first byte of the pixel data.
+ *
+ * The header is parsed by scanHeader() straight from the stdio buffer with
+ * getc_unlocked(), which only takes the bytes of the header out of the
+ * buffer. No byte is given back, so the file does not have to support seeking
+ * and pipes work like regular files.
+ */
+
+PPMHeaderStatus scanPPMHeader(FILE *fp, size_t *width, size_t *height, unsigned *maxval, int *plain) {
+
+    HeaderSource source = {fp, NULL, 0, 0};
+    flockfile(fp);
+    PPMHeaderStatus status = scanHeader(&source, width, height, maxval, plain);
+    funlockfile(fp);
+    return status;
+}
+
+
+/**
+ * @brief Prints the error message for an invalid header.
+ *
+ * @param status The reason returned by scanHeader(), not PPM_HEADER_OK or PPM_HEADER_INCOMPLETE.
+ * @param filename The path of the file.
+ */
+
+static void reportHeaderStatus(PPMHeaderStatus status, const char *filename) {
+    switch (status) {
+        case PPM_HEADER_CORRUPTED:
+            fprintf(stderr, "Image format corrupted\n");
+            break;
+        case PPM_HEADER_MAGIC:
+            fprintf(stderr, "Format of ppm must be P6 or P3\n");
+            break;
+        case PPM_HEADER_WIDTH:
+            fprintf(stderr, "Invalid image width\n");
+            break;
+        case PPM_HEADER_HEIGHT:
+            fprintf(stderr, "Invalid image height\n");
+            break;
+        case PPM_HEADER_MAXVAL:
+            fprintf(stderr, "Invalid max color value (error loading '%s')\n", filename);
+            break;
+        case PPM_HEADER_MAXVAL_RANGE:
+            fprintf(stderr, "Invalid maximum value\n");
+            break;
+        case PPM_HEADER_TOO_BIG:
+            fprintf(stderr, "Image too big\n");
+            break;
+        case PPM_HEADER_JPEG:
+            fprintf(stderr, "'%s' is a JPEG image, JPEG images are only supported by the in-memory conversion, "
+                            "not with --mmap, --stream, --batch, --roi, --downscale, --variant and --connect\n",
+                    filename);
+            break;
+        default:
+            break;
+    }
+}
+
+
+/**
+ * @brief Parses the header of a PPM image held in memory.
+ *
+ * @param block The first bytes of the image.
+ * @param length Number of bytes in block.
+ * @param filename The path of the file, used for error messages.
+ * @param width Pointer where the width of the image will be stored.
+ * @param height Pointer where the height of the image will be stored.
+ * @param maxval Pointer where the maximum color value of the image will be stored.
+ * @param plain Pointer where 1 is stored for a plain image (P3) with ascii samples, 0 for P6.
+ * @param header_length Pointer where the offset of the pixel data will be stored.
+ *
+ * @return 1 if a valid P6 or P3 header was parsed, 0 if the header is invalid and -1
+ *         if block ends before the header is complete.
+ *
+ * The header is parsed by scanPPMHeaderBlock(). On failure an error message
+ * is printed, an incomplete header is not reported.
+ */
+
+int parsePPMHeader(const uint8_t *block, size_t length, const char *filename, size_t *width, size_t *height,
+                   unsigned *maxval, int *plain, size_t *header_length) {
+
+    PPMHeaderStatus status = scanPPMHeaderBlock(block, length, width, height, maxval, plain, header_length);
+    if (status == PPM_HEADER_INCOMPLETE) {
+        return -1;
+    }
+    if (status != PPM_HEADER_OK) {
+        reportHeaderStatus(status, filename);
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Reads the header of a PPM image.
+ *
+ * @param fp The file positioned at the start of the image.
+ * @param filename The path of the file, used for error messages.
+ * @param width Pointer where the width of the image will be stored.
+ * @param height Pointer where the height of the image will be stored.
+ * @param maxval Pointer where the maximum color value of the image will be stored.
+ * @param plain Pointer where 1 is stored for a plain image (P3) with ascii samples, 0 for P6.
+ *
+ * @return 1 if a valid P6 or P3 header was read, 0 otherwise. On success fp is
+ *         positioned at the first byte of the pixel data.
+ *
+ * The header is parsed by scanPPMHeader(). On failure an error message is
+ * printed, fp is not closed.
+ */
+
+int readPPMHeader(FILE *fp, const char *filename, size_t *width, size_t *height, unsigned *maxval, int *plain) {
+
+    PPMHeaderStatus status = scanPPMHeader(fp, width, height, maxval, plain);
+    if (status == PPM_HEADER_INCOMPLETE) {
+        // end of file before the header is complete
+        fprintf(stderr, "Error reading file.\n");
+        return 0;
+    }
+    if (status != PPM_HEADER_OK) {
+        reportHeaderStatus(status, filename);
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Prepares the parsing of the ascii samples of a plain PPM image.
+ *
+ * @param reader The reader to be initialized.
+ * @param fp The file positioned at the first byte of the samples, see readPPMHeader().
+ * @param filename The path of the file, used for error messages, NULL if no message is printed.
+ * @param maxval Maximum color value of the image.
+ * @param kernels The kernels whose parser is used for images with a maximum value of at most 255.
+ *
+ * @return 1 on success, 0 if the memory could not be allocated.
+ */
+
+int initPlainReader(PlainReader *reader, FILE *fp, const char *filename, unsigned maxval, const Kernels *kernels) {
+    reader->fp = fp;
+    reader->filename = filename;
+    reader->maxval = maxval;
+    reader->kernels = kernels;
+    reader->pos = 0;
+    reader->length = 0;
+    reader->block = malloc(PPM_PLAIN_BLOCK);
+    if (!reader->block) {
+        if (filename) {
+            fprintf(stderr, "Unable to allocate memory for plain image\n");
+        }
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Moves the unparsed bytes to the front of the block and fills it from the file.
+ *
+ * @param reader The reader.
+ *
+ * @return The number of bytes read, 0 at the end of the file.
+ */
+
+static size_t refillPlainReader(PlainReader *reader) {
+    size_t rest = reader->length - reader->pos;
+    memmove(reader->block, reader->block + reader->pos, rest);
+    reader->pos = 0;
+    reader->length = rest + fread(reader->block + rest, 1, PPM_PLAIN_BLOCK - rest, reader->fp);
+    return reader->length - rest;
+}
+
+
+/**
+ * @brief Returns the next unparsed byte of a plain PPM image without consuming it.
+ *
+ * @param reader The reader.
+ *
+ * @return The byte, -1 at the end of the file.
+ */
+
+static int peekPlain(PlainReader *reader) {
+    if (reader->pos == reader->length && !refillPlainReader(reader)) {
+        return -1;
+    }
+    return reader->block[reader->pos];
+}
+
+
+/**
+ * @brief Parses one sample of a plain PPM image byte by byte.
+ *
+ * @param reader The reader.
+ * @param value Pointer where the sample will be stored.
+ *
+ * @return 1 on success, 0 if the file ends or the sample is invalid.
+ *
+ * Handles everything the parser of the kernels leaves out: comments between
+ * samples, samples with leading zeros or above 255 and samples at the end of
+ * a block. Errors are reported here if the reader has a filename.
+ */
+
+static int readPlainSample(PlainReader *reader, unsigned *value) {
+    int c = peekPlain(reader);
+    while (c == '#' || (c >= 0 && isHeaderWhitespace((char) c))) {
+        if (c == '#') {
+            // a comment ends at the end of the line
+            while (c >= 0 && c != '\r' && c != '\n') {
+                reader->pos++;
+                c = peekPlain(reader);
+            }
+        } else {
+            reader->pos++;
+            c = peekPlain(reader);
+        }
+    }
+    if (c < 0) {
+        if (reader->filename) {
+            fprintf(stderr, "Error loading image data from '%s'\n", reader->filename);
+        }
+        return 0;
+    }
+
+    unsigned long sample = 0;
+    int digits = 0;
+    while (c >= '0' && c <= '9') {
+        sample = 10 * sample + (unsigned) (c - '0');
+        if (sample > reader->maxval) {
+            if (reader->filename) {
+                fprintf(stderr, "Sample above the maximum value in '%s'\n", reader->filename);
+            }
+            return 0;
+        }
+        digits++;
+        reader->pos++;
+        c = peekPlain(reader);
+    }
+    if (!digits || (c >= 0 && c != '#' && !isHeaderWhitespace((char) c))) {
+        if (reader->filename) {
+            fprintf(stderr, "Invalid sample in '%s'\n", reader->filename);
+        }
+        return 0;
+    }
+    *value = (unsigned) sample;
+    return 1;
+}
+
+
+/**
+ * @brief Parses the next samples of a plain PPM image.
+ *
+ * @param reader The reader.
+ * @param samples Pointer where the samples will be stored, two bytes per sample if the maximum value is above 255.
+ * @param count Number of samples to be parsed.
+ *
+ * @return 1 on success, 0 if the file ends or a sample is invalid.
+ *
+ * The samples are stored like the ones of a P6 image, so the kernels convert
+ * both formats alike. The file is read in blocks of PPM_PLAIN_BLOCK bytes. Most
+ * samples are parsed by the parse_plain kernel, which stops in front of
+ * anything unusual and at the end of the block. The next sample is then parsed
+ * by readPlainSample(), which also refills the block.
+ */
+
+int readPlainSamples(PlainReader *reader, uint8_t *samples, size_t count) {
+    size_t done = 0;
+    while (done < count) {
+        if (reader->maxval <= 255) {
+            size_t parsed;
+            reader->pos += reader->kernels->parse_plain(reader->block + reader->pos, reader->length - reader->pos,
+                                                        (uint8_t) reader->maxval, samples + done, count - done,
+                                                        &parsed);
+            done += parsed;
+            if (done == count) {
+                break;
+            }
+        }
+
+        unsigned value;
+        if (!readPlainSample(reader, &value)) {
+            return 0;
+        }
+        if (reader->maxval > 255) {
+            samples[2 * done] = (uint8_t) (value >> 8);
+            samples[2 * done + 1] = (uint8_t) value;
+        } else {
+            samples[done] = (uint8_t) value;
+        }
+        done++;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Frees the memory of a plain reader, the file is not closed.
+ *
+ * @param reader The reader.
+ */
+
+void freePlainReader(PlainReader *reader) {
+    free(reader->block);
+    reader->block = NULL;
+}
+
+
+/**
+ * @brief Reads a PPM image from an open stream.
+ *
+ * @param fp The stream positioned at the start of the image, it is not closed.
+ * @param filename The path of the file, used for error messages.
+ *
+ * @return A pointer to a dynamically allocated PPMImage structure containing
+ *         the image data. If the image is not in the correct format, or if
+ *         there is a memory allocation failure, an error message is printed
+ *         and NULL is returned.
+ *
+ * The header is parsed by readPPMHeader(). The pixel data is stored in a buffer
+ * from buffer_alloc(), aligned for the SIMD kernels. The ascii samples of a
+ * plain image are parsed with the kernels of get_kernels() into the same layout.
+ */
+
+PPMImage *readPPMStream(FILE *fp, const char *filename) {
+
+    PPMImage *img = (PPMImage *) malloc(sizeof(PPMImage));
+    if (!img) {
+        fprintf(stderr, "Failed to allocate memeory for image\n");
+        return NULL;
+    }
+
+    int plain;
+    PHASE_BEGIN(PHASE_HEADER);
+    if (!readPPMHeader(fp, filename, &img->width, &img->height, &img->maxval, &plain)) {
+        free(img);
+        return NULL;
+    }
+    PHASE_END(PHASE_HEADER);
+
+    // overflow checked in readPPMHeader()
+    size_t three_height = 3 * PPM_SAMPLE_BYTES(img->maxval) * img->height;
+    size_t pix_mem_size = three_height * img->width;
+
+    // allocate aligned memory for rgb values
+    PoolBuffer buffer;
+    int allocated = buffer_alloc(pix_mem_size, &buffer);
+    img->data = buffer.data;
+    img->capacity = buffer.capacity;
+
+    if (!allocated) {
+        fprintf(stderr, "Unable to allocate memory for image\n");
+        free(img);
+        return NULL;
+    }
+
+    // load rgb values into img->data
+    PHASE_BEGIN(PHASE_LOAD);
+    int loaded;
+    if (plain) {
+        PlainReader reader;
+        loaded = initPlainReader(&reader, fp, filename, img->maxval, get_kernels());
+        loaded = loaded && readPlainSamples(&reader, img->data, 3 * img->height * img->width);
+        freePlainReader(&reader);
+    } else {
+        loaded = fread(img->data, three_height, img->width, fp) == img->width;
+        if (!loaded) {
+            fprintf(stderr, "Error loading image data from '%s'\n", filename);
+        }
+    }
+    if (!loaded) {
+        buffer_free(&buffer);
+        free(img);
+        return NULL;
+    }
+    PHASE_END(PHASE_LOAD);
+    return img;
+}
+
+
+/**
+ * @brief Reads a PPM image from a file.
+ *
+ * @param filename The path to the PPM file to be read.
+ *
+ * @return A pointer to a dynamically allocated PPMImage structure containing
+ *         the image data. If the file cannot be opened, is not in the correct
+ *         format, or if there is a memory allocation failure, an error message
+ *         is printed and NULL is returned.
+ *
+ * This function opens a PPM file and reads it with readPPMStream().
+ */
+
+PPMImage *readPPM(const char *filename) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        fprintf(stderr, "Unable to open file '%s'\n", filename);
+        return NULL;
+    }
+    PPMImage *img = readPPMStream(fp, filename);
+    fclose(fp);
+    return img;
+}
+
+/**
+ * @brief Writes a PGM image to a file.
+ *
+ * @param output_filename The path where the PGM file will be written.
+ * @param pixels Pointer to the array of pixels that constitute the image.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ *
+ * This function creates a PGM file and writes the image data into it.
+ * The image is written in P5 format. In case of failure to open the file for writing,
+ * the program terminates with an error message.
+ */
+int writePGM(const char *output_filename, const uint8_t *pixels, size_t width, size_t height) {
+    FILE *fp;
+
+    fp = fopen(output_filename, "wb");
+
+    if (fp == NULL) {
+        fprintf(stderr, "Unable to open file '%s' for writing\n", output_filename);
+        return 0;
+    }
+
+    fprintf(fp, "P5\n%zu %zu\n255\n", width, height);
+
+    // overflow checked already
+    PHASE_BEGIN(PHASE_WRITE);
+    fwrite(pixels, sizeof(uint8_t), width * height, fp);
+    fclose(fp);
+    PHASE_END(PHASE_WRITE);
+    return 1;
+}
+
+
+/**
+ * @brief Writes a PGM image with 16 bit samples to a file.
+ *
+ * @param output_filename The path where the PGM file will be written.
+ * @param pixels Pointer to the samples, two bytes each, most significant byte first.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param maxval The maximum value of the samples, in [256,65535].
+ *
+ * @return 1 on success, 0 if the file could not be opened.
+ *
+ * The samples are already stored in the byte order of the file and are written
+ * without conversion.
+ */
+int writePGM16(const char *output_filename, const uint8_t *pixels, size_t width, size_t height, unsigned maxval) {
+    FILE *fp = fopen(output_filename, "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "Unable to open file '%s' for writing\n", output_filename);
+        return 0;
+    }
+
+    fprintf(fp, "P5\n%zu %zu\n%u\n", width, height, maxval);
+
+    // overflow of 6 * width * height checked in parsePPMHeader()
+    PHASE_BEGIN(PHASE_WRITE);
+    fwrite(pixels, 2 * sizeof(uint8_t), width * height, fp);
+    fclose(fp);
+    PHASE_END(PHASE_WRITE);
+    return 1;
+}
+
+/**
+ * @brief Frees the memory allocated for a PPMImage structure.
+ *
+ * @param img Pointer to the PPMImage structure to be freed.
+ */
+
+void freePPM(PPMImage *img) {
+    PoolBuffer buffer = {img->data, img->capacity};
+    buffer_free(&buffer);
+    free(img);
+}
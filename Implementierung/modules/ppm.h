@@ -0,0 +1,226 @@
+#include <stdint.h>
+#include <stdio.h>
+#include "dispatch.h"
+
+#ifndef TEAM120_PPM_H
+#define TEAM120_PPM_H
+
+// maximum length of a header token including the terminating zero
+#define PPM_TOKEN_LENGTH 64
+
+// largest maximum color value, images above 255 have two bytes per sample
+#define PPM_MAX_MAXVAL 65535
+
+// bytes of a sample of an image with the given maximum color value
+#define PPM_SAMPLE_BYTES(maxval) ((maxval) > 255 ? 2 : 1)
+
+// bytes of ascii samples of a plain image read at once, see readPlainSamples()
+#define PPM_PLAIN_BLOCK (64 * 1024)
+
+typedef enum {
+    PPM_HEADER_OK = 0,
+    PPM_HEADER_INCOMPLETE,      // the data ends before the header is complete
+    PPM_HEADER_CORRUPTED,       // a token is longer than PPM_TOKEN_LENGTH - 1 characters
+    PPM_HEADER_MAGIC,           // the format is neither P6 nor P3
+    PPM_HEADER_WIDTH,           // the width is not a positive number
+    PPM_HEADER_HEIGHT,          // the height is not a positive number
+    PPM_HEADER_MAXVAL,          // the maximum value is not a number
+    PPM_HEADER_MAXVAL_RANGE,    // the maximum value is not in [1, PPM_MAX_MAXVAL]
+    PPM_HEADER_TOO_BIG,         // the size of the pixel data does not fit into size_t
+    PPM_HEADER_JPEG,            // the data starts like a JPEG image
+} PPMHeaderStatus;
+
+typedef struct {
+    size_t width, height;
+    unsigned maxval;            // samples are 16 bit big endian if above 255
+    uint8_t *data;
+    size_t capacity;            // size of the buffer behind data, see buffer_alloc()
+} PPMImage;
+
+typedef struct {
+    FILE *fp;
+    const char *filename;       // used for error messages, NULL if none are printed
+    unsigned maxval;
+    const Kernels *kernels;     // parse_plain is used for a maximum value of at most 255
+    uint8_t *block;             // PPM_PLAIN_BLOCK bytes of the file
+    size_t pos;                 // first unparsed byte in block
+    size_t length;              // number of valid bytes in block
+} PlainReader;
+
+
+/**
+ * @brief Parses the header of a PPM image held in memory without printing anything.
+ *
+ * @param block The first bytes of the image.
+ * @param length Number of bytes in block.
+ * @param width Pointer where the width of the image will be stored.
+ * @param height Pointer where the height of the image will be stored.
+ * @param maxval Pointer where the maximum color value of the image will be stored.
+ * @param plain Pointer where 1 is stored for a plain image (P3) with ascii samples, 0 for P6.
+ * @param header_length Pointer where the offset of the pixel data will be stored.
+ *
+ * @return PPM_HEADER_OK if a valid P6 or P3 header was parsed, the reason
+ *         otherwise. PPM_HEADER_INCOMPLETE if block ends before the header is complete.
+ */
+
+PPMHeaderStatus scanPPMHeaderBlock(const uint8_t *block, size_t length, size_t *width, size_t *height,
+                                   unsigned *maxval, int *plain, size_t *header_length);
+
+
+/**
+ * @brief Reads the header of a PPM image without printing anything.
+ *
+ * @param fp The file positioned at the start of the image.
+ * @param width Pointer where the width of the image will be stored.
+ * @param height Pointer where the height of the image will be stored.
+ * @param maxval Pointer where the maximum color value of the image will be stored.
+ * @param plain Pointer where 1 is stored for a plain image (P3) with ascii samples, 0 for P6.
+ *
+ * @return PPM_HEADER_OK if a valid P6 or P3 header was read, the reason
+ *         otherwise. On success fp is positioned at the first byte of the pixel data.
+ */
+
+PPMHeaderStatus scanPPMHeader(FILE *fp, size_t *width, size_t *height, unsigned *maxval, int *plain);
+
+
+/**
+ * @brief Parses the header of a PPM image held in memory.
+ *
+ * @param block The first bytes of the image.
+ * @param length Number of bytes in block.
+ * @param filename The path of the file, used for error messages.
+ * @param width Pointer where the width of the image will be stored.
+ * @param height Pointer where the height of the image will be stored.
+ * @param maxval Pointer where the maximum color value of the image will be stored.
+ * @param plain Pointer where 1 is stored for a plain image (P3) with ascii samples, 0 for P6.
+ * @param header_length Pointer where the offset of the pixel data will be stored.
+ *
+ * @return 1 if a valid P6 or P3 header was parsed, 0 if the header is invalid and -1
+ *         if block ends before the header is complete.
+ */
+
+int parsePPMHeader(const uint8_t *block, size_t length, const char *filename, size_t *width, size_t *height,
+                   unsigned *maxval, int *plain, size_t *header_length);
+
+
+/**
+ * @brief Reads the header of a PPM image.
+ *
+ * @param fp The file positioned at the start of the image.
+ * @param filename The path of the file, used for error messages.
+ * @param width Pointer where the width of the image will be stored.
+ * @param height Pointer where the height of the image will be stored.
+ * @param maxval Pointer where the maximum color value of the image will be stored.
+ * @param plain Pointer where 1 is stored for a plain image (P3) with ascii samples, 0 for P6.
+ *
+ * @return 1 if a valid P6 or P3 header was read, 0 otherwise. On success fp is
+ *         positioned at the first byte of the pixel data.
+ */
+
+int readPPMHeader(FILE *fp, const char *filename, size_t *width, size_t *height, unsigned *maxval, int *plain);
+
+
+/**
+ * @brief Prepares the parsing of the ascii samples of a plain PPM image.
+ *
+ * @param reader The reader to be initialized.
+ * @param fp The file positioned at the first byte of the samples, see readPPMHeader().
+ * @param filename The path of the file, used for error messages, NULL if no message is printed.
+ * @param maxval Maximum color value of the image.
+ * @param kernels The kernels whose parser is used for images with a maximum value of at most 255.
+ *
+ * @return 1 on success, 0 if the memory could not be allocated.
+ */
+
+int initPlainReader(PlainReader *reader, FILE *fp, const char *filename, unsigned maxval, const Kernels *kernels);
+
+
+/**
+ * @brief Parses the next samples of a plain PPM image.
+ *
+ * @param reader The reader.
+ * @param samples Pointer where the samples will be stored, two bytes per sample if the maximum value is above 255.
+ * @param count Number of samples to be parsed.
+ *
+ * @return 1 on success, 0 if the file ends or a sample is invalid.
+ */
+
+int readPlainSamples(PlainReader *reader, uint8_t *samples, size_t count);
+
+
+/**
+ * @brief Frees the memory of a plain reader, the file is not closed.
+ *
+ * @param reader The reader.
+ */
+
+void freePlainReader(PlainReader *reader);
+
+
+/**
+ * @brief Reads a PPM image from an open stream.
+ *
+ * @param fp The stream positioned at the start of the image, it is not closed.
+ * @param filename The path of the file, used for error messages.
+ *
+ * @return A pointer to a dynamically allocated PPMImage structure containing
+ *         the image data. If the image is not in the correct format, or if
+ *         there is a memory allocation failure, an error message is printed
+ *         and NULL is returned.
+ */
+
+PPMImage *readPPMStream(FILE *fp, const char *filename);
+
+
+/**
+ * @brief Reads a PPM image from a file.
+ *
+ * @param filename The path to the PPM file to be read.
+ *
+ * @return A pointer to a dynamically allocated PPMImage structure containing
+ *         the image data. If the file cannot be opened, is not in the correct
+ *         format, or if there is a memory allocation failure, an error message
+ *         is printed and NULL is returned.
+ */
+
+PPMImage *readPPM(const char *filename);
+
+
+/**
+ * @brief Writes a PGM image to a file.
+ *
+ * @param output_filename The path where the PGM file will be written.
+ * @param pixels Pointer to the array of pixels that constitute the image.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ *
+ * @return 1 on success, 0 if the file could not be opened.
+ */
+
+int writePGM(const char *output_filename, const uint8_t *pixels, size_t width, size_t height);
+
+
+/**
+ * @brief Writes a PGM image with 16 bit samples to a file.
+ *
+ * @param output_filename The path where the PGM file will be written.
+ * @param pixels Pointer to the samples, two bytes each, most significant byte first.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param maxval The maximum value of the samples, in [256,65535].
+ *
+ * @return 1 on success, 0 if the file could not be opened.
+ */
+
+int writePGM16(const char *output_filename, const uint8_t *pixels, size_t width, size_t height, unsigned maxval);
+
+
+/**
+ * @brief Frees the memory allocated for a PPMImage structure.
+ *
+ * @param img Pointer to the PPMImage structure to be freed.
+ */
+
+void freePPM(PPMImage *img);
+
+#endif
@@ -0,0 +1,329 @@
+#define _DEFAULT_SOURCE
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include "roi.h"
+#include "brightness_contrast_simd.h"
+#include "buffer_pool.h"
+#include "dispatch.h"
+#include "grey_pass.h"
+#include "histogram.h"
+#include "mapped_io.h"
+#include "ppm.h"
+#include "util.h"
+
+
+typedef struct {
+    FILE *fp;                   // the rows are read from the file if not NULL
+    const uint8_t *data;        // else the pixel data of the mapped image
+    const char *filename;
+    off_t offset;               // offset of the pixel data in the file
+    size_t width;               // width of the whole image
+    uint8_t *strip;             // buffer the rows are read into
+} RowSource;
+
+typedef struct {
+    const Kernels *kernels;
+    uint16_t coeffs[3];
+    int16_t brightness;
+    int with_histogram;
+    uint64_t histogram[256];
+    SubHistograms hist;
+    size_t counted;             // pixels counted into hist since the last merge
+} RegionConversion;
+
+
+/**
+ * @brief Parses a region of interest given as x,y,w,h.
+ *
+ * @param str The string containing the first column, the first row, the width and the height, separated by commas.
+ * @param region Pointer where the region will be stored.
+ *
+ * @return 1 if the parsing is successful, 0 otherwise.
+ */
+
+int parseRegion(const char *str, Region *region) {
+    long values[4];
+    char extraChar;
+    int numParsed = sscanf(str, "%ld,%ld,%ld,%ld%c", &values[0], &values[1], &values[2], &values[3], &extraChar);
+
+    if (numParsed != 4 || values[0] < 0 || values[1] < 0 || values[2] <= 0 || values[3] <= 0) {
+        fprintf(stderr, "Error: Invalid format of region. Expected format: 'x,y,width,height' with a positive size\n");
+        return 0;
+    }
+    region->x = (size_t) values[0];
+    region->y = (size_t) values[1];
+    region->width = (size_t) values[2];
+    region->height = (size_t) values[3];
+    return 1;
+}
+
+
+/**
+ * @brief Returns the rgb values of some columns of consecutive rows.
+ *
+ * @param source The image.
+ * @param row The first row.
+ * @param rows Number of rows.
+ * @param x The first column.
+ * @param w Number of columns.
+ * @param stride Pointer where the distance between the rows in bytes will be stored.
+ *
+ * @return Pointer to the first pixel, NULL if the rows could not be read.
+ *
+ * The rows of a mapped image are returned in place with the stride of the
+ * image. Otherwise only the requested columns are read into the strip, whole
+ * rows with a single read.
+ */
+
+static const uint8_t *read_rows(RowSource *source, size_t row, size_t rows, size_t x, size_t w, size_t *stride) {
+    size_t row_bytes = 3 * source->width;
+    if (source->data) {
+        *stride = row_bytes;
+        return source->data + row * row_bytes + 3 * x;
+    }
+
+    *stride = 3 * w;
+    off_t start = source->offset + (off_t) (row * row_bytes + 3 * x);
+    if (w == source->width) {
+        if (fseeko(source->fp, start, SEEK_SET) || fread(source->strip, row_bytes, rows, source->fp) != rows) {
+            fprintf(stderr, "Error loading image data from '%s'\n", source->filename);
+            return NULL;
+        }
+        return source->strip;
+    }
+    for (size_t r = 0; r < rows; r++) {
+        if (fseeko(source->fp, start + (off_t) (r * row_bytes), SEEK_SET) ||
+            fread(source->strip + r * 3 * w, 3 * w, 1, source->fp) != 1) {
+            fprintf(stderr, "Error loading image data from '%s'\n", source->filename);
+            return NULL;
+        }
+    }
+    return source->strip;
+}
+
+
+/**
+ * @brief Converts consecutive pixels and counts their grey values if the contrast is adjusted.
+ *
+ * @param conversion The conversion.
+ * @param rgb Pointer to the first RGB pixel.
+ * @param n Number of pixels.
+ * @param grey Pointer where the grey values will be stored.
+ */
+
+static void convert_span(RegionConversion *conversion, const uint8_t *rgb, size_t n, uint8_t *grey) {
+    const Kernels *kernels = conversion->kernels;
+    int16_t brightness = conversion->brightness;
+
+    if (!conversion->with_histogram) {
+        kernels->grey_pass[grey_pass_index(brightness != 0, 0)](rgb, n, conversion->coeffs, brightness, NULL, grey);
+        return;
+    }
+    // merge before a 32 bit counter can overflow
+    if (n > HISTOGRAM_CHUNK - conversion->counted) {
+        histogram_merge(conversion->histogram, conversion->hist);
+        conversion->counted = 0;
+    }
+    if (n > HISTOGRAM_CHUNK) {
+        grey_pass_histogram(kernels, rgb, n, conversion->coeffs, brightness, conversion->histogram, grey);
+        return;
+    }
+    kernels->grey_pass[grey_pass_index(brightness != 0, 1)](rgb, n, conversion->coeffs, brightness,
+                                                             conversion->hist, grey);
+    conversion->counted += n;
+}
+
+
+/**
+ * @brief Advises the kernel to read the rows of a region of a mapped image ahead.
+ *
+ * @param file The mapped image.
+ * @param region The region.
+ *
+ * Read ahead is switched off for the rest of the mapping, so only the pages
+ * holding the region are read, and all of them are requested at once.
+ */
+
+static void advise_region(const MappedFile *file, const Region *region) {
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t row_bytes = 3 * file->width;
+    madvise(file->base, file->length, MADV_RANDOM);
+    for (size_t y = region->y; y < region->y + region->height; y++) {
+        size_t start = (size_t) (file->data - file->base) + y * row_bytes + 3 * region->x;
+        size_t end = start + 3 * region->width;
+        size_t first_page = start & ~(page - 1);
+        madvise(file->base + first_page, end - first_page, MADV_WILLNEED);
+    }
+}
+
+
+/**
+ * @brief Converts a region of a PPM file to a PGM file of the size of the region.
+ *
+ * @param input_filename The path to the PPM file to be read.
+ * @param output_filename The path where the PGM file will be written.
+ * @param region The region, must lie inside the image.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param region_statistics 1 to compute the statistics for the contrast over the region only,
+ *                          0 over the whole image.
+ * @param use_mmap 1 to map the input file instead of reading the rows of the region.
+ *
+ * @return 1 on success, 0 on failure.
+ *
+ * Only the rows of the region are read, with a seek to every row if the region
+ * is narrower than the image, and only its columns are converted with the
+ * kernels of version 0. A mapped image is converted in place with the stride of
+ * its rows and only the pages of the region are read from the disk. The result
+ * equals the region of the converted whole image. If the contrast is adjusted
+ * with the statistics of the whole image, every row has to be converted for
+ * the histogram, so the whole image is read; with region_statistics the
+ * statistics are taken from the grey values of the region.
+ */
+
+int brightness_contrast_roi(const char *input_filename, const char *output_filename, const Region *region, float a,
+                            float b, float c, int16_t brightness, float contrast, int region_statistics, int use_mmap) {
+
+    int with_contrast = !isnan(contrast);
+    int whole_image = with_contrast && !region_statistics;
+    RowSource source = {NULL, NULL, input_filename, 0, 0, NULL};
+    MappedFile map;
+    size_t width, height;
+
+    if (use_mmap) {
+        if (!mapPPM(input_filename, &map)) {
+            return 0;
+        }
+        source.data = map.data;
+        width = map.width;
+        height = map.height;
+    } else {
+        unsigned maxval;
+        int plain;
+        source.fp = fopen(input_filename, "rb");
+        if (!source.fp) {
+            fprintf(stderr, "Unable to open file '%s'\n", input_filename);
+            return 0;
+        }
+        if (!readPPMHeader(source.fp, input_filename, &width, &height, &maxval, &plain)) {
+            fclose(source.fp);
+            return 0;
+        }
+        if (maxval > 255 || plain) {
+            fprintf(stderr, "Only P6 images with 8 bit samples are supported with --roi\n");
+            fclose(source.fp);
+            return 0;
+        }
+        source.offset = ftello(source.fp);
+    }
+    source.width = width;
+
+    if (region->x >= width || region->width > width - region->x ||
+        region->y >= height || region->height > height - region->y) {
+        fprintf(stderr, "Region %zu,%zu,%zu,%zu is outside of the %zux%zu image\n", region->x, region->y,
+                region->width, region->height, width, height);
+        if (use_mmap) {
+            unmapFile(&map);
+        } else {
+            fclose(source.fp);
+        }
+        return 0;
+    }
+
+    // the statistics of the whole image need every pixel, otherwise only the region is converted
+    size_t x = whole_image ? 0 : region->x;
+    size_t w = whole_image ? width : region->width;
+    size_t first_row = whole_image ? 0 : region->y;
+    size_t end_row = whole_image ? height : region->y + region->height;
+    size_t strip_rows = ROI_STRIP_BYTES / (3 * w) ? ROI_STRIP_BYTES / (3 * w) : 1;
+    if (strip_rows > end_row - first_row) {
+        strip_rows = end_row - first_row;
+    }
+    if (use_mmap && whole_image) {
+        madvise(map.base, map.length, MADV_SEQUENTIAL);
+    } else if (use_mmap) {
+        advise_region(&map, region);
+    }
+
+    // grey values of whole rows are converted into a strip and the region is copied out
+    PoolBuffer output_buffer = {NULL, 0}, rgb_buffer = {NULL, 0}, grey_buffer = {NULL, 0};
+    int buffers_ok = buffer_alloc(region->width * region->height, &output_buffer);
+    if (!use_mmap) {
+        buffers_ok &= buffer_alloc(3 * w * strip_rows, &rgb_buffer);
+        source.strip = rgb_buffer.data;
+    }
+    if (whole_image) {
+        buffers_ok &= buffer_alloc(w * strip_rows, &grey_buffer);
+    }
+
+    RegionConversion *conversion = calloc(1, sizeof(RegionConversion));
+    int success = buffers_ok && conversion;
+    if (!success) {
+        fprintf(stderr, "Unable to allocate memory for region\n");
+    } else {
+        conversion->kernels = get_kernels();
+        convert_coeffs_to_max256(a, b, c, conversion->coeffs);
+        conversion->brightness = brightness;
+        conversion->with_histogram = with_contrast;
+    }
+
+    uint8_t *output = output_buffer.data;
+    for (size_t row = first_row; success && row < end_row; row += strip_rows) {
+        size_t rows = end_row - row < strip_rows ? end_row - row : strip_rows;
+        size_t stride;
+        const uint8_t *rgb = read_rows(&source, row, rows, x, w, &stride);
+        if (!rgb) {
+            success = 0;
+            break;
+        }
+
+        uint8_t *grey = whole_image ? grey_buffer.data : output + (row - region->y) * w;
+        if (stride == 3 * w) {
+            convert_span(conversion, rgb, rows * w, grey);
+        } else {
+            for (size_t r = 0; r < rows; r++) {
+                convert_span(conversion, rgb + r * stride, w, grey + r * w);
+            }
+        }
+
+        // rows of the strip inside the region
+        for (size_t r = 0; whole_image && r < rows; r++) {
+            if (row + r >= region->y && row + r < region->y + region->height) {
+                memcpy(output + (row + r - region->y) * region->width, grey + r * w + region->x, region->width);
+            }
+        }
+    }
+
+    if (success && with_contrast) {
+        histogram_merge(conversion->histogram, conversion->hist);
+        uint8_t lookup[256];
+        success = build_contrast_lookup(conversion->histogram, contrast, lookup);
+        if (success) {
+            conversion->kernels->apply_lookup(output, region->width * region->height, lookup);
+        }
+    }
+    if (success) {
+        success = writePGM(output_filename, output, region->width, region->height);
+    }
+
+    free(conversion);
+    buffer_free(&output_buffer);
+    buffer_free(&rgb_buffer);
+    buffer_free(&grey_buffer);
+    if (use_mmap) {
+        unmapFile(&map);
+    } else {
+        fclose(source.fp);
+    }
+    return success;
+}
@@ -0,0 +1,49 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef TEAM120_ROI_H
+#define TEAM120_ROI_H
+
+// size of the rgb strip the rows of a region are read into and converted from at once
+#define ROI_STRIP_BYTES ((size_t) 1 << 20)
+
+typedef struct {
+    size_t x, y;                // first column and first row of the region
+    size_t width, height;
+} Region;
+
+
+/**
+ * @brief Parses a region of interest given as x,y,w,h.
+ *
+ * @param str The string containing the first column, the first row, the width and the height, separated by commas.
+ * @param region Pointer where the region will be stored.
+ *
+ * @return 1 if the parsing is successful, 0 otherwise.
+ */
+
+int parseRegion(const char *str, Region *region);
+
+
+/**
+ * @brief Converts a region of a PPM file to a PGM file of the size of the region.
+ *
+ * @param input_filename The path to the PPM file to be read.
+ * @param output_filename The path where the PGM file will be written.
+ * @param region The region, must lie inside the image.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param region_statistics 1 to compute the statistics for the contrast over the region only,
+ *                          0 over the whole image.
+ * @param use_mmap 1 to map the input file instead of reading the rows of the region.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+
+int brightness_contrast_roi(const char *input_filename, const char *output_filename, const Region *region, float a,
+                            float b, float c, int16_t brightness, float contrast, int region_statistics, int use_mmap);
+
+#endif
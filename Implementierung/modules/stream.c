@@ -0,0 +1,184 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "stream.h"
+#include "brightness_contrast_simd.h"
+#include "buffer_pool.h"
+#include "dispatch.h"
+#include "ppm.h"
+#include "util.h"
+
+
+/**
+ * @brief Converts a PPM file to a PGM file strip by strip with bounded memory.
+ *
+ * @param input_filename The path to the PPM file to be read.
+ * @param output_filename The path where the PGM file will be written.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param strip_rows Number of rows per strip, 0 to fill STREAM_STRIP_BYTES.
+ *
+ * @return 1 on success, 0 on failure.
+ *
+ * Only one strip of rgb values and one strip of grey values are held in memory,
+ * so the memory usage does not depend on the size of the image. Every strip is
+ * converted with the kernels of version 0 and written immediately. The samples
+ * of a plain image (P3) are parsed strip by strip into the rgb strip.
+ * For the contrast cases the histogram is collected while the grey values are
+ * written. Afterwards the grey values are read back from the output file, which
+ * is a third of the size of the input, and the lookup table is applied in place.
+ * Therefore the output has to be a regular file if the contrast is adjusted, a
+ * pipe or terminal is rejected before anything is written. A regular output
+ * file is removed on failure, so no complete looking image is left behind.
+ */
+
+int brightness_contrast_stream(const char *input_filename, const char *output_filename, float a, float b, float c,
+                               int16_t brightness, float contrast, size_t strip_rows) {
+
+    int with_contrast = !isnan(contrast);
+    size_t width, height;
+    unsigned maxval;
+    int plain;
+
+    FILE *in = fopen(input_filename, "rb");
+    if (!in) {
+        fprintf(stderr, "Unable to open file '%s'\n", input_filename);
+        return 0;
+    }
+    if (!readPPMHeader(in, input_filename, &width, &height, &maxval, &plain)) {
+        fclose(in);
+        return 0;
+    }
+    if (maxval > 255) {
+        fprintf(stderr, "16 bit images are not supported in stream mode\n");
+        fclose(in);
+        return 0;
+    }
+
+    // the output is read again to apply the contrast, which needs a file that can be positioned
+    struct stat st;
+    if (with_contrast && !stat(output_filename, &st) && !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "The output '%s' has to be a regular file to adjust the contrast in stream mode\n",
+                output_filename);
+        fclose(in);
+        return 0;
+    }
+    FILE *out = fopen(output_filename, with_contrast ? "w+b" : "wb");
+    if (!out) {
+        fprintf(stderr, "Unable to open file '%s' for writing\n", output_filename);
+        fclose(in);
+        return 0;
+    }
+    // only a regular file is removed on failure, never a link like /dev/stdout
+    int regular = !lstat(output_filename, &st) && S_ISREG(st.st_mode);
+    int header_length = fprintf(out, "P5\n%zu %zu\n255\n", width, height);
+
+    // 3*width*height checked for overflow in readPPMHeader()
+    size_t row_bytes = 3 * width;
+    if (!strip_rows) {
+        strip_rows = STREAM_STRIP_BYTES / row_bytes ? STREAM_STRIP_BYTES / row_bytes : 1;
+    }
+    if (strip_rows > height) {
+        strip_rows = height;
+    }
+
+    PoolBuffer rgb_buffer, grey_buffer;
+    int rgb_ok = buffer_alloc(row_bytes * strip_rows, &rgb_buffer);
+    int grey_ok = buffer_alloc(width * strip_rows, &grey_buffer);
+    uint8_t *rgb = rgb_buffer.data;
+    uint8_t *grey = grey_buffer.data;
+    const Kernels *kernels = get_kernels();
+    PlainReader reader = {NULL, NULL, 0, NULL, NULL, 0, 0};
+    if (header_length < 0 || !rgb_ok || !grey_ok ||
+        (plain && !initPlainReader(&reader, in, input_filename, maxval, kernels))) {
+        fprintf(stderr, "Unable to allocate memory for strip\n");
+        buffer_free(&rgb_buffer);
+        buffer_free(&grey_buffer);
+        freePlainReader(&reader);
+        fclose(in);
+        fclose(out);
+        if (regular) {
+            remove(output_filename);
+        }
+        return 0;
+    }
+
+    uint16_t coeffs[3];
+    convert_coeffs_to_max256(a, b, c, coeffs);
+    uint64_t histogram[256] = {0};
+    int success = 1;
+
+    // first pass: convert every strip of the input to grey
+    for (size_t row = 0; row < height && success; row += strip_rows) {
+        size_t rows = height - row < strip_rows ? height - row : strip_rows;
+
+        // the ascii samples of a strip are parsed and converted while they are in the cache
+        if (plain) {
+            if (!readPlainSamples(&reader, rgb, rows * row_bytes)) {
+                success = 0;
+                break;
+            }
+        } else if (fread(rgb, row_bytes, rows, in) != rows) {
+            fprintf(stderr, "Error loading image data from '%s'\n", input_filename);
+            success = 0;
+            break;
+        }
+
+        if (with_contrast) {
+            grey_pass_histogram(kernels, rgb, rows * width, coeffs, brightness, histogram, grey);
+        } else {
+            kernels->grey_pass[grey_pass_index(brightness != 0, 0)](rgb, rows * width, coeffs, brightness, NULL, grey);
+        }
+
+        if (fwrite(grey, width, rows, out) != rows) {
+            fprintf(stderr, "Error writing image data to '%s'\n", output_filename);
+            success = 0;
+        }
+    }
+
+    // second pass: apply the lookup table to the grey values in the output file
+    uint8_t lookup[256];
+    if (success && with_contrast && build_contrast_lookup(histogram, contrast, lookup)) {
+        // the rgb buffer holds three times as many grey values
+        size_t grey_rows = 3 * strip_rows;
+        for (size_t row = 0; row < height; row += grey_rows) {
+            size_t rows = height - row < grey_rows ? height - row : grey_rows;
+            off_t offset = (off_t) header_length + (off_t) (row * width);
+
+            if (fseeko(out, offset, SEEK_SET) || fread(rgb, width, rows, out) != rows) {
+                fprintf(stderr, "Error reading back image data from '%s'\n", output_filename);
+                success = 0;
+                break;
+            }
+            kernels->apply_lookup(rgb, rows * width, lookup);
+            if (fseeko(out, offset, SEEK_SET) || fwrite(rgb, width, rows, out) != rows) {
+                fprintf(stderr, "Error writing image data to '%s'\n", output_filename);
+                success = 0;
+                break;
+            }
+        }
+    } else if (with_contrast) {
+        success = 0;
+    }
+
+    buffer_free(&rgb_buffer);
+    buffer_free(&grey_buffer);
+    freePlainReader(&reader);
+    fclose(in);
+    if (fclose(out)) {
+        fprintf(stderr, "Error writing image data to '%s'\n", output_filename);
+        success = 0;
+    }
+    if (!success && regular) {
+        remove(output_filename);
+    }
+    return success;
+}
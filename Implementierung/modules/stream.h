@@ -0,0 +1,31 @@
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef TEAM120_STREAM_H
+#define TEAM120_STREAM_H
+
+// size of the rgb strip buffer if the number of rows per strip is not given
+#define STREAM_STRIP_BYTES ((size_t) 4 << 20)
+
+/**
+ * @brief Converts a PPM file to a PGM file strip by strip with bounded memory.
+ *
+ * @param input_filename The path to the PPM file to be read.
+ * @param output_filename The path where the PGM file will be written.
+ * @param a Coefficient for the red component in the grayscale conversion.
+ * @param b Coefficient for the green component in the grayscale conversion.
+ * @param c Coefficient for the blue component in the grayscale conversion.
+ * @param brightness Brightness adjustment value.
+ * @param contrast Contrast adjustment value, NaN if the contrast is not adjusted.
+ * @param strip_rows Number of rows per strip, 0 to fill STREAM_STRIP_BYTES.
+ *
+ * @return 1 on success, 0 on failure. A regular output file is removed on failure.
+ *
+ * The grey values are read back from the output to adjust the contrast, so it
+ * has to be a regular file then.
+ */
+
+int brightness_contrast_stream(const char *input_filename, const char *output_filename, float a, float b, float c,
+                               int16_t brightness, float contrast, size_t strip_rows);
+
+#endif
@@ -6,99 +6,6 @@
 #include <limits.h>
 #include <math.h>
 
-/**
- * @brief Prints the help message for the program.
- */
-
-void printHelp() {
-    printf("Usage:\n"
-           "  program_name input_file [options] \n\n"
-           "Options:\n"
-           "  -o <file>\t\t Specifies output file path (default: output.pgm)\n"
-           "  -V <val>\t\t Use variant <val> (integer) of the algorithm (default: 0).\n"
-           "  -B <val>\t\t Measures the runtime of the specified implementation. The optional argument <val> (integer) specifies the number of repetitions of the function call.\n"
-           "  --coeffs <a,b,c>\t Specify coefficients for grayscale conversion (default: 0.21,0.72,0.07).\n"
-           "  --brightness <val>\t Adjust brightness by <val> (integer).\n"
-           "  --contrast <val>\t Adjust contrast by <val> (integer).\n"
-           "  -h, --help\t\t Display this help and exit.\n\n"
-           "Description:\n"
-           "This program converts PPM (P6 format) images to grayscale PGM images. It allows adjustment of brightness and contrast.\n"
-           "The grayscale conversion uses the specified coefficients for the red, green, and blue channels.\n"
-           "Brightness and contrast adjustments are optional.\n"
-           "The program supports three variants of the algorithm: V0, V1, and V2.\n\n"
-           "Examples:\n"
-           "  program_name input.ppm -o output.pgm\n"
-           "  program_name input.ppm -o output.pgm --coeffs 0.3,0.59,0.11 --brightness 20 --contrast 10\n"
-           "  program_name input.ppm -o output.pgm -V 1 -B 2\n\n");
-}
-
-
-/**
- * @brief Validates the input parameters provided to the program.
- * 
- * @param V_option The version of the algorithm to use.
- * @param B_option The number of repetitions for the function call.
- * @param input_filename The name of the input file.
- * @param output_filename The name of the output file.
- * @param a The coefficient for the red component.
- * @param b The coefficient for the green component.
- * @param c The coefficient for the blue component.
- * @param brightness The brightness adjustment value.
- * @param contrast The contrast adjustment value.
- * 
- * @return 1 if all parameters are valid, 0 otherwise.
- */
-
-int MAX_VERSION = 2;
-
-int checkParams(int V_option, int B_option, char *input_filename, char *output_filename, double a, double b, double c,
-                int brightness, float contrast) {
-
-    if (brightness < -255 || brightness > 255) {
-        fprintf(stderr, "The brightness must be in [-255, 255].\n");
-        return 0;
-    }
-
-    if (!isnan(contrast)) {
-        if (contrast < -255 || contrast > 255) {
-            fprintf(stderr, "The contrast must be in [-255, 255].\n");
-            return 0;
-        }
-    }
-
-    if (a < 0 || b < 0 || c < 0) {
-        fprintf(stderr, "The coefficients must greater or equal to zero.\n");
-        return 0;
-    }
-
-    if (V_option < 0 || V_option > MAX_VERSION) {
-        fprintf(stderr, "Version %d does not exist. Choose a version from [0, %d].\n", V_option, MAX_VERSION);
-        return 0;
-    }
-
-    if (B_option < 0) {
-        fprintf(stderr, "Option -B can not be negative.\n");
-        return 0;
-    }
-
-    if (!output_filename) {
-        fprintf(stderr, "Output filename has to be set.\n");
-        return 0;
-    }
-
-    if (!input_filename) {
-        fprintf(stderr, "Input filename has to be set.\n");
-        return 0;
-    }
-
-    if (a + b + c == 0.0) {
-        fprintf(stderr, "Sum of coefficients can not be 0.\n");
-        return 0;
-    }
-
-    return 1;
-}
-
 
 /**
  * @brief Parses a string of grayscale conversion coefficients and stores them.
@@ -207,4 +114,135 @@ float sqrtHeron(float n) {
         x = (x + (n / x)) / 2;
     }
     return x;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Builds the lookup table for the contrast adjustment.
+ *
+ * @param histogram Histogram of all grey values with 256 entries.
+ * @param contrast The contrast adjustment value.
+ * @param lookup Array with 256 entries where the lookup table will be stored.
+ *
+ * @return 1 if the lookup table was built, 0 if the computation for contrast failed.
+ *
+ * Sum and sum of squares of the grey values are derived exactly from the histogram,
+ * so the table only depends on the statistics of the image and not on the order in
+ * which the grey values were processed. Every entry is kstd * i + (1 - kstd) * mean
+ * clamped to [0,255].
+ */
+
+int build_contrast_lookup(const uint64_t *histogram, float contrast, uint8_t *lookup) {
+
+    uint64_t n = 0;
+    uint64_t sum = 0;
+    uint64_t sum_sq = 0;
+    for (uint64_t v = 0; v < 256; v++) {
+        n += histogram[v];
+        sum += v * histogram[v];
+        sum_sq += v * v * histogram[v];
+    }
+    if (!n) {
+        fprintf(stderr, "computation for contrast failed\n");
+        return 0;
+    }
+
+    double mean = (double) sum / n;
+    double var = (double) sum_sq / n - mean * mean;
+    if (var < 0.0) {
+        // rounding of sum_sq / n for images with (almost) no variance
+        var = 0.0;
+    }
+
+    float kstd = 0.0;
+    if (var != 0.0) {        // if var = 0 => kstd = 0 (Aufgabenstellung)
+        kstd = contrast / sqrtHeron(var);       // k/std = k / sqrt(var)
+        if (isnan(kstd) || isinf(kstd)) {
+            fprintf(stderr, "computation for contrast failed\n");
+            return 0;
+        }
+    }
+
+    float summand = (1 - kstd) * mean;         // pre calculation of (1-kstd)*mean
+    if (isnan(summand) || isinf(summand)) {
+        fprintf(stderr, "computation for contrast failed\n");
+        return 0;
+    }
+
+    float res;
+    for (size_t i = 0; i < 256; i++) {
+        res = kstd * i + summand;   // new_val = kstd * pix + (1-kstd)*mean
+        if (res > 255) {
+            lookup[i] = 255;
+        } else if (res < 0) {
+            lookup[i] = 0;
+        } else {
+            lookup[i] = (uint8_t) res;
+        }
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Builds the lookup table for the contrast adjustment of an image with 16 bit samples.
+ *
+ * @param histogram Histogram of all grey values with maxval + 1 entries.
+ * @param maxval Maximum color value of the image.
+ * @param contrast The contrast adjustment value, scaled to maxval.
+ * @param lookup Array with maxval + 1 entries where the lookup table will be stored.
+ *
+ * @return 1 if the lookup table was built, 0 if the computation for contrast failed.
+ *
+ * The squares of 16 bit grey values overflow a 64 bit sum of squares for large
+ * images, so the variance is accumulated in double around the mean. Every entry
+ * is kstd * i + (1 - kstd) * mean clamped to [0,maxval].
+ */
+
+int build_contrast_lookup_16(const uint64_t *histogram, unsigned maxval, float contrast, uint16_t *lookup) {
+
+    uint64_t n = 0;
+    double sum = 0.0;
+    for (uint64_t v = 0; v <= maxval; v++) {
+        n += histogram[v];
+        sum += (double) v * histogram[v];
+    }
+    if (!n) {
+        fprintf(stderr, "computation for contrast failed\n");
+        return 0;
+    }
+
+    double mean = sum / n;
+    double var = 0.0;
+    for (uint64_t v = 0; v <= maxval; v++) {
+        var += (v - mean) * (v - mean) * histogram[v];
+    }
+    var /= n;
+
+    float kstd = 0.0;
+    if (var != 0.0) {        // if var = 0 => kstd = 0 (Aufgabenstellung)
+        kstd = contrast / sqrtHeron(var);       // k/std = k / sqrt(var)
+        if (isnan(kstd) || isinf(kstd)) {
+            fprintf(stderr, "computation for contrast failed\n");
+            return 0;
+        }
+    }
+
+    float summand = (1 - kstd) * mean;         // pre calculation of (1-kstd)*mean
+    if (isnan(summand) || isinf(summand)) {
+        fprintf(stderr, "computation for contrast failed\n");
+        return 0;
+    }
+
+    float res;
+    for (size_t i = 0; i <= maxval; i++) {
+        res = kstd * i + summand;   // new_val = kstd * pix + (1-kstd)*mean
+        if (res > maxval) {
+            lookup[i] = (uint16_t) maxval;
+        } else if (res < 0) {
+            lookup[i] = 0;
+        } else {
+            lookup[i] = (uint16_t) res;
+        }
+    }
+    return 1;
+}
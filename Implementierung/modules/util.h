@@ -1,42 +1,43 @@
+#include <stdint.h>
+#include <stddef.h>
+
 #ifndef TEAM120_UTIL_H
 #define TEAM120_UTIL_H
 
 
-/**
- * @brief Prints the help message for the program.
- */
+int parseAndStoreCoeffs(const char* str, float coeffs[3]);
 
-void printHelp();
+int stringToLong(char* str, long* out);
+
+int stringToInt(char* str, int* out);
+
+float sqrtHeron(float n);
 
 
 /**
- * @brief Validates the input parameters provided to the program.
- * 
- * @param V_option The version of the algorithm to use.
- * @param B_option The number of repetitions for the function call.
- * @param input_filename The name of the input file.
- * @param output_filename The name of the output file.
- * @param a The coefficient for the red component.
- * @param b The coefficient for the green component.
- * @param c The coefficient for the blue component.
- * @param brightness The brightness adjustment value.
+ * @brief Builds the lookup table for the contrast adjustment.
+ *
+ * @param histogram Histogram of all grey values with 256 entries.
  * @param contrast The contrast adjustment value.
- * 
- * @return 1 if all parameters are valid, 0 otherwise.
+ * @param lookup Array with 256 entries where the lookup table will be stored.
+ *
+ * @return 1 if the lookup table was built, 0 if the computation for contrast failed.
  */
 
-int checkParams(int V_option, int B_option,
-                char *input_filename, char *output_filename,
-                double a, double b, double c,
-                int brightness, float contrast);
+int build_contrast_lookup(const uint64_t *histogram, float contrast, uint8_t *lookup);
 
 
-int parseAndStoreCoeffs(const char* str, float coeffs[3]);
-
-int stringToLong(char* str, long* out);
-
-int stringToInt(char* str, int* out);
+/**
+ * @brief Builds the lookup table for the contrast adjustment of an image with 16 bit samples.
+ *
+ * @param histogram Histogram of all grey values with maxval + 1 entries.
+ * @param maxval Maximum color value of the image.
+ * @param contrast The contrast adjustment value, scaled to maxval.
+ * @param lookup Array with maxval + 1 entries where the lookup table will be stored.
+ *
+ * @return 1 if the lookup table was built, 0 if the computation for contrast failed.
+ */
 
-float sqrtHeron(float n);
+int build_contrast_lookup_16(const uint64_t *histogram, unsigned maxval, float contrast, uint16_t *lookup);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "variants.h"
+#include "brightness_contrast_simd.h"
+#include "buffer_pool.h"
+#include "dispatch.h"
+#include "ppm.h"
+#include "util.h"
+
+
+/**
+ * @brief Parses a variant given as colon separated fields.
+ *
+ * @param str The fields brightness=<val>, contrast=<val>, coeffs=<a>,<b>,<c> in any order,
+ *            followed by output=<file> as the last field, which takes the rest of the string.
+ * @param coeffs The coefficients used if the variant has no coeffs field.
+ * @param brightness The brightness used if the variant has no brightness field.
+ * @param contrast The contrast used if the variant has no contrast field, NaN for none.
+ * @param variant Pointer where the variant will be stored.
+ *
+ * @return 1 if the parsing is successful and the values are valid, 0 otherwise.
+ */
+
+int parseVariant(const char *str, const float *coeffs, int brightness, float contrast, Variant *variant) {
+    memcpy(variant->coeffs, coeffs, sizeof(variant->coeffs));
+    variant->brightness = brightness;
+    variant->contrast = contrast;
+    variant->output = NULL;
+
+    const char *field = str;
+    while (*field && !variant->output) {
+        if (!strncmp(field, "output=", 7)) {
+            variant->output = field + 7;
+            break;
+        }
+
+        // copy the field, so it can be parsed as a terminated string
+        size_t length = strcspn(field, ":");
+        char value[PPM_TOKEN_LENGTH];
+        const char *equals = memchr(field, '=', length);
+        size_t key_length = equals ? (size_t) (equals - field) : length;
+        size_t value_length = equals ? length - key_length - 1 : 0;
+        if (!equals || value_length >= sizeof(value)) {
+            fprintf(stderr, "Error: Invalid field '%.*s' of variant '%s'\n", (int) length, field, str);
+            return 0;
+        }
+        memcpy(value, equals + 1, value_length);
+        value[value_length] = '\0';
+
+        int parsed;
+        if (key_length == 10 && !strncmp(field, "brightness", key_length)) {
+            parsed = stringToInt(value, &variant->brightness);
+        } else if (key_length == 8 && !strncmp(field, "contrast", key_length)) {
+            int tmp_contrast;
+            parsed = stringToInt(value, &tmp_contrast);
+            variant->contrast = (float) tmp_contrast;
+        } else if (key_length == 6 && !strncmp(field, "coeffs", key_length)) {
+            parsed = parseAndStoreCoeffs(value, variant->coeffs);
+        } else {
+            parsed = 0;
+        }
+        if (!parsed) {
+            fprintf(stderr, "Error: Invalid field '%.*s' of variant '%s'\n", (int) length, field, str);
+            return 0;
+        }
+        field += length + (field[length] == ':');
+    }
+
+    if (!variant->output || !*variant->output) {
+        fprintf(stderr, "Error: Variant '%s' has no output file. Expected format: "
+                        "'brightness=10:contrast=20:coeffs=0.3,0.6,0.1:output=file.pgm'\n", str);
+        return 0;
+    }
+    if (variant->brightness < -255 || variant->brightness > 255) {
+        fprintf(stderr, "The brightness of variant '%s' must be in [-255, 255].\n", str);
+        return 0;
+    }
+    if (!isnan(variant->contrast) && (variant->contrast < -255 || variant->contrast > 255)) {
+        fprintf(stderr, "The contrast of variant '%s' must be in [-255, 255].\n", str);
+        return 0;
+    }
+    const float *c = variant->coeffs;
+    if (c[0] < 0 || c[1] < 0 || c[2] < 0 || c[0] + c[1] + c[2] == 0.0f) {
+        fprintf(stderr, "The coefficients of variant '%s' must not be negative and must not sum up to 0.\n", str);
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Converts a PPM file into one PGM file for every variant.
+ *
+ * @param input_filename The path to the PPM file to be read.
+ * @param variants The variants with their output files.
+ * @param count Number of variants, at most VARIANTS_MAX.
+ *
+ * @return 1 on success, 0 on failure.
+ *
+ * The image is decoded once. The variants are grouped by their coefficients
+ * scaled to a sum of 256; every group runs one grey pass of version 0 without
+ * brightness, counting the histogram if a variant of the group adjusts the
+ * contrast. Each variant then only needs a lookup table of 256 entries, see
+ * build_adjust_lookup(). The tables of a group are applied in one pass over
+ * the grey values: every chunk of VARIANTS_CHUNK values is looked up for all
+ * variants while it is in the L1 cache and appended to their files, so N
+ * variants cost one decode, one grey pass per distinct coefficients and N
+ * lookup passes. The outputs are equal to separate runs of version 0.
+ */
+
+int convert_variants(const char *input_filename, const Variant *variants, size_t count) {
+
+    PPMImage *input_image = readPPM(input_filename);
+    if (!input_image) {
+        return 0;
+    }
+    if (input_image->maxval > 255) {
+        fprintf(stderr, "Only images with 8 bit samples are supported with --variant\n");
+        freePPM(input_image);
+        return 0;
+    }
+
+    size_t width = input_image->width, height = input_image->height;
+    size_t n = width * height;
+    const Kernels *kernels = get_kernels();
+
+    uint16_t coeffs[VARIANTS_MAX][3];
+    int done[VARIANTS_MAX] = {0};
+    for (size_t v = 0; v < count; v++) {
+        convert_coeffs_to_max256(variants[v].coeffs[0], variants[v].coeffs[1], variants[v].coeffs[2], coeffs[v]);
+    }
+
+    PoolBuffer grey_buffer = {NULL, 0}, chunk_buffer = {NULL, 0};
+    int success = buffer_alloc(n, &grey_buffer) && buffer_alloc(VARIANTS_CHUNK, &chunk_buffer);
+    if (!success) {
+        fprintf(stderr, "Unable to allocate memory for variants\n");
+    }
+
+    for (size_t first = 0; success && first < count; first++) {
+        if (done[first]) {
+            continue;
+        }
+
+        // the variants sharing the coefficients of the first one not converted yet
+        size_t group[VARIANTS_MAX], members = 0;
+        int with_contrast = 0;
+        for (size_t v = first; v < count; v++) {
+            if (!done[v] && !memcmp(coeffs[v], coeffs[first], sizeof(coeffs[v]))) {
+                group[members++] = v;
+                with_contrast |= !isnan(variants[v].contrast);
+                done[v] = 1;
+            }
+        }
+
+        uint64_t histogram[256] = {0};
+        if (with_contrast) {
+            grey_pass_histogram(kernels, input_image->data, n, coeffs[first], 0, histogram, grey_buffer.data);
+        } else {
+            kernels->grey_pass[grey_pass_index(0, 0)](input_image->data, n, coeffs[first], 0, NULL,
+                                                       grey_buffer.data);
+        }
+
+        uint8_t lookups[VARIANTS_MAX][256];
+        FILE *files[VARIANTS_MAX];
+        size_t opened = 0;
+        for (size_t m = 0; success && m < members; m++) {
+            const Variant *variant = &variants[group[m]];
+            if (!build_adjust_lookup(histogram, variant->brightness, variant->contrast, lookups[m])) {
+                success = 0;
+                break;
+            }
+            files[m] = fopen(variant->output, "wb");
+            if (!files[m]) {
+                fprintf(stderr, "Unable to open file '%s' for writing\n", variant->output);
+                success = 0;
+                break;
+            }
+            opened++;
+            fprintf(files[m], "P5\n%zu %zu\n255\n", width, height);
+        }
+
+        for (size_t i = 0; success && i < n; i += VARIANTS_CHUNK) {
+            size_t length = n - i < VARIANTS_CHUNK ? n - i : VARIANTS_CHUNK;
+            for (size_t m = 0; m < members; m++) {
+                memcpy(chunk_buffer.data, grey_buffer.data + i, length);
+                kernels->apply_lookup(chunk_buffer.data, length, lookups[m]);
+                if (fwrite(chunk_buffer.data, 1, length, files[m]) != length) {
+                    fprintf(stderr, "Unable to write file '%s'\n", variants[group[m]].output);
+                    success = 0;
+                    break;
+                }
+            }
+        }
+
+        for (size_t m = 0; m < opened; m++) {
+            if (fclose(files[m]) && success) {
+                fprintf(stderr, "Unable to write file '%s'\n", variants[group[m]].output);
+                success = 0;
+            }
+        }
+    }
+
+    buffer_free(&grey_buffer);
+    buffer_free(&chunk_buffer);
+    freePPM(input_image);
+    return success;
+}
@@ -0,0 +1,49 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef TEAM120_VARIANTS_H
+#define TEAM120_VARIANTS_H
+
+// maximum number of variants of one invocation, every variant keeps its output file open
+#define VARIANTS_MAX 64
+
+// grey values looked up for every variant at once, so they stay in the L1 cache
+#define VARIANTS_CHUNK ((size_t) 16 * 1024)
+
+typedef struct {
+    float coeffs[3];
+    int brightness;
+    float contrast;             // NaN if the contrast is not adjusted
+    const char *output;         // points into the string the variant was parsed from
+} Variant;
+
+
+/**
+ * @brief Parses a variant given as colon separated fields.
+ *
+ * @param str The fields brightness=<val>, contrast=<val>, coeffs=<a>,<b>,<c> in any order,
+ *            followed by output=<file> as the last field, which takes the rest of the string.
+ * @param coeffs The coefficients used if the variant has no coeffs field.
+ * @param brightness The brightness used if the variant has no brightness field.
+ * @param contrast The contrast used if the variant has no contrast field, NaN for none.
+ * @param variant Pointer where the variant will be stored.
+ *
+ * @return 1 if the parsing is successful and the values are valid, 0 otherwise.
+ */
+
+int parseVariant(const char *str, const float *coeffs, int brightness, float contrast, Variant *variant);
+
+
+/**
+ * @brief Converts a PPM file into one PGM file for every variant.
+ *
+ * @param input_filename The path to the PPM file to be read.
+ * @param variants The variants with their output files.
+ * @param count Number of variants, at most VARIANTS_MAX.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+
+int convert_variants(const char *input_filename, const Variant *variants, size_t count);
+
+#endif
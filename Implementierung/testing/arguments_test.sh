@@ -45,6 +45,76 @@ declare -a invalid_options=(
   "./main.out --coeffs= ./testing/in/valid/mandrill.ppm"                # Fehlende Koeffizienten
   "./main.out -V ./testing/in/valid/mandrill.ppm"                       # Fehlender Wert für Implementierungsnummer
   "./main.out --unknownoption ./testing/in/valid/mandrill.ppm"          # Unbekannte Option
+  "./main.out ./testing/in/valid/mandrill.ppm -V 5"                     # Version out of range
+  "./main.out ./testing/in/valid/mandrill.ppm -V 3 -t 0"                # Zero threads
+  "./main.out ./testing/in/valid/mandrill.ppm -V 3 -t abc"              # Non-numeric thread count
+  "./main.out ./testing/in/valid/mandrill.ppm --isa mmx"                # Unknown instruction set
+  "./main.out ./testing/in/valid/mandrill.ppm --stream=0"               # Zero rows per strip
+  "./main.out ./testing/in/valid/mandrill.ppm -V 1 --stream"            # Stream mode with version 1
+  "./main.out ./testing/in/valid/mandrill.ppm --stream --mmap"          # Stream mode with mapped files
+  "./main.out ./testing/in/valid/mandrill.ppm --stream --contrast=10 -o /dev/stdout"  # Stream mode with contrast to a terminal or pipe
+  "./main.out ./testing/in/valid/mandrill.ppm --mmap -o ./testing/in/valid/mandrill.ppm"   # Mapped output onto input
+  "./main.out ./testing/in/valid/mandrill.ppm --batch -V 2"             # Batch mode with version 2
+  "./main.out ./testing/in/valid/mandrill.ppm --batch -o output.pgm"    # Batch output neither directory nor template
+  "./main.out --batch=./testing/in/valid/missing_manifest.txt"         # Manifest does not exist
+  "./main.out ./testing/in/valid/mandrill.ppm --io-uring"              # io_uring without batch mode
+  "./main.out ./testing/in/valid/mandrill.ppm --batch --io-uring=sync"  # Unknown io_uring mode
+  "./main.out ./testing/in/valid/mandrill.ppm -B --warmup=-1"          # Negative warmup iterations
+  "./main.out ./testing/in/valid/mandrill.ppm -B --warmup=abc"          # Non-numeric warmup iterations
+  "./main.out ./testing/in/valid/deep.ppm -V 1"                         # 16 bit image with version 1
+  "./main.out ./testing/in/valid/deep.ppm -V 3"                         # 16 bit image with version 3
+  "./main.out ./testing/in/valid/deep.ppm --mmap"                       # 16 bit image with mapped files
+  "./main.out ./testing/in/valid/deep.ppm --stream"                     # 16 bit image in stream mode
+  "./main.out ./testing/in/valid/mandrill.ppm --precise -V 2"          # Precise mode with version 2
+  "./main.out ./testing/in/valid/mandrill.ppm --precise --stream"       # Precise mode in stream mode
+  "./main.out ./testing/in/valid/deep.ppm --precise"                    # Precise mode with a 16 bit image
+  "./main.out ./testing/in/valid/mandrill.ppm --nontemporal=-1"        # Negative non-temporal threshold
+  "./main.out ./testing/in/valid/mandrill.ppm --nontemporal=abc"       # Non-numeric non-temporal threshold
+  "./main.out ./testing/in/valid/mandrill.ppm --previous-contrast"     # Previous contrast without frames
+  "./main.out ./testing/in/valid/mandrill.ppm --frames -V 1"           # Frames with version 1
+  "./main.out ./testing/in/valid/mandrill.ppm --frames --mmap"         # Frames with mapped files
+  "./main.out ./testing/in/valid/deep.ppm --frames -o /dev/null"       # 16 bit frames
+  "./main.out ./testing/in/valid/small_plain.ppm --frames -o /dev/null" # Plain frames
+  "./main.out ./testing/in/valid/mandrill.ppm --sample=0"              # Sample rate zero
+  "./main.out ./testing/in/valid/mandrill.ppm --downscale 0"           # Downscale factor zero
+  "./main.out ./testing/in/valid/mandrill.ppm --downscale 257"         # Downscale factor too large
+  "./main.out ./testing/in/valid/mandrill.ppm --downscale 2 -V 1"      # Downscale with version 1
+  "./main.out ./testing/in/valid/deep.ppm --downscale 2"               # 16 bit image downscaled
+  "./main.out ./testing/in/valid/mandrill.ppm --variant brightness=3"  # Variant without output
+  "./main.out ./testing/in/valid/mandrill.ppm --variant gamma=2:output=testing/out/valid/variant.pgm"  # Unknown variant field
+  "./main.out ./testing/in/valid/mandrill.ppm --variant contrast=300:output=testing/out/valid/variant.pgm"  # Variant contrast too large
+  "./main.out ./testing/in/valid/mandrill.ppm --variant output=testing/out/valid/variant.pgm -V 1"  # Variant with version 1
+  "./main.out ./testing/in/valid/mandrill.ppm --variant output=testing/out/valid/variant.pgm -o testing/out/valid/variant.pgm"  # Variant and output file
+  "./main.out ./testing/in/valid/deep.ppm --variant output=testing/out/valid/variant.pgm"  # 16 bit image with variants
+  "./main.out --autotune -V 1"                                         # Autotuning with a fixed version
+  "./main.out --autotune ./testing/in/valid/mandrill.ppm"              # Autotuning with an input file
+  "./main.out --autotune -o testing/out/valid/autotune.pgm"           # Autotuning with an output file
+  "./main.out ./testing/in/valid/mandrill.ppm -V fast"                 # Unknown version name
+  "./main.out ./testing/in/valid/gradient.jpg --mmap"                  # JPEG image with mapped files
+  "./main.out ./testing/in/valid/gradient.jpg --stream"                # JPEG image in stream mode
+  "./main.out ./testing/in/valid/gradient.jpg --roi 0,0,1,1"          # JPEG image with a region of interest
+  "./main.out ./testing/in/valid/gradient.jpg --downscale 2"           # JPEG image in downscale mode
+  "./main.out ./testing/in/valid/gradient.jpg --variant coeffs=1,0,0"  # JPEG image with variants
+  "./main.out ./testing/in/valid/gradient.jpg --connect testing/out/valid/none.sock"  # JPEG image sent to a daemon
+  "./main.out ./testing/in/valid/gradient.jpg --batch -o testing/out/valid"  # JPEG image in batch mode
+  "./main.out ./testing/in/valid/mandrill.ppm --sample=abc"            # Non-numeric sample rate
+  "./main.out ./testing/in/valid/mandrill.ppm --sample=4 -V 3"         # Sampled statistics with version 3
+  "./main.out ./testing/in/valid/deep.ppm --sample=4 --contrast=10"    # Sampled statistics of a 16 bit image
+  "./main.out ./testing/in/valid/mandrill.ppm --roi 0,0,513,1"         # Region wider than the image
+  "./main.out ./testing/in/valid/mandrill.ppm --roi 0,512,1,1"         # Region below the image
+  "./main.out ./testing/in/valid/mandrill.ppm --roi 0,0,0,1"           # Region without pixels
+  "./main.out ./testing/in/valid/mandrill.ppm --roi 1,2,3"             # Incomplete region
+  "./main.out ./testing/in/valid/mandrill.ppm --roi-statistics"        # Region statistics without region
+  "./main.out ./testing/in/valid/mandrill.ppm --roi 0,0,8,8 -V 1"      # Region with version 1
+  "./main.out ./testing/in/valid/deep.ppm --roi 0,0,1,1"               # Region of a 16 bit image
+  "./main.out ./testing/in/valid/mandrill.ppm --gpu-threshold=-1"      # Negative GPU threshold
+  "./main.out ./testing/in/valid/mandrill.ppm --gpu-threshold=abc"     # Non-numeric GPU threshold
+  "./main.out ./testing/in/valid/deep.ppm -V 4"                         # 16 bit image with version 4
+  "./main.out --daemon ./testing/out/valid/imgconv.sock -V 2"           # Daemon with version 2
+  "./main.out ./testing/in/valid/mandrill.ppm --daemon ./testing/out/valid/imgconv.sock"   # Daemon with an input file
+  "./main.out --daemon ./testing/in/valid/mandrill.ppm"                # Daemon socket onto a regular file
+  "./main.out --daemon-metrics"                                         # Daemon metrics without --connect
+  "./main.out ./testing/in/valid/mandrill.ppm --connect ./testing/out/valid/missing.sock"  # No daemon listening
 
 )
 
@@ -0,0 +1,80 @@
+#!/bin/bash
+
+# Sweeps the image size from L1-resident to multiple GB for every version and
+# every combination of brightness and contrast adjustment.
+#
+# Variables:
+#   BENCH_SIZES     widths x heights to measure (default: L1 to 3.2 GB of rgb values)
+#   BENCH_PATTERNS  content distributions of create_ppm_image.out (default: noise)
+#   BENCH_VERSIONS  versions to measure (default: 0 1 2 3)
+#   BENCH_ISAS      kernels of versions 0 and 3 to measure, e.g. "avx2 avx2-madd" (default: widest supported)
+#   BENCH_DIR       directory for the generated images (default: bench_images)
+#   BENCH_RESULTS   file the JSON results are appended to (default: bench_results.jsonl)
+
+BENCH_SIZES=${BENCH_SIZES:-"32x32 128x128 512x512 1024x1024 4096x4096 16384x8192 32768x32768"}
+BENCH_PATTERNS=${BENCH_PATTERNS:-"noise"}
+BENCH_VERSIONS=${BENCH_VERSIONS:-"0 1 2 3"}
+BENCH_ISAS=${BENCH_ISAS:-"default"}
+BENCH_DIR=${BENCH_DIR:-bench_images}
+BENCH_RESULTS=${BENCH_RESULTS:-bench_results.jsonl}
+
+declare -a adjustments=("" "--brightness=20" "--contrast=40" "--brightness=20 --contrast=40")
+
+mkdir -p "$BENCH_DIR"
+rm -f "$BENCH_RESULTS"
+
+printf "%-12s %-12s %-20s %-32s %14s %10s %14s\n" "size" "pattern" "version" "adjustment" "Mpixel/s" "GB/s" "cycles/pixel"
+
+for size in $BENCH_SIZES; do
+  width=${size%x*}
+  height=${size#*x}
+  pixels=$((width * height))
+
+  # about 2^28 pixels per measurement, at least 3 and at most 1000 iterations
+  iterations=$(( (1 << 28) / pixels ))
+  if ((iterations < 3)); then iterations=3; fi
+  if ((iterations > 1000)); then iterations=1000; fi
+
+  for pattern in $BENCH_PATTERNS; do
+    image="$BENCH_DIR/${pattern}_${size}.ppm"
+    if [[ ! -f "$image" ]]; then
+      if ! ./create_ppm_image.out -w "$width" -h "$height" -p "$pattern" -o "$image"; then
+        echo "Skipped - Could not create $image"
+        rm -f "$image"
+        continue
+      fi
+    fi
+
+    for version in $BENCH_VERSIONS; do
+      for isa in $BENCH_ISAS; do
+        # versions 1 and 2 do not use the kernels
+        isa_option=""
+        if [[ "$isa" != "default" ]]; then
+          if [[ "$version" != "0" && "$version" != "3" ]]; then continue; fi
+          isa_option="--isa $isa"
+        fi
+
+        for adjustment in "${adjustments[@]}"; do
+          ./main.out "$image" -V "$version" $isa_option $adjustment -B"$iterations" --json -o "$BENCH_DIR/output.pgm" |
+            while IFS= read -r line; do
+              echo "$line" >> "$BENCH_RESULTS"
+              mpixels=$(echo "$line" | grep -oP '"pixels_per_second":\K[0-9.]+')
+              gbytes=$(echo "$line" | grep -oP '"bytes_per_second":\K[0-9.]+')
+              cycles=$(echo "$line" | grep -oP '"cycles_per_pixel":\K([0-9.]+|null)')
+              threads=$(echo "$line" | grep -oP '"threads":\K[0-9]+')
+              label="V${version}"
+              if [[ "$version" == "3" ]]; then label="V3/${threads}t"; fi
+              if [[ -n "$isa_option" ]]; then label="${label}/${isa}"; fi
+              awk -v size="$size" -v pattern="$pattern" -v label="$label" -v adjustment="${adjustment:-none}" \
+                -v mpixels="$mpixels" -v gbytes="$gbytes" -v cycles="$cycles" \
+                'BEGIN { printf "%-12s %-12s %-20s %-32s %14.1f %10.2f %14s\n", size, pattern, label, adjustment, mpixels / 1e6, gbytes / 1e9, cycles }'
+            done
+        done
+      done
+    done
+  done
+done
+
+rm -f "$BENCH_DIR/output.pgm"
+echo ""
+echo "Results written to $BENCH_RESULTS"
@@ -0,0 +1,85 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "../modules/daemon.h"
+#include "../modules/imgconv.h"
+
+typedef struct {
+    int segment;
+    int result;                 // result of ftruncate()
+    int error;                  // errno of ftruncate()
+} Truncation;
+
+
+/**
+ * @brief Truncates the segment 10 ms after the request was sent.
+ */
+
+static void *truncate_segment(void *arg) {
+    Truncation *truncation = arg;
+    struct timespec delay = {0, 10 * 1000 * 1000};
+    nanosleep(&delay, NULL);
+    truncation->result = ftruncate(truncation->segment, 0);
+    truncation->error = errno;
+    return NULL;
+}
+
+
+/**
+ * @brief Sends a conversion request to a daemon and truncates the segment while it is converted.
+ *
+ * Usage: daemon_truncate_client.out <socket> <width> <height> <seal>
+ *
+ * With a seal of 1, the segment is sealed against shrinking before it is sent,
+ * so the truncation has to fail and the conversion has to succeed. With 0, the
+ * daemon has to reject the unsealed segment. The program returns 0 if the
+ * daemon replied as expected.
+ */
+
+int main(int argc, char **argv) {
+
+    if (argc != 5) {
+        fprintf(stderr, "Usage: %s <socket> <width> <height> <seal>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    size_t width = strtoul(argv[2], NULL, 10), height = strtoul(argv[3], NULL, 10);
+    int seal = atoi(argv[4]);
+
+    Truncation truncation = {memfd_create("truncated", MFD_CLOEXEC | MFD_ALLOW_SEALING), 0, 0};
+    if (truncation.segment < 0 || ftruncate(truncation.segment, (off_t) (4 * width * height)) ||
+        (seal && fcntl(truncation.segment, F_ADD_SEALS, F_SEAL_SHRINK))) {
+        fprintf(stderr, "Unable to create the segment: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    int connection = daemon_connect(argv[1]);
+    if (connection < 0) {
+        return EXIT_FAILURE;
+    }
+    pthread_t thread;
+    pthread_create(&thread, NULL, truncate_segment, &truncation);
+    DaemonReply reply;
+    int replied = daemon_convert(connection, truncation.segment, width, height, &reply);
+    pthread_join(thread, NULL);
+    close(connection);
+    close(truncation.segment);
+
+    if (!replied) {
+        fprintf(stderr, "The daemon did not reply\n");
+        return EXIT_FAILURE;
+    }
+    printf("Reply: %s, truncation: %s\n", imgconv_strerror((ImgconvError) reply.status),
+           truncation.result ? strerror(truncation.error) : "done");
+    if (seal) {
+        return reply.status == IMGCONV_OK && truncation.result ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    return reply.status == IMGCONV_ERROR_DATA ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -10,7 +10,7 @@ echo ""
 echo "Tests for valid Image formats (PPM)"
 
 # Array of test image names
-declare -a images=("mandrill" "comment1" "comment2" "comment3" "comment4" "multiple" "small")
+declare -a images=("mandrill" "comment1" "comment2" "comment3" "comment4" "multiple" "small" "longComment" "deep" "deep12" "small_plain" "pixel_edge_cases_plain" "deep_plain")
 
 test_counter=1
 
@@ -35,7 +35,7 @@ echo ""
 echo ""
 echo "Tests for invalid Image formats (PPM)"
 
-declare -a images=("notEnoughPixel" "invaildFormat" "invaildComment" "negativeImageSize1" "negativeImageSize2" "missingMaxValue" "missingValues" "tooLargeMaxval" "overflow" "invalidWhiteSpace")
+declare -a images=("notEnoughPixel" "invaildFormat" "invaildComment" "negativeImageSize1" "negativeImageSize2" "missingMaxValue" "missingValues" "tooLargeMaxval" "overflow" "invalidWhiteSpace" "notEnoughPixel16" "plainAboveMaxval" "plainInvalidSample" "notEnoughPixelPlain")
 test_counter=1
 
 for image in "${images[@]}"; do
@@ -58,3 +58,47 @@ for image in "${images[@]}"; do
 done
 
 echo ""
+echo ""
+echo "Tests for invalid pixel data in stream mode, the partly written output has to be removed"
+
+declare -a images=("notEnoughPixel" "plainInvalidSample" "notEnoughPixelPlain")
+declare -a adjustments=("" " --contrast=10")
+test_counter=1
+
+for image in "${images[@]}"; do
+  for adjustment in "${adjustments[@]}"; do
+    output="./testing/out/invalid/${image}_stream.pgm"
+    err_output=$(./main.out ./testing/in/invalid/${image}.ppm --stream=1${adjustment} -o ${output} 2>&1 >/dev/null)
+    echo ""
+    if [ -n "$err_output" ] && [ ! -e "${output}" ]; then
+      echo -n "Passed - Test ${test_counter} - ${image}.ppm --stream=1${adjustment} -o ${image}_stream.pgm"
+    else
+      echo -n "Failed - Test ${test_counter} - ${image}.ppm --stream=1${adjustment} -o ${image}_stream.pgm"
+      rm -f "${output}"
+    fi
+    ((test_counter++))
+  done
+done
+
+echo ""
+echo ""
+echo "Tests for images read from a pipe, which can not seek, the output has to equal the one of the file"
+
+declare -a images=("mandrill" "longComment" "small_plain" "deep")
+test_counter=1
+
+for image in "${images[@]}"; do
+  ./main.out ./testing/in/valid/${image}.ppm -o ./testing/out/valid/${image}_file.pgm 2>/dev/null
+  err_output=$(cat ./testing/in/valid/${image}.ppm | ./main.out /dev/stdin -o ./testing/out/valid/${image}_pipe.pgm 2>&1 >/dev/null)
+  echo ""
+  if [ -z "$err_output" ] && cmp -s ./testing/out/valid/${image}_file.pgm ./testing/out/valid/${image}_pipe.pgm; then
+    echo -n "Passed - Test ${test_counter} - cat ${image}.ppm | /dev/stdin -o ${image}_pipe.pgm"
+  else
+    echo -n "Failed - Test ${test_counter} - cat ${image}.ppm | /dev/stdin -o ${image}_pipe.pgm"
+    echo "Error Output: $err_output"
+  fi
+  rm -f ./testing/out/valid/${image}_file.pgm ./testing/out/valid/${image}_pipe.pgm
+  ((test_counter++))
+done
+
+echo ""
@@ -0,0 +1,41 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../modules/imgconv.h"
+
+
+/**
+ * @brief Converts several images with one libimgconv context.
+ *
+ * Usage: imgconv_client.out <brightness> <contrast|nan> <input> <output> [<input> <output> ...]
+ *
+ * Every image is decoded, processed and encoded with the same context, so the
+ * buffers are reused. The program stops at the first error and returns its code.
+ */
+
+int main(int argc, char **argv) {
+
+    if (argc < 5 || (argc - 3) % 2) {
+        fprintf(stderr, "Usage: %s <brightness> <contrast|nan> <input> <output> [<input> <output> ...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ImgconvContext ctx;
+    ImgconvError error = imgconv_init(&ctx, 0.21484375, 0.7109375, 0.07421875, atoi(argv[1]), strtof(argv[2], NULL),
+                                      NULL);
+
+    for (int i = 3; i < argc && error == IMGCONV_OK; i += 2) {
+        error = imgconv_decode(&ctx, argv[i]);
+        if (error == IMGCONV_OK) {
+            error = imgconv_process(&ctx);
+        }
+        if (error == IMGCONV_OK) {
+            error = imgconv_encode(&ctx, argv[i + 1]);
+        }
+        if (error != IMGCONV_OK) {
+            fprintf(stderr, "%s: %s\n", argv[i], imgconv_strerror(error));
+        }
+    }
+
+    imgconv_free(&ctx);
+    return error;
+}
@@ -0,0 +1,121 @@
+#!/bin/bash
+
+make
+make lib
+gcc -o imgconv_client.out testing/imgconv_client.c libimgconv.a -std=c17 -O3 -Wall -Wextra -Wpedantic -pthread -lm
+
+echo "These tests are for libimgconv, to verify that the library converts images like version 0 and reports errors with error codes"
+echo ""
+
+declare -a images=("mandrill" "sailboat" "small" "pixel_edge_cases" "lowVariance" "comment1" "multiple" "small_plain" "pixel_edge_cases_plain")
+declare -a adjustments=("0 nan" "20 nan" "0 50" "-30 -40")
+
+test_counter=1
+
+for adjustment in "${adjustments[@]}"; do
+  read brightness contrast <<< "$adjustment"
+  options=""
+  [ "$brightness" != "0" ] && options="$options --brightness=$brightness"
+  [ "$contrast" != "nan" ] && options="$options --contrast=$contrast"
+
+  # convert all images with one context
+  args=()
+  for image in "${images[@]}"; do
+    args+=("./testing/in/valid/${image}.ppm" "./testing/out/valid/${image}_lib.pgm")
+  done
+  ./imgconv_client.out $brightness $contrast "${args[@]}"
+
+  for image in "${images[@]}"; do
+    ./main.out ./testing/in/valid/${image}.ppm -V0 $options -o ./testing/out/valid/${image}_main.pgm
+    if cmp -s ./testing/out/valid/${image}_lib.pgm ./testing/out/valid/${image}_main.pgm; then
+      echo "Passed - Test ${test_counter} - ${image}.ppm${options}"
+    else
+      echo "Failed - Test ${test_counter} - ${image}.ppm${options}"
+    fi
+    ((test_counter++))
+  done
+done
+
+echo ""
+echo "Tests for error codes"
+
+declare -a invalid=("notEnoughPixel" "invaildFormat" "missingMaxValue" "overflow" "plainInvalidSample")
+declare -a expected=(4 3 3 3 4)
+
+for i in "${!invalid[@]}"; do
+  ./imgconv_client.out 0 nan ./testing/in/invalid/${invalid[$i]}.ppm ./testing/out/invalid/${invalid[$i]}.pgm 2>/dev/null
+  code=$?
+  if [ $code -eq ${expected[$i]} ]; then
+    echo "Passed - Test ${test_counter} - ${invalid[$i]}.ppm returned error code ${code}"
+  else
+    echo "Failed - Test ${test_counter} - ${invalid[$i]}.ppm returned error code ${code}, expected ${expected[$i]}"
+  fi
+  ((test_counter++))
+done
+
+# the library only returns the error, the one line is printed by the client
+for i in "${!invalid[@]}"; do
+  lines=$(./imgconv_client.out 0 nan ./testing/in/invalid/${invalid[$i]}.ppm ./testing/out/invalid/${invalid[$i]}.pgm 2>&1 | wc -l)
+  if [ $lines -eq 1 ]; then
+    echo "Passed - Test ${test_counter} - ${invalid[$i]}.ppm printed nothing in the library"
+  else
+    echo "Failed - Test ${test_counter} - ${invalid[$i]}.ppm printed $((lines - 1)) lines in the library"
+  fi
+  ((test_counter++))
+done
+
+./imgconv_client.out 300 nan ./testing/in/valid/small.ppm ./testing/out/valid/small_lib.pgm 2>/dev/null
+code=$?
+if [ $code -eq 1 ]; then
+  echo "Passed - Test ${test_counter} - brightness 300 returned error code ${code}"
+else
+  echo "Failed - Test ${test_counter} - brightness 300 returned error code ${code}, expected 1"
+fi
+
+echo ""
+echo "Tests for the symbols exported by libimgconv.so"
+
+exported=$(nm -D --defined-only libimgconv.so | awk '$2 == "T" { print $3 }' | grep -v -E '^(imgconv_.*|pool_init|pool_destroy)$')
+if [ -z "$exported" ]; then
+  echo "Passed - Test ${test_counter} - only the imgconv API is exported"
+else
+  echo "Failed - Test ${test_counter} - exported symbols outside the imgconv API:" $exported
+fi
+((test_counter++))
+
+echo ""
+echo "Tests for segments truncated by a client of the daemon"
+
+gcc -o daemon_truncate_client.out testing/daemon_truncate_client.c libimgconv.a -std=c17 -O3 -Wall -Wextra -Wpedantic -pthread -lm
+socket="testing/out/valid/imgconv_lib.sock"
+# a socket left by a daemon that crashed would be found before the new one listens
+rm -f ${socket}
+./main.out --daemon ${socket} 2>/dev/null &
+daemon_pid=$!
+for i in {1..100}; do
+  [ -S "${socket}" ] && break
+  sleep 0.05
+done
+
+# a sealed segment can not be truncated, an unsealed one has to be rejected before it is mapped
+for seal in 1 0; do
+  ((test_counter++))
+  if ./daemon_truncate_client.out ${socket} 4000 4000 ${seal} >/dev/null && kill -0 ${daemon_pid} 2>/dev/null; then
+    echo "Passed - Test ${test_counter} - truncated segment with seal ${seal}"
+  else
+    echo "Failed - Test ${test_counter} - truncated segment with seal ${seal}"
+  fi
+done
+
+((test_counter++))
+./main.out --connect ${socket} ./testing/in/valid/small.ppm -o ./testing/out/valid/small_lib.pgm
+./main.out ./testing/in/valid/small.ppm -V0 -o ./testing/out/valid/small_main.pgm
+if cmp -s ./testing/out/valid/small_lib.pgm ./testing/out/valid/small_main.pgm; then
+  echo "Passed - Test ${test_counter} - daemon converts after truncated segments"
+else
+  echo "Failed - Test ${test_counter} - daemon converts after truncated segments"
+fi
+kill -TERM ${daemon_pid}
+wait ${daemon_pid}
+
+rm -f ./testing/out/valid/*_lib.pgm ./testing/out/valid/*_main.pgm
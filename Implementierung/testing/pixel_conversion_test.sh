@@ -1,6 +1,13 @@
 #!/bin/bash
 
-make
+# build with libjpeg if it is installed, the JPEG images are converted then
+if [ -f /usr/include/jpeglib.h ]; then
+  jpeg=1
+  make JPEG=1
+else
+  jpeg=0
+  make
+fi
 
 compare_files() {
   local file1="$1"
@@ -36,6 +43,30 @@ compare_files() {
 
 rm -f testing/out/valid/*pgm
 
+# Instruction sets known to this build and supported by the cpu, probed once with a tiny image
+declare -A isa_supported
+for isa in scalar sse4.2 sse4.2-madd avx2 avx2-madd avx512 neon; do
+  isa_supported[$isa]=1
+  if ./main.out ./testing/in/valid/small.ppm --isa ${isa} -o testing/out/valid/probe.pgm 2>&1 | grep -q "Unknown instruction set\|not supported by this cpu"; then
+    isa_supported[$isa]=0
+  fi
+done
+rm -f testing/out/valid/probe.pgm
+
+# Runs a test command, returns 1 after printing Skipped if it selects an unsupported instruction set
+# and Failed if it exits with an error
+run_test() {
+  local isa=$(echo "$1" | grep -oP -- '--isa \K[^ ]*')
+  if [[ -n "${isa}" && "${isa_supported[${isa}]}" != "1" ]]; then
+    echo "Skipped - Instruction set ${isa} is not supported"
+    return 1
+  fi
+  if ! eval "$1"; then
+    echo "Failed - The command exited with an error"
+    return 1
+  fi
+}
+
 # Array of test commands
 declare -a tests=(
   "./main.out ./testing/in/valid/small.ppm --brightness=10 --contrast=10 -o testing/out/valid/small_con10_bri10_coeffs_standard.pgm"
@@ -55,7 +86,7 @@ test_counter=1
 # Iterate over each test command
 for test_cmd in "${tests[@]}"; do
   # Iterate over each version
-  for version in {0..2}; do
+  for version in {0..4}; do
     # Append the version option to the test command
     versioned_cmd="$test_cmd -V${version}"
 
@@ -74,3 +105,434 @@ for test_cmd in "${tests[@]}"; do
     echo ""
   done
 done
+
+# Iterate over each instruction set of version 0
+for test_cmd in "${tests[@]}"; do
+  for isa in scalar sse4.2 sse4.2-madd avx2 avx2-madd avx512 neon; do
+    versioned_cmd="$test_cmd -V0 --isa ${isa}"
+
+    echo "Running Test ${test_counter}: $versioned_cmd"
+    if ! run_test "$versioned_cmd"; then
+      ((test_counter++))
+      echo ""
+      continue
+    fi
+
+    file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+
+    output_file="testing/out/valid/${file}"
+    reference_file="testing/reference/${file}"
+
+    compare_files "${output_file}" "${reference_file}" ${max_diff}
+    ((test_counter++))
+    echo ""
+  done
+done
+
+# Iterate over each instruction set of the precise version 0, which has to match version 1 exactly
+for test_cmd in "${tests[@]}"; do
+  file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+  output_file="testing/out/valid/${file}"
+  v1_file="testing/out/valid/V1_${file}"
+  eval "$test_cmd -V1" > /dev/null
+  mv "${output_file}" "${v1_file}"
+
+  for isa in scalar sse4.2 avx2 avx512 neon; do
+    versioned_cmd="$test_cmd -V0 --precise --isa ${isa}"
+
+    echo "Running Test ${test_counter}: $versioned_cmd"
+    if ! run_test "$versioned_cmd"; then
+      ((test_counter++))
+      echo ""
+      continue
+    fi
+
+    compare_files "${output_file}" "${v1_file}" 0
+    ((test_counter++))
+    echo ""
+  done
+done
+
+# Iterate over each instruction set and version 3 with the grey values written by non-temporal stores
+for test_cmd in "${tests[@]}"; do
+  for variant in "--isa scalar" "--isa sse4.2" "--isa avx2" "--isa avx512" "--isa neon" "-V3 -t 3" "--mmap"; do
+    versioned_cmd="$test_cmd --nontemporal=0 ${variant}"
+
+    echo "Running Test ${test_counter}: $versioned_cmd"
+    if ! run_test "$versioned_cmd"; then
+      ((test_counter++))
+      echo ""
+      continue
+    fi
+
+    file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+
+    output_file="testing/out/valid/${file}"
+    reference_file="testing/reference/${file}"
+
+    compare_files "${output_file}" "${reference_file}" ${max_diff}
+    ((test_counter++))
+    echo ""
+  done
+done
+
+# Iterate over each version and instruction set with the plain (P3) version of the input image
+for test_cmd in "${tests[@]}"; do
+  image=$(echo $test_cmd | grep -oP 'testing/in/valid/\K[^ .]*')
+  plain_cmd=$(echo "$test_cmd" | sed "s#in/valid/${image}.ppm#in/valid/${image}_plain.ppm#")
+  for variant in "-V0" "-V1" "-V2" "-V3" "--stream=1" "--isa scalar" "--isa sse4.2" "--isa neon"; do
+    versioned_cmd="$plain_cmd ${variant}"
+
+    echo "Running Test ${test_counter}: $versioned_cmd"
+    if ! run_test "$versioned_cmd"; then
+      ((test_counter++))
+      echo ""
+      continue
+    fi
+
+    file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+
+    output_file="testing/out/valid/${file}"
+    reference_file="testing/reference/${file}"
+
+    compare_files "${output_file}" "${reference_file}" ${max_diff}
+    ((test_counter++))
+    echo ""
+  done
+done
+
+# Iterate over each instruction set with statistics sampled from every block, which have to be exact
+for test_cmd in "${tests[@]}"; do
+  for variant in "--isa scalar" "--isa sse4.2" "--isa avx2" "--isa avx512" "--isa neon" "--mmap"; do
+    versioned_cmd="$test_cmd --sample=1 ${variant}"
+
+    echo "Running Test ${test_counter}: $versioned_cmd"
+    if ! run_test "$versioned_cmd"; then
+      ((test_counter++))
+      echo ""
+      continue
+    fi
+
+    file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+
+    output_file="testing/out/valid/${file}"
+    reference_file="testing/reference/${file}"
+
+    compare_files "${output_file}" "${reference_file}" ${max_diff}
+    ((test_counter++))
+    echo ""
+  done
+done
+
+# Iterate over each instruction set with the whole image and with a part of it as region of interest
+for test_cmd in "${tests[@]}"; do
+  image=$(echo $test_cmd | grep -oP 'testing/in/valid/\K[^ .]*')
+  file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+  reference_file="testing/reference/${file}"
+  region_file="testing/out/valid/region_${file}"
+  if [[ "$image" == "pixel_edge_cases" ]]; then
+    # the rows 3 to 6 and columns 2 to 6 of the 10x10 reference
+    region="2,3,5,4"
+    printf 'P5\n5 4\n255\n' > "${region_file}"
+    for row in 3 4 5 6; do
+      tail -c 100 "${reference_file}" | tail -c +$((row * 10 + 3)) | head -c 5 >> "${region_file}"
+    done
+  else
+    region="0,0,1,2"
+    cp "${reference_file}" "${region_file}"
+  fi
+
+  for variant in "--isa scalar" "--isa sse4.2" "--isa avx2" "--isa avx512" "--isa neon" "--mmap"; do
+    versioned_cmd="$test_cmd --roi ${region} ${variant}"
+
+    echo "Running Test ${test_counter}: $versioned_cmd"
+    if ! run_test "$versioned_cmd"; then
+      ((test_counter++))
+      echo ""
+      continue
+    fi
+
+    compare_files "testing/out/valid/${file}" "${region_file}" ${max_diff}
+    ((test_counter++))
+    echo ""
+  done
+  rm -f "${region_file}"
+done
+
+# Iterate over each instruction set with the factor 1 of the downscale mode, which has to equal version 0
+for test_cmd in "${tests[@]}"; do
+  for variant in "--isa scalar" "--isa sse4.2" "--isa avx2" "--isa avx512" "--isa neon" "--mmap"; do
+    versioned_cmd="$test_cmd --downscale 1 ${variant}"
+
+    echo "Running Test ${test_counter}: $versioned_cmd"
+    if ! run_test "$versioned_cmd"; then
+      ((test_counter++))
+      echo ""
+      continue
+    fi
+
+    file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+    compare_files "testing/out/valid/${file}" "testing/reference/${file}" ${max_diff}
+    ((test_counter++))
+    echo ""
+  done
+done
+
+# Iterate over each instruction set with blocks of 3x3 pixels, the last column and row of blocks are 1 pixel wide
+for variant in "--isa scalar" "--isa sse4.2" "--isa avx2" "--isa avx512" "--isa neon" "--mmap"; do
+  versioned_cmd="./main.out ./testing/in/valid/pixel_edge_cases.ppm --brightness=10 --downscale 3 ${variant} -o testing/out/valid/pixel_edge_cases_downscale3_bri10.pgm"
+
+  echo "Running Test ${test_counter}: $versioned_cmd"
+  if ! run_test "$versioned_cmd"; then
+    ((test_counter++))
+    echo ""
+    continue
+  fi
+
+  compare_files "testing/out/valid/pixel_edge_cases_downscale3_bri10.pgm" "testing/reference/pixel_edge_cases_downscale3_bri10.pgm" 0
+  ((test_counter++))
+  echo ""
+done
+
+# Iterate over each strip height of the stream mode
+for test_cmd in "${tests[@]}"; do
+  for stream in "--stream=1" "--stream=3" "--stream"; do
+    versioned_cmd="$test_cmd ${stream}"
+
+    echo "Running Test ${test_counter}: $versioned_cmd"
+    eval $versioned_cmd
+
+    file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+
+    output_file="testing/out/valid/${file}"
+    reference_file="testing/reference/${file}"
+
+    compare_files "${output_file}" "${reference_file}" ${max_diff}
+    ((test_counter++))
+    echo ""
+  done
+done
+
+# Iterate over each test command with three copies of the image as a stream of frames, the frames are equal
+# so the contrast of the previous frame gives the same result
+for test_cmd in "${tests[@]}"; do
+  image=$(echo $test_cmd | grep -oP 'testing/in/valid/\K[^ .]*')
+  if [[ "$image" != "pixel_edge_cases" ]]; then
+    continue
+  fi
+  file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+  frames_file="testing/out/valid/frames_${image}.ppm"
+  # the 14 bytes of the header and 300 bytes of pixel data, without the further bytes at the end of the file
+  head -c 314 "testing/in/valid/${image}.ppm" > "testing/out/valid/frame_${image}.ppm"
+  cat "testing/out/valid/frame_${image}.ppm" "testing/out/valid/frame_${image}.ppm" "testing/out/valid/frame_${image}.ppm" > "${frames_file}"
+  reference_file="testing/out/valid/frames_${file}"
+  cat "testing/reference/${file}" "testing/reference/${file}" "testing/reference/${file}" > "${reference_file}"
+
+  for variant in "--isa scalar" "--isa sse4.2" "--isa avx2" "--isa avx512" "--isa neon" "--previous-contrast"; do
+    frames_cmd="$(echo "$test_cmd" | sed "s#./testing/in/valid/${image}.ppm#--frames#; s#-o testing/out/valid/${file}##") ${variant}"
+
+    echo "Running Test ${test_counter}: cat ${frames_file} | ${frames_cmd} > testing/out/valid/${file}"
+    if ! run_test "cat ${frames_file} | ${frames_cmd} > testing/out/valid/${file}"; then
+      ((test_counter++))
+      echo ""
+      continue
+    fi
+
+    compare_files "testing/out/valid/${file}" "${reference_file}" ${max_diff}
+    ((test_counter++))
+    echo ""
+  done
+  rm -f "testing/out/valid/frame_${image}.ppm" "${frames_file}" "${reference_file}"
+done
+
+# Iterate over each version with memory-mapped input and output
+for test_cmd in "${tests[@]}"; do
+  for version in {0..3}; do
+    versioned_cmd="$test_cmd -V${version} --mmap"
+
+    echo "Running Test ${test_counter}: $versioned_cmd"
+    eval $versioned_cmd
+
+    file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+
+    output_file="testing/out/valid/${file}"
+    reference_file="testing/reference/${file}"
+
+    compare_files "${output_file}" "${reference_file}" ${max_diff}
+    ((test_counter++))
+    echo ""
+  done
+done
+
+# Iterate over each test command with a measured profile and with a written profile that switches between
+# version 3 and the scalar kernels with non-temporal stores by the image size, -V auto has to equal version 0
+profile_file="testing/out/valid/autotune.profile"
+echo "Running Test ${test_counter}: ./main.out --autotune -B1 --warmup=0 --profile ${profile_file}"
+if ./main.out --autotune -B1 --warmup=0 --profile "${profile_file}" > /dev/null; then
+  echo "Passed - The profile was written."
+else
+  echo "Failed - The profile could not be written."
+fi
+((test_counter++))
+echo ""
+printf '# min_pixels version kernels threads stores\n0 3 scalar 2 temporal\n50 0 scalar 1 nontemporal\n' > testing/out/valid/written.profile
+
+for profile in "${profile_file}" "testing/out/valid/written.profile"; do
+  for test_cmd in "${tests[@]}"; do
+    versioned_cmd="$test_cmd -V auto --profile ${profile}"
+
+    echo "Running Test ${test_counter}: $versioned_cmd"
+    eval $versioned_cmd
+
+    file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+
+    output_file="testing/out/valid/${file}"
+    reference_file="testing/reference/${file}"
+
+    compare_files "${output_file}" "${reference_file}" ${max_diff}
+    ((test_counter++))
+    echo ""
+  done
+done
+rm -f "${profile_file}" testing/out/valid/written.profile
+
+# Convert every image once with the options of all its test commands as variants
+for image in small pixel_edge_cases; do
+  variants_cmd="./main.out ./testing/in/valid/${image}.ppm"
+  declare -a files=()
+  for test_cmd in "${tests[@]}"; do
+    if [[ "$(echo $test_cmd | grep -oP 'testing/in/valid/\K[^ .]*')" != "$image" ]]; then
+      continue
+    fi
+    file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+    spec=$(echo $test_cmd | grep -oP -- '--\K(brightness|contrast|coeffs)=[^ ]*' | tr '\n' ':')
+    variants_cmd="${variants_cmd} --variant ${spec}output=testing/out/valid/${file}"
+    files+=("${file}")
+    rm -f "testing/out/valid/${file}"
+  done
+
+  echo "Running Test ${test_counter}: $variants_cmd"
+  eval $variants_cmd
+
+  for file in "${files[@]}"; do
+    compare_files "testing/out/valid/${file}" "testing/reference/${file}" ${max_diff}
+  done
+  unset files
+  ((test_counter++))
+  echo ""
+done
+
+# Iterate over each test command in batch mode with every I/O backend, the output name is built from a template
+for io_option in "" " --io-uring" " --io-uring=direct"; do
+  for test_cmd in "${tests[@]}"; do
+    image=$(echo $test_cmd | grep -oP 'testing/in/valid/\K[^ .]*')
+    batch_cmd="$(echo "$test_cmd" | sed "s#out/valid/${image}_#out/valid/%s_#") --batch -t 2${io_option}"
+    file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+    rm -f "testing/out/valid/${file}"
+
+    echo "Running Test ${test_counter}: $batch_cmd"
+    eval $batch_cmd
+
+    output_file="testing/out/valid/${file}"
+    reference_file="testing/reference/${file}"
+
+    compare_files "${output_file}" "${reference_file}" ${max_diff}
+    ((test_counter++))
+    echo ""
+  done
+done
+
+# Convert every image through a daemon started with the options of the test
+socket="testing/out/valid/imgconv.sock"
+for test_cmd in "${tests[@]}"; do
+  input=$(echo $test_cmd | grep -oP '\./testing/in/valid/[^ ]*')
+  file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+  options=$(echo $test_cmd | sed -e "s|^./main.out ${input}||" -e "s| -o testing/out/valid/${file}||")
+
+  ./main.out --daemon ${socket} ${options} -t 2 2>/dev/null &
+  daemon_pid=$!
+  for i in {1..100}; do
+    [ -S "${socket}" ] && break
+    sleep 0.05
+  done
+
+  versioned_cmd="./main.out --connect ${socket} ${input} -o testing/out/valid/${file}"
+  echo "Running Test ${test_counter}: $versioned_cmd (daemon started with${options})"
+  eval $versioned_cmd
+  kill -TERM ${daemon_pid}
+  wait ${daemon_pid}
+
+  compare_files "testing/out/valid/${file}" "testing/reference/${file}" ${max_diff}
+  ((test_counter++))
+  echo ""
+done
+
+# Images with 16 bit samples, only converted by version 0
+declare -a tests_16=(
+  "./main.out ./testing/in/valid/deep.ppm -o testing/out/valid/deep_con0_bri0_coeffs_standard.pgm"
+  "./main.out ./testing/in/valid/deep.ppm --brightness=-20 --pgm16 -o testing/out/valid/deep_con0_bri-20_pgm16.pgm"
+  "./main.out ./testing/in/valid/deep.ppm --brightness=10 --contrast=30 -o testing/out/valid/deep_con30_bri10_coeffs_standard.pgm"
+  "./main.out ./testing/in/valid/deep12.ppm --brightness=30 -o testing/out/valid/deep12_con0_bri30_coeffs_standard.pgm"
+  "./main.out ./testing/in/valid/deep12.ppm --brightness=10 --contrast=30 --pgm16 -o testing/out/valid/deep12_con30_bri10_pgm16.pgm"
+  "./main.out ./testing/in/valid/deep_plain.ppm --brightness=10 --contrast=30 -o testing/out/valid/deep_con30_bri10_coeffs_standard.pgm"
+)
+
+# Iterate over each instruction set of version 0 for the images with 16 bit samples
+for test_cmd in "${tests_16[@]}"; do
+  for isa in scalar sse4.2 avx2 avx512 neon; do
+    versioned_cmd="$test_cmd -V0 --isa ${isa}"
+
+    echo "Running Test ${test_counter}: $versioned_cmd"
+    if ! run_test "$versioned_cmd"; then
+      ((test_counter++))
+      echo ""
+      continue
+    fi
+
+    file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+
+    output_file="testing/out/valid/${file}"
+    reference_file="testing/reference/${file}"
+
+    compare_files "${output_file}" "${reference_file}" ${max_diff}
+    ((test_counter++))
+    echo ""
+  done
+done
+
+# JPEG images, the luma path with the weights of BT.601 and greyscale images and the rgb path otherwise,
+# only if libjpeg is installed, the program is built with make JPEG=1 then
+declare -a tests_jpeg=(
+  "./main.out ./testing/in/valid/gradient.jpg --coeffs=0.299,0.587,0.114 -o testing/out/valid/gradient_jpeg_luma.pgm"
+  "./main.out ./testing/in/valid/gradient.jpg --coeffs=0.299,0.587,0.114 --brightness=10 --contrast=15 -o testing/out/valid/gradient_jpeg_luma_con15_bri10.pgm"
+  "./main.out ./testing/in/valid/gradient.jpg -o testing/out/valid/gradient_jpeg_con0_bri0_coeffs_standard.pgm"
+  "./main.out ./testing/in/valid/gradient_grey.jpg --coeffs=0.5,0.3,0.2 --contrast=20 -o testing/out/valid/gradient_grey_jpeg_con20_coeffs_0-5_0-3_0-2.pgm"
+  "./main.out ./testing/in/valid/gradient_rgb.jpg --coeffs=0.299,0.587,0.114 -o testing/out/valid/gradient_rgb_jpeg_luma.pgm"
+)
+
+# Iterate over each instruction set of version 0 and the benchmark for the JPEG images
+if [ ${jpeg} -eq 0 ]; then
+  echo "Skipped - JPEG images are not supported, libjpeg is not installed"
+  tests_jpeg=()
+fi
+for test_cmd in "${tests_jpeg[@]}"; do
+  for variant in "--isa scalar" "--isa sse4.2" "--isa avx2" "--isa avx512" "--isa neon" "-B1"; do
+    versioned_cmd="$test_cmd ${variant}"
+
+    echo "Running Test ${test_counter}: $versioned_cmd"
+    if ! run_test "$versioned_cmd > /dev/null"; then
+      ((test_counter++))
+      echo ""
+      continue
+    fi
+
+    file=$(echo $test_cmd | grep -oP 'testing/out/valid/\K[^ ]*')
+
+    output_file="testing/out/valid/${file}"
+    reference_file="testing/reference/${file}"
+
+    compare_files "${output_file}" "${reference_file}" ${max_diff}
+    ((test_counter++))
+    echo ""
+  done
+done